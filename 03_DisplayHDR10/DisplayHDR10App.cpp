@@ -152,10 +152,7 @@ void DisplayHDR10App::Render()
     shaderParams.cameraPos = glm::vec4(cameraPos, 0.0f);
 
     auto ubo = m_uniformBuffers[imageIndex];
-    void* p;
-    vkMapMemory(m_device, ubo.memory, 0, VK_WHOLE_SIZE, 0, &p);
-    memcpy(p, &shaderParams, sizeof(ShaderParameters));
-    vkUnmapMemory(m_device, ubo.memory);
+    WriteToHostVisibleMemory(ubo, sizeof(ShaderParameters), &shaderParams);
   }
 
   auto command = m_commandBuffers[imageIndex];
@@ -273,8 +270,8 @@ bool DisplayHDR10App::OnSizeChanged(uint32_t width, uint32_t height)
   auto result = VulkanAppBase::OnSizeChanged(width, height);
   if (result)
   {
-    DestroyImage(m_depthBuffer);
-    DestroyFramebuffers(uint32_t(m_framebuffers.size()), m_framebuffers.data());
+    DestroyImageDeferred(m_depthBuffer);
+    DestroyFramebuffersDeferred(uint32_t(m_framebuffers.size()), m_framebuffers.data());
 
     // fvXobt@Đ.
     auto extent = m_swapchain->GetSurfaceExtent();
@@ -299,13 +296,8 @@ void DisplayHDR10App::PrepareTeapot()
   auto stageIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, srcMemoryProps);
   auto targetIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_DST_BIT, dstMemoryProps);
 
-  void* p;
-  vkMapMemory(m_device, stageVB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotVerticesPN, bufferSizeVB);
-  vkUnmapMemory(m_device, stageVB.memory);
-  vkMapMemory(m_device, stageIB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotIndices, bufferSizeIB);
-  vkUnmapMemory(m_device, stageIB.memory);
+  WriteToHostVisibleMemory(stageVB, bufferSizeVB, TeapotModel::TeapotVerticesPN);
+  WriteToHostVisibleMemory(stageIB, bufferSizeIB, TeapotModel::TeapotIndices);
 
   VkCommandBuffer command = CreateCommandBuffer();
   VkBufferCopy copyRegionVB{}, copyRegionIB{};
@@ -444,14 +436,13 @@ void DisplayHDR10App::CreatePipeline()
   // VF[_[̃[h.
   std::vector<VkPipelineShaderStageCreateInfo> shaderStages
   {
-    book_util::LoadShader(m_device, "shaderVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(m_device, "shaderFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+    GetShaderLibrary()->Load("shaderVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    GetShaderLibrary()->Load("shaderFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
   };
 
   auto rasterizerState = book_util::GetDefaultRasterizerState();
   auto dsState = book_util::GetDefaultDepthStencilState();
 
-  VkResult result;
   // pCvC\z.
   VkGraphicsPipelineCreateInfo pipelineCI{
     VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -470,8 +461,11 @@ void DisplayHDR10App::CreatePipeline()
     0, // subpass
     VK_NULL_HANDLE, 0, // basePipeline
   };
-  result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &m_pipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipeline Failed.");
+  GetPipelineManager()->CreateGraphicsPipelines(1, &pipelineCI, &m_pipeline);
 
-  book_util::DestroyShaderModules(m_device, shaderStages);
+  // VF[_[XVꂽ蒼.
+  GetShaderLibrary()->Watch(&m_pipeline, shaderStages, [this]() {
+    DestroyPipelineDeferred(m_pipeline);
+    CreatePipeline();
+  });
 }
\ No newline at end of file
@@ -80,10 +80,8 @@ static void WindowResizeCallback(GLFWwindow* window, int width, int height)
   pApp->OnSizeChanged(width, height);
 }
 
-int __stdcall wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
+int main(int argc, char** argv)
 {
-  UNREFERENCED_PARAMETER(hPrevInstance);
-  UNREFERENCED_PARAMETER(lpCmdLine);
   glfwInit();
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
   glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
@@ -107,14 +105,15 @@ int __stdcall wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCm
     while (glfwWindowShouldClose(window) == GLFW_FALSE)
     {
       glfwPollEvents();
+      theApp.PollShaderChanges();
       theApp.Render();
     }
     theApp.Terminate();
   }
   catch (std::runtime_error e)
   {
-    OutputDebugStringA(e.what());
-    OutputDebugStringA("\n");
+    book_util::OutputDebugMessage(e.what());
+    book_util::OutputDebugMessage("\n");
   }
   glfwTerminate();
   return 0;
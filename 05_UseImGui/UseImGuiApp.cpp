@@ -110,10 +110,10 @@ bool UseImGuiApp::OnSizeChanged(uint32_t width, uint32_t height)
   if (isResized)
   {
     // ÂfvXobt@j
-    DestroyImage(m_depthBuffer);
+    DestroyImageDeferred(m_depthBuffer);
 
     // Ât[obt@j.
-    DestroyFramebuffers(uint32_t(m_framebuffers.size()), m_framebuffers.data());
+    DestroyFramebuffersDeferred(uint32_t(m_framebuffers.size()), m_framebuffers.data());
 
     // V𑜓xł̃fvXobt@쐬.
     PrepareDepthbuffer();
@@ -221,6 +221,7 @@ void UseImGuiApp::PrepareImGui()
   info.QueueFamily = m_gfxQueueIndex;
   info.Queue = m_deviceQueue;
   info.DescriptorPool = m_descriptorPool;
+  info.PipelineCache = m_pipelineManager->GetPipelineCache();
   info.MinImageCount = m_swapchain->GetImageCount();
   info.ImageCount = m_swapchain->GetImageCount();
   ImGui_ImplVulkan_Init(&info, GetRenderPass("default"));
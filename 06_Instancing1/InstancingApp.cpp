@@ -76,37 +76,40 @@ void InstancingApp::Prepare()
 
   CreatePipeline();
 
-  // ImGui
-  IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
-  ImGui_ImplGlfw_InitForVulkan(m_window, true);
-
-  ImGui_ImplVulkan_InitInfo info{};
-  info.Instance = m_vkInstance;
-  info.PhysicalDevice = m_physicalDevice;
-  info.Device = m_device;
-  info.QueueFamily = m_gfxQueueIndex;
-  info.Queue = m_deviceQueue;
-  info.DescriptorPool = m_descriptorPool;
-  info.MinImageCount = imageCount;
-  info.ImageCount = imageCount;
-  ImGui_ImplVulkan_Init(&info, m_renderPass);
-
-  VkCommandBufferBeginInfo beginInfo{
-    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-    nullptr,
-    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-  };
-  vkBeginCommandBuffer(m_commandBuffers[0], &beginInfo);
-  ImGui_ImplVulkan_CreateFontsTexture(m_commandBuffers[0]);
-  vkEndCommandBuffer(m_commandBuffers[0]);
-  VkSubmitInfo submitInfo{
-    VK_STRUCTURE_TYPE_SUBMIT_INFO,nullptr,
-  };
-  submitInfo.pCommandBuffers = m_commandBuffers.data();
-  submitInfo.commandBufferCount = 1;
-  vkQueueSubmit(m_deviceQueue, 1, &submitInfo, VK_NULL_HANDLE);
-  vkDeviceWaitIdle(m_device);
+  if (!IsHeadless())
+  {
+    // ImGui
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui_ImplGlfw_InitForVulkan(m_window, true);
+
+    ImGui_ImplVulkan_InitInfo info{};
+    info.Instance = m_vkInstance;
+    info.PhysicalDevice = m_physicalDevice;
+    info.Device = m_device;
+    info.QueueFamily = m_gfxQueueIndex;
+    info.Queue = m_deviceQueue;
+    info.DescriptorPool = m_descriptorPool;
+    info.MinImageCount = imageCount;
+    info.ImageCount = imageCount;
+    ImGui_ImplVulkan_Init(&info, m_renderPass);
+
+    VkCommandBufferBeginInfo beginInfo{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      nullptr,
+      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    vkBeginCommandBuffer(m_commandBuffers[0], &beginInfo);
+    ImGui_ImplVulkan_CreateFontsTexture(m_commandBuffers[0]);
+    vkEndCommandBuffer(m_commandBuffers[0]);
+    VkSubmitInfo submitInfo{
+      VK_STRUCTURE_TYPE_SUBMIT_INFO,nullptr,
+    };
+    submitInfo.pCommandBuffers = m_commandBuffers.data();
+    submitInfo.commandBufferCount = 1;
+    vkQueueSubmit(m_deviceQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkDeviceWaitIdle(m_device);
+  }
 }
 
 void InstancingApp::Cleanup()
@@ -138,9 +141,12 @@ void InstancingApp::Cleanup()
   m_commandBuffers.clear();
   m_commandFences.clear();
 
-  ImGui_ImplVulkan_Shutdown();
-  ImGui_ImplGlfw_Shutdown();
-  ImGui::DestroyContext();
+  if (!IsHeadless())
+  {
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+  }
 }
 
 void InstancingApp::Render()
@@ -196,10 +202,7 @@ void InstancingApp::Render()
     );
 
     auto ubo = m_uniformBuffers[imageIndex];
-    void* p;
-    vkMapMemory(m_device, ubo.memory, 0, VK_WHOLE_SIZE, 0, &p);
-    memcpy(p, &shaderParams, sizeof(ShaderParameters));
-    vkUnmapMemory(m_device, ubo.memory);
+    WriteToHostVisibleMemory(ubo, sizeof(ShaderParameters), &shaderParams);
   }
 
   auto command = m_commandBuffers[imageIndex];
@@ -321,8 +324,8 @@ bool InstancingApp::OnSizeChanged(uint32_t width, uint32_t height)
   bool result = VulkanAppBase::OnSizeChanged(width, height);
   if (result)
   {
-    DestroyImage(m_depthBuffer);
-    DestroyFramebuffers(uint32_t(m_framebuffers.size()), m_framebuffers.data());
+    DestroyImageDeferred(m_depthBuffer);
+    DestroyFramebuffersDeferred(uint32_t(m_framebuffers.size()), m_framebuffers.data());
 
     // fvXobt@Đ.
     auto extent = m_swapchain->GetSurfaceExtent();
@@ -336,6 +339,10 @@ bool InstancingApp::OnSizeChanged(uint32_t width, uint32_t height)
 
 void InstancingApp::RenderImGui(VkCommandBuffer command)
 {
+  if (IsHeadless())
+  {
+    return;
+  }
   ImGui_ImplVulkan_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
@@ -367,13 +374,8 @@ void InstancingApp::PrepareTeapot()
   auto stageIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, srcMemoryProps);
   auto targetIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_DST_BIT, dstMemoryProps);
 
-  void* p;
-  vkMapMemory(m_device, stageVB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotVerticesPN, bufferSizeVB);
-  vkUnmapMemory(m_device, stageVB.memory);
-  vkMapMemory(m_device, stageIB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotIndices, bufferSizeIB);
-  vkUnmapMemory(m_device, stageIB.memory);
+  WriteToHostVisibleMemory(stageVB, bufferSizeVB, TeapotModel::TeapotVerticesPN);
+  WriteToHostVisibleMemory(stageIB, bufferSizeIB, TeapotModel::TeapotIndices);
 
   VkCommandBuffer command = CreateCommandBuffer();
   VkBufferCopy copyRegionVB{}, copyRegionIB{};
@@ -472,10 +474,7 @@ void InstancingApp::PrepareInstanceData()
     data[i].color = colorSet[i % _countof(colorSet)];
   }
 
-  void* p;
-  vkMapMemory(m_device, stageBuf.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, data.data(), bufferSize);
-  vkUnmapMemory(m_device, stageBuf.memory);
+  WriteToHostVisibleMemory(stageBuf, bufferSize, data.data());
 
   auto command = CreateCommandBuffer();
   VkBufferCopy copyRegion{};
@@ -552,14 +551,13 @@ void InstancingApp::CreatePipeline()
   // VF[_[̃[h.
   std::vector<VkPipelineShaderStageCreateInfo> shaderStages
   {
-    book_util::LoadShader(m_device, "shaderVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(m_device, "shaderFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+    GetShaderLibrary()->Load("shaderVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    GetShaderLibrary()->Load("shaderFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
   };
 
   auto rasterizerState = book_util::GetDefaultRasterizerState();
   auto dsState = book_util::GetDefaultDepthStencilState();
 
-  VkResult result;
   // pCvC\z.
   VkGraphicsPipelineCreateInfo pipelineCI{
     VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -578,8 +576,11 @@ void InstancingApp::CreatePipeline()
     0, // subpass
     VK_NULL_HANDLE, 0, // basePipeline
   };
-  result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &m_pipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipeline Failed.");
+  GetPipelineManager()->CreateGraphicsPipelines(1, &pipelineCI, &m_pipeline);
 
-  book_util::DestroyShaderModules(m_device, shaderStages);
+  // VF[_[XVꂽ蒼.
+  GetShaderLibrary()->Watch(&m_pipeline, shaderStages, [this]() {
+    DestroyPipelineDeferred(m_pipeline);
+    CreatePipeline();
+  });
 }
\ No newline at end of file
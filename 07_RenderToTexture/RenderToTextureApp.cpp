@@ -54,8 +54,7 @@ void RenderToTextureApp::Prepare()
 
   PrepareTeapot();
   PreparePlane();
-  CreatePipelineTeapot();
-  CreatePipelinePlane();
+  CreatePipelines();
 
 }
 
@@ -290,8 +289,8 @@ bool RenderToTextureApp::OnSizeChanged(uint32_t width, uint32_t height)
   auto result = VulkanAppBase::OnSizeChanged(width, height);
   if (result)
   {
-    DestroyImage(m_depthBuffer);
-    DestroyFramebuffers(uint32_t(m_framebuffers.size()), m_framebuffers.data());
+    DestroyImageDeferred(m_depthBuffer);
+    DestroyFramebuffersDeferred(uint32_t(m_framebuffers.size()), m_framebuffers.data());
 
     // fvXobt@Đ.
     auto extent = m_swapchain->GetSurfaceExtent();
@@ -316,13 +315,8 @@ void RenderToTextureApp::PrepareTeapot()
   auto stageIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, srcMemoryProps);
   auto targetIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_DST_BIT, dstMemoryProps);
 
-  void* p;
-  vkMapMemory(m_device, stageVB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotVerticesPN, bufferSizeVB);
-  vkUnmapMemory(m_device, stageVB.memory);
-  vkMapMemory(m_device, stageIB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotIndices, bufferSizeIB);
-  vkUnmapMemory(m_device, stageIB.memory);
+  WriteToHostVisibleMemory(stageVB, bufferSizeVB, TeapotModel::TeapotVerticesPN);
+  WriteToHostVisibleMemory(stageIB, bufferSizeIB, TeapotModel::TeapotIndices);
 
   VkCommandBuffer command = CreateCommandBuffer();
   VkBufferCopy copyRegionVB{}, copyRegionIB{};
@@ -422,13 +416,8 @@ void RenderToTextureApp::PreparePlane()
   m_plane.indexBuffer = CreateBuffer(bufferSizeIB, usageIB, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
   m_plane.vertexCount = _countof(vertices);
   m_plane.indexCount = _countof(indices);
-  void* p;
-  vkMapMemory(m_device, m_plane.vertexBuffer.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, vertices, bufferSizeVB);
-  vkUnmapMemory(m_device, m_plane.vertexBuffer.memory);
-  vkMapMemory(m_device, m_plane.indexBuffer.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, indices, bufferSizeIB);
-  vkUnmapMemory(m_device, m_plane.indexBuffer.memory);
+  WriteToHostVisibleMemory(m_plane.vertexBuffer, bufferSizeVB, vertices);
+  WriteToHostVisibleMemory(m_plane.indexBuffer, bufferSizeIB, indices);
 
   // 萔obt@̏.
   uint32_t imageCount = m_swapchain->GetImageCount();
@@ -525,7 +514,7 @@ void RenderToTextureApp::PreparePlane()
   m_layoutPlane = layout;
 }
 
-void RenderToTextureApp::CreatePipelineTeapot()
+void RenderToTextureApp::CreatePipelines(const VkPipeline* target)
 {
   // Teapot p Pipeline
   auto stride = uint32_t(sizeof(TeapotModel::Vertex));
@@ -587,15 +576,14 @@ void RenderToTextureApp::CreatePipelineTeapot()
   // VF[_[̃[h.
   std::vector<VkPipelineShaderStageCreateInfo> shaderStages
   {
-    book_util::LoadShader(m_device, "modelVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(m_device, "modelFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+    GetShaderLibrary()->Load("modelVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    GetShaderLibrary()->Load("modelFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
   };
 
   auto rasterizerState = book_util::GetDefaultRasterizerState();
   auto dsState = book_util::GetDefaultDepthStencilState();
 
   auto renderPass = GetRenderPass("render_target");
-  VkResult result;
   // pCvC\z.
   VkGraphicsPipelineCreateInfo pipelineCI{
     VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -614,49 +602,42 @@ void RenderToTextureApp::CreatePipelineTeapot()
     0, // subpass
     VK_NULL_HANDLE, 0, // basePipeline
   };
-  result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &m_teapot.pipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipeline Failed.");
-
-  book_util::DestroyShaderModules(m_device, shaderStages);
-}
 
-void RenderToTextureApp::CreatePipelinePlane()
-{
   // Plane p Pipeline
-  auto stride = uint32_t(sizeof(VertexPT));
-  VkVertexInputBindingDescription vibDesc{
+  auto stridePlane = uint32_t(sizeof(VertexPT));
+  VkVertexInputBindingDescription vibDescPlane{
       0, // binding
-      stride,
+      stridePlane,
       VK_VERTEX_INPUT_RATE_VERTEX
   };
 
-  array<VkVertexInputAttributeDescription, 2> inputAttribs{
+  array<VkVertexInputAttributeDescription, 2> inputAttribsPlane{
     {
       { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexPT, position) },
       { 1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(VertexPT, uv) },
     }
   };
-  VkPipelineVertexInputStateCreateInfo pipelineVisCI{
+  VkPipelineVertexInputStateCreateInfo pipelineVisCIPlane{
     VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
     nullptr, 0,
-    1, &vibDesc,
-    uint32_t(inputAttribs.size()), inputAttribs.data(),
+    1, &vibDescPlane,
+    uint32_t(inputAttribsPlane.size()), inputAttribsPlane.data(),
   };
 
-  auto colorBlendAttachmentState = book_util::GetOpaqueColorBlendAttachmentState();
-  VkPipelineColorBlendStateCreateInfo colorBlendStateCI{
+  auto colorBlendAttachmentStatePlane = book_util::GetOpaqueColorBlendAttachmentState();
+  VkPipelineColorBlendStateCreateInfo colorBlendStateCIPlane{
     VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
     nullptr, 0,
     VK_FALSE, VK_LOGIC_OP_CLEAR, // logicOpEnable
-    1, &colorBlendAttachmentState,
+    1, &colorBlendAttachmentStatePlane,
     { 0.0f, 0.0f, 0.0f,0.0f }
   };
-  VkPipelineInputAssemblyStateCreateInfo inputAssemblyCI{
+  VkPipelineInputAssemblyStateCreateInfo inputAssemblyCIPlane{
     VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
     nullptr, 0, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
     VK_FALSE,
   };
-  VkPipelineMultisampleStateCreateInfo multisampleCI{
+  VkPipelineMultisampleStateCreateInfo multisampleCIPlane{
     VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
     nullptr, 0,
     VK_SAMPLE_COUNT_1_BIT,
@@ -665,62 +646,84 @@ void RenderToTextureApp::CreatePipelinePlane()
     VK_FALSE, VK_FALSE,
   };
 
-  auto extent = m_swapchain->GetSurfaceExtent();
-  VkViewport viewport = book_util::GetViewportFlipped(float(extent.width), float(extent.height));
-  VkRect2D scissor{
+  auto extentPlane = m_swapchain->GetSurfaceExtent();
+  VkViewport viewportPlane = book_util::GetViewportFlipped(float(extentPlane.width), float(extentPlane.height));
+  VkRect2D scissorPlane{
     { 0, 0},
-    extent
+    extentPlane
   };
-  VkPipelineViewportStateCreateInfo viewportCI{
+  VkPipelineViewportStateCreateInfo viewportCIPlane{
     VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
     nullptr, 0,
-    1, &viewport,
-    1, &scissor,
+    1, &viewportPlane,
+    1, &scissorPlane,
   };
 
   // VF[_[̃[h.
-  std::vector<VkPipelineShaderStageCreateInfo> shaderStages
+  std::vector<VkPipelineShaderStageCreateInfo> shaderStagesPlane
   {
-    book_util::LoadShader(m_device, "planeVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(m_device, "planeFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+    GetShaderLibrary()->Load("planeVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    GetShaderLibrary()->Load("planeFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
   };
 
-  std::vector<VkDynamicState> dynamicStates{
+  std::vector<VkDynamicState> dynamicStatesPlane{
     VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_VIEWPORT
   };
-  VkPipelineDynamicStateCreateInfo pipelineDynamicStateCI{
+  VkPipelineDynamicStateCreateInfo pipelineDynamicStateCIPlane{
     VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO, nullptr, 0,
-    uint32_t(dynamicStates.size()), dynamicStates.data()
+    uint32_t(dynamicStatesPlane.size()), dynamicStatesPlane.data()
   };
 
-  auto rasterizerState = book_util::GetDefaultRasterizerState();
-  auto dsState = book_util::GetDefaultDepthStencilState();
+  auto rasterizerStatePlane = book_util::GetDefaultRasterizerState();
+  auto dsStatePlane = book_util::GetDefaultDepthStencilState();
 
-  VkRenderPass renderPass = GetRenderPass("main");
+  VkRenderPass renderPassPlane = GetRenderPass("main");
 
-  VkResult result;
   // pCvC\z.
-  VkGraphicsPipelineCreateInfo pipelineCI{
+  VkGraphicsPipelineCreateInfo pipelineCIPlane{
     VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
     nullptr, 0,
-    uint32_t(shaderStages.size()), shaderStages.data(),
-    &pipelineVisCI, &inputAssemblyCI,
+    uint32_t(shaderStagesPlane.size()), shaderStagesPlane.data(),
+    &pipelineVisCIPlane, &inputAssemblyCIPlane,
     nullptr, // Tessellation
-    &viewportCI, // ViewportState
-    &rasterizerState,
-    &multisampleCI,
-    &dsState,
-    &colorBlendStateCI,
-    &pipelineDynamicStateCI,
+    &viewportCIPlane, // ViewportState
+    &rasterizerStatePlane,
+    &multisampleCIPlane,
+    &dsStatePlane,
+    &colorBlendStateCIPlane,
+    &pipelineDynamicStateCIPlane,
     m_layoutPlane.pipeline,
-    renderPass,
+    renderPassPlane,
     0, // subpass
     VK_NULL_HANDLE, 0, // basePipeline
   };
-  result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &m_plane.pipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipeline Failed.");
 
-  book_util::DestroyShaderModules(m_device, shaderStages);
+  // 2 ̃pCvC݂͌ɈˑȂ̂ŁA܂Ƃ߂ĕɐ.
+  // target w肵ꍇ́ÃpCvĈ݂蒼.
+  VkGraphicsPipelineCreateInfo createInfos[] = { pipelineCI, pipelineCIPlane };
+  VkPipeline* pipelines[] = { &m_teapot.pipeline, &m_plane.pipeline };
+  uint32_t first = 0, count = _countof(createInfos);
+  if (target != nullptr)
+  {
+    first = (target == &m_teapot.pipeline) ? 0 : 1;
+    count = 1;
+  }
+  VkPipeline created[_countof(createInfos)];
+  GetPipelineManager()->CreateGraphicsPipelines(count, createInfos + first, created);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    *pipelines[first + i] = created[i];
+  }
+
+  // VF[_[XVꂽAgpCvĈ݂蒼.
+  GetShaderLibrary()->Watch(&m_teapot.pipeline, shaderStages, [this]() {
+    DestroyPipelineDeferred(m_teapot.pipeline);
+    CreatePipelines(&m_teapot.pipeline);
+  });
+  GetShaderLibrary()->Watch(&m_plane.pipeline, shaderStagesPlane, [this]() {
+    DestroyPipelineDeferred(m_plane.pipeline);
+    CreatePipelines(&m_plane.pipeline);
+  });
 }
 
 void RenderToTextureApp::PrepareRenderTexture()
@@ -865,10 +868,7 @@ void RenderToTextureApp::RenderToTexture(VkCommandBuffer command)
     );
 
     auto ubo = m_teapot.sceneUB[m_frameIndex];
-    void* p;
-    vkMapMemory(m_device, ubo.memory, 0, VK_WHOLE_SIZE, 0, &p);
-    memcpy(p, &shaderParams, sizeof(ShaderParameters));
-    vkUnmapMemory(m_device, ubo.memory);
+    WriteToHostVisibleMemory(ubo, sizeof(ShaderParameters), &shaderParams);
   }
 
   vkCmdBeginRenderPass(command, &rpBI, VK_SUBPASS_CONTENTS_INLINE);
@@ -924,10 +924,7 @@ void RenderToTextureApp::RenderToMain( VkCommandBuffer command )
     );
 
     auto ubo = m_plane.sceneUB[m_frameIndex];
-    void* p;
-    vkMapMemory(m_device, ubo.memory, 0, VK_WHOLE_SIZE, 0, &p);
-    memcpy(p, &shaderParams, sizeof(ShaderParameters));
-    vkUnmapMemory(m_device, ubo.memory);
+    WriteToHostVisibleMemory(ubo, sizeof(ShaderParameters), &shaderParams);
   }
   vkCmdBeginRenderPass(command, &rpBI, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -958,13 +955,11 @@ void RenderToTextureApp::DestroyModelData(ModelData& model)
 {
   for (auto& bufObj : { model.vertexBuffer, model.indexBuffer })
   {
-    vkDestroyBuffer(m_device, bufObj.buffer, nullptr);
-    vkFreeMemory(m_device, bufObj.memory, nullptr);
+    DestroyBuffer(bufObj);
   }
   for (auto& bufCB : model.sceneUB)
   {
-    vkDestroyBuffer(m_device, bufCB.buffer, nullptr);
-    vkFreeMemory(m_device, bufCB.memory, nullptr);
+    DestroyBuffer(bufCB);
   }
   vkDestroyPipeline(m_device, model.pipeline, nullptr);
   vkFreeDescriptorSets(m_device, m_descriptorPool, uint32_t(model.descriptorSet.size()), model.descriptorSet.data());
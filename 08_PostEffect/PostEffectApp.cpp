@@ -177,6 +177,11 @@ void PostEffectApp::Render()
   auto fence = m_commandFences[m_frameIndex];
   vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX);
   vkResetFences(m_device, 1, &fence);
+  if (m_isEffectDescriptorDirty[m_frameIndex])
+  {
+    WritePostEffectDescriptor(m_frameIndex);
+    m_isEffectDescriptorDirty[m_frameIndex] = false;
+  }
 
   VkCommandBufferBeginInfo commandBI{
     VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
@@ -251,8 +256,8 @@ bool PostEffectApp::OnSizeChanged(uint32_t width, uint32_t height)
   if (result)
   {
 
-    DestroyImage(m_depthBuffer);
-    DestroyFramebuffers(uint32_t(m_framebuffers.size()), m_framebuffers.data());
+    DestroyImageDeferred(m_depthBuffer);
+    DestroyFramebuffersDeferred(uint32_t(m_framebuffers.size()), m_framebuffers.data());
 
     // fvXobt@Đ.
     auto extent = m_swapchain->GetSurfaceExtent();
@@ -262,14 +267,14 @@ bool PostEffectApp::OnSizeChanged(uint32_t width, uint32_t height)
     PrepareFramebuffers();
 
     // |XgGtFNgp\[X̍폜Đ.
-    DestroyImage(m_colorTarget);
-    DestroyImage(m_depthTarget);
-    DestroyFramebuffers(1, &m_renderTextureFB);
+    DestroyImageDeferred(m_colorTarget);
+    DestroyImageDeferred(m_depthTarget);
+    DestroyFramebuffersDeferred(1, &m_renderTextureFB);
 
     PrepareRenderTexture();
 
-    // fBXNv^XV.
-    PreparePostEffectDescriptors();
+    // fBXNv^͕`撆̃t[gĂ邽߁AeC[W̃R}h̊ Render ōXV.
+    m_isEffectDescriptorDirty.assign(m_effectDescriptorSet.size(), true);
   }
   return result;
 }
@@ -287,13 +292,8 @@ void PostEffectApp::PrepareTeapot()
   auto stageIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, srcMemoryProps);
   auto targetIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_DST_BIT, dstMemoryProps);
 
-  void* p;
-  vkMapMemory(m_device, stageVB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotVerticesPN, bufferSizeVB);
-  vkUnmapMemory(m_device, stageVB.memory);
-  vkMapMemory(m_device, stageIB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotIndices, bufferSizeIB);
-  vkUnmapMemory(m_device, stageIB.memory);
+  WriteToHostVisibleMemory(stageVB, bufferSizeVB, TeapotModel::TeapotVerticesPN);
+  WriteToHostVisibleMemory(stageIB, bufferSizeIB, TeapotModel::TeapotIndices);
 
   VkCommandBuffer command = CreateCommandBuffer();
   VkBufferCopy copyRegionVB{}, copyRegionIB{};
@@ -446,10 +446,7 @@ void PostEffectApp::PrepareInstanceData()
 
   for (auto& ubo : m_instanceUniforms)
   {
-    void* p;
-    vkMapMemory(m_device, ubo.memory, 0, VK_WHOLE_SIZE, 0, &p);
-    memcpy(p, data.data(), bufferSize);
-    vkUnmapMemory(m_device, ubo.memory);
+    WriteToHostVisibleMemory(ubo, bufferSize, data.data());
   }
 }
 
@@ -505,28 +502,34 @@ void PostEffectApp::PreparePostEffectDescriptors()
 
   for (uint32_t i = 0; i < imageCount; ++i)
   {
-    VkDescriptorBufferInfo effectUbo{
-      m_effectUB[i].buffer,
-      0, VK_WHOLE_SIZE
-    };
+    WritePostEffectDescriptor(i);
+  }
+  m_isEffectDescriptorDirty.assign(imageCount, false);
+}
 
-    auto descSetSceneUB = book_util::PrepareWriteDescriptorSet(
-      m_effectDescriptorSet[i], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
-    );
-    descSetSceneUB.pBufferInfo = &effectUbo;
-    vkUpdateDescriptorSets(m_device, 1, &descSetSceneUB, 0, nullptr);
+void PostEffectApp::WritePostEffectDescriptor(uint32_t index)
+{
+  VkDescriptorBufferInfo effectUbo{
+    m_effectUB[index].buffer,
+    0, VK_WHOLE_SIZE
+  };
 
-    VkDescriptorImageInfo texInfo{
-      m_sampler,
-      m_colorTarget.view,
-      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-    };
-    auto descSetTexture = book_util::PrepareWriteDescriptorSet(
-      m_effectDescriptorSet[i], 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
-    );
-    descSetTexture.pImageInfo = &texInfo;
-    vkUpdateDescriptorSets(m_device, 1, &descSetTexture, 0, nullptr);
-  }
+  auto descSetSceneUB = book_util::PrepareWriteDescriptorSet(
+    m_effectDescriptorSet[index], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+  );
+  descSetSceneUB.pBufferInfo = &effectUbo;
+  vkUpdateDescriptorSets(m_device, 1, &descSetSceneUB, 0, nullptr);
+
+  VkDescriptorImageInfo texInfo{
+    m_sampler,
+    m_colorTarget.view,
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+  };
+  auto descSetTexture = book_util::PrepareWriteDescriptorSet(
+    m_effectDescriptorSet[index], 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+  );
+  descSetTexture.pImageInfo = &texInfo;
+  vkUpdateDescriptorSets(m_device, 1, &descSetTexture, 0, nullptr);
 }
 
 void PostEffectApp::CreatePipelineTeapot()
@@ -591,8 +594,8 @@ void PostEffectApp::CreatePipelineTeapot()
   // VF[_[̃[h.
   std::vector<VkPipelineShaderStageCreateInfo> shaderStages
   {
-    book_util::LoadShader(m_device, "modelVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(m_device, "modelFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+    GetShaderLibrary()->Load("modelVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    GetShaderLibrary()->Load("modelFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
   };
 
   std::vector<VkDynamicState> dynamicStates{
@@ -607,7 +610,6 @@ void PostEffectApp::CreatePipelineTeapot()
   auto rasterizerState = book_util::GetDefaultRasterizerState();
 
   auto renderPass = GetRenderPass("render_target");
-  VkResult result;
   // pCvC\z.
   VkGraphicsPipelineCreateInfo pipelineCI{
     VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -626,10 +628,13 @@ void PostEffectApp::CreatePipelineTeapot()
     0, // subpass
     VK_NULL_HANDLE, 0, // basePipeline
   };
-  result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &m_teapot.pipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipeline Failed.");
+  GetPipelineManager()->CreateGraphicsPipelines(1, &pipelineCI, &m_teapot.pipeline);
 
-  book_util::DestroyShaderModules(m_device, shaderStages);
+  // VF[_[XVꂽ蒼.
+  GetShaderLibrary()->Watch(&m_teapot.pipeline, shaderStages, [this]() {
+    DestroyPipelineDeferred(m_teapot.pipeline);
+    CreatePipelineTeapot();
+  });
 }
 
 void PostEffectApp::CreatePipelinePlane()
@@ -692,13 +697,13 @@ void PostEffectApp::CreatePipelinePlane()
   // VF[_[̃[h.
   std::vector<VkPipelineShaderStageCreateInfo> shaderStagesForMosaic
   {
-    book_util::LoadShader(m_device, "quadVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(m_device, "mosaicFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+    GetShaderLibrary()->Load("quadVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    GetShaderLibrary()->Load("mosaicFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
   };
   std::vector<VkPipelineShaderStageCreateInfo> shaderStagesForWater
   {
-    book_util::LoadShader(m_device, "quadVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(m_device, "waterFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+    GetShaderLibrary()->Load("quadVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    GetShaderLibrary()->Load("waterFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
   };
 
   std::vector<VkDynamicState> dynamicStates{
@@ -713,7 +718,6 @@ void PostEffectApp::CreatePipelinePlane()
   auto dsState = book_util::GetDefaultDepthStencilState();
 
   auto renderPass = GetRenderPass("main");
-  VkResult result;
   // pCvC\z.
   VkGraphicsPipelineCreateInfo pipelineCI{
     VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -732,15 +736,22 @@ void PostEffectApp::CreatePipelinePlane()
     0, // subpass
     VK_NULL_HANDLE, 0, // basePipeline
   };
-  result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &m_mosaicPipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipeline Failed.");
-
-  pipelineCI.pStages = shaderStagesForWater.data();
-  result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &m_waterPipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipeline Failed.");
-
-  book_util::DestroyShaderModules(m_device, shaderStagesForMosaic);
-  book_util::DestroyShaderModules(m_device, shaderStagesForWater);
+  // 2 ̃GtFNg̓VF[_[݂̂قȂ. ܂Ƃ߂ĕɐ.
+  VkGraphicsPipelineCreateInfo createInfos[] = { pipelineCI, pipelineCI };
+  createInfos[1].pStages = shaderStagesForWater.data();
+  VkPipeline pipelines[_countof(createInfos)];
+  GetPipelineManager()->CreateGraphicsPipelines(_countof(createInfos), createInfos, pipelines);
+  m_mosaicPipeline = pipelines[0];
+  m_waterPipeline = pipelines[1];
+
+  // ǂ炩̃VF[_[XVꂽ 2 Ƃ蒼.
+  auto shaderStages = shaderStagesForMosaic;
+  shaderStages.insert(shaderStages.end(), shaderStagesForWater.begin(), shaderStagesForWater.end());
+  GetShaderLibrary()->Watch(&m_mosaicPipeline, shaderStages, [this]() {
+    DestroyPipelineDeferred(m_mosaicPipeline);
+    DestroyPipelineDeferred(m_waterPipeline);
+    CreatePipelinePlane();
+  });
 }
 
 void PostEffectApp::PrepareRenderTexture()
@@ -883,10 +894,7 @@ void PostEffectApp::RenderToTexture(VkCommandBuffer command)
     );
 
     auto ubo = m_teapot.sceneUB[m_frameIndex];
-    void* p;
-    vkMapMemory(m_device, ubo.memory, 0, VK_WHOLE_SIZE, 0, &p);
-    memcpy(p, &shaderParams, sizeof(ShaderParameters));
-    vkUnmapMemory(m_device, ubo.memory);
+    WriteToHostVisibleMemory(ubo, sizeof(ShaderParameters), &shaderParams);
   }
 
   auto extent = m_swapchain->GetSurfaceExtent();
@@ -954,10 +962,7 @@ void PostEffectApp::RenderToMain( VkCommandBuffer command )
     m_effectParameter.screenSize = screenSize;
 
     auto ubo = m_effectUB[m_frameIndex];
-    void* p;
-    vkMapMemory(m_device, ubo.memory, 0, VK_WHOLE_SIZE, 0, &p);
-    memcpy(p, &m_effectParameter, sizeof(ShaderParameters));
-    vkUnmapMemory(m_device, ubo.memory);
+    WriteToHostVisibleMemory(ubo, sizeof(ShaderParameters), &m_effectParameter);
   }
 
   vkCmdBeginRenderPass(command, &rpBI, VK_SUBPASS_CONTENTS_INLINE);
@@ -1039,13 +1044,11 @@ void PostEffectApp::DestroyModelData(ModelData& model)
 {
   for (auto& bufObj : { model.vertexBuffer, model.indexBuffer })
   {
-    vkDestroyBuffer(m_device, bufObj.buffer, nullptr);
-    vkFreeMemory(m_device, bufObj.memory, nullptr);
+    DestroyBuffer(bufObj);
   }
   for (auto& bufCB : model.sceneUB)
   {
-    vkDestroyBuffer(m_device, bufCB.buffer, nullptr);
-    vkFreeMemory(m_device, bufCB.memory, nullptr);
+    DestroyBuffer(bufCB);
   }
   vkDestroyPipeline(m_device, model.pipeline, nullptr);
   vkFreeDescriptorSets(m_device, m_descriptorPool, uint32_t(model.descriptorSet.size()), model.descriptorSet.data());
@@ -59,6 +59,7 @@ private:
 
   void PrepareDescriptors();
   void PreparePostEffectDescriptors();
+  void WritePostEffectDescriptor(uint32_t index);
   void PrepareRenderTexture();
 
   void RenderToTexture(VkCommandBuffer command);
@@ -111,6 +112,7 @@ private:
   EffectParameters  m_effectParameter;
   std::vector<BufferObject> m_effectUB;
   std::vector<VkDescriptorSet> m_effectDescriptorSet;
+  std::vector<bool> m_isEffectDescriptorDirty; // TCYύXA܂VeNX`ݒ肵ĂȂ.
 
   EffectType m_effectType;
   VkPipeline m_mosaicPipeline, m_waterPipeline;
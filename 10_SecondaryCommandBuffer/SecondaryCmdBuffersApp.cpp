@@ -72,11 +72,9 @@ void SecondaryCmdBuffersApp::Prepare()
 
 void SecondaryCmdBuffersApp::Cleanup()
 {
-  for (auto& data : m_instanceUniforms)
-  {
-    DestroyBuffer(data);
-  }
+  DestroyBuffer(m_instanceUniform);
   DestroyModelData(m_teapot); 
+  m_frameBuffer.Cleanup(this);
 
   for (auto& layout : { m_layoutTeapot })
   {
@@ -111,7 +109,12 @@ void SecondaryCmdBuffersApp::Render()
     return;
   }
 
-  // jtH[obt@XV.
+  auto command = m_commandBuffers[imageIndex];
+  auto fence = m_commandFences[imageIndex];
+  vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX);
+  vkResetFences(m_device, 1, &fence);
+
+  // jtH[obt@XV. ̃C[W̃R}h̊҂Ă珑.
   {
     ShaderParameters shaderParams{};
     shaderParams.view = glm::lookAtRH(
@@ -124,17 +127,8 @@ void SecondaryCmdBuffersApp::Render()
       glm::radians(45.0f), float(extent.width) / float(extent.height), 0.1f, 1000.0f
     );
 
-    void* p;
-    auto ubo = m_teapot.sceneUB[imageIndex];
-    vkMapMemory(m_device, ubo.memory, 0, VK_WHOLE_SIZE, 0, &p);
-    memcpy(p, &shaderParams, sizeof(shaderParams));
-    vkUnmapMemory(m_device, ubo.memory);
+    memcpy(m_frameBuffer.GetMapped(imageIndex, m_teapot.sceneSlot), &shaderParams, sizeof(shaderParams));
   }
-  
-  auto command = m_commandBuffers[imageIndex];
-  auto fence = m_commandFences[imageIndex];
-  vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX);
-  vkResetFences(m_device, 1, &fence);
 
   array<VkClearValue, 2> clearValue = {
   {
@@ -208,8 +202,8 @@ bool SecondaryCmdBuffersApp::OnSizeChanged(uint32_t width, uint32_t height)
   if (result)
   {
 
-    DestroyImage(m_depthBuffer);
-    DestroyFramebuffers(uint32_t(m_framebuffers.size()), m_framebuffers.data());
+    DestroyImageDeferred(m_depthBuffer);
+    DestroyFramebuffersDeferred(uint32_t(m_framebuffers.size()), m_framebuffers.data());
 
     // fvXobt@Đ.
     auto extent = m_swapchain->GetSurfaceExtent();
@@ -234,13 +228,8 @@ void SecondaryCmdBuffersApp::PrepareTeapot()
   auto stageIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, srcMemoryProps);
   auto targetIB = CreateBuffer(bufferSizeIB, usageIB | VK_BUFFER_USAGE_TRANSFER_DST_BIT, dstMemoryProps);
 
-  void* p;
-  vkMapMemory(m_device, stageVB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotVerticesPN, bufferSizeVB);
-  vkUnmapMemory(m_device, stageVB.memory);
-  vkMapMemory(m_device, stageIB.memory, 0, VK_WHOLE_SIZE, 0, &p);
-  memcpy(p, TeapotModel::TeapotIndices, bufferSizeIB);
-  vkUnmapMemory(m_device, stageIB.memory);
+  WriteToHostVisibleMemory(stageVB, bufferSizeVB, TeapotModel::TeapotVerticesPN);
+  WriteToHostVisibleMemory(stageIB, bufferSizeIB, TeapotModel::TeapotIndices);
 
   VkCommandBuffer command = CreateCommandBuffer();
   VkBufferCopy copyRegionVB{}, copyRegionIB{};
@@ -258,17 +247,18 @@ void SecondaryCmdBuffersApp::PrepareTeapot()
   DestroyBuffer(stageVB);
   DestroyBuffer(stageIB);
 
-  // 萔obt@̏.
+  // 萔obt@̏. C[WƂ̗̈ 1 ̃}bv܂܂̃obt@ɒu.
   uint32_t imageCount = m_swapchain->GetImageCount();
-  auto bufferSize = uint32_t(sizeof(ShaderParameters));
-  m_teapot.sceneUB = CreateUniformBuffers(bufferSize, imageCount);
+  m_frameBuffer = FrameRingBuffer();
+  m_teapot.sceneSlot = m_frameBuffer.Reserve(uint32_t(sizeof(ShaderParameters)));
+  m_frameBuffer.Initialize(this, imageCount, 0, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
   m_teapot.indexCount = _countof(TeapotModel::TeapotIndices);
   m_teapot.vertexCount = _countof(TeapotModel::TeapotVerticesPN);
 
   // teapot p̃fBXNv^Zbg/CAEg.
   LayoutInfo layout{};
   VkDescriptorSetLayoutBinding descSetLayoutBindings[] = {
-    { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT },  // SceneParameters
+    { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT },  // SceneParameters
     { 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT },  // InstanceParameters
   };
   VkDescriptorSetLayoutCreateInfo descSetLayoutCI{
@@ -299,11 +289,7 @@ void SecondaryCmdBuffersApp::PrepareInstanceData()
 
   // CX^VOp̃jtH[obt@
   auto bufferSize = uint32_t(sizeof(InstanceData)) * InstanceCount;
-  m_instanceUniforms.resize(m_swapchain->GetImageCount());
-  for (auto& ubo : m_instanceUniforms)
-  {
-    ubo = CreateBuffer(bufferSize, usage, memoryProps);
-  }
+  m_instanceUniform = CreateBuffer(bufferSize, usage, memoryProps);
 
   std::random_device rnd;
   std::vector<InstanceData> data(InstanceCount);
@@ -324,58 +310,42 @@ void SecondaryCmdBuffersApp::PrepareInstanceData()
     data[i].color = colorSet[i % _countof(colorSet)];
   }
 
-  for (auto& ubo : m_instanceUniforms)
-  {
-    void* p;
-    vkMapMemory(m_device, ubo.memory, 0, VK_WHOLE_SIZE, 0, &p);
-    memcpy(p, data.data(), bufferSize);
-    vkUnmapMemory(m_device, ubo.memory);
-  }
+  WriteToHostVisibleMemory(m_instanceUniform, bufferSize, data.data());
 }
 
 void SecondaryCmdBuffersApp::PrepareDescriptors()
 {
-  auto imageCount = m_swapchain->GetImageCount();
   VkResult result;
 
   // teapot pfBXNv^.
+  // V[̒萔̓_Ci~bNItZbgŐ؂ւ̂ŁAC[W̐ɂ炸 1 ł悢.
   VkDescriptorSetAllocateInfo descriptorSetAI{
     VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
     nullptr, m_descriptorPool,
     1, &m_layoutTeapot.descriptorSet
   };
-
-  m_teapot.descriptorSet.reserve(imageCount);
-  for (uint32_t i = 0; i < imageCount; ++i)
-  {
-    VkDescriptorSet descriptorSet;
-    result = vkAllocateDescriptorSets(m_device, &descriptorSetAI, &descriptorSet);
-    ThrowIfFailed(result, "vkAllocateDescriptorSets Failed.");
-    m_teapot.descriptorSet.push_back(descriptorSet);
-  }
+  result = vkAllocateDescriptorSets(m_device, &descriptorSetAI, &m_teapot.descriptorSet);
+  ThrowIfFailed(result, "vkAllocateDescriptorSets Failed.");
 
   // (teapotp) fBXNv^.
-  for (uint32_t i = 0; i < imageCount; ++i)
-  {
-    VkDescriptorBufferInfo uboInfo{
-      m_teapot.sceneUB[i].buffer,
-      0, VK_WHOLE_SIZE
-    };
-    VkDescriptorBufferInfo instanceInfo{
-      m_instanceUniforms[i].buffer,
-      0, VK_WHOLE_SIZE
-    };
+  VkDescriptorBufferInfo uboInfo{
+    m_frameBuffer.GetBuffer(),
+    0, sizeof(ShaderParameters)
+  };
+  VkDescriptorBufferInfo instanceInfo{
+    m_instanceUniform.buffer,
+    0, VK_WHOLE_SIZE
+  };
 
-    VkWriteDescriptorSet writes[] = {
-      book_util::PrepareWriteDescriptorSet(
-        m_teapot.descriptorSet[i], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
-      book_util::PrepareWriteDescriptorSet(
-        m_teapot.descriptorSet[i], 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
-    };
-    writes[0].pBufferInfo = &uboInfo;
-    writes[1].pBufferInfo = &instanceInfo;
-    vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
-  }
+  VkWriteDescriptorSet writes[] = {
+    book_util::PrepareWriteDescriptorSet(
+      m_teapot.descriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC),
+    book_util::PrepareWriteDescriptorSet(
+      m_teapot.descriptorSet, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+  };
+  writes[0].pBufferInfo = &uboInfo;
+  writes[1].pBufferInfo = &instanceInfo;
+  vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
 }
 
 void SecondaryCmdBuffersApp::CreatePipelineTeapot()
@@ -438,14 +408,13 @@ void SecondaryCmdBuffersApp::CreatePipelineTeapot()
   // VF[_[̃[h.
   std::vector<VkPipelineShaderStageCreateInfo> shaderStages
   {
-    book_util::LoadShader(m_device, "modelVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(m_device, "modelFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+    GetShaderLibrary()->Load("modelVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    GetShaderLibrary()->Load("modelFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
   };
 
   auto rasterizerState = book_util::GetDefaultRasterizerState();
   auto dsState = book_util::GetDefaultDepthStencilState();
 
-  VkResult result;
   // pCvC\z.
   VkGraphicsPipelineCreateInfo pipelineCI{
     VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -464,10 +433,15 @@ void SecondaryCmdBuffersApp::CreatePipelineTeapot()
     0, // subpass
     VK_NULL_HANDLE, 0, // basePipeline
   };
-  result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &m_teapot.pipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipeline Failed.");
-
-  book_util::DestroyShaderModules(m_device, shaderStages);
+  GetPipelineManager()->CreateGraphicsPipelines(1, &pipelineCI, &m_teapot.pipeline);
+
+  // VF[_[XVꂽ蒼. pCvCL^ς݂̃ZJ_R}hobt@L^.
+  GetShaderLibrary()->Watch(&m_teapot.pipeline, shaderStages, [this]() {
+    DestroyPipelineDeferred(m_teapot.pipeline);
+    FreeCommandBufferSecondaryDeferred(uint32_t(m_secondaryCommands.size()), m_secondaryCommands.data());
+    CreatePipelineTeapot();
+    PrepareSecondaryCommands();
+  });
 }
 
 void SecondaryCmdBuffersApp::PrepareSecondaryCommands()
@@ -488,12 +462,13 @@ void SecondaryCmdBuffersApp::PrepareSecondaryCommands()
 
   for (uint32_t i = 0; i < imageCount; ++i)
   {
+    // t[obt@̓TCYύXō蒼ߎw肵Ȃ.
     VkCommandBufferInheritanceInfo inheritanceInfo{
       VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
       nullptr,
       m_renderPass,
       0,
-      m_framebuffers[i],
+      VK_NULL_HANDLE,
       VK_FALSE, 0, 0
     };
     VkCommandBufferBeginInfo beginInfo{
@@ -507,10 +482,11 @@ void SecondaryCmdBuffersApp::PrepareSecondaryCommands()
     ThrowIfFailed(result, "vkBeginCommandBuffer Failed.");
 
     vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, m_teapot.pipeline);
+    auto sceneOffset = m_frameBuffer.GetOffset(i, m_teapot.sceneSlot);
     vkCmdBindDescriptorSets(
       command, VK_PIPELINE_BIND_POINT_GRAPHICS,
       m_layoutTeapot.pipeline,
-      0, 1, &m_teapot.descriptorSet[i], 0, nullptr);
+      0, 1, &m_teapot.descriptorSet, 1, &sceneOffset);
     vkCmdBindIndexBuffer(command, m_teapot.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
     VkDeviceSize offsets[] = { 0 };
     vkCmdBindVertexBuffers(command, 0,
@@ -525,14 +501,8 @@ void SecondaryCmdBuffersApp::DestroyModelData(ModelData& model)
 {
   for (auto& bufObj : { model.vertexBuffer, model.indexBuffer })
   {
-    vkDestroyBuffer(m_device, bufObj.buffer, nullptr);
-    vkFreeMemory(m_device, bufObj.memory, nullptr);
-  }
-  for (auto& bufCB : model.sceneUB)
-  {
-    vkDestroyBuffer(m_device, bufCB.buffer, nullptr);
-    vkFreeMemory(m_device, bufCB.memory, nullptr);
+    DestroyBuffer(bufObj);
   }
   vkDestroyPipeline(m_device, model.pipeline, nullptr);
-  vkFreeDescriptorSets(m_device, m_descriptorPool, uint32_t(model.descriptorSet.size()), model.descriptorSet.data());
+  vkFreeDescriptorSets(m_device, m_descriptorPool, 1, &model.descriptorSet);
 }
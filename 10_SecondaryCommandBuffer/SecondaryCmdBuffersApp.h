@@ -1,5 +1,6 @@
 #pragma once
 #include "VulkanAppBase.h"
+#include "FrameRingBuffer.h"
 #include <glm/glm.hpp>
 
 class SecondaryCmdBuffersApp : public VulkanAppBase
@@ -51,8 +52,9 @@ private:
     uint32_t vertexCount;
     uint32_t indexCount;
 
-    std::vector<BufferObject> sceneUB;
-    std::vector<VkDescriptorSet> descriptorSet;
+    // V[̒萔 m_frameBuffer  sceneSlot ɒuA_Ci~bNItZbgŃC[Ẅ̗I.
+    FrameRingBuffer::Slot sceneSlot;
+    VkDescriptorSet descriptorSet;
 
     VkPipeline pipeline;
   };
@@ -67,7 +69,8 @@ private:
   std::vector<VkCommandBuffer> m_commandBuffers;
 
   ModelData m_teapot;
-  std::vector<BufferObject> m_instanceUniforms;
+  BufferObject m_instanceUniform; // Ȃ̂őSẴC[WŋL.
+  FrameRingBuffer m_frameBuffer;
 
   struct LayoutInfo
   {
@@ -8,4 +8,6 @@ glslangValidator -V -S frag modelOutlineFS.frag -o modelOutlineFS.spv
 glslangValidator -V -S vert modelShadowVS.vert -o modelShadowVS.spv
 glslangValidator -V -S frag modelShadowFS.frag -o modelShadowFS.spv
 
+glslangValidator -V -S comp modelMorphCS.comp -o modelMorphCS.spv
+
 @echo on
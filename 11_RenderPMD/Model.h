@@ -1,9 +1,14 @@
 #pragma once
 #include "VulkanAppBase.h"
+#include "MorphEvaluator.h"
+#include "AnimationRuntime.h"
+#include "FrameRingBuffer.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <memory>
+
 class Material
 {
 public:
@@ -14,7 +19,7 @@ public:
     glm::uvec1 useTexture;
     glm::uvec1 edgeFlag;
   };
-  Material(const MaterialParameters& params) : m_parameters(params), m_uniformBuffer(), m_texture(){ }
+  Material(const MaterialParameters& params) : m_parameters(params), m_uniformBuffer(), m_texture(), m_descriptorSet(VK_NULL_HANDLE) { }
 
   glm::vec4 GetDiffuse() const { return m_parameters.diffuse; }
   glm::vec4 GetAmbient() const { return m_parameters.ambient; }
@@ -29,14 +34,18 @@ public:
   bool HasTexture() const { return m_parameters.useTexture.x != 0; }
   void Update(VulkanAppBase* app);
 
-  VkDescriptorSet GetDescriptorSet(int index) const { return m_descriptorSets[index]; }
-  void SetDescriptorSet(std::vector<VkDescriptorSet> descriptorSets) { m_descriptorSets = descriptorSets; }
+  // V[ƃ{[s̓_Ci~bNItZbgŃt[̗̈IԂ̂ŁASẴC[WŋL.
+  VkDescriptorSet GetDescriptorSet() const { return m_descriptorSet; }
+  void SetDescriptorSet(VkDescriptorSet descriptorSet) { m_descriptorSet = descriptorSet; }
+  VkDescriptorSet GetInstancedDescriptorSet(int index) const { return m_instancedDescriptorSets[index]; }
+  void SetInstancedDescriptorSet(std::vector<VkDescriptorSet> descriptorSets) { m_instancedDescriptorSets = descriptorSets; }
 
 private:
   MaterialParameters m_parameters;
   VulkanAppBase::BufferObject m_uniformBuffer;
   VulkanAppBase::ImageObject  m_texture;
-  std::vector<VkDescriptorSet> m_descriptorSets;
+  VkDescriptorSet m_descriptorSet;
+  std::vector<VkDescriptorSet> m_instancedDescriptorSets;
 };
 
 class Bone
@@ -120,9 +129,41 @@ class Model
 public:
   using SecondaryCommandBuffers = std::vector<VkCommandBuffer>;
 
-  void Load(const char* fileName, VulkanAppBase* app);
+  // \[ťvZ@.
+  enum class MorphMode
+  {
+    Cpu,      // CPU ŕω_̂ݏāA͈̔͂].
+    Compute,  // Rs[gVF[_[Œ_obt@֒ڏ.
+  };
+
+  // PMD t@C̓ǂݍݕ@.
+  enum class LoaderMode
+  {
+    Stream,       // std::istream vfƂɓǂݍ.
+    MemoryMapped, // t@C}bvĈꊇWJ.
+  };
+  // ǂݍݎԂ̓(~b).
+  struct LoadTimings
+  {
+    double parseMs;     // t@C.
+    double decodeMs;    // _ECfbNX̓WJ.
+    double skeletonMs;  // {[E\[tEIK ̍\z.
+    double totalMs;     // GPU \[X܂߂S.
+
+    uint32_t textureCount;  // deNX`.
+    double textureDecodeMs; // [J[Xbhł̃fR[hԂ̍v.
+    double textureWaitMs;   // CXbhfR[h҂.
+    double uploadMs;        // eNX`Ɠ]̋L^AM.
+    double descriptorMs;    // fBXNv^Zbg̍\z (Prepare ).
+  };
+
+  void Load(const char* fileName, VulkanAppBase* app, LoaderMode mode = LoaderMode::MemoryMapped);
   void Prepare(VulkanAppBase* app);
   void Cleanup(VulkanAppBase* app);
+  // Xbv`FC̍蒼̌ɌĂяo. ʃTCYĂ񂾃pCvCƃR}hobt@蒼A
+  // Â͕̂`撆̃t[gIĂj.
+  // VF[_[̍XVł́ÃVF[_[gpCvĈ݂ RebuildPipeline ō蒼.
+  void RebuildPipelines(VulkanAppBase* app);
 
   struct Mesh {
     uint32_t startIndexOffset;
@@ -152,8 +193,20 @@ public:
   {
     glm::mat4 bone[512];
   };
+  // CX^X`ŃLN^[Ƃɓn. modelInstancedVS.vert  Instance Ɠ.
+  struct InstanceParameter
+  {
+    glm::mat4 world;
+    glm::uvec4 palette; // x: {[s̑g̐擪 (s̔ԍ).
+  };
 
   void SetSceneParameter(const SceneParameter& params) { m_sceneParams = params; }
+
+  // Load Oɐݒ肷邱.
+  void SetMorphMode(MorphMode mode) { m_morphMode = mode; }
+  MorphMode GetMorphMode() const { return m_morphMode; }
+  // \[ťvZR}hɐς. _[pX̊OŌĂяo.
+  void RecordMorphCommands(VkCommandBuffer command, uint32_t imageIndex, VulkanAppBase* app);
   
   void UpdateMatrices();
   void Update(uint32_t imageIndex, VulkanAppBase* app);
@@ -162,8 +215,37 @@ public:
   SecondaryCommandBuffers GetCommandBuffersOutline(uint32_t index);
   SecondaryCommandBuffers GetCommandBuffersShadow(uint32_t index);
 
+  // CX^X`.
+  // Prepare Oɐݒ肷ƁAbṼLN^[}eAƂ 1 ̊Ԑڕ`ŕ`߂̃obt@ƃR}hpӂ.
+  // {[s̑g (p)  paletteCapacity gALN^[ instanceCapacity ̂܂Œu.
+  // g̓LN^[ԂŋLł̂ŁAPoseCache ̎pƂ 1 gu΂悢.
+  // _obt@͋L邽߁A\[t͑SẴLN^[œɂȂ.
+  // pCvCCAEg "modelInstanced" AvP[Vœo^Ă.
+  void SetInstanceCapacity(uint32_t instanceCapacity, uint32_t paletteCapacity);
+  uint32_t GetInstanceCapacity() const { return m_instanceCapacity; }
+  // SetInstanceCapacity Ă΂ȂTv (11_RenderPMD) ł̓CX^X`̃VF[_[pCvCgȂ.
+  bool IsInstancingEnabled() const { return m_instanceCapacity > 0; }
+  // t[ƂɑgƃLN^[ݒ肵.
+  void ClearInstances();
+  // XLjOs GetBoneCount() ̑gǉĔԍԂ. eʂ𒴂ꍇ InvalidPalette Ԃ.
+  uint32_t AddBonePalette(const glm::mat4* matrices);
+  bool AddInstance(const glm::mat4& world, uint32_t palette);
+  uint32_t GetInstanceCount() const { return uint32_t(m_instances.size()); }
+  // ݒ肵gƃLN^[ imageIndex ̃obt@֏݁AԐڕ`̃CX^XXV.
+  void UpdateInstances(uint32_t imageIndex, VulkanAppBase* app);
+
+  SecondaryCommandBuffers GetCommandBuffersInstanced(uint32_t index);
+  SecondaryCommandBuffers GetCommandBuffersInstancedOutline(uint32_t index);
+  SecondaryCommandBuffers GetCommandBuffersInstancedShadow(uint32_t index);
+
+  static const uint32_t InvalidPalette = ~0u;
+
   void SetShadowMap(VulkanAppBase::ImageObject shadowMap) { m_shadowMap = shadowMap; }
 
+  const LoadTimings& GetLoadTimings() const { return m_loadTimings; }
+  // GPU ւ̓]܂ރob`̃g[N. UploadBatcher::IsComplete ŊmFł.
+  UploadBatcher::Token GetUploadToken() const { return m_uploadToken; }
+
   // {[
   uint32_t GetBoneCount() const { return uint32_t(m_bones.size()); }
   const Bone* GetBone(int idx) const { return m_bones[idx]; }
@@ -172,30 +254,53 @@ public:
   // \[t.
   uint32_t GetFaceMorphCount() const { return uint32_t(m_faceOffsetInfo.size()); }
   int GetFaceMorphIndex(const std::string& faceName) const;
+  const std::string& GetFaceMorphName(int index) const { return m_faceOffsetInfo[index].name; }
   void SetFaceMorphWeight(int index, float weight);
 
   // IK
   uint32_t GetBoneIKCount() const { return uint32_t(m_boneIkList.size()); }
   const PMDBoneIK& GetBoneIK(int idx) const { return m_boneIkList[idx]; }
 
+  // Aj[Vp̍i. p AnimationRuntime ̃CX^X.
+  std::shared_ptr<const Skeleton> GetSkeleton() const { return m_skeleton; }
+  // ݒ肷ƃ{[s Bone ł͂Ȃ runtime ̃CX^X狁߂.
+  void BindAnimationRuntime(const AnimationRuntime* runtime, AnimationRuntime::InstanceId instance)
+  {
+    m_animationRuntime = runtime;
+    m_animationInstance = instance;
+  }
+
 private:
   void PrepareModelUniformBuffers(uint32_t count, VulkanAppBase* app);
-  void PreparePipelines(VulkanAppBase* app);
+  // pipeline w肷Ƃ̖ÕpCvCA܂͂L^R}hobt@݂̂.
+  void PreparePipelines(VulkanAppBase* app, const std::string& pipeline = std::string());
   void PrepareDescriptorSets(VulkanAppBase* app);
   void PrepareDummyTexture(VulkanAppBase* app);
-  void PrepareCommandBuffers(uint32_t count, VulkanAppBase* app);
+  void PrepareCommandBuffers(uint32_t count, VulkanAppBase* app, const std::string& pipeline = std::string());
+  void PrepareInstanceBuffers(uint32_t count, VulkanAppBase* app);
+  void PrepareInstancedDescriptorSets(VulkanAppBase* app);
+  void PrepareInstancedCommandBuffers(uint32_t count, VulkanAppBase* app, const std::string& pipeline = std::string());
+  void FreeCommandBuffers(std::vector<SecondaryCommandBuffers>& commandBuffers, VulkanAppBase* app);
+  void RebuildPipeline(const std::string& name, VulkanAppBase* app);
+  void PrepareMorphBuffers(VulkanAppBase* app);
+  void PrepareMorphDescriptorSets(VulkanAppBase* app);
+  void PrepareMorphEvaluator(uint32_t imageCount);
+  void UpdateMorphVertices(uint32_t imageIndex, VulkanAppBase* app);
 
   std::vector<PMDVertex> m_hostMemVertices;
   std::vector<Mesh> m_meshes;
   std::vector<Material> m_materials;
+  std::vector<VulkanAppBase::ImageObject> m_textures; // }eAԂŋL.
   SceneParameter m_sceneParams;
-  BoneParameter m_boneMatrices;
-
-  using UniformBuffers = std::vector<VulkanAppBase::BufferObject>;
 
   std::vector<VulkanAppBase::BufferObject> m_vertexBuffers;
-  UniformBuffers m_boneUBO;
-  UniformBuffers m_sceneParamUBO;
+
+  // t[Ƃɏf[^. V[ƃ{[s͋L^ς݂̃R}hQƂ̂ŌŒ̗̈ɁA
+  // \[t̃EFCg͖t[L^R}hQƂ̂Ő؂öɒu.
+  FrameRingBuffer m_frameBuffer;
+  FrameRingBuffer::Slot m_sceneSlot = 0;
+  FrameRingBuffer::Slot m_boneSlot = 0;
+  uint32_t m_morphWeightOffset = 0;
   
   VulkanAppBase::BufferObject m_indexBuffer;
 
@@ -203,11 +308,25 @@ private:
   std::vector<SecondaryCommandBuffers> m_commandBuffersOutline;
   std::vector<SecondaryCommandBuffers> m_commandBuffersShadow;
 
+  // CX^X`p. obt@̓C[WƂɎ.
+  // Ԑڕ`̈̓}eAƂ 1 ŁACX^X݂̂𖈃t[.
+  uint32_t m_instanceCapacity = 0;
+  uint32_t m_paletteCapacity = 0;
+  std::vector<InstanceParameter> m_instances;
+  std::vector<glm::mat4> m_bonePalettes;
+  std::vector<VkDrawIndexedIndirectCommand> m_indirectCommands;
+  std::vector<VulkanAppBase::BufferObject> m_instanceBuffers;
+  std::vector<VulkanAppBase::BufferObject> m_paletteBuffers;
+  std::vector<VulkanAppBase::BufferObject> m_indirectBuffers;
+  std::vector<SecondaryCommandBuffers> m_commandBuffersInstanced;
+  std::vector<SecondaryCommandBuffers> m_commandBuffersInstancedOutline;
+  std::vector<SecondaryCommandBuffers> m_commandBuffersInstancedShadow;
+
   VulkanAppBase::ImageObject m_shadowMap;
   VulkanAppBase::ImageObject m_dummyTexture;
   VkSampler m_sampler;
 
-  std::unordered_map<std::string, VkPipeline> m_pipelines;
+  std::unordered_map<std::string, VkPipeline> m_pipelines; // vf̃AhX ShaderLibrary::Watch ̃L[Ƃ.
   std::vector<Bone*> m_bones;
   
 
@@ -228,5 +347,43 @@ private:
   std::vector<PMDFaceInfo> m_faceOffsetInfo;
   std::vector<float> m_faceMorphWeights;
 
+  // Rs[gVF[_[ɂ\[tp.
+  enum
+  {
+    MorphGroupSize = 64, // modelMorphCS.comp  local_size_x.
+  };
+  struct MorphParameter
+  {
+    uint32_t morphVertexCount;
+    uint32_t vertexStride;    // float P.
+    uint32_t positionOffset;  // float P.
+    uint32_t reserved;
+  };
+  MorphMode m_morphMode = MorphMode::Compute;
+  uint32_t m_morphVertexCount = 0;
+  VulkanAppBase::BufferObject m_morphVertexBuffer;
+  VulkanAppBase::BufferObject m_morphBasePosBuffer;
+  VulkanAppBase::BufferObject m_morphDeltaBuffer;
+  std::vector<VkDescriptorSet> m_morphDescriptorSets;
+
+  // CPU ɂ\[tp.
+  enum
+  {
+    MorphRangeMergeGap = 16, // ̒_ȉ̌Ԃ͌ 1 œ].
+  };
+  MorphEvaluator m_morphEvaluator;
+  uint32_t m_morphSerial = 0;
+  std::vector<uint32_t> m_morphBlockSerials;  // ubNŌɕὡԍ.
+  std::vector<uint32_t> m_morphImageSerials;  // _obt@֍Ōɔf̔ԍ.
+  std::vector<uint32_t> m_morphUploadBlocks;
+  std::vector<MorphEvaluator::Range> m_morphUploadRanges;
+
   std::vector<PMDBoneIK> m_boneIkList;
+
+  std::shared_ptr<Skeleton> m_skeleton;
+  const AnimationRuntime* m_animationRuntime = nullptr;
+  AnimationRuntime::InstanceId m_animationInstance = 0;
+
+  LoadTimings m_loadTimings;
+  UploadBatcher::Token m_uploadToken = 0;
 };
@@ -46,24 +46,26 @@ void RenderPMDApp::Prepare()
   PrepareFramebuffers();
   PrepareShadowTargets();
 
-  PrepareCommandBuffersPrimary();
-
-  // ImGui
-  IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
-  ImGui_ImplGlfw_InitForVulkan(m_window, true);
-
-  ImGui_ImplVulkan_InitInfo info{};
-  info.Instance = m_vkInstance;
-  info.PhysicalDevice = m_physicalDevice;
-  info.Device = m_device;
-  info.QueueFamily = m_gfxQueueIndex;
-  info.Queue = m_deviceQueue;
-  info.DescriptorPool = m_descriptorPool;
-  info.MinImageCount = m_swapchain->GetImageCount();
-  info.ImageCount = m_swapchain->GetImageCount();
-  ImGui_ImplVulkan_Init(&info, GetRenderPass("default"));
-
+  if (!IsHeadless())
+  {
+    // ImGui
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui_ImplGlfw_InitForVulkan(m_window, true);
+
+    ImGui_ImplVulkan_InitInfo info{};
+    info.Instance = m_vkInstance;
+    info.PhysicalDevice = m_physicalDevice;
+    info.Device = m_device;
+    info.QueueFamily = m_gfxQueueIndex;
+    info.Queue = m_deviceQueue;
+    info.DescriptorPool = m_descriptorPool;
+    info.PipelineCache = m_pipelineManager->GetPipelineCache();
+    info.MinImageCount = m_swapchain->GetImageCount();
+    // ImGui ̒_obt@̓t[ƂɏɎĝŁAɏt[ȏpӂ.
+    info.ImageCount = (std::max)(m_swapchain->GetImageCount(), m_framePacer->GetFramesInFlight());
+    ImGui_ImplVulkan_Init(&info, GetRenderPass("default"));
+  }
   const char filePath[] = "~N.pmd";
   //const char filePath[] = "v.pmd";
   
@@ -71,11 +73,13 @@ void RenderPMDApp::Prepare()
   m_model.SetShadowMap(m_shadowColor);
   m_model.Prepare(this);
 
-  auto command = CreateCommandBuffer();
-  ImGui_ImplVulkan_CreateFontsTexture(command);
-  FinishCommandBuffer(command);
-  vkFreeCommandBuffers(m_device, m_commandPool, 1, &command);
-
+  if (!IsHeadless())
+  {
+    auto command = CreateCommandBuffer();
+    ImGui_ImplVulkan_CreateFontsTexture(command);
+    FinishCommandBuffer(command);
+    vkFreeCommandBuffers(m_device, m_commandPool, 1, &command);
+  }
   m_faceWeights.resize(m_model.GetFaceMorphCount());
 }
 
@@ -87,18 +91,15 @@ void RenderPMDApp::Cleanup()
   DestroyImage(m_shadowDepth);
   DestroyFramebuffers(1, &m_shadowFramebuffer);
 
-  for (auto& cmd : m_mainCommands)
-  {
-    vkFreeCommandBuffers(m_device, m_commandPool, 1, &cmd.command);
-    vkDestroyFence(m_device, cmd.fence, nullptr);
-  }
-
   DestroyImage(m_depthBuffer);
   DestroyFramebuffers(uint32_t(m_framebuffers.size()), m_framebuffers.data());
 
-  ImGui_ImplVulkan_Shutdown();
-  ImGui_ImplGlfw_Shutdown();
-  ImGui::DestroyContext();
+  if (!IsHeadless())
+  {
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+  }
 }
 
 void RenderPMDApp::Render()
@@ -106,8 +107,9 @@ void RenderPMDApp::Render()
   if (m_isMinimizedWindow) {
     MsgLoopMinimizedWindow();
   }
+  auto& frame = m_framePacer->BeginFrame();
   uint32_t imageIndex = 0;
-  auto result = m_swapchain->AcquireNextImage(&imageIndex, m_presentCompletedSem);
+  auto result = m_swapchain->AcquireNextImage(&imageIndex, frame.imageAcquired);
   if (result == VK_ERROR_OUT_OF_DATE_KHR)
   {
     return;
@@ -143,18 +145,14 @@ void RenderPMDApp::Render()
     m_model.SetFaceMorphWeight(i, m_faceWeights[i]);
   }
 
+  // ̃C[Wgt[̊҂ĂAC[WƂ̃obt@.
+  m_framePacer->WaitForImage(imageIndex);
   m_model.Update(imageIndex, this);
 
-  auto command = m_mainCommands[imageIndex].command;
-  auto fence = m_mainCommands[imageIndex].fence;
-  vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX);
-  vkResetFences(m_device, 1, &fence);
+  auto command = m_framePacer->BeginCommand();
 
-  VkCommandBufferBeginInfo commandBI{
-    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-    nullptr, 0, nullptr
-  };
-  vkBeginCommandBuffer(command, &commandBI);
+  // \[t𒸓_obt@֔f.
+  m_model.RecordMorphCommands(command, imageIndex, this);
 
   auto renderPass = GetRenderPass("default");
   VkRenderPassBeginInfo rpBI{
@@ -209,21 +207,8 @@ void RenderPMDApp::Render()
   RenderImGui(command);
   vkCmdEndRenderPass(command);
 
-  vkEndCommandBuffer(command);
-
-  VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  VkSubmitInfo submitInfo{
-    VK_STRUCTURE_TYPE_SUBMIT_INFO,
-    nullptr,
-    1, &m_presentCompletedSem, // WaitSemaphore
-    &waitStageMask, // DstStageMask
-    1, &command, // CommandBuffer
-    1, &m_renderCompletedSem, // SignalSemaphore
-  };
-  
-  vkQueueSubmit(m_deviceQueue, 1, &submitInfo, fence);
-
-  m_swapchain->QueuePresent(m_deviceQueue, imageIndex, m_renderCompletedSem);
+  m_framePacer->Submit();
+  m_swapchain->QueuePresent(m_deviceQueue, imageIndex, frame.renderCompleted);
 
 }
 
@@ -232,6 +217,14 @@ bool RenderPMDApp::OnSizeChanged(uint32_t width, uint32_t height)
   bool ret = VulkanAppBase::OnSizeChanged(width, height);
   if (ret)
   {
+    // `撆̃t[҂ɍ蒼. Â̂ GPU gIĂj.
+    DestroyImageDeferred(m_depthBuffer);
+    DestroyFramebuffersDeferred(uint32_t(m_framebuffers.size()), m_framebuffers.data());
+    PrepareDepthbuffer();
+    PrepareFramebuffers();
+
+    // ʃTCYĂ񂾃pCvCƃR}hobt@.
+    m_model.RebuildPipelines(this);
   }
   return ret;
 }
@@ -361,8 +354,8 @@ void RenderPMDApp::PrepareLayout()
 
   array<VkDescriptorSetLayoutBinding, 5> descriptorSetLayoutBindings{
     {
-      { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_ALL, nullptr}, // SceneParam
-      { 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}, //Bone
+      { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_ALL, nullptr}, // SceneParam
+      { 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}, //Bone
       { 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // MaterialParam
       { 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
       { 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
@@ -391,31 +384,33 @@ void RenderPMDApp::PrepareLayout()
   ThrowIfFailed(result, "vkCreatePipelineLayout Failed.");
   RegisterLayout("model", pipelineLayout);
 
-
-}
-
-void RenderPMDApp::PrepareCommandBuffersPrimary()
-{
-  VkFenceCreateInfo fenceCI{
-    VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr,
-    VK_FENCE_CREATE_SIGNALED_BIT
+  // \[tvZp.
+  array<VkDescriptorSetLayoutBinding, 5> morphLayoutBindings{
+    {
+      { 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // MorphVertices
+      { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // BasePositions
+      { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Deltas
+      { 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Weights
+      { 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Vertices
+    }
   };
-  VkCommandBufferAllocateInfo commandAI{
-    VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, nullptr,
-    m_commandPool,
-    VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1
+  descriptorSetLayoutCI.bindingCount = uint32_t(morphLayoutBindings.size());
+  descriptorSetLayoutCI.pBindings = morphLayoutBindings.data();
+  result = vkCreateDescriptorSetLayout(m_device, &descriptorSetLayoutCI, nullptr, &descriptorSetLayout);
+  ThrowIfFailed(result, "vkCreateDescriptorSetLayout Failed.");
+  RegisterLayout("morph", descriptorSetLayout);
+
+  VkPushConstantRange morphPushConstant{
+    VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t) * 4
   };
+  pipelineLayoutCI.pSetLayouts = &descriptorSetLayout;
+  pipelineLayoutCI.pushConstantRangeCount = 1;
+  pipelineLayoutCI.pPushConstantRanges = &morphPushConstant;
+  result = vkCreatePipelineLayout(m_device, &pipelineLayoutCI, nullptr, &pipelineLayout);
+  ThrowIfFailed(result, "vkCreatePipelineLayout Failed.");
+  RegisterLayout("morph", pipelineLayout);
+
 
-  VkResult result;
-  auto imageCount = m_swapchain->GetImageCount();
-  m_mainCommands.resize(imageCount);
-  for (uint32_t i = 0; i < imageCount; ++i)
-  {
-    result = vkAllocateCommandBuffers(m_device, &commandAI, &m_mainCommands[i].command);
-    ThrowIfFailed(result, "vkAllocateCommandBuffers Failed.");
-    result = vkCreateFence(m_device, &fenceCI, nullptr, &m_mainCommands[i].fence);
-    ThrowIfFailed(result, "vkCreateFence Failed.");
-  }
 }
 
 void RenderPMDApp::RenderShadowPass(VkCommandBuffer command, uint32_t imageIndex)
@@ -441,6 +436,10 @@ void RenderPMDApp::RenderShadowPass(VkCommandBuffer command, uint32_t imageIndex
 
 void RenderPMDApp::RenderImGui(VkCommandBuffer command)
 {
+  if (IsHeadless())
+  {
+    return;
+  }
   ImGui_ImplVulkan_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
@@ -450,9 +449,34 @@ void RenderPMDApp::RenderImGui(VkCommandBuffer command)
     ImGui::Text("RenderPMD");
     auto framerate = ImGui::GetIO().Framerate;
     ImGui::Text("Framerate(avg) %.3f ms/frame", 1000.0f / framerate);
+    const auto& pacerStats = m_framePacer->GetStatistics();
+    ImGui::Text("FramesInFlight %u: CPU wait %.2f ms, GPU %.2f ms (idle %.2f ms)",
+      m_framePacer->GetFramesInFlight(), pacerStats.cpuWaitMs, pacerStats.gpuBusyMs, pacerStats.gpuIdleMs);
+    // \Ȃł vkQueuePresentKHR ̖߂܂ł̒lɂȂ.
+    auto latency = m_swapchain->GetRecentLatencyStatistics();
+    const auto& presentTimings = m_swapchain->GetPresentTimings();
+    auto isDisplayTime = !presentTimings.empty() && presentTimings.back().isDisplayTime;
+    ImGui::Text("%s x%u: acquire->present %.2f ms, submit->present %.2f ms (max %.2f ms)%s",
+      Swapchain::GetPresentModeName(m_swapchain->GetPresentMode()), m_swapchain->GetImageCount(),
+      latency.acquireToPresentMs, latency.submitToPresentMs, latency.maxSubmitToPresentMs,
+      isDisplayTime ? " display" : "");
+    const auto& pipelineStats = m_pipelineManager->GetStatistics();
+    ImGui::Text("PipelineCache %s (%.1f KB): %u pipelines in %.2f ms",
+      pipelineStats.isWarm ? "warm" : "cold", pipelineStats.loadedBytes / 1024.0,
+      pipelineStats.pipelineCount, pipelineStats.createMs);
+    const auto& shaderStats = m_shaderLibrary->GetStatistics();
+    ImGui::Text("Shaders %u modules for %u loads, %u reloaded%s",
+      shaderStats.moduleCount, shaderStats.loadCount, shaderStats.reloadCount,
+      m_shaderLibrary->IsSourceCompileEnabled() ? " (source)" : "");
 
     auto cameraPos = m_camera.GetPosition();
     ImGui::Text("CameraPos: (%.2f, %.2f, %.2f)", cameraPos.x, cameraPos.y, cameraPos.z);
+    const auto& loadTimings = m_model.GetLoadTimings();
+    ImGui::Text("ModelLoad %.2f ms (parse %.2f, decode %.2f, skeleton %.2f)",
+      loadTimings.totalMs, loadTimings.parseMs, loadTimings.decodeMs, loadTimings.skeletonMs);
+    ImGui::Text("Textures %u (decode %.2f, wait %.2f, upload %.2f, descriptor %.2f)",
+      loadTimings.textureCount, loadTimings.textureDecodeMs, loadTimings.textureWaitMs,
+      loadTimings.uploadMs, loadTimings.descriptorMs);
     ImGui::Checkbox("Outline", &m_drawOutline);
     ImGui::ColorEdit3("Outline", (float*)&m_sceneParameters.outlineColor);
     ImGui::Spacing();
@@ -461,7 +485,7 @@ void RenderPMDApp::RenderImGui(VkCommandBuffer command)
     for (uint32_t i = 0; i < uint32_t(m_faceWeights.size()); ++i)
     {
       char name[256];
-      sprintf_s(name, "face%d", i);
+      snprintf(name, sizeof(name), "face%d", i);
       ImGui::SliderFloat(name, &m_faceWeights[i], 0.0f, 1.0f, "%.2f");
     }
     
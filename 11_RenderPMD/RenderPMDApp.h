@@ -33,7 +33,6 @@ private:
   void PrepareFramebuffers();
   void PrepareShadowTargets();
   void PrepareLayout();
-  void PrepareCommandBuffersPrimary();
 
   void RenderShadowPass(VkCommandBuffer command, uint32_t imageIndex);
   void RenderImGui(VkCommandBuffer command);
@@ -48,12 +47,6 @@ private:
   enum {
     ShadowSize = 1024,
   };
-  struct CommandBuffer
-  {
-    VkFence fence;
-    VkCommandBuffer command;
-  };
-  std::vector<CommandBuffer> m_mainCommands;
   Model m_model;
   Model::SceneParameter m_sceneParameters;
 
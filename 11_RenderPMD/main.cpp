@@ -8,6 +8,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "VulkanBookUtil.h"
+#include "HeadlessRunner.h"
 
 const int WindowWidth = 800, WindowHeight = 600;
 const char* AppTitle = "RenderPMD";
@@ -84,10 +85,17 @@ static void WindowResizeCallback(GLFWwindow* window, int width, int height)
   pApp->OnSizeChanged(width, height);
 }
 
-int __stdcall wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
+int main(int argc, char** argv)
 {
-  UNREFERENCED_PARAMETER(hPrevInstance);
-  UNREFERENCED_PARAMETER(lpCmdLine);
+  // --headless w莞̓EBhE炸Ɏwt[`悷.
+  auto options = book_util::ParseHeadlessOptions(argc, argv, WindowWidth, WindowHeight);
+  auto appOptions = book_util::ParseAppOptions(argc, argv);
+  if (options.enabled)
+  {
+    RenderPMDApp headlessApp;
+    return book_util::RunHeadless(headlessApp, options, appOptions, VK_FORMAT_B8G8R8A8_UNORM);
+  }
+
   glfwInit();
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
   glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
@@ -102,6 +110,11 @@ int __stdcall wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCm
   glfwSetWindowSizeCallback(window, WindowResizeCallback);
 
   RenderPMDApp theApp;
+  theApp.SetFramesInFlight(appOptions.framesInFlight);
+  theApp.SetPresentMode(appOptions.presentMode);
+  theApp.SetSwapchainImageCount(appOptions.swapchainImageCount);
+  theApp.SetPipelineCacheMode(appOptions.pipelineCacheMode);
+  theApp.SetShaderSourceCompileEnabled(appOptions.compileShaders);
   glfwSetWindowUserPointer(window, &theApp);
 
   try
@@ -110,14 +123,15 @@ int __stdcall wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCm
     while (glfwWindowShouldClose(window) == GLFW_FALSE)
     {
       glfwPollEvents();
+      theApp.PollShaderChanges();
       theApp.Render();
     }
     theApp.Terminate();
   }
   catch (std::runtime_error e)
   {
-    OutputDebugStringA(e.what());
-    OutputDebugStringA("\n");
+    book_util::OutputDebugMessage(e.what());
+    book_util::OutputDebugMessage("\n");
   }
   glfwTerminate();
   return 0;
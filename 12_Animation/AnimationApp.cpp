@@ -3,6 +3,10 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
 #include "imgui.h"
 #include "examples/imgui_impl_vulkan.h"
 #include "examples/imgui_impl_glfw.h"
@@ -32,8 +36,18 @@ RenderPMDApp::RenderPMDApp()
 {
   m_camera.SetLookAt(vec3(-7.0f, 14.0f, 13.0f), vec3(-2.0f, 15.0f, 0.0f));
   m_drawOutline = true;
-  m_frameCount = 0;
+  m_animationFrame = 0.0f;
+  m_isFixedFrameRate = false;
+  m_isMotionCacheEnabled = false;
   m_isAnimeStart = false;
+  m_crowdSize = 0;
+  m_crowdMotion = 0;
+}
+
+void RenderPMDApp::SetFixedFrameRate(double fps)
+{
+  m_animationClock.SetStepRate(fps);
+  m_isFixedFrameRate = true;
 }
 
 void RenderPMDApp::Prepare()
@@ -48,38 +62,67 @@ void RenderPMDApp::Prepare()
   PrepareFramebuffers();
   PrepareShadowTargets();
 
-  PrepareCommandBuffersPrimary();
-
-  // ImGui
-  IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
-  ImGui_ImplGlfw_InitForVulkan(m_window, true);
-
-  ImGui_ImplVulkan_InitInfo info{};
-  info.Instance = m_vkInstance;
-  info.PhysicalDevice = m_physicalDevice;
-  info.Device = m_device;
-  info.QueueFamily = m_gfxQueueIndex;
-  info.Queue = m_deviceQueue;
-  info.DescriptorPool = m_descriptorPool;
-  info.MinImageCount = m_swapchain->GetImageCount();
-  info.ImageCount = m_swapchain->GetImageCount();
-  ImGui_ImplVulkan_Init(&info, GetRenderPass("default"));
-
+  if (!IsHeadless())
+  {
+    // ImGui
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui_ImplGlfw_InitForVulkan(m_window, true);
+
+    ImGui_ImplVulkan_InitInfo info{};
+    info.Instance = m_vkInstance;
+    info.PhysicalDevice = m_physicalDevice;
+    info.Device = m_device;
+    info.QueueFamily = m_gfxQueueIndex;
+    info.Queue = m_deviceQueue;
+    info.DescriptorPool = m_descriptorPool;
+    info.PipelineCache = m_pipelineManager->GetPipelineCache();
+    info.MinImageCount = m_swapchain->GetImageCount();
+    // ImGui ̒_obt@̓t[ƂɏɎĝŁAɏt[ȏpӂ.
+    info.ImageCount = (std::max)(m_swapchain->GetImageCount(), m_framePacer->GetFramesInFlight());
+    ImGui_ImplVulkan_Init(&info, GetRenderPass("default"));
+  }
   const char filePath[] = "~N.pmd"; // ̃f[^͗pӂĂB
   m_model.Load(filePath, this);
   m_model.SetShadowMap(m_shadowColor);
+  if (m_crowdSize > 0)
+  {
+    // {[s̑g͓ɕ`قȂp̐΂悢.
+    m_model.SetInstanceCapacity(m_crowdSize, (std::min)(m_crowdSize, uint32_t(CrowdGroupCount)));
+  }
   m_model.Prepare(this);
 
-  auto command = CreateCommandBuffer();
-  ImGui_ImplVulkan_CreateFontsTexture(command);
-  FinishCommandBuffer(command);
-  vkFreeCommandBuffers(m_device, m_commandPool, 1, &command);
-
+  if (!IsHeadless())
+  {
+    auto command = CreateCommandBuffer();
+    ImGui_ImplVulkan_CreateFontsTexture(command);
+    FinishCommandBuffer(command);
+    vkFreeCommandBuffers(m_device, m_commandPool, 1, &command);
+  }
   m_faceWeights.resize(m_model.GetFaceMorphCount());
 
+  auto instance = m_animationRuntime.AddInstance(m_model.GetSkeleton());
+  m_model.BindAnimationRuntime(&m_animationRuntime, instance);
+  m_animator.Attach(&m_model, &m_animationRuntime, instance);
+  // fɌѕtĂƁA쐬LbVɃgbN̔ԍۑ.
+  if (m_isMotionCacheEnabled)
+  {
+    m_animator.SetCacheDirectory("motion_cache");
+  }
   m_animator.Prepare("animation.vmd"); // ̃f[^͗pӂĂB
-  m_animator.Attach(&m_model);
+  m_animationDone = m_animator.AddJobs(m_animationJobs, m_animationFrame);
+  if (m_crowdSize > 0)
+  {
+    m_crowdMotion = m_animator.AddToPoseCache(m_poseCache);
+    CheckCrowdPose(instance);
+    m_camera.SetLookAt(vec3(-40.0f, 60.0f, 80.0f), vec3(0.0f, 10.0f, -20.0f));
+  }
+
+  // wbhX͑łȂ̂ōŏĐ.
+  if (IsHeadless())
+  {
+    m_isAnimeStart = true;
+  }
 }
 
 void RenderPMDApp::Cleanup()
@@ -90,18 +133,15 @@ void RenderPMDApp::Cleanup()
   DestroyImage(m_shadowDepth);
   DestroyFramebuffers(1, &m_shadowFramebuffer);
 
-  for (auto& cmd : m_mainCommands)
-  {
-    vkFreeCommandBuffers(m_device, m_commandPool, 1, &cmd.command);
-    vkDestroyFence(m_device, cmd.fence, nullptr);
-  }
-
   DestroyImage(m_depthBuffer);
   DestroyFramebuffers(uint32_t(m_framebuffers.size()), m_framebuffers.data());
 
-  ImGui_ImplVulkan_Shutdown();
-  ImGui_ImplGlfw_Shutdown();
-  ImGui::DestroyContext();
+  if (!IsHeadless())
+  {
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+  }
 }
 
 void RenderPMDApp::Render()
@@ -109,10 +149,36 @@ void RenderPMDApp::Render()
   if (m_isMinimizedWindow) {
     MsgLoopMinimizedWindow();
   }
+  // Aj[VKp. ~͖L[ 1 t[.
+  if (!m_isAnimeStart)
+  {
+    if (ImGui::GetIO().KeysDown[ImGui::GetKeyIndex(ImGuiKey_LeftArrow)])
+    {
+      m_animationClock.SetFrame(m_animationClock.GetFrame() - 1.0);
+    }
+    if (ImGui::GetIO().KeysDown[ImGui::GetKeyIndex(ImGuiKey_RightArrow)])
+    {
+      m_animationClock.SetFrame(m_animationClock.GetFrame() + 1.0);
+    }
+  }
+  // Aj[V̌vZ̓[J[XbhŐi߁A{[s񂪕KvɂȂ܂ő҂Ȃ.
+  // QȌꍇ͓ Animator  PoseCache ĝŁAł͌vZȂ.
+  m_animationFrame = m_animationClock.GetFrame();
+  if (m_crowdSize == 0)
+  {
+    m_jobSystem.Dispatch(m_animationJobs);
+  }
+
+  // Õt[ GPU ̏҂ԂAj[V̌vZ͐i.
+  auto& frame = m_framePacer->BeginFrame();
   uint32_t imageIndex = 0;
-  auto result = m_swapchain->AcquireNextImage(&imageIndex, m_presentCompletedSem);
+  auto result = m_swapchain->AcquireNextImage(&imageIndex, frame.imageAcquired);
   if (result == VK_ERROR_OUT_OF_DATE_KHR)
   {
+    if (m_crowdSize == 0)
+    {
+      m_jobSystem.Wait(m_animationJobs, m_animationDone);
+    }
     return;
   }
 
@@ -140,37 +206,24 @@ void RenderPMDApp::Render()
   auto matBias = glm::translate(mat4(1.0f), vec3(0.5f,0.5f,0.5f)) * glm::scale(mat4(1.0f), vec3(0.5f, 0.5f, 0.5f));
   m_sceneParameters.lightViewProjBias = matBias * m_sceneParameters.lightViewProj;
 
-  // Aj[VKp.
-  if (!m_isAnimeStart)
+  // ̃C[Wgt[̊҂ĂAC[WƂ̃obt@.
+  m_framePacer->WaitForImage(imageIndex);
+
+  m_model.SetSceneParameter(m_sceneParameters);
+  if (m_crowdSize > 0)
   {
-    if (ImGui::GetIO().KeysDown[ImGui::GetKeyIndex(ImGuiKey_LeftArrow)])
-    {
-      m_frameCount--;
-    }
-    if (ImGui::GetIO().KeysDown[ImGui::GetKeyIndex(ImGuiKey_RightArrow)])
-    {
-      m_frameCount++;
-    }
+    UpdateCrowd(imageIndex);
   }
-  if (m_frameCount < 0)
+  else
   {
-    m_frameCount = 0;
+    m_jobSystem.Wait(m_animationJobs, m_animationDone);
   }
-  m_animator.UpdateAnimation(m_frameCount);
-
-  m_model.SetSceneParameter(m_sceneParameters);
   m_model.Update(imageIndex, this);
 
-  auto command = m_mainCommands[imageIndex].command;
-  auto fence = m_mainCommands[imageIndex].fence;
-  vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX);
-  vkResetFences(m_device, 1, &fence);
+  auto command = m_framePacer->BeginCommand();
 
-  VkCommandBufferBeginInfo commandBI{
-    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-    nullptr, 0, nullptr
-  };
-  vkBeginCommandBuffer(command, &commandBI);
+  // \[t𒸓_obt@֔f.
+  m_model.RecordMorphCommands(command, imageIndex, this);
 
   auto renderPass = GetRenderPass("default");
   VkRenderPassBeginInfo rpBI{
@@ -209,13 +262,14 @@ void RenderPMDApp::Render()
   }
 
   vkCmdBeginRenderPass(command, &rpBI, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
-  auto subcommand = m_model.GetCommandBuffers(imageIndex);
+  auto isCrowd = m_crowdSize > 0;
+  auto subcommand = isCrowd ? m_model.GetCommandBuffersInstanced(imageIndex) : m_model.GetCommandBuffers(imageIndex);
   // fʏ`
   vkCmdExecuteCommands(command, uint32_t(subcommand.size()), subcommand.data());
   // ֊s`
   if (m_drawOutline)
   {
-    auto commandOutline = m_model.GetCommandBuffersOutline(imageIndex);
+    auto commandOutline = isCrowd ? m_model.GetCommandBuffersInstancedOutline(imageIndex) : m_model.GetCommandBuffersOutline(imageIndex);
     vkCmdExecuteCommands(command, uint32_t(commandOutline.size()), commandOutline.data());
   }
   vkCmdEndRenderPass(command);
@@ -225,25 +279,22 @@ void RenderPMDApp::Render()
   RenderImGui(command);
   vkCmdEndRenderPass(command);
 
-  vkEndCommandBuffer(command);
-
-  VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  VkSubmitInfo submitInfo{
-    VK_STRUCTURE_TYPE_SUBMIT_INFO,
-    nullptr,
-    1, &m_presentCompletedSem, // WaitSemaphore
-    &waitStageMask, // DstStageMask
-    1, &command, // CommandBuffer
-    1, &m_renderCompletedSem, // SignalSemaphore
-  };
-  
-  vkQueueSubmit(m_deviceQueue, 1, &submitInfo, fence);
-
-  m_swapchain->QueuePresent(m_deviceQueue, imageIndex, m_renderCompletedSem);
+  m_framePacer->Submit();
+  m_swapchain->QueuePresent(m_deviceQueue, imageIndex, frame.renderCompleted);
 
+  // ̕`̎֐i߂. `ɂԂɂ炸A[V͎ (܂͌Œ̊Ԋu) Ői.
+  auto elapsedMs = m_frameTimer.GetElapsedMs();
+  m_frameTimer.Reset();
   if (m_isAnimeStart)
   {
-    m_frameCount++;
+    if (m_isFixedFrameRate)
+    {
+      m_animationClock.Step();
+    }
+    else
+    {
+      m_animationClock.Advance(elapsedMs / 1000.0);
+    }
   }
 }
 
@@ -252,6 +303,14 @@ bool RenderPMDApp::OnSizeChanged(uint32_t width, uint32_t height)
   bool ret = VulkanAppBase::OnSizeChanged(width, height);
   if (ret)
   {
+    // `撆̃t[҂ɍ蒼. Â̂ GPU gIĂj.
+    DestroyImageDeferred(m_depthBuffer);
+    DestroyFramebuffersDeferred(uint32_t(m_framebuffers.size()), m_framebuffers.data());
+    PrepareDepthbuffer();
+    PrepareFramebuffers();
+
+    // ʃTCYĂ񂾃pCvCƃR}hobt@.
+    m_model.RebuildPipelines(this);
   }
   return ret;
 }
@@ -381,8 +440,8 @@ void RenderPMDApp::PrepareLayout()
 
   array<VkDescriptorSetLayoutBinding, 5> descriptorSetLayoutBindings{
     {
-      { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_ALL, nullptr}, // SceneParam
-      { 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}, //Bone
+      { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_ALL, nullptr}, // SceneParam
+      { 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}, //Bone
       { 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // MaterialParam
       { 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
       { 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
@@ -411,30 +470,140 @@ void RenderPMDApp::PrepareLayout()
   ThrowIfFailed(result, "vkCreatePipelineLayout Failed.");
   RegisterLayout("model", pipelineLayout);
 
+  // CX^X`p. {[s̓jtH[obt@ł͂ȂASLN^[Xg[Wobt@ǂ.
+  array<VkDescriptorSetLayoutBinding, 6> instancedLayoutBindings{
+    {
+      { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_ALL, nullptr}, // SceneParam
+      { 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // MaterialParam
+      { 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+      { 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+      { 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}, // Instances
+      { 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}, // BonePalettes
+    }
+  };
+  descriptorSetLayoutCI.bindingCount = uint32_t(instancedLayoutBindings.size());
+  descriptorSetLayoutCI.pBindings = instancedLayoutBindings.data();
+  result = vkCreateDescriptorSetLayout(m_device, &descriptorSetLayoutCI, nullptr, &descriptorSetLayout);
+  ThrowIfFailed(result, "vkCreateDescriptorSetLayout Failed.");
+  RegisterLayout("modelInstanced", descriptorSetLayout);
 
-}
+  pipelineLayoutCI.pSetLayouts = &descriptorSetLayout;
+  result = vkCreatePipelineLayout(m_device, &pipelineLayoutCI, nullptr, &pipelineLayout);
+  ThrowIfFailed(result, "vkCreatePipelineLayout Failed.");
+  RegisterLayout("modelInstanced", pipelineLayout);
 
-void RenderPMDApp::PrepareCommandBuffersPrimary()
-{
-  VkFenceCreateInfo fenceCI{
-    VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr,
-    VK_FENCE_CREATE_SIGNALED_BIT
+  // \[tvZp.
+  array<VkDescriptorSetLayoutBinding, 5> morphLayoutBindings{
+    {
+      { 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // MorphVertices
+      { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // BasePositions
+      { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Deltas
+      { 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Weights
+      { 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Vertices
+    }
   };
-  VkCommandBufferAllocateInfo commandAI{
-    VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, nullptr,
-    m_commandPool,
-    VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1
+  descriptorSetLayoutCI.bindingCount = uint32_t(morphLayoutBindings.size());
+  descriptorSetLayoutCI.pBindings = morphLayoutBindings.data();
+  result = vkCreateDescriptorSetLayout(m_device, &descriptorSetLayoutCI, nullptr, &descriptorSetLayout);
+  ThrowIfFailed(result, "vkCreateDescriptorSetLayout Failed.");
+  RegisterLayout("morph", descriptorSetLayout);
+
+  VkPushConstantRange morphPushConstant{
+    VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t) * 4
   };
+  pipelineLayoutCI.pSetLayouts = &descriptorSetLayout;
+  pipelineLayoutCI.pushConstantRangeCount = 1;
+  pipelineLayoutCI.pPushConstantRanges = &morphPushConstant;
+  result = vkCreatePipelineLayout(m_device, &pipelineLayoutCI, nullptr, &pipelineLayout);
+  ThrowIfFailed(result, "vkCreatePipelineLayout Failed.");
+  RegisterLayout("morph", pipelineLayout);
 
-  VkResult result;
-  auto imageCount = m_swapchain->GetImageCount();
-  m_mainCommands.resize(imageCount);
-  for (uint32_t i = 0; i < imageCount; ++i)
+
+}
+
+void RenderPMDApp::CheckCrowdPose(AnimationRuntime::InstanceId instance)
+{
+  // QO̎p PoseCache Ŗ񏉊pvZ. [V̏I߂t[ŁA
+  // Đ𑱂Ă Animator ̎pƈv邱 (IgbNpɖ߂Ȃ) m߂.
+  const float tolerance = 1.0e-3f;
+  auto frame = float(m_animator.GetFramePeriod()) + 30.0f;
+  m_animator.UpdateAnimation(0.0f);
+  m_animator.UpdateAnimation(float(m_animator.GetFramePeriod()));
+  m_animator.UpdateAnimation(frame);
+  auto boneCount = m_model.GetSkeleton()->GetBoneCount();
+  std::vector<mat4> direct(boneCount);
+  m_animationRuntime.GetSkinMatrices(instance, direct.data(), boneCount);
+
+  m_poseCache.BeginFrame();
+  auto pose = m_poseCache.Request(m_crowdMotion, frame);
+  m_poseCache.Evaluate();
+  auto cached = m_poseCache.GetSkinMatrices(pose);
+  float maxDiff = 0.0f;
+  for (uint32_t i = 0; i < boneCount; ++i)
+  {
+    for (int col = 0; col < 4; ++col)
+    {
+      for (int row = 0; row < 4; ++row)
+      {
+        maxDiff = (std::max)(maxDiff, std::fabs(cached[i][col][row] - direct[i][col][row]));
+      }
+    }
+  }
+  m_animator.UpdateAnimation(0.0f);
+
+  char buf[128];
+  snprintf(buf, sizeof(buf), "Crowd pose check at frame %.0f: max difference %.2e%s\n",
+    frame, maxDiff, maxDiff > tolerance ? " (mismatch)" : "");
+  book_util::OutputDebugMessage(buf);
+}
+
+void RenderPMDApp::UpdateCrowd(uint32_t imageIndex)
+{
+  // O[vƂɂ炵t[̎pv. p 1 񂾂vZ.
+  // QO̓[VJԂĐA炵t[[V̒̒Ɏ߂.
+  const float groupOffset = 10.0f;
+  auto period = float(m_animator.GetFramePeriod());
+  m_poseCache.BeginFrame();
+  std::vector<PoseCache::PoseId> poses(m_crowdSize);
+  for (uint32_t i = 0; i < m_crowdSize; ++i)
   {
-    result = vkAllocateCommandBuffers(m_device, &commandAI, &m_mainCommands[i].command);
-    ThrowIfFailed(result, "vkAllocateCommandBuffers Failed.");
-    result = vkCreateFence(m_device, &fenceCI, nullptr, &m_mainCommands[i].fence);
-    ThrowIfFailed(result, "vkCreateFence Failed.");
+    auto frame = m_animationFrame + groupOffset * float(i % CrowdGroupCount);
+    if (period > 0.0f)
+    {
+      frame = std::fmod(frame, period);
+    }
+    poses[i] = m_poseCache.Request(m_crowdMotion, frame);
+  }
+  m_poseCache.Evaluate(&m_jobSystem);
+
+  // pƂɃ{[s̑g 1 uALN^[͊iqɕׂĂ̑gQƂ.
+  m_model.ClearInstances();
+  m_posePalettes.clear();
+  auto columns = uint32_t(std::ceil(std::sqrt(float(m_crowdSize))));
+  const float spacing = 8.0f;
+  for (uint32_t i = 0; i < m_crowdSize; ++i)
+  {
+    auto pose = poses[i];
+    if (pose >= m_posePalettes.size())
+    {
+      m_posePalettes.resize(pose + 1, Model::InvalidPalette);
+    }
+    auto& palette = m_posePalettes[pose];
+    if (palette == Model::InvalidPalette)
+    {
+      palette = m_model.AddBonePalette(m_poseCache.GetSkinMatrices(pose));
+    }
+    auto column = i % columns, row = i / columns;
+    auto position = vec3((float(column) - float(columns - 1) * 0.5f) * spacing, 0.0f, -float(row) * spacing);
+    m_model.AddInstance(glm::translate(mat4(1.0f), position), palette);
+  }
+  m_model.UpdateInstances(imageIndex, this);
+
+  // _obt@͋L̂ŁA\͐擪̃LN^[̂̂g.
+  auto weights = m_poseCache.GetMorphWeights(poses[0]);
+  for (uint32_t i = 0; i < m_model.GetFaceMorphCount(); ++i)
+  {
+    m_model.SetFaceMorphWeight(i, weights[i]);
   }
 }
 
@@ -454,13 +623,17 @@ void RenderPMDApp::RenderShadowPass(VkCommandBuffer command, uint32_t imageIndex
   };
 
   vkCmdBeginRenderPass(command, &rpBI, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
-  auto modelCommands = m_model.GetCommandBuffersShadow(imageIndex);
+  auto modelCommands = m_crowdSize > 0 ? m_model.GetCommandBuffersInstancedShadow(imageIndex) : m_model.GetCommandBuffersShadow(imageIndex);
   vkCmdExecuteCommands(command, uint32_t(modelCommands.size()), modelCommands.data());
   vkCmdEndRenderPass(command);
 }
 
 void RenderPMDApp::RenderImGui(VkCommandBuffer command)
 {
+  if (IsHeadless())
+  {
+    return;
+  }
   ImGui_ImplVulkan_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
@@ -472,14 +645,61 @@ void RenderPMDApp::RenderImGui(VkCommandBuffer command)
 
     auto cameraPos = m_camera.GetPosition();
     ImGui::Text("CameraPos: (%.2f, %.2f, %.2f)", cameraPos.x, cameraPos.y, cameraPos.z);
+    const auto& loadTimings = m_model.GetLoadTimings();
+    ImGui::Text("ModelLoad %.2f ms (parse %.2f, decode %.2f, skeleton %.2f)",
+      loadTimings.totalMs, loadTimings.parseMs, loadTimings.decodeMs, loadTimings.skeletonMs);
+    ImGui::Text("Textures %u (decode %.2f, wait %.2f, upload %.2f, descriptor %.2f)",
+      loadTimings.textureCount, loadTimings.textureDecodeMs, loadTimings.textureWaitMs,
+      loadTimings.uploadMs, loadTimings.descriptorMs);
+    auto ikStats = m_animationRuntime.GetIkStatistics();
+    if (ikStats.solveCount > 0)
+    {
+      ImGui::Text("IK %.2f iterations/solve, %.2f us/solve (converged %.1f%%)",
+        double(ikStats.iterationCount) / ikStats.solveCount, ikStats.solveMs * 1000.0 / ikStats.solveCount,
+        100.0 * ikStats.convergedCount / ikStats.solveCount);
+    }
+    const auto& pacerStats = m_framePacer->GetStatistics();
+    ImGui::Text("FramesInFlight %u: CPU wait %.2f ms, GPU %.2f ms (idle %.2f ms)",
+      m_framePacer->GetFramesInFlight(), pacerStats.cpuWaitMs, pacerStats.gpuBusyMs, pacerStats.gpuIdleMs);
+    // \Ȃł vkQueuePresentKHR ̖߂܂ł̒lɂȂ.
+    auto latency = m_swapchain->GetRecentLatencyStatistics();
+    const auto& presentTimings = m_swapchain->GetPresentTimings();
+    auto isDisplayTime = !presentTimings.empty() && presentTimings.back().isDisplayTime;
+    ImGui::Text("%s x%u: acquire->present %.2f ms, submit->present %.2f ms (max %.2f ms)%s",
+      Swapchain::GetPresentModeName(m_swapchain->GetPresentMode()), m_swapchain->GetImageCount(),
+      latency.acquireToPresentMs, latency.submitToPresentMs, latency.maxSubmitToPresentMs,
+      isDisplayTime ? " display" : "");
+    const auto& pipelineStats = m_pipelineManager->GetStatistics();
+    ImGui::Text("PipelineCache %s (%.1f KB): %u pipelines in %.2f ms",
+      pipelineStats.isWarm ? "warm" : "cold", pipelineStats.loadedBytes / 1024.0,
+      pipelineStats.pipelineCount, pipelineStats.createMs);
+    const auto& shaderStats = m_shaderLibrary->GetStatistics();
+    ImGui::Text("Shaders %u modules for %u loads, %u reloaded%s",
+      shaderStats.moduleCount, shaderStats.loadCount, shaderStats.reloadCount,
+      m_shaderLibrary->IsSourceCompileEnabled() ? " (source)" : "");
+    if (m_crowdSize > 0)
+    {
+      const auto& poseStats = m_poseCache.GetStatistics();
+      ImGui::Text("Crowd %u characters, %u poses (%u evaluated)", m_crowdSize, poseStats.poseCount, poseStats.evaluatedCount);
+    }
     ImGui::Checkbox("Outline", &m_drawOutline);
     ImGui::ColorEdit3("Outline", (float*)&m_sceneParameters.outlineColor);
     ImGui::Spacing();
-    ImGui::InputInt("Frame: ", &m_frameCount);
-    if (ImGui::Checkbox("EnableAnimation", &m_isAnimeStart))
+    auto frame = int(m_animationClock.GetFrame());
+    if (ImGui::InputInt("Frame: ", &frame))
+    {
+      m_animationClock.SetFrame(frame);
+    }
+    if (ImGui::Checkbox("EnableAnimation", &m_isAnimeStart) && m_isAnimeStart)
+    {
+      m_animationClock.Reset();
+    }
+    auto speed = float(m_animationClock.GetSpeed());
+    if (ImGui::SliderFloat("Speed", &speed, 0.1f, 2.0f))
     {
-      m_frameCount = m_isAnimeStart ? 0 : m_frameCount;
+      m_animationClock.SetSpeed(speed);
     }
+    ImGui::Text("AnimationFrame %.2f (%.3f s)", m_animationFrame, m_animationClock.GetTime());
     ImGui::End();
   }
 
@@ -13,6 +13,9 @@
 #include "Camera.h"
 #include "Model.h"
 #include "Animator.h"
+#include "AnimationClock.h"
+#include "PoseCache.h"
+#include "VulkanBookUtil.h"
 
 class RenderPMDApp : public VulkanAppBase
 {
@@ -28,14 +31,23 @@ public:
   virtual void OnMouseButtonUp(int button);
   virtual void OnMouseMove(int dx, int dy);
 
+  // Ԃł͂ȂA1 t[̕`悲ƂɃAj[V 1/fps bi߂ (ItC`p).
+  void SetFixedFrameRate(double fps);
+  // Prepare O 1 ȏݒ肷ƁAf count ׂ̕ăCX^X`悷.
+  // LN^[ CrowdGroupCount ̃O[vƂɃ[V炵Ap PoseCache ŋL.
+  void SetCrowdSize(uint32_t count) { m_crowdSize = count; }
+  // Prepare O true ݒ肷ƁAVMD ̕ϊʂƃfBNg motion_cache ɕۑĎ񂩂g.
+  void SetMotionCacheEnabled(bool enabled) { m_isMotionCacheEnabled = enabled; }
+
 private:
   void CreateRenderPass();
   void PrepareDepthbuffer();
   void PrepareFramebuffers();
   void PrepareShadowTargets();
   void PrepareLayout();
-  void PrepareCommandBuffersPrimary();
 
+  void CheckCrowdPose(AnimationRuntime::InstanceId instance);
+  void UpdateCrowd(uint32_t imageIndex);
   void RenderShadowPass(VkCommandBuffer command, uint32_t imageIndex);
   void RenderImGui(VkCommandBuffer command);
 private:
@@ -48,22 +60,30 @@ private:
   
   enum {
     ShadowSize = 1024,
+    CrowdGroupCount = 16,
   };
-  struct CommandBuffer
-  {
-    VkFence fence;
-    VkCommandBuffer command;
-  };
-  std::vector<CommandBuffer> m_mainCommands;
   Model m_model;
   Model::SceneParameter m_sceneParameters;
   Animator m_animator;
+  AnimationRuntime m_animationRuntime;
+  JobSystem m_jobSystem;
+  JobGraph m_animationJobs;
+  JobGraph::JobId m_animationDone;
+  float m_animationFrame;
+  AnimationClock m_animationClock;
+  book_util::StopWatch m_frameTimer;
+  bool m_isFixedFrameRate;
+  bool m_isMotionCacheEnabled;
+
+  uint32_t m_crowdSize;
+  PoseCache m_poseCache;
+  PoseCache::MotionId m_crowdMotion;
+  std::vector<uint32_t> m_posePalettes; // PoseCache ̎p̔ԍ  ̃t[̃{[s̑g.
 
   Camera m_camera;
   bool m_drawOutline;
   std::vector<float> m_faceWeights;
 
-  int m_frameCount;
   bool m_isAnimeStart;
 };
 
@@ -0,0 +1,192 @@
+// Aj[VvZ̃x`}[N.
+//  12_Animation_AnimationBenchmark [VMDt@C]
+// VMD ̕ԋȐɂāA]̃j[g@ 32 񔽕 BezierCurveTable r.
+// VMD t@Cw肷Ƃ̋ȐŏԂv (ȗ͗ōȐ).
+#include "BezierCurveTable.h"
+#include "VulkanBookUtil.h"
+#include "loader/PMDloader.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace glm;
+
+namespace
+{
+  // ] Animator::InterporateBezier ƓvZ.
+  float dFx(float ax, float ay, float t)
+  {
+    float s = 1.0f - t;
+    return -6.0f * s * t * t * ax + 3.0f * s * s * ax - 3.0f * t * t * ay + 6.0f * s * t * ay + 3.0f * t * t;
+  }
+  float fx(float ax, float ay, float t, float x0)
+  {
+    float s = 1.0f - t;
+    return 3.0f * s * s * t * ax + 3.0f * s * t * t * ay + t * t * t - x0;
+  }
+  float InterporateBezierNewton(const vec4& bezier, float x)
+  {
+    float t = 0.5f;
+    float ft = fx(bezier.x, bezier.z, t, x);
+    for (int i = 0; i < 32; ++i)
+    {
+      auto dfx = dFx(bezier.x, bezier.z, t);
+      t = t - ft / dfx;
+      ft = fx(bezier.x, bezier.z, t, x);
+    }
+    t = std::min(std::max(0.0f, t), 1.0f);
+    float s = 1.0f - t;
+    return 3.0f * s * s * t * bezier.y + 3.0f * s * t * t * bezier.w + t * t * t;
+  }
+
+  // 񕪖@ɂl ({x).
+  double InterporateBezierReference(double x1, double y1, double x2, double y2, double x)
+  {
+    auto cubic = [](double p1, double p2, double t) {
+      double s = 1.0 - t;
+      return 3.0 * s * s * t * p1 + 3.0 * s * t * t * p2 + t * t * t;
+    };
+    double lo = 0.0, hi = 1.0;
+    for (int i = 0; i < 60; ++i)
+    {
+      double mid = (lo + hi) * 0.5;
+      (cubic(x1, x2, mid) < x ? lo : hi) = mid;
+    }
+    return cubic(y1, y2, (lo + hi) * 0.5);
+  }
+
+  struct ErrorStats
+  {
+    double maxError = 0.0;
+    double sumError = 0.0;
+    uint64_t count = 0;
+    void Add(double e)
+    {
+      if (std::isnan(e))
+      {
+        e = 1.0;
+      }
+      maxError = std::max(maxError, e);
+      sumError += e;
+      ++count;
+    }
+  };
+
+  void MeasureAccuracy()
+  {
+    // _ 9 ݂őSđgݍ킹ȐAx  200 _ŕ].
+    const int step = 9;
+    const int samples = 200;
+    BezierCurveTable table;
+    ErrorStats tableError, newtonError;
+    for (int x1 = 0; x1 < 128; x1 += step)
+    for (int y1 = 0; y1 < 128; y1 += step)
+    for (int x2 = 0; x2 < 128; x2 += step)
+    for (int y2 = 0; y2 < 128; y2 += step)
+    {
+      auto curve = table.Register(uint8_t(x1), uint8_t(y1), uint8_t(x2), uint8_t(y2));
+      vec4 bezier(x1 / 127.0f, y1 / 127.0f, x2 / 127.0f, y2 / 127.0f);
+      for (int i = 0; i <= samples; ++i)
+      {
+        double x = double(i) / samples;
+        double ref = InterporateBezierReference(x1 / 127.0, y1 / 127.0, x2 / 127.0, y2 / 127.0, x);
+        tableError.Add(std::fabs(table.Evaluate(curve, float(x)) - ref));
+        newtonError.Add(std::fabs(InterporateBezierNewton(bezier, float(x)) - ref));
+      }
+    }
+    printf("Accuracy against bisection (%u curves, %d samples each)\n", table.GetCurveCount(), samples + 1);
+    printf("  %-8s max %.2e  mean %.2e\n", "table", tableError.maxError, tableError.sumError / tableError.count);
+    printf("  %-8s max %.2e  mean %.2e\n", "newton", newtonError.maxError, newtonError.sumError / newtonError.count);
+  }
+
+  // 1 {[ 4 `l (X, Y, Z, ]) ]鎞Ԃv.
+  void MeasureCost(const std::vector<vec4>& curves)
+  {
+    BezierCurveTable table;
+    std::vector<BezierCurveTable::CurveId> ids;
+    ids.reserve(curves.size());
+    for (const auto& c : curves)
+    {
+      ids.push_back(table.Register(c));
+    }
+    auto boneCount = uint32_t(curves.size() / 4);
+    const uint32_t frames = 200;
+
+    volatile float sink = 0.0f;
+    book_util::StopWatch stopWatch;
+    float sum = 0.0f;
+    for (uint32_t frame = 0; frame < frames; ++frame)
+    {
+      float rate = (frame + 0.5f) / frames;
+      for (size_t i = 0; i < curves.size(); ++i)
+      {
+        sum += InterporateBezierNewton(curves[i], rate);
+      }
+    }
+    double newtonMs = stopWatch.GetElapsedMs();
+    sink = sum;
+
+    stopWatch.Reset();
+    sum = 0.0f;
+    for (uint32_t frame = 0; frame < frames; ++frame)
+    {
+      float rate = (frame + 0.5f) / frames;
+      for (size_t i = 0; i < ids.size(); ++i)
+      {
+        sum += table.Evaluate(ids[i], rate);
+      }
+    }
+    double tableMs = stopWatch.GetElapsedMs();
+    sink = sum;
+
+    double evaluations = double(boneCount) * frames;
+    printf("Per-bone cost (%u bones x %u frames, %u unique curves)\n", boneCount, frames, table.GetCurveCount());
+    printf("  %-8s %.1f ns/bone\n", "newton", newtonMs * 1.0e6 / evaluations);
+    printf("  %-8s %.1f ns/bone\n", "table", tableMs * 1.0e6 / evaluations);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MeasureAccuracy();
+
+  std::vector<vec4> curves;
+  if (argc > 1)
+  {
+    std::ifstream infile(argv[1], std::ios::binary);
+    if (!infile)
+    {
+      printf("Failed to open %s\n", argv[1]);
+      return 1;
+    }
+    loader::VMDFile loader(infile);
+    for (uint32_t i = 0; i < loader.getNodeCount(); ++i)
+    {
+      for (const auto& key : loader.getKeyframes(loader.getNodeName(i)))
+      {
+        for (int c = 0; c < 4; ++c)
+        {
+          curves.push_back(key.getBezierParam(c));
+        }
+      }
+    }
+  }
+  if (curves.empty())
+  {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(0, 127);
+    curves.resize(4 * 4096);
+    for (auto& c : curves)
+    {
+      c = vec4(dist(rng), dist(rng), dist(rng), dist(rng)) / 127.0f;
+    }
+  }
+  MeasureCost(curves);
+  return 0;
+}
@@ -1,39 +1,35 @@
 #include "Animator.h"
 #include <fstream>
+#include <cstddef>
 
 #include "loader/PMDloader.h"
+#include "loader/MotionCache.h"
 
 #include "Model.h"
 
 using namespace std;
 using namespace glm;
 
-static float dFx(float ax, float ay, float t)
-{
-  float s = 1.0f - t;
-  float v = -6.0f * s * t * t * ax + 3.0f * s * s * ax - 3.0f * t * t * ay + 6.0f * s * t * ay + 3.0f * t * t;
-  return v;
-}
-static float fx(float ax, float ay, float t, float x0)
-{
-  float s = 1.0f - t;
-  return 3.0f * s * s * t * ax + 3.0f * s * t * t * ay + t * t * t - x0;
-}
-
-static float funcBezierX(glm::vec4 k, float t)
-{
-  float s = 1.0f - t;
-  return 3.0f * s * s * t * k.x + 3.0f * s * t * t * k.y + t * t * t;
-}
-static float funcBezierY(glm::vec4 k, float t)
-{
-  float s = 1.0f - t;
-  return 3.0f * s * s * t * k.y + 3.0f * s * t * t * k.w + t * t * t;
-}
-
+// LbṼL[ NodeAnimeFrame ƂĒڎQƂ.
+static_assert(sizeof(NodeAnimeFrame) == sizeof(loader::motioncache::NodeKey), "NodeAnimeFrame layout");
+static_assert(offsetof(NodeAnimeFrame, translation) == offsetof(loader::motioncache::NodeKey, translation), "NodeAnimeFrame layout");
+static_assert(offsetof(NodeAnimeFrame, rotation) == offsetof(loader::motioncache::NodeKey, rotation), "NodeAnimeFrame layout");
+static_assert(offsetof(NodeAnimeFrame, curveX) == offsetof(loader::motioncache::NodeKey, curves), "NodeAnimeFrame layout");
+static_assert(sizeof(MorphAnimeFrame) == sizeof(loader::motioncache::MorphKey), "MorphAnimeFrame layout");
 
 void Animator::Prepare(const char* filename)
 {
+  std::string cacheFile;
+  if (!m_cacheDirectory.empty())
+  {
+    cacheFile = loader::motioncache::getCachePath(m_cacheDirectory, filename);
+    if (PrepareCache(cacheFile.c_str(), filename))
+    {
+      return;
+    }
+  }
+
+  ClearTracks();
   std::ifstream infile(filename, std::ios::binary);
   loader::VMDFile loader(infile);
 
@@ -55,10 +51,10 @@ void Animator::Prepare(const char* filename)
       dst.frame = src.getKeyframeNumber();
       dst.translation = src.getLocation();
       dst.rotation = src.getRotation();
-      dst.interpX = src.getBezierParam(0);
-      dst.interpY = src.getBezierParam(1);
-      dst.interpZ = src.getBezierParam(2);
-      dst.interpR = src.getBezierParam(3);
+      dst.curveX = m_curveTable.Register(src.getBezierParam(0));
+      dst.curveY = m_curveTable.Register(src.getBezierParam(1));
+      dst.curveZ = m_curveTable.Register(src.getBezierParam(2));
+      dst.curveR = m_curveTable.Register(src.getBezierParam(3));
     }
     keyframes.SetKeyframes(frames);
   }
@@ -82,13 +78,135 @@ void Animator::Prepare(const char* filename)
     }
     keyframes.SetKeyframes(frames);
   }
+
+  // LbVgꍇ͎͂炩ǂݍ. oȂĂĐɂ͉eȂ.
+  // fݒς݂ȂgbN̔ԍĕۑ.
+  if (!cacheFile.empty())
+  {
+    loader::motioncache::CookOptions options;
+    std::vector<std::string> boneNames, morphNames;
+    if (m_model != nullptr)
+    {
+      GetModelNames(boneNames, morphNames);
+      options.boneNames = &boneNames;
+      options.morphNames = &morphNames;
+    }
+    if (loader::motioncache::getFileStamp(filename, options.sourceSize, options.sourceTime))
+    {
+      loader::motioncache::createDirectory(m_cacheDirectory);
+      loader::motioncache::cook(loader, cacheFile.c_str(), options);
+    }
+  }
+
+  // Ƀfݒ肳Ă΃gbNѕt.
+  BindTracks();
+}
+
+bool Animator::PrepareCache(const char* cacheFile, const char* sourceFile)
+{
+  auto cache = std::make_unique<loader::MotionCache>(cacheFile);
+  if (!cache->isValid() || (sourceFile != nullptr && !cache->isUpToDate(sourceFile)))
+  {
+    return false;
+  }
+  ClearTracks();
+
+  // ̃e[u֕ۑɓo^ƁAL[ԍƈv.
+  for (uint32_t i = 0; i < cache->getCurveCount(); ++i)
+  {
+    const auto& c = cache->getCurve(i);
+    if (m_curveTable.Register(c.x1, c.y1, c.x2, c.y2) != i + 1)
+    {
+      ClearTracks();
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < cache->getNodeTrackCount(); ++i)
+  {
+    const auto& track = cache->getNodeTrack(i);
+    auto& animation = m_nodeMap[cache->getName(track)];
+    if (cache->isQuantized())
+    {
+      std::vector<NodeAnimeFrame> frames(track.keyCount);
+      cache->decodeNodeKeys(track, reinterpret_cast<loader::motioncache::NodeKey*>(frames.data()));
+      animation.SetKeyframes(frames);
+    }
+    else
+    {
+      animation.SetKeyframes(reinterpret_cast<const NodeAnimeFrame*>(cache->getNodeKeys(track)), track.keyCount);
+    }
+    m_resolvedNodes.emplace_back(track.resolvedIndex, &animation);
+  }
+  for (uint32_t i = 0; i < cache->getMorphTrackCount(); ++i)
+  {
+    const auto& track = cache->getMorphTrack(i);
+    auto& animation = m_morphMap[cache->getName(track)];
+    animation.SetKeyframes(reinterpret_cast<const MorphAnimeFrame*>(cache->getMorphKeys(track)), track.keyCount);
+    m_resolvedMorphs.emplace_back(track.resolvedIndex, &animation);
+  }
+  m_framePeriod = cache->getFrameCount();
+  m_motionCache = std::move(cache);
+
+  BindTracks();
+  return true;
+}
+
+void Animator::ClearTracks()
+{
+  m_nodeBindings.clear();
+  m_morphBindings.clear();
+  m_resolvedNodes.clear();
+  m_resolvedMorphs.clear();
+  m_nodeMap.clear();
+  m_morphMap.clear();
+  m_curveTable.Clear();
+  m_motionCache.reset();
+  m_framePeriod = 0;
 }
 
 void Animator::Cleanup()
 {
 }
 
-void Animator::UpdateAnimation(uint32_t animeFrame)
+void Animator::CompressNodeTracks(const CompressedNodeTrack::Settings& settings)
+{
+  for (auto& node : m_nodeMap)
+  {
+    if (!node.second.IsCompressed())
+    {
+      node.second.Compress(m_curveTable, settings);
+    }
+  }
+}
+
+size_t Animator::GetTrackMemorySize() const
+{
+  size_t size = 0;
+  for (const auto& node : m_nodeMap)
+  {
+    size += node.second.GetMemorySize();
+  }
+  for (const auto& morph : m_morphMap)
+  {
+    size += morph.second.GetMemorySize();
+  }
+  return size;
+}
+
+void Animator::UpdateAnimation(float animeFrame)
+{
+  if (m_model == nullptr)
+  {
+    return;
+  }
+  SampleAnimation(animeFrame);
+
+  m_runtime->UpdateWorldMatrices(m_instance);
+  m_runtime->SolveIK(m_instance);
+}
+
+void Animator::SampleAnimation(float animeFrame)
 {
   if (m_model == nullptr)
   {
@@ -96,193 +214,198 @@ void Animator::UpdateAnimation(uint32_t animeFrame)
   }
 
   // SẴm[hŎw肳ꂽt[ł̒lvZ.
-  UpdateNodeAnimation(animeFrame);
-  UpdateMorthAnimation(animeFrame);
+  UpdateNodeAnimation(animeFrame, *m_runtime, m_instance);
+  UpdateMorthAnimation(animeFrame, nullptr);
+}
 
-  UpdateIKchains();
+void Animator::SampleAnimation(float animeFrame, AnimationRuntime& runtime, AnimationRuntime::InstanceId instance, float* morphWeights)
+{
+  UpdateNodeAnimation(animeFrame, runtime, instance);
+  UpdateMorthAnimation(animeFrame, morphWeights);
 }
 
-void Animator::UpdateNodeAnimation(uint32_t animeFrame)
+PoseCache::MotionId Animator::AddToPoseCache(PoseCache& cache)
 {
-  auto boneCount = m_model->GetBoneCount();
-  for (uint32_t i = 0; i < boneCount; ++i) {
-    auto bone = m_model->GetBone(i);
+  return cache.AddMotion(m_model->GetSkeleton(), m_model->GetFaceMorphCount(),
+    [this](float frame, AnimationRuntime& runtime, AnimationRuntime::InstanceId instance, float* morphWeights) {
+      SampleAnimation(frame, runtime, instance, morphWeights);
+    });
+}
 
-    auto itr = m_nodeMap.find(bone->GetName());
-    if (itr == m_nodeMap.end())
-    {
-      continue;
-    }
-    auto segment = (*itr).second.FindSegment(animeFrame);
-    auto start = std::get<0>(segment);
-    auto last = std::get<1>(segment);
+JobGraph::JobId Animator::AddJobs(JobGraph& graph, const float& animeFrame)
+{
+  auto frame = &animeFrame;
+  auto nodes = graph.Add([this, frame]() { UpdateNodeAnimation(*frame, *m_runtime, m_instance); });
+  auto morphs = graph.Add([this, frame]() { UpdateMorthAnimation(*frame, nullptr); });
+  auto pose = m_runtime->AddUpdateJobs(graph, m_instance, nodes);
+  return graph.Add(nullptr, { pose, morphs });
+}
 
-    // `.
-    auto range = float(last.frame - start.frame);
-    vec3 translation = start.translation;
-    quat rotation = start.rotation;
-    if (range > 0)
+void Animator::UpdateNodeAnimation(float animeFrame, AnimationRuntime& runtime, AnimationRuntime::InstanceId instance)
+{
+  // L[̃t[ԍ͐Ȃ̂ŁAԂ͏؂̂Ăt[ŒT΂悢.
+  animeFrame = (std::max)(animeFrame, 0.0f);
+  auto keyFrame = uint32_t(animeFrame);
+  for (auto& binding : m_nodeBindings)
+  {
+    const auto& animation = *binding.animation;
+    auto segment = animation.FindSegment(keyFrame, binding.cursor);
+    if (animation.IsCompressed())
     {
-      auto rate = float(animeFrame - start.frame) / float(range);
-      translation = start.translation;
-      translation += (last.translation - start.translation) * rate;
-      translation += bone->GetInitialTranslation();
-      rotation = normalize(glm::slerp(start.rotation, last.rotation, rate));
+      const auto& track = animation.GetCompressed();
+      SampleNode(binding, track.GetKey(segment.start), track.GetKey(segment.last), animeFrame, runtime, instance);
     }
-    if (range == 0)
+    else
     {
-      continue;
+      SampleNode(binding, animation.GetKeyframe(segment.start), animation.GetKeyframe(segment.last), animeFrame, runtime, instance);
     }
-    bone->SetTranslation(translation);
-    bone->SetRotation(rotation);
-
-#if 01
-    auto rate = float(animeFrame - start.frame) / float(range);
-    vec4 bezierK(0.f);
-    bezierK.x = InterporateBezier(start.interpX, rate);
-    bezierK.y = InterporateBezier(start.interpY, rate);
-    bezierK.z = InterporateBezier(start.interpZ, rate);
-    bezierK.w = InterporateBezier(start.interpR, rate);
-
-    translation = start.translation;
-    translation += (last.translation - start.translation) * vec3(bezierK);
-    translation += bone->GetInitialTranslation();
-    bone->SetTranslation(translation);
-
-    rotation = glm::slerp(start.rotation, last.rotation, bezierK.w);
-    bone->SetRotation(rotation);
-#endif
   }
-  // e{[̎pZbĝōsXV.
-  m_model->UpdateMatrices();
 }
-float Animator::InterporateBezier(const glm::vec4& bezier, float x)
+
+void Animator::SampleNode(const NodeTrackBinding& binding, const NodeAnimeFrame& start, const NodeAnimeFrame& last, float animeFrame,
+  AnimationRuntime& runtime, AnimationRuntime::InstanceId instance)
 {
-  float t = 0.5f;
-  float ft = fx(bezier.x, bezier.z, t, x);
-  for (int i = 0; i < 32; ++i)
+  auto range = float(last.frame - start.frame);
+  if (range == 0)
   {
-    auto dfx = dFx(bezier.x, bezier.z, t);
-    t = t - ft / dfx;
-    ft = fx(bezier.x, bezier.z, t, x);
+    // ŏ̃L[OAŌ̃L[AL[ 1 ̃gbN͂̃L[̒lۂ.
+    // ppvZꍇ (PoseCache) AIgbNpɖ߂Ȃ悤Kݒ肷.
+    runtime.SetLocalTranslation(instance, binding.boneIndex, start.translation + binding.initialTranslation);
+    runtime.SetLocalRotation(instance, binding.boneIndex, start.rotation);
+    return;
   }
-  t = std::min(std::max(0.0f, t), 1.0f);
-  float dy = funcBezierY(bezier, t);
-  return dy;
+  auto rate = (animeFrame - float(start.frame)) / range;
+  vec4 bezierK(0.f);
+  bezierK.x = m_curveTable.Evaluate(start.curveX, rate);
+  bezierK.y = m_curveTable.Evaluate(start.curveY, rate);
+  bezierK.z = m_curveTable.Evaluate(start.curveZ, rate);
+  bezierK.w = m_curveTable.Evaluate(start.curveR, rate);
+
+  auto translation = start.translation;
+  translation += (last.translation - start.translation) * vec3(bezierK);
+  translation += binding.initialTranslation;
+  runtime.SetLocalTranslation(instance, binding.boneIndex, translation);
+
+  auto rotation = glm::slerp(start.rotation, last.rotation, bezierK.w);
+  runtime.SetLocalRotation(instance, binding.boneIndex, rotation);
 }
 
-void Animator::UpdateMorthAnimation(uint32_t animeFrame)
+void Animator::UpdateMorthAnimation(float animeFrame, float* morphWeights)
 {
-  for (auto& m : m_morphMap)
+  animeFrame = (std::max)(animeFrame, 0.0f);
+  auto keyFrame = uint32_t(animeFrame);
+  for (auto& binding : m_morphBindings)
   {
-    auto name = m.first;
-    auto segment = m.second.FindSegment(animeFrame);
-    auto start = std::get<0>(segment);
-    auto last = std::get<1>(segment);
+    const auto& animation = *binding.animation;
+    auto segment = animation.FindSegment(keyFrame, binding.cursor);
+    const auto& start = animation.GetKeyframe(segment.start);
+    const auto& last = animation.GetKeyframe(segment.last);
 
     auto range = float(last.frame - start.frame);
     auto weight = start.weight;
     if (range > 0)
     {
-      auto rate = float(animeFrame - start.frame) / range;
+      auto rate = (animeFrame - float(start.frame)) / range;
       weight += (last.weight - start.weight) * rate;
     }
 
-    auto index = m_model->GetFaceMorphIndex(name);
-    m_model->SetFaceMorphWeight(index, weight);
+    if (morphWeights != nullptr)
+    {
+      morphWeights[binding.morphIndex] = weight;
+    }
+    else
+    {
+      m_model->SetFaceMorphWeight(binding.morphIndex, weight);
+    }
   }
 }
 
-void Animator::Attach(Model* model)
+void Animator::Attach(Model* model, AnimationRuntime* runtime, AnimationRuntime::InstanceId instance)
 {
   m_model = model;
+  m_runtime = runtime;
+  m_instance = instance;
+  BindTracks();
 }
 
-void Animator::UpdateIKchains()
+void Animator::BindTracks()
 {
-  if (m_model == nullptr)
+  m_nodeBindings.clear();
+  m_morphBindings.clear();
+  if (m_model == nullptr || BindResolvedTracks())
   {
     return;
   }
-  auto ikCount = m_model->GetBoneIKCount();
-  for (uint32_t i = 0; i < ikCount; ++i)
+
+  // {[̔ԍɕׂ. fɑ݂ȂgbN͊܂߂Ȃ.
+  auto boneCount = m_model->GetBoneCount();
+  for (uint32_t i = 0; i < boneCount; ++i)
   {
-    SolveIK(m_model->GetBoneIK(i));
+    auto bone = m_model->GetBone(i);
+    auto itr = m_nodeMap.find(bone->GetName());
+    if (itr != m_nodeMap.end())
+    {
+      m_nodeBindings.push_back(NodeTrackBinding{ i, bone->GetInitialTranslation(), &itr->second });
+    }
   }
-}
 
-inline glm::vec4 GetPosition(const glm::mat4& m)
-{
-  return glm::vec4(m[3]);
+  for (auto& m : m_morphMap)
+  {
+    auto index = m_model->GetFaceMorphIndex(m.first);
+    if (index >= 0)
+    {
+      m_morphBindings.push_back(MorphTrackBinding{ index, &m.second });
+    }
+  }
+  std::sort(m_morphBindings.begin(), m_morphBindings.end(),
+    [](const MorphTrackBinding& a, const MorphTrackBinding& b) { return a.morphIndex < b.morphIndex; });
 }
 
-void Animator::SolveIK(const PMDBoneIK& boneIk)
+bool Animator::BindResolvedTracks()
 {
-  auto target = boneIk.GetTarget();
-  auto eff = boneIk.GetEffector();
+  if (!m_motionCache || !m_motionCache->isResolved())
+  {
+    return false;
+  }
+  std::vector<std::string> boneNames, morphNames;
+  GetModelNames(boneNames, morphNames);
+  if (loader::motioncache::computeModelSignature(boneNames, morphNames) != m_motionCache->getModelSignature())
+  {
+    return false;
+  }
 
-  const auto& chains = boneIk.GetChains();
-  for (int ite = 0; ite < boneIk.GetIterationCount(); ++ite)
+  for (const auto& track : m_resolvedNodes)
+  {
+    if (track.first != loader::motioncache::NoIndex)
+    {
+      auto bone = m_model->GetBone(track.first);
+      m_nodeBindings.push_back(NodeTrackBinding{ track.first, bone->GetInitialTranslation(), track.second });
+    }
+  }
+  std::sort(m_nodeBindings.begin(), m_nodeBindings.end(),
+    [](const NodeTrackBinding& a, const NodeTrackBinding& b) { return a.boneIndex < b.boneIndex; });
+  for (const auto& track : m_resolvedMorphs)
   {
-    for (uint32_t i = 0; i < chains.size(); ++i)
+    if (track.first != loader::motioncache::NoIndex)
     {
-      auto bone = chains[i];
-      auto mtxInvBone = glm::inverse(bone->GetWorldMatrix());
-
-      // GtFN^ƃ^[Qbg̈ʒuA݃{[ł̃[JԂɂ.
-      auto effectorPos = vec3(mtxInvBone * GetPosition(eff->GetWorldMatrix()));
-      auto targetPos = vec3(mtxInvBone * GetPosition(target->GetWorldMatrix()));
-
-      auto len = glm::length(targetPos - effectorPos);
-      if (len * len < 0.0001f)
-      {
-        return;
-      }
-      // {[^[QbgуGtFN^֌xNg𐶐.
-      auto vecToEff = glm::normalize(effectorPos);
-      auto vecToTarget = glm::normalize(targetPos);
-
-      auto dot = glm::dot(vecToEff, vecToTarget);
-      dot = glm::clamp(dot, -1.0f, 1.0f);
-      float radian = acosf(dot);
-      if (radian < 0.0001f)
-        continue;
-      auto limitAngle = boneIk.GetAngleWeight();
-      radian = glm::clamp(radian, -limitAngle, limitAngle);
-
-      // ]߂.
-      auto axis = normalize(cross(vecToTarget, vecToEff));
-
-      if (radian < 0.001f)
-      {
-        continue;
-      }
-
-      if (bone->GetName().find("Ђ") != std::string::npos )
-      {
-        auto rotation = angleAxis(radian, axis);
-        auto eulerAngle = eulerAngles(rotation);
-        eulerAngle.y = 0.0f; eulerAngle.z = 0.0f;
-        eulerAngle.x = clamp(eulerAngle.x, 0.002f, glm::pi<float>());
-        rotation = quat(eulerAngle);
-
-        rotation = normalize(bone->GetRotation() * rotation);
-        bone->SetRotation(rotation);
-      }
-      else
-      {
-        auto rotation = angleAxis(radian, axis);
-        rotation = normalize(bone->GetRotation() * rotation);
-        bone->SetRotation(rotation);
-      }
-      
-      // ʒuWXV.
-      for (int j = i; j >= 0; --j)
-      {
-        chains[j]->UpdateWorldMatrix();
-      }
-      eff->UpdateWorldMatrix();
-      target->UpdateWorldMatrix();
+      m_morphBindings.push_back(MorphTrackBinding{ int(track.first), track.second });
     }
   }
+  std::sort(m_morphBindings.begin(), m_morphBindings.end(),
+    [](const MorphTrackBinding& a, const MorphTrackBinding& b) { return a.morphIndex < b.morphIndex; });
+  return true;
+}
+
+void Animator::GetModelNames(std::vector<std::string>& boneNames, std::vector<std::string>& morphNames) const
+{
+  boneNames.resize(m_model->GetBoneCount());
+  for (uint32_t i = 0; i < m_model->GetBoneCount(); ++i)
+  {
+    boneNames[i] = m_model->GetBone(i)->GetName();
+  }
+  morphNames.resize(m_model->GetFaceMorphCount());
+  for (uint32_t i = 0; i < m_model->GetFaceMorphCount(); ++i)
+  {
+    morphNames[i] = m_model->GetFaceMorphName(i);
+  }
 }
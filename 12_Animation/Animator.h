@@ -1,74 +1,90 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <algorithm>
+#include <memory>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include "BezierCurveTable.h"
+#include "AnimationRuntime.h"
+#include "PoseCache.h"
+#include "CompressedTrack.h"
+#include "Keyframe.h"
+#include "loader/MotionCache.h"
+
 class Model;
-class PMDBoneIK;
 
 template<class T>
 class Animation
 {
 public:
- 
-  using Segment = std::tuple<T, T>;
-  Segment FindSegment(uint32_t frame)
+  // frame ܂ދԂ̃L[̔ԍԂ. cursor ̓gbNĐ鑤 (FindKeySegment Q).
+  KeySegment FindSegment(uint32_t frame, uint32_t& cursor) const
   {
-    const T refValue{ frame };
-    typename std::vector<T>::iterator first, last;
+    auto keys = GetKeyframes();
+    return FindKeySegment(m_keyframeCount, frame, cursor, [keys](uint32_t i) { return keys[i].frame; });
+  }
+  const T& GetKeyframe(uint32_t index) const { return GetKeyframes()[index]; }
 
-    last = std::upper_bound(m_keyframes.begin(), m_keyframes.end(),
-      refValue, [](const T& a, const T& b) { return a.frame < b.frame; });
-    first = last - 1;
-    if (last == m_keyframes.end())
-    {
-      last = first;
-    }
-    Segment ret;
-    std::get<0>(ret) = *first;
-    std::get<1>(ret) = *last;
-    return ret;
+  void SetKeyframes(std::vector<T>& src)
+  {
+    m_keyframes = src;
+    m_external = nullptr;
+    m_keyframeCount = uint32_t(m_keyframes.size());
+  }
+  // ɎQƂ. keyframes ͂̃IuWFNg蒷Lł邱.
+  void SetKeyframes(const T* keyframes, uint32_t count)
+  {
+    std::vector<T>().swap(m_keyframes);
+    m_external = keyframes;
+    m_keyframeCount = count;
   }
 
-  void SetKeyframes(std::vector<T>& src) { m_keyframes = src; }
+  const T* GetKeyframes() const { return m_external ? m_external : m_keyframes.data(); }
+  uint32_t GetKeyframeCount() const { return m_keyframeCount; }
+  // mۂĂL[t[̃oCg (QƂĂ邾̂̂͊܂܂Ȃ).
+  size_t GetMemorySize() const { return m_keyframes.capacity() * sizeof(T); }
 private:
+
   std::vector<T> m_keyframes;
+  const T* m_external = nullptr;
+  uint32_t m_keyframeCount = 0;
 };
 
-struct NodeAnimeFrame
+class NodeAnimation : public Animation<NodeAnimeFrame>
 {
-  uint32_t frame;
-  glm::vec3 translation;
-  glm::quat rotation;
-  glm::vec4 interpX;
-  glm::vec4 interpY;
-  glm::vec4 interpZ;
-  glm::vec4 interpR;
-
-  bool operator<(const NodeAnimeFrame& v) const
+public:
+  NodeAnimation() { }
+
+  // L[t[k`ɒu. kłȂΌ̂܂ false Ԃ.
+  bool Compress(const BezierCurveTable& curves, const CompressedNodeTrack::Settings& settings)
   {
-    return frame < v.frame;
+    CompressedNodeTrack compressed;
+    if (!compressed.Build(GetKeyframes(), GetKeyframeCount(), curves, settings))
+    {
+      return false;
+    }
+    m_compressed = std::move(compressed);
+    SetKeyframes(nullptr, 0);
+    return true;
   }
-};
-struct MorphAnimeFrame
-{
-  uint32_t frame;
-  float weight;
+  bool IsCompressed() const { return !m_compressed.IsEmpty(); }
 
-  bool operator<(const MorphAnimeFrame& v) const
+  KeySegment FindSegment(uint32_t frame, uint32_t& cursor) const
   {
-    return frame < v.frame;
+    return IsCompressed() ? m_compressed.FindSegment(frame, cursor) : Animation::FindSegment(frame, cursor);
   }
-};
-
-class NodeAnimation : public Animation<NodeAnimeFrame>
-{
-public:
-  NodeAnimation() { }
+  const CompressedNodeTrack& GetCompressed() const { return m_compressed; }
+  size_t GetMemorySize() const
+  {
+    return IsCompressed() ? m_compressed.GetMemorySize() : Animation::GetMemorySize();
+  }
+private:
+  CompressedNodeTrack m_compressed;
 };
 
 class MorphAnimation : public Animation<MorphAnimeFrame>
@@ -81,27 +97,89 @@ public:
 class Animator
 {
 public:
-  Animator() : m_model(nullptr), m_framePeriod(0) { }
+  Animator() : m_model(nullptr), m_runtime(nullptr), m_instance(0), m_framePeriod(0) { }
 
+  // VMD ǂݍ. SetCacheDirectory Ŏw肵fBNg VMD ƈvϊς݂̃LbV΂gA
+  // Ȃ VMD ĕۑ. fBNgw肵Ȃ΃LbV͎gȂ.
   void Prepare(const char* filename);
+  // Prepare OɌĂяo. LbV motioncache::getCachePath ̖OŒu.
+  void SetCacheDirectory(const std::string& directory) { m_cacheDirectory = directory; }
+  // [VLbVǂݍ. sourceFile w肵ꍇ͂ VMD ƈvȂΎs.
+  bool PrepareCache(const char* cacheFile, const char* sourceFile = nullptr);
   void Cleanup();
 
-  void UpdateAnimation(uint32_t animeFrame);
-
-  void Attach(Model* model);
+  // {[̃gbN CompressedNodeTrack ɒuă炷. p̌vZɌĂяoȂ.
+  void CompressNodeTracks(const CompressedNodeTrack::Settings& settings);
+  // {[ƕ\̃gbNmۂĂoCg.
+  size_t GetTrackMemorySize() const;
+  // Ō̃L[̃t[ԍ.
+  uint32_t GetFramePeriod() const { return m_framePeriod; }
+
+  // pvZAIK [hs܂ł߂.
+  // animeFrame ̓[Ṽt[ԍ (30fps). ̓L[̊ԂŕԂ (AnimationClock::GetFrame).
+  void UpdateAnimation(float animeFrame);
+  // [Jpƕ\[t̃EFCĝ݂ݒ肷.
+  // LN^[܂Ƃ߂ AnimationRuntime::UpdateWorldMatrices() ꍇɎg.
+  void SampleAnimation(float animeFrame);
+  // [Jp runtime  instance ցA\[t̃EFCg morphWeights (\̔ԍ) ֏o.
+  // instance  Attach fƓił邱.  Animator œɌĂяoȂ.
+  void SampleAnimation(float animeFrame, AnimationRuntime& runtime, AnimationRuntime::InstanceId instance, float* morphWeights);
+  // ̃[V Attach f̍i cache ֓o^.
+  // fE[ṼLN^[ 1  Animator LAt[Ƃ cache p.
+  PoseCache::MotionId AddToPoseCache(PoseCache& cache);
+  // UpdateAnimation ƓvZWuƂ graph ֒ǉASĊWuԂ.
+  // m[h̃TvO  sXV  IK ƁA\[t̃TvO͓Ɨɐi.
+  // eWu͎s animeFrame ̒lǂނ̂ŁADispatch ̑OɏĂ.
+  JobGraph::JobId AddJobs(JobGraph& graph, const float& animeFrame);
+
+  // fƎp̏ݐݒ肵AegbNΏۂ̃{[E\̔ԍ֌ѕt.
+  void Attach(Model* model, AnimationRuntime* runtime, AnimationRuntime::InstanceId instance);
 private:
-  void UpdateNodeAnimation(uint32_t animeFrame);
-  void UpdateMorthAnimation(uint32_t animeFrame);
-  void UpdateIKchains();
-  void SolveIK(const PMDBoneIK&);
-
-  static float InterporateBezier(const glm::vec4& bezier, float x);
+  struct NodeTrackBinding;
+
+  void ClearTracks();
+  void BindTracks();
+  bool BindResolvedTracks();
+  void GetModelNames(std::vector<std::string>& boneNames, std::vector<std::string>& morphNames) const;
+  void UpdateNodeAnimation(float animeFrame, AnimationRuntime& runtime, AnimationRuntime::InstanceId instance);
+  void SampleNode(const NodeTrackBinding& binding, const NodeAnimeFrame& start, const NodeAnimeFrame& last, float animeFrame,
+    AnimationRuntime& runtime, AnimationRuntime::InstanceId instance);
+  // morphWeights  nullptr Ȃ烂f֐ݒ肷.
+  void UpdateMorthAnimation(float animeFrame, float* morphWeights);
 
   using NodeAnimationMap = std::unordered_map<std::string, NodeAnimation>;
   using MorphAnimationMap = std::unordered_map<std::string, MorphAnimation>;
   NodeAnimationMap m_nodeMap;
   MorphAnimationMap m_morphMap;
   Model* m_model;
+  AnimationRuntime* m_runtime;
+  AnimationRuntime::InstanceId m_instance;
+  BezierCurveTable m_curveTable;
+
+  // LbVǂݍ񂾏ꍇ̓L[t[}bvQƂ.
+  // gbNԍς݂ł΁Afւ Attach ł͖OȂ.
+  std::unique_ptr<loader::MotionCache> m_motionCache;
+  std::string m_cacheDirectory;
+  std::vector<std::pair<uint32_t, NodeAnimation*>> m_resolvedNodes;
+  std::vector<std::pair<uint32_t, MorphAnimation*>> m_resolvedMorphs;
+
+  // Attach ɖOgbN. t[͂̔ẑ݂𑖍.
+  // cursor ͑Õt[ŌԂ̊JnL[ŁÃt[̌Ɏg.
+  struct NodeTrackBinding
+  {
+    uint32_t boneIndex;
+    glm::vec3 initialTranslation;
+    NodeAnimation* animation;
+    uint32_t cursor = 0;
+  };
+  struct MorphTrackBinding
+  {
+    int morphIndex;
+    MorphAnimation* animation;
+    uint32_t cursor = 0;
+  };
+  std::vector<NodeTrackBinding> m_nodeBindings;
+  std::vector<MorphTrackBinding> m_morphBindings;
 
   uint32_t m_framePeriod;
 };
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+// x`}[Np̃[V̓ǂݍ.
+#include "BezierCurveTable.h"
+#include "Keyframe.h"
+#include "loader/PMDloader.h"
+
+#include <fstream>
+#include <vector>
+
+using NodeTrack = std::vector<NodeAnimeFrame>;
+
+// VMD ̃{[̃gbNǂݍ. Animator::Prepare  VMD ̕ϊƓ.
+// L[ȂgbN͊܂߂Ȃ. JȂ false.
+inline bool LoadNodeTracks(const char* fileName, BezierCurveTable& curves, std::vector<NodeTrack>& tracks)
+{
+  std::ifstream infile(fileName, std::ios::binary);
+  if (!infile)
+  {
+    return false;
+  }
+  loader::VMDFile vmd(infile);
+  for (uint32_t i = 0; i < vmd.getNodeCount(); ++i)
+  {
+    auto framesSrc = vmd.getKeyframes(vmd.getNodeName(i));
+    if (framesSrc.empty())
+    {
+      continue;
+    }
+    NodeTrack track(framesSrc.size());
+    for (size_t j = 0; j < framesSrc.size(); ++j)
+    {
+      auto& dst = track[j];
+      const auto& src = framesSrc[j];
+      dst.frame = src.getKeyframeNumber();
+      dst.translation = src.getLocation();
+      dst.rotation = src.getRotation();
+      dst.curveX = curves.Register(src.getBezierParam(0));
+      dst.curveY = curves.Register(src.getBezierParam(1));
+      dst.curveZ = curves.Register(src.getBezierParam(2));
+      dst.curveR = curves.Register(src.getBezierParam(3));
+    }
+    tracks.push_back(std::move(track));
+  }
+  return true;
+}
@@ -0,0 +1,133 @@
+#pragma once
+// x`}[Np̍i̓ǂݍ݂Ɛ.
+#include "Skeleton.h"
+#include "loader/PMDloader.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// PMD t@C̃{[ IK 獜i. JȂ nullptr.
+inline std::shared_ptr<Skeleton> LoadSkeleton(const char* fileName)
+{
+  std::ifstream infile(fileName, std::ios::binary);
+  if (!infile)
+  {
+    return nullptr;
+  }
+  loader::PMDFile loader(infile);
+  auto boneCount = loader.getBoneCount();
+  std::vector<Skeleton::BoneDesc> bones(boneCount);
+  for (uint32_t i = 0; i < boneCount; ++i)
+  {
+    const auto& src = loader.getBone(i);
+    auto parent = src.getParent();
+    auto translation = src.getPosition();
+    if (parent != 0xFFFFu)
+    {
+      translation = translation - loader.getBone(parent).getPosition();
+    }
+    bones[i] = Skeleton::BoneDesc{
+      parent != 0xFFFFu ? int32_t(parent) : int32_t(Skeleton::NoParent),
+      translation,
+      glm::inverse(glm::translate(src.getPosition())) };
+  }
+  std::vector<Skeleton::IkChain> chains(loader.getIkCount());
+  for (uint32_t i = 0; i < loader.getIkCount(); ++i)
+  {
+    const auto& ik = loader.getIk(i);
+    auto& chain = chains[i];
+    chain.target = ik.getTargetBoneId();
+    chain.effector = ik.getBoneEff();
+    chain.iterationCount = ik.getIterations();
+    chain.angleLimit = ik.getAngleLimit();
+    for (auto id : ik.getChains())
+    {
+      auto knee = Skeleton::IsKneeBoneName(loader.getBone(id).getName());
+      chain.links.push_back(Skeleton::IkLink{ id, knee });
+    }
+  }
+  return std::make_shared<Skeleton>(bones, chains);
+}
+
+// ōi. [gLт limbCount {̎葫(4 i)ɂꂼ IK ݒ肵A
+// c̃{[͊̃{[֓KɂȂ. ԍ͐eqɗ邱Ƃ悤בւ.
+inline std::shared_ptr<Skeleton> MakeRandomSkeleton(uint32_t boneCount, uint32_t limbCount = 4)
+{
+  const uint32_t limbLength = 4;
+  limbCount = std::min(limbCount, (boneCount - 1) / (limbLength + 1));
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<uint32_t> order(boneCount);
+  for (uint32_t i = 0; i < boneCount; ++i)
+  {
+    order[i] = i;
+  }
+  std::shuffle(order.begin() + 1, order.end(), rng);
+
+  //  i ̃{[̔ԍ order[i].
+  std::vector<Skeleton::BoneDesc> bones(boneCount);
+  std::vector<glm::vec3> positions(boneCount);
+  std::vector<bool> isTarget(boneCount, false);
+  auto addBone = [&](uint32_t i, uint32_t parent) {
+    auto translation = glm::vec3(dist(rng), 1.0f + dist(rng), dist(rng));
+    positions[order[i]] = positions[parent] + translation;
+    bones[order[i]] = Skeleton::BoneDesc{ int32_t(parent), translation, glm::inverse(glm::translate(positions[order[i]])) };
+  };
+  bones[order[0]] = Skeleton::BoneDesc{ Skeleton::NoParent, glm::vec3(0.0f), glm::mat4(1.0f) };
+
+  std::vector<Skeleton::IkChain> chains;
+  uint32_t next = 1;
+  for (uint32_t limb = 0; limb < limbCount; ++limb)
+  {
+    auto parent = order[0];
+    Skeleton::IkChain chain{ 0, 0, {}, 15, 0.5f };
+    for (uint32_t j = 0; j < limbLength; ++j, ++next)
+    {
+      addBone(next, parent);
+      parent = order[next];
+    }
+    chain.effector = parent;
+    for (auto p = bones[parent].parent; chain.links.size() < limbLength - 1; p = bones[p].parent)
+    {
+      chain.links.push_back(Skeleton::IkLink{ uint32_t(p), chain.links.empty() });
+    }
+    // ^[Qbg̓[gɒu.
+    addBone(next, order[0]);
+    chain.target = order[next];
+    isTarget[order[next]] = true;
+    ++next;
+    chains.push_back(chain);
+  }
+  for (; next < boneCount; ++next)
+  {
+    uint32_t parent;
+    do
+    {
+      parent = order[std::uniform_int_distribution<uint32_t>(0, next - 1)(rng)];
+    } while (isTarget[parent]);
+    addBone(next, parent);
+  }
+  return std::make_shared<Skeleton>(bones, chains);
+}
+
+// Aj[ṼTvȎɗ^郍[J̉] (Ȋpx) ̕\.
+// ̎͌ŒȂ̂ŁAǂ̃x`}[NłтɂȂ.
+inline std::vector<glm::quat> MakeRandomRotations(uint32_t count = 4096)
+{
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<float> dist(-0.3f, 0.3f);
+  std::vector<glm::quat> rotations(count);
+  for (auto& q : rotations)
+  {
+    q = glm::normalize(glm::quat(1.0f, dist(rng), dist(rng), dist(rng)));
+  }
+  return rotations;
+}
@@ -8,4 +8,10 @@ glslangValidator -V -S frag modelOutlineFS.frag -o modelOutlineFS.spv
 glslangValidator -V -S vert modelShadowVS.vert -o modelShadowVS.spv
 glslangValidator -V -S frag modelShadowFS.frag -o modelShadowFS.spv
 
+glslangValidator -V -S vert modelInstancedVS.vert -o modelInstancedVS.spv
+glslangValidator -V -S vert modelInstancedOutlineVS.vert -o modelInstancedOutlineVS.spv
+glslangValidator -V -S vert modelInstancedShadowVS.vert -o modelInstancedShadowVS.spv
+
+glslangValidator -V -S comp modelMorphCS.comp -o modelMorphCS.spv
+
 @echo on
@@ -0,0 +1,239 @@
+#include "CompressedTrack.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+using namespace glm;
+
+namespace
+{
+  const float Sqrt2 = 1.41421356f;
+  const uint32_t RotationMax = 0x7FFF;
+  // 1 Ԃɂ܂Ƃ߂t[̏. 덷̊mFԂ̒ɔႷ邽.
+  const uint32_t MaxMergeFrames = 1024;
+
+  // Animator::UpdateNodeAnimation Ɠ. Ԃ̒ 0 Ȃ start ̒l.
+  void Interpolate(const NodeAnimeFrame& start, const NodeAnimeFrame& last, uint32_t frame,
+    const BezierCurveTable& curves, vec3& translation, quat& rotation)
+  {
+    auto range = float(last.frame - start.frame);
+    if (range == 0)
+    {
+      translation = start.translation;
+      rotation = start.rotation;
+      return;
+    }
+    auto rate = float(frame - start.frame) / range;
+    vec3 k(curves.Evaluate(start.curveX, rate), curves.Evaluate(start.curveY, rate), curves.Evaluate(start.curveZ, rate));
+    translation = start.translation + (last.translation - start.translation) * k;
+    rotation = glm::slerp(start.rotation, last.rotation, curves.Evaluate(start.curveR, rate));
+  }
+
+  // 2 ̉]̍̊px. ς acos ͍ float ̐xȂ̂ŁA
+  // |a - b| = 2 sin(/4) 狁߂ (q  -q ͓]).
+  float RotationError(const quat& a, const quat& b)
+  {
+    auto square = [](float v) { return v * v; };
+    auto minus = square(a.x - b.x) + square(a.y - b.y) + square(a.z - b.z) + square(a.w - b.w);
+    auto plus = square(a.x + b.x) + square(a.y + b.y) + square(a.z + b.z) + square(a.w + b.w);
+    return 4.0f * std::asin(std::min(std::sqrt(std::min(minus, plus)) * 0.5f, 1.0f));
+  }
+
+  float TranslationError(const vec3& a, const vec3& b)
+  {
+    auto d = glm::abs(a - b);
+    return std::max(d.x, std::max(d.y, d.z));
+  }
+
+  bool IsSamePose(const NodeAnimeFrame& a, const NodeAnimeFrame& b)
+  {
+    return a.translation == b.translation && a.rotation == b.rotation;
+  }
+
+  // keys[first]  keys[last] ܂ł keys[first] ̋Ȑ 1 ԂɂƂA
+  // Ԃ̑SẴt[Ō̃L[ɂlƂ̍e덷ł true.
+  bool CanMerge(const NodeAnimeFrame* keys, uint32_t first, uint32_t last,
+    const BezierCurveTable& curves, const CompressedNodeTrack::Settings& settings)
+  {
+    if (keys[last].frame - keys[first].frame > MaxMergeFrames)
+    {
+      return false;
+    }
+    uint32_t segment = first;
+    for (auto frame = keys[first].frame + 1; frame < keys[last].frame; ++frame)
+    {
+      while (keys[segment + 1].frame <= frame)
+      {
+        ++segment;
+      }
+      vec3 t0, t1;
+      quat r0, r1;
+      Interpolate(keys[segment], keys[segment + 1], frame, curves, t0, r0);
+      Interpolate(keys[first], keys[last], frame, curves, t1, r1);
+      if (TranslationError(t0, t1) > settings.translationTolerance || RotationError(r0, r1) > settings.rotationTolerance)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Βlő̐𐳂ɂďAc 3  (}1/2 ͈̔)  15bit ɂ.
+  // ̔ԍ 1 ڂ 2 ڂ̍ŏʃrbgɓ.
+  void EncodeRotation(const quat& rotation, uint16_t* dst)
+  {
+    auto q = glm::normalize(rotation);
+    float c[4] = { q.x, q.y, q.z, q.w };
+    int largest = 0;
+    for (int i = 1; i < 4; ++i)
+    {
+      if (std::fabs(c[i]) > std::fabs(c[largest]))
+      {
+        largest = i;
+      }
+    }
+    float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+    for (int i = 0, j = 0; i < 4; ++i)
+    {
+      if (i == largest)
+      {
+        continue;
+      }
+      auto v = std::lround((c[i] * sign * Sqrt2 + 1.0f) * 0.5f * RotationMax);
+      dst[j++] = uint16_t(std::min(std::max(v, 0L), long(RotationMax)));
+    }
+    dst[0] |= uint16_t((largest & 1) << 15);
+    dst[1] |= uint16_t((largest >> 1) << 15);
+  }
+
+  quat DecodeRotation(const uint16_t* src)
+  {
+    int largest = (src[0] >> 15) | ((src[1] >> 15) << 1);
+    float c[4];
+    float sum = 0.0f;
+    for (int i = 0, j = 0; i < 4; ++i)
+    {
+      if (i == largest)
+      {
+        continue;
+      }
+      auto v = (float(src[j++] & RotationMax) / RotationMax * 2.0f - 1.0f) / Sqrt2;
+      c[i] = v;
+      sum += v * v;
+    }
+    c[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+    return quat(c[3], c[0], c[1], c[2]);
+  }
+}
+
+bool CompressedNodeTrack::Build(const NodeAnimeFrame* keys, uint32_t keyCount, const BezierCurveTable& curves, const Settings& settings)
+{
+  m_frames.clear();
+  m_rotations.clear();
+  m_translations.clear();
+  m_curveSets.clear();
+  m_curvePalette.clear();
+  if (keyCount == 0)
+  {
+    return true;
+  }
+
+  // O珇ɁAOɎcL[玟̃L[܂ł 1 Ԃɂł΂̃L[菜.
+  std::vector<uint32_t> kept(1, 0);
+  bool reduce = settings.translationTolerance > 0.0f && settings.rotationTolerance > 0.0f;
+  uint32_t anchor = 0;
+  bool constant = true; // keys[anchor]  keys[i] ܂œp.
+  for (uint32_t i = 1; i + 1 < keyCount; ++i)
+  {
+    // pԂ͌덷̊mFȂ.
+    constant = constant && IsSamePose(keys[anchor], keys[i]);
+    if (reduce && ((constant && IsSamePose(keys[anchor], keys[i + 1])) || CanMerge(keys, anchor, i + 1, curves, settings)))
+    {
+      continue;
+    }
+    kept.push_back(i);
+    anchor = i;
+    constant = true;
+  }
+  if (keyCount > 1)
+  {
+    kept.push_back(keyCount - 1);
+  }
+
+  vec3 minT = keys[kept[0]].translation, maxT = minT;
+  for (auto i : kept)
+  {
+    minT = glm::min(minT, keys[i].translation);
+    maxT = glm::max(maxT, keys[i].translation);
+  }
+  m_translationMin = minT;
+  m_translationScale = (maxT - minT) / 65535.0f;
+  bool hasTranslation = maxT != minT;
+
+  std::map<CurveSet, uint16_t> paletteIndex;
+  auto count = kept.size();
+  m_frames.reserve(count);
+  m_rotations.resize(count * 3);
+  m_translations.resize(hasTranslation ? count * 3 : 0);
+  m_curveSets.reserve(count);
+  for (size_t n = 0; n < count; ++n)
+  {
+    const auto& key = keys[kept[n]];
+    m_frames.push_back(key.frame);
+    EncodeRotation(key.rotation, &m_rotations[n * 3]);
+    if (hasTranslation)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        auto scale = m_translationScale[c];
+        auto q = scale > 0.0f ? std::lround((key.translation[c] - minT[c]) / scale) : 0;
+        m_translations[n * 3 + c] = uint16_t(std::min(std::max(q, 0L), 65535L));
+      }
+    }
+
+    CurveSet set = { key.curveX, key.curveY, key.curveZ, key.curveR };
+    auto itr = paletteIndex.find(set);
+    if (itr == paletteIndex.end())
+    {
+      if (m_curvePalette.size() > 0xFFFF)
+      {
+        return false;
+      }
+      itr = paletteIndex.emplace(set, uint16_t(m_curvePalette.size())).first;
+      m_curvePalette.push_back(set);
+    }
+    m_curveSets.push_back(itr->second);
+  }
+  m_curvePalette.shrink_to_fit();
+  return true;
+}
+
+NodeAnimeFrame CompressedNodeTrack::GetKey(uint32_t index) const
+{
+  NodeAnimeFrame key;
+  key.frame = m_frames[index];
+  key.rotation = DecodeRotation(&m_rotations[index * 3]);
+  key.translation = m_translationMin;
+  if (!m_translations.empty())
+  {
+    const auto* t = &m_translations[index * 3];
+    key.translation += vec3(t[0], t[1], t[2]) * m_translationScale;
+  }
+  const auto& curves = m_curvePalette[m_curveSets[index]];
+  key.curveX = curves[0];
+  key.curveY = curves[1];
+  key.curveZ = curves[2];
+  key.curveR = curves[3];
+  return key;
+}
+
+size_t CompressedNodeTrack::GetMemorySize() const
+{
+  return sizeof(*this) +
+    m_frames.capacity() * sizeof(uint32_t) +
+    m_rotations.capacity() * sizeof(uint16_t) +
+    m_translations.capacity() * sizeof(uint16_t) +
+    m_curveSets.capacity() * sizeof(uint16_t) +
+    m_curvePalette.capacity() * sizeof(CurveSet);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "BezierCurveTable.h"
+#include "Keyframe.h"
+
+// {[̃L[t[kĎgbN. 1 L[ 12 oCg (ړʂωgbN 18 oCg).
+//  - Ԃŋe덷ɍČłL[菜. ŏƍŌ̃L[͎c.
+//  - ] smallest-three `. Βlő̐ 3  15bit A̔ԍ 2bit Ŏ.
+//  - ړʂ̓gbN͈̔͂Ŋe 16bit ɗʎq. SẴL[œlȂ玝Ȃ.
+//  - ԋȐ 4 ̔ԍ̑g̓gbN̕\ɂ܂Ƃ߁AL[͂̕\ 16bit ̔ԍ.
+// ʎqɂ덷͕Ԍ̉] 1e-4 rad xAړʂŔ͈͂ 1/131070 ȉ.
+class CompressedNodeTrack
+{
+public:
+  struct Settings
+  {
+    // L[菜Ƃ̋e덷. 0 ȉȂL[菜Ȃ.
+    float translationTolerance = 1.0e-3f;
+    float rotationTolerance = 1.0e-3f; // WA.
+  };
+
+  // keys (t[) k. Ȑ̑g 65536 ނ𒴂ꍇ false.
+  bool Build(const NodeAnimeFrame* keys, uint32_t keyCount, const BezierCurveTable& curves, const Settings& settings);
+
+  bool IsEmpty() const { return m_frames.empty(); }
+  uint32_t GetKeyCount() const { return uint32_t(m_frames.size()); }
+  NodeAnimeFrame GetKey(uint32_t index) const;
+  // Animation::FindSegment Ɠ frame ܂ދԂ̃L[̔ԍԂ. L[ GetKey œWJ.
+  KeySegment FindSegment(uint32_t frame, uint32_t& cursor) const
+  {
+    return FindKeySegment(uint32_t(m_frames.size()), frame, cursor, [this](uint32_t i) { return m_frames[i]; });
+  }
+
+  // mۂĂ郁̃oCg (̃IuWFNg܂).
+  size_t GetMemorySize() const;
+
+private:
+  using CurveSet = std::array<BezierCurveTable::CurveId, 4>;
+
+  std::vector<uint32_t> m_frames;
+  std::vector<uint16_t> m_rotations;    // L[Ƃ 3 .
+  std::vector<uint16_t> m_translations; // L[Ƃ 3 . Ȃ.
+  std::vector<uint16_t> m_curveSets;    // m_curvePalette ̔ԍ.
+  std::vector<CurveSet> m_curvePalette;
+  glm::vec3 m_translationMin = glm::vec3(0.0f);
+  glm::vec3 m_translationScale = glm::vec3(0.0f);
+};
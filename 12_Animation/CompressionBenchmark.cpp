@@ -0,0 +1,197 @@
+// L[t[k̃x`}[N.
+//  12_Animation_CompressionBenchmark [VMDt@C] [e덷]
+// {[̃gbN CompressedNodeTrack ɈkA1 gbÑoCgA
+// St[ł̌덷A1 Tv̓WJƕԂ̎ԂkOƔr.
+// VMD ȗ邩 - w肷ƁA[VLv`̂悤ɖt[ɃL[̃[Vg.
+// e덷͉] (rad) ƈړʂɓlg (ȗ CompressedNodeTrack::Settings ̊l).
+#include "CompressedTrack.h"
+#include "Keyframe.h"
+#include "BenchmarkMotion.h"
+#include "BezierCurveTable.h"
+#include "VulkanBookUtil.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace glm;
+
+namespace
+{
+  using Track = NodeTrack;
+
+  // t[ɃL[炩ȃ[V. ꕔ̃{[͓Aړʂ̓Z^[̂ݎ.
+  void MakeTracks(std::vector<Track>& tracks)
+  {
+    const uint32_t TrackCount = 100, FrameCount = 3600;
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (uint32_t i = 0; i < TrackCount; ++i)
+    {
+      Track track(FrameCount);
+      bool still = i % 5 == 4;
+      auto axis = glm::normalize(vec3(dist(rng), dist(rng), dist(rng)));
+      float speed = 0.01f + 0.05f * std::fabs(dist(rng)), amplitude = 0.8f * std::fabs(dist(rng)), phase = dist(rng) * 3.0f;
+      for (uint32_t f = 0; f < FrameCount; ++f)
+      {
+        auto& key = track[f];
+        auto t = float(f);
+        auto angle = still ? 0.0f : amplitude * std::sin(t * speed + phase) + 0.2f * amplitude * std::sin(t * speed * 3.7f);
+        key.frame = f;
+        key.rotation = glm::angleAxis(angle, axis);
+        key.translation = i == 0 ? vec3(std::sin(t * 0.01f), 0.0f, 10.0f * std::cos(t * 0.003f)) : vec3(0.0f);
+        key.curveX = key.curveY = key.curveZ = key.curveR = BezierCurveTable::LinearCurve;
+      }
+      tracks.push_back(track);
+    }
+  }
+
+  // Animator::SampleNode Ɠ.
+  void Sample(const NodeAnimeFrame& start, const NodeAnimeFrame& last, uint32_t frame, const BezierCurveTable& curves, vec3& translation, quat& rotation)
+  {
+    auto range = float(last.frame - start.frame);
+    if (range == 0)
+    {
+      translation = start.translation;
+      rotation = start.rotation;
+      return;
+    }
+    auto rate = float(frame - start.frame) / range;
+    vec3 k(curves.Evaluate(start.curveX, rate), curves.Evaluate(start.curveY, rate), curves.Evaluate(start.curveZ, rate));
+    translation = start.translation + (last.translation - start.translation) * k;
+    rotation = glm::slerp(start.rotation, last.rotation, curves.Evaluate(start.curveR, rate));
+  }
+
+  void Sample(const Track& track, uint32_t frame, uint32_t& cursor, const BezierCurveTable& curves, vec3& translation, quat& rotation)
+  {
+    auto segment = FindKeySegment(uint32_t(track.size()), frame, cursor, [&track](uint32_t i) { return track[i].frame; });
+    Sample(track[segment.start], track[segment.last], frame, curves, translation, rotation);
+  }
+
+  void Sample(const CompressedNodeTrack& track, uint32_t frame, uint32_t& cursor, const BezierCurveTable& curves, vec3& translation, quat& rotation)
+  {
+    auto segment = track.FindSegment(frame, cursor);
+    Sample(track.GetKey(segment.start), track.GetKey(segment.last), frame, curves, translation, rotation);
+  }
+
+  // CompressedNodeTrack Ɠ |a - b| = 2 sin(/4) px߂.
+  float RotationError(const quat& a, const quat& b)
+  {
+    auto square = [](float v) { return v * v; };
+    auto minus = square(a.x - b.x) + square(a.y - b.y) + square(a.z - b.z) + square(a.w - b.w);
+    auto plus = square(a.x + b.x) + square(a.y + b.y) + square(a.z + b.z) + square(a.w + b.w);
+    return 4.0f * std::asin(std::min(std::sqrt(std::min(minus, plus)) * 0.5f, 1.0f));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  BezierCurveTable curves;
+  std::vector<Track> tracks;
+  if (argc > 1 && strcmp(argv[1], "-") != 0)
+  {
+    if (!LoadNodeTracks(argv[1], curves, tracks))
+    {
+      printf("Failed to open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  else
+  {
+    MakeTracks(tracks);
+  }
+  CompressedNodeTrack::Settings settings;
+  if (argc > 2)
+  {
+    settings.translationTolerance = settings.rotationTolerance = float(atof(argv[2]));
+  }
+
+  uint32_t lastFrame = 0;
+  size_t keyCount = 0, rawBytes = 0;
+  for (const auto& track : tracks)
+  {
+    lastFrame = std::max(lastFrame, track.back().frame);
+    keyCount += track.size();
+    rawBytes += sizeof(Track) + track.size() * sizeof(NodeAnimeFrame);
+  }
+
+  book_util::StopWatch stopWatch;
+  std::vector<CompressedNodeTrack> compressed(tracks.size());
+  size_t compressedKeys = 0, compressedBytes = 0;
+  for (size_t i = 0; i < tracks.size(); ++i)
+  {
+    if (!compressed[i].Build(tracks[i].data(), uint32_t(tracks[i].size()), curves, settings))
+    {
+      printf("Failed to compress track %zu\n", i);
+      return 1;
+    }
+    compressedKeys += compressed[i].GetKeyCount();
+    compressedBytes += compressed[i].GetMemorySize();
+  }
+  double buildMs = stopWatch.GetElapsedMs();
+
+  auto trackCount = double(tracks.size());
+  printf("%zu tracks, %u frames, tolerance translation %.1e, rotation %.1e rad\n",
+    tracks.size(), lastFrame + 1, settings.translationTolerance, settings.rotationTolerance);
+  printf("keys:        %10zu -> %10zu (%.1f%%)\n", keyCount, compressedKeys, 100.0 * compressedKeys / keyCount);
+  printf("bytes/track: %10.0f -> %10.0f (%.1f%%)\n", rawBytes / trackCount, compressedBytes / trackCount, 100.0 * compressedBytes / rawBytes);
+  printf("bytes/key:   %10.1f -> %10.1f\n", double(rawBytes) / keyCount, double(compressedBytes) / std::max<size_t>(compressedKeys, 1));
+  printf("compress:    %.1f ms\n", buildMs);
+
+  // St[ł̌덷.
+  float maxTranslation = 0.0f, maxRotation = 0.0f;
+  for (size_t i = 0; i < tracks.size(); ++i)
+  {
+    uint32_t cursor0 = 0, cursor1 = 0;
+    for (uint32_t frame = 0; frame <= lastFrame; ++frame)
+    {
+      vec3 t0, t1;
+      quat r0, r1;
+      Sample(tracks[i], frame, cursor0, curves, t0, r0);
+      Sample(compressed[i], frame, cursor1, curves, t1, r1);
+      auto d = glm::abs(t0 - t1);
+      maxTranslation = std::max(maxTranslation, std::max(d.x, std::max(d.y, d.z)));
+      maxRotation = std::max(maxRotation, RotationError(r0, r1));
+    }
+  }
+  printf("max error:   translation %.2e, rotation %.2e rad\n", maxTranslation, maxRotation);
+
+  // 1 Tv̋Ԃ̌EWJƕԂ̎.
+  auto sampleCount = double(tracks.size()) * (lastFrame + 1);
+  vec3 sumT(0.0f);
+  std::vector<uint32_t> cursors(tracks.size(), 0);
+  stopWatch.Reset();
+  for (uint32_t frame = 0; frame <= lastFrame; ++frame)
+  {
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+      vec3 t;
+      quat r;
+      Sample(tracks[i], frame, cursors[i], curves, t, r);
+      sumT += t + vec3(r.w);
+    }
+  }
+  double rawNs = stopWatch.GetElapsedMs() * 1.0e6 / sampleCount;
+  std::fill(cursors.begin(), cursors.end(), 0);
+  stopWatch.Reset();
+  for (uint32_t frame = 0; frame <= lastFrame; ++frame)
+  {
+    for (size_t i = 0; i < compressed.size(); ++i)
+    {
+      vec3 t;
+      quat r;
+      Sample(compressed[i], frame, cursors[i], curves, t, r);
+      sumT += t + vec3(r.w);
+    }
+  }
+  double compressedNs = stopWatch.GetElapsedMs() * 1.0e6 / sampleCount;
+  printf("sample:      %.1f ns -> %.1f ns (checksum %.3f)\n", rawNs, compressedNs, sumT.x + sumT.y + sumT.z);
+  return 0;
+}
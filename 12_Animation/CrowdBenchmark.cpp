@@ -0,0 +1,176 @@
+// [VĐQO̎pvZ̃x`}[N.
+//  12_Animation_CrowdBenchmark [PMDt@C] [LN^[] [O[v]
+// LN^[̓O[vɕAO[vƂ 10 t[炵ē[VĐ.
+// LN^[ƂɎpvZ@ƁAPoseCache ŏdȂ ([V, t[) ̑ĝ݂vZ@r.
+// [V 60fps  AnimationClock Ői߁Ãt[Ԃ.
+// PMD t@Cȗ邩 - w肵ꍇ͗ōig.
+#include "AnimationClock.h"
+#include "AnimationRuntime.h"
+#include "BenchmarkSkeleton.h"
+#include "JobSystem.h"
+#include "PoseCache.h"
+#include "VulkanBookUtil.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace glm;
+
+namespace
+{
+  const uint32_t Frames = 240;
+  const float GroupOffset = 10.0f;
+
+  // Aj[ṼTvȎɁÃt[ƂɌ܂]^ĊԂԂ.
+  class Motion
+  {
+  public:
+    Motion() : m_rotations(MakeRandomRotations())
+    {
+    }
+
+    void Sample(float frame, AnimationRuntime& runtime, AnimationRuntime::InstanceId instance) const
+    {
+      auto key = uint32_t(frame);
+      auto rate = frame - float(key);
+      auto boneCount = runtime.GetSkeleton(instance).GetBoneCount();
+      for (uint32_t i = 0; i < boneCount; ++i)
+      {
+        const auto& a = m_rotations[(key * 17 + i) % m_rotations.size()];
+        const auto& b = m_rotations[((key + 1) * 17 + i) % m_rotations.size()];
+        runtime.SetLocalRotation(instance, i, glm::slerp(a, b, rate));
+      }
+    }
+
+  private:
+    std::vector<quat> m_rotations;
+  };
+
+  float GetFrame(const AnimationClock& clock, uint32_t character, uint32_t groupCount)
+  {
+    return clock.GetFrame() + GroupOffset * float(character % groupCount);
+  }
+
+  float MaxDifference(const glm::mat4* a, const glm::mat4* b, uint32_t count)
+  {
+    float maxDiff = 0.0f;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      for (int col = 0; col < 4; ++col)
+      {
+        for (int row = 0; row < 4; ++row)
+        {
+          maxDiff = std::max(maxDiff, std::fabs(a[i][col][row] - b[i][col][row]));
+        }
+      }
+    }
+    return maxDiff;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::shared_ptr<Skeleton> skeleton;
+  if (argc > 1 && strcmp(argv[1], "-") != 0)
+  {
+    skeleton = LoadSkeleton(argv[1]);
+    if (!skeleton)
+    {
+      printf("Failed to open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  else
+  {
+    skeleton = MakeRandomSkeleton(128);
+  }
+  auto boneCount = skeleton->GetBoneCount();
+  if (boneCount == 0)
+  {
+    printf("No bones\n");
+    return 1;
+  }
+  uint32_t characterCount = argc > 2 ? uint32_t(std::max(1, atoi(argv[2]))) : 256;
+  uint32_t groupCount = argc > 3 ? uint32_t(std::max(1, atoi(argv[3]))) : 8;
+  groupCount = std::min(groupCount, characterCount);
+
+  Motion motion;
+  auto sample = [&motion](float frame, AnimationRuntime& runtime, AnimationRuntime::InstanceId instance, float*) {
+    motion.Sample(frame, runtime, instance);
+  };
+
+  // LN^[ƂɌvZ. PoseCache Ɠ񏉊p狁߂.
+  AnimationRuntime runtime;
+  for (uint32_t c = 0; c < characterCount; ++c)
+  {
+    runtime.AddInstance(skeleton);
+  }
+  std::vector<mat4> palettes(size_t(characterCount) * boneCount);
+  AnimationClock clock(60.0);
+  book_util::StopWatch stopWatch;
+  for (uint32_t frame = 0; frame < Frames; ++frame, clock.Step())
+  {
+    for (uint32_t c = 0; c < characterCount; ++c)
+    {
+      runtime.ResetPose(c);
+      sample(GetFrame(clock, c, groupCount), runtime, c, nullptr);
+      runtime.UpdateWorldMatrices(c);
+      runtime.SolveIK(c);
+      runtime.GetSkinMatrices(c, &palettes[size_t(c) * boneCount], boneCount);
+    }
+  }
+  double individualMs = stopWatch.GetElapsedMs() / Frames;
+
+  // PoseCache ŌvZ. Ō̃t[̌ʂLN^[Ƃ̌vZƔׂ.
+  auto runCache = [&](JobSystem* jobSystem, float& maxDiff, double& posesPerFrame, double& evaluatedPerFrame) {
+    PoseCache cache;
+    auto motionId = cache.AddMotion(skeleton, 0, sample);
+    std::vector<PoseCache::PoseId> poses(characterCount);
+    AnimationClock cacheClock(60.0);
+    uint64_t poseCount = 0, evaluatedCount = 0;
+    stopWatch.Reset();
+    for (uint32_t frame = 0; frame < Frames; ++frame, cacheClock.Step())
+    {
+      cache.BeginFrame();
+      for (uint32_t c = 0; c < characterCount; ++c)
+      {
+        poses[c] = cache.Request(motionId, GetFrame(cacheClock, c, groupCount));
+      }
+      cache.Evaluate(jobSystem);
+      poseCount += cache.GetStatistics().poseCount;
+      evaluatedCount += cache.GetStatistics().evaluatedCount;
+    }
+    double ms = stopWatch.GetElapsedMs() / Frames;
+    maxDiff = 0.0f;
+    for (uint32_t c = 0; c < characterCount; ++c)
+    {
+      maxDiff = std::max(maxDiff, MaxDifference(cache.GetSkinMatrices(poses[c]), &palettes[size_t(c) * boneCount], boneCount));
+    }
+    posesPerFrame = double(poseCount) / Frames;
+    evaluatedPerFrame = double(evaluatedCount) / Frames;
+    return ms;
+  };
+
+  float serialDiff = 0.0f, jobDiff = 0.0f;
+  double posesPerFrame = 0.0, evaluatedPerFrame = 0.0;
+  double cacheMs = runCache(nullptr, serialDiff, posesPerFrame, evaluatedPerFrame);
+  JobSystem jobSystem;
+  double jobMs = runCache(&jobSystem, jobDiff, posesPerFrame, evaluatedPerFrame);
+
+  printf("Skeleton: %u bones, %u IK chains, %u characters in %u groups, %u frames\n",
+    boneCount, uint32_t(skeleton->GetIkChains().size()), characterCount, groupCount, Frames);
+  printf("poses/frame: %.1f requested, %.1f evaluated\n", posesPerFrame, evaluatedPerFrame);
+  printf("individual:        %8.3f ms/frame\n", individualMs);
+  printf("PoseCache:         %8.3f ms/frame (%.1fx)\n", cacheMs, individualMs / cacheMs);
+  printf("PoseCache + jobs:  %8.3f ms/frame (%.1fx, %u workers)\n", jobMs, individualMs / jobMs, jobSystem.GetThreadCount());
+  printf("max matrix difference against individual %.2e\n", std::max(serialDiff, jobDiff));
+  return 0;
+}
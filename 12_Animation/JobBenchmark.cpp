@@ -0,0 +1,184 @@
+// WuVXeɂpvZ̃XP[Õx`}[N.
+//  12_Animation_JobBenchmark [PMDt@C] [őLN^[] [őXbh]
+// LN^[Ƃ TvO  sXV  IK(`FC)  sXV ̃Wug݁A
+// LN^[ƃ[J[Xbh 1 {Xɕς 1 t[̎Ԃv.
+// ĂяõXbh Wait ̊Ԃ̓Wu.
+#include "AnimationRuntime.h"
+#include "BenchmarkSkeleton.h"
+#include "JobSystem.h"
+#include "VulkanBookUtil.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace glm;
+
+namespace
+{
+  const uint32_t Frames = 60;
+
+  class Scene
+  {
+  public:
+    Scene(std::shared_ptr<const Skeleton> skeleton, uint32_t characterCount) : m_rotations(MakeRandomRotations()), m_frame(0)
+    {
+      for (uint32_t c = 0; c < characterCount; ++c)
+      {
+        m_runtime.AddInstance(skeleton);
+      }
+    }
+
+    // Aj[ṼTvȎɁAt[ƂɌ܂]^.
+    void Sample(uint32_t character)
+    {
+      auto boneCount = m_runtime.GetSkeleton(character).GetBoneCount();
+      for (uint32_t i = 0; i < boneCount; ++i)
+      {
+        auto index = (character * 131 + m_frame * 17 + i) % m_rotations.size();
+        m_runtime.SetLocalRotation(character, i, m_rotations[index]);
+      }
+    }
+
+    void UpdateSerial()
+    {
+      for (uint32_t c = 0; c < m_runtime.GetInstanceCount(); ++c)
+      {
+        Sample(c);
+        m_runtime.UpdateWorldMatrices(c);
+        m_runtime.SolveIK(c);
+      }
+    }
+
+    void BuildJobs(JobGraph& graph)
+    {
+      for (uint32_t c = 0; c < m_runtime.GetInstanceCount(); ++c)
+      {
+        auto sample = graph.Add([this, c]() { Sample(c); });
+        m_runtime.AddUpdateJobs(graph, c, sample);
+      }
+    }
+
+    void SetFrame(uint32_t frame) { m_frame = frame; }
+    const AnimationRuntime& GetRuntime() const { return m_runtime; }
+
+  private:
+    AnimationRuntime m_runtime;
+    std::vector<quat> m_rotations;
+    uint32_t m_frame;
+  };
+
+  float MaxDifference(const AnimationRuntime& a, const AnimationRuntime& b)
+  {
+    float maxDiff = 0.0f;
+    for (uint32_t c = 0; c < a.GetInstanceCount(); ++c)
+    {
+      for (uint32_t i = 0; i < a.GetSkeleton(c).GetBoneCount(); ++i)
+      {
+        const auto& ma = a.GetWorldMatrix(c, i);
+        const auto& mb = b.GetWorldMatrix(c, i);
+        for (int col = 0; col < 4; ++col)
+        {
+          for (int row = 0; row < 4; ++row)
+          {
+            maxDiff = std::max(maxDiff, std::fabs(ma[col][row] - mb[col][row]));
+          }
+        }
+      }
+    }
+    return maxDiff;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::shared_ptr<Skeleton> skeleton;
+  if (argc > 1)
+  {
+    skeleton = LoadSkeleton(argv[1]);
+    if (!skeleton)
+    {
+      printf("Failed to open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  else
+  {
+    skeleton = MakeRandomSkeleton(128);
+  }
+  if (skeleton->GetBoneCount() == 0)
+  {
+    printf("No bones\n");
+    return 1;
+  }
+  uint32_t maxCharacters = argc > 2 ? uint32_t(std::max(1, atoi(argv[2]))) : 64;
+  uint32_t maxThreads = argc > 3 ? uint32_t(std::max(1, atoi(argv[3]))) : std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t t = 1; t < maxThreads; t *= 2)
+  {
+    threadCounts.push_back(t);
+  }
+  threadCounts.push_back(maxThreads);
+
+  uint32_t independentChains = 0;
+  for (const auto& dependencies : skeleton->GetIkDependencies())
+  {
+    independentChains += dependencies.empty() ? 1 : 0;
+  }
+  printf("Skeleton: %u bones, %u IK chains (%u without dependencies), %u frames\n",
+    skeleton->GetBoneCount(), uint32_t(skeleton->GetIkChains().size()), independentChains, Frames);
+  printf("ms/frame (speedup against serial)\n");
+  printf("%10s %10s", "characters", "serial");
+  for (auto t : threadCounts)
+  {
+    printf("   %3u workers", t);
+  }
+  printf("\n");
+
+  float maxDiff = 0.0f;
+  for (uint32_t characters = 1; ; characters = std::min(characters * 2, maxCharacters))
+  {
+    Scene serial(skeleton, characters);
+    book_util::StopWatch stopWatch;
+    for (uint32_t frame = 0; frame < Frames; ++frame)
+    {
+      serial.SetFrame(frame);
+      serial.UpdateSerial();
+    }
+    double serialMs = stopWatch.GetElapsedMs() / Frames;
+    printf("%10u %10.3f", characters, serialMs);
+
+    for (auto threads : threadCounts)
+    {
+      JobSystem jobSystem(threads);
+      Scene scene(skeleton, characters);
+      JobGraph graph;
+      scene.BuildJobs(graph);
+
+      stopWatch.Reset();
+      for (uint32_t frame = 0; frame < Frames; ++frame)
+      {
+        scene.SetFrame(frame);
+        jobSystem.Run(graph);
+      }
+      double ms = stopWatch.GetElapsedMs() / Frames;
+      printf("   %7.3f (%3.1fx)", ms, serialMs / ms);
+      maxDiff = std::max(maxDiff, MaxDifference(serial.GetRuntime(), scene.GetRuntime()));
+    }
+    printf("\n");
+    if (characters == maxCharacters)
+    {
+      break;
+    }
+  }
+  printf("max matrix difference against serial %.2e\n", maxDiff);
+  return 0;
+}
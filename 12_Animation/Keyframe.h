@@ -0,0 +1,83 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "BezierCurveTable.h"
+
+// Aj[ṼL[t[.
+struct NodeAnimeFrame
+{
+  uint32_t frame;
+  glm::vec3 translation;
+  glm::quat rotation;
+  // ԋȐ (Animator::m_curveTable ̔ԍ).
+  BezierCurveTable::CurveId curveX;
+  BezierCurveTable::CurveId curveY;
+  BezierCurveTable::CurveId curveZ;
+  BezierCurveTable::CurveId curveR;
+
+  bool operator<(const NodeAnimeFrame& v) const
+  {
+    return frame < v.frame;
+  }
+};
+struct MorphAnimeFrame
+{
+  uint32_t frame;
+  float weight;
+
+  bool operator<(const MorphAnimeFrame& v) const
+  {
+    return frame < v.frame;
+  }
+};
+
+// L[t[̋. frame ŏ̃L[OŌ̃L[ȍ~Ȃ start == last.
+struct KeySegment
+{
+  uint32_t start;
+  uint32_t last;
+};
+
+// t[ɕ count ̃L[ frame ܂ދԂT. frameOf(i)  i Ԗڂ̃L[̃t[ԍ.
+// cursor ͑O start ŁAʂ start ɍXV. ĐiނȂ cursor 琔i߂邾Ō.
+// ߂Ƃ傫񂾂Ƃ͑Ŝ񕪒T (͈͂߂ƖႤL[ǂނƂɂȂAĒx).
+template<class FrameOf>
+KeySegment FindKeySegment(uint32_t count, uint32_t frame, uint32_t& cursor, FrameOf frameOf)
+{
+  const uint32_t LinearSteps = 4;
+  // frame ɂŏ̃L[̔ԍ ( count).
+  uint32_t next = 0;
+  bool found = false;
+  if (cursor < count && frameOf(cursor) <= frame)
+  {
+    auto end = std::min(count, cursor + 1 + LinearSteps);
+    for (next = cursor + 1; next < end && frameOf(next) <= frame; ++next)
+    {
+    }
+    found = next < end || end == count;
+  }
+  if (!found)
+  {
+    uint32_t hi = count;
+    next = 0;
+    while (next < hi)
+    {
+      auto mid = next + (hi - next) / 2;
+      if (frameOf(mid) <= frame)
+      {
+        next = mid + 1;
+      }
+      else
+      {
+        hi = mid;
+      }
+    }
+  }
+  cursor = next > 0 ? next - 1 : 0;
+  auto last = (next > 0 && next < count) ? next : cursor;
+  return KeySegment{ cursor, last };
+}
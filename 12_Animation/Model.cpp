@@ -1,10 +1,15 @@
 #include "Model.h"
 #include "loader/PMDloader.h"
+#include "loader/MappedFile.h"
 
 #include "VulkanAppBase.h"
 #include "VulkanBookUtil.h"
 
 #include <fstream>
+#include <algorithm>
+#include <memory>
+#include <future>
+#include <unordered_map>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
@@ -17,22 +22,10 @@ using namespace std;
 using namespace glm;
 
 
-
-
-inline Model::PMDVertex convertTo(const loader::PMDVertex& v)
-{
-  return Model::PMDVertex{
-    v.getPosition(), v.getNormal(), v.getUV(),
-    uvec2(v.getBoneIndex(0), v.getBoneIndex(1)),
-    vec2(v.getBoneWeight(0), v.getBoneWeight(1)),
-    v.getEdgeFlag(),
-  };
-}
-
 void Material::Update(VulkanAppBase* app)
 {
   auto bufferSize = uint32_t(sizeof(m_parameters));
-  app->WriteToHostVisibleMemory(m_uniformBuffer.memory, bufferSize, &m_parameters );
+  app->WriteToHostVisibleMemory(m_uniformBuffer, bufferSize, &m_parameters );
 }
 
 void Bone::UpdateLocalMatrix()
@@ -61,55 +54,148 @@ void Bone::UpdateMatrices()
   }
 }
 
-void Model::Load(const char* filename, VulkanAppBase* app)
+void Model::Load(const char* filename, VulkanAppBase* app, LoaderMode mode)
 {
-  ifstream infile(filename, std::ios::binary);
-  loader::PMDFile loader(infile);
+  book_util::StopWatch totalTime, stopWatch;
+  std::unique_ptr<loader::MappedFile> mappedFile;
+  std::unique_ptr<loader::PMDFile> pmdFile;
+  if (mode == LoaderMode::MemoryMapped)
+  {
+    mappedFile = std::make_unique<loader::MappedFile>(filename);
+    pmdFile = std::make_unique<loader::PMDFile>(*mappedFile);
+  }
+  else
+  {
+    ifstream infile(filename, std::ios::binary);
+    pmdFile = std::make_unique<loader::PMDFile>(infile);
+  }
+  const auto& loader = *pmdFile;
+  m_loadTimings.parseMs = stopWatch.GetElapsedMs();
   auto device = app->GetDevice();
 
+  // eNX`̃fR[h[J[Xbh֓Aȍ~̏ƕs.
+  // t@CQƂ}eA̓eNX`L.
+  struct DecodedTexture
+  {
+    int width = 0;
+    int height = 0;
+    stbi_uc* pixels = nullptr;
+    double decodeMs = 0.0;
+  };
+  const uint32_t materialCount = loader.getMaterialCount();
+  std::vector<int> materialTextures(materialCount, -1);
+  std::vector<std::future<DecodedTexture>> decodeJobs;
+  {
+    std::unordered_map<std::string, int> textureIndices;
+    auto threadPool = app->GetThreadPool();
+    for (uint32_t i = 0; i < materialCount; ++i)
+    {
+      auto textureFileName = loader.getMaterial(i).getTexture();
+      auto hasSphereMap = textureFileName.find('*');
+      if (hasSphereMap != std::string::npos)
+      {
+        textureFileName = textureFileName.substr(0, hasSphereMap);
+      }
+      if (textureFileName.empty())
+      {
+        continue;
+      }
+      auto it = textureIndices.find(textureFileName);
+      if (it == textureIndices.end())
+      {
+        it = textureIndices.emplace(textureFileName, int(decodeJobs.size())).first;
+        decodeJobs.push_back(threadPool->Submit([textureFileName]() {
+          book_util::StopWatch decodeTime;
+          DecodedTexture decoded;
+          decoded.pixels = stbi_load(textureFileName.c_str(), &decoded.width, &decoded.height, nullptr, 4);
+          decoded.decodeMs = decodeTime.GetElapsedMs();
+          return decoded;
+        }));
+      }
+      materialTextures[i] = it->second;
+    }
+  }
+
+  // _ECfbNX GPU p̃CAEg֒ړWJ.
+  stopWatch.Reset();
   auto vertexCount = loader.getVertexCount();
   auto indexCount = loader.getIndexCount();
   m_hostMemVertices.resize(vertexCount);
-  for (uint32_t i = 0; i < vertexCount; ++i)
-  {
-    m_hostMemVertices[i] = convertTo(loader.getVertex(i));
-  }
+  const loader::PMDVertexLayout vertexLayout{
+    sizeof(PMDVertex),
+    offsetof(PMDVertex, position),
+    offsetof(PMDVertex, normal),
+    offsetof(PMDVertex, uv),
+    offsetof(PMDVertex, boneIndices),
+    offsetof(PMDVertex, boneWeights),
+    offsetof(PMDVertex, edgeFlag),
+  };
+  loader.decodeVertices(m_hostMemVertices.data(), vertexLayout);
   std::vector<uint32_t> modelIndices(indexCount);
-  for (uint32_t i = 0; i < indexCount; ++i)
-  {
-    auto& v = modelIndices[i];
-    v = loader.getIndices()[i];
-  }
+  loader.decodeIndices(modelIndices.data());
+  m_loadTimings.decodeMs = stopWatch.GetElapsedMs();
 
   uint32_t bufferSizeIB = indexCount * sizeof(uint32_t);
   VkMemoryPropertyFlags stageMemProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
   const auto deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-  VkBufferUsageFlagBits stage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-  auto stagingIB = app->CreateBuffer(bufferSizeIB, stage, stageMemProps);
 
   m_indexBuffer = app->CreateBuffer(bufferSizeIB,
     VK_BUFFER_USAGE_INDEX_BUFFER_BIT  | VK_BUFFER_USAGE_TRANSFER_DST_BIT, deviceLocal );
 
-  app->WriteToHostVisibleMemory(stagingIB.memory, bufferSizeIB, modelIndices.data());
-
-  // Stageing => DeviceLocal ֓].
-  auto command = app->CreateCommandBuffer();
-  VkBufferCopy copyRegion{};
-  copyRegion.size = bufferSizeIB;
-  vkCmdCopyBuffer(command, stagingIB.buffer, m_indexBuffer.buffer, 1, &copyRegion);
-  app->FinishCommandBuffer(command);
-  app->DestroyBuffer(stagingIB);
+  // Stageing => DeviceLocal ւ̓]͂܂Ƃ߂čŌɑM.
+  auto uploader = app->GetUploadBatcher();
+  uploader->UploadBuffer(m_indexBuffer.buffer, 0, modelIndices.data(), bufferSizeIB);
 
   const uint32_t imageCount = app->GetSwapchain()->GetImageCount();
   m_vertexBuffers.resize(imageCount);
   uint32_t bufferSizeVB = vertexCount * sizeof(PMDVertex);
   for (uint32_t i = 0; i < imageCount; ++i)
   {
-    m_vertexBuffers[i] = app->CreateBuffer(bufferSizeVB, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, stageMemProps);
+    if (m_morphMode == MorphMode::Compute)
+    {
+      // \[t̓Rs[gVF[_[ňʒu.
+      m_vertexBuffers[i] = app->CreateBuffer(bufferSizeVB,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, deviceLocal);
+    }
+    else
+    {
+      m_vertexBuffers[i] = app->CreateBuffer(bufferSizeVB, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, stageMemProps);
+    }
+  }
+
+  // fR[hÎ珇ɃeNX`𐶐ē]ς.
+  m_loadTimings.textureCount = uint32_t(decodeJobs.size());
+  m_loadTimings.textureDecodeMs = 0.0;
+  m_loadTimings.textureWaitMs = 0.0;
+  m_loadTimings.uploadMs = 0.0;
+  m_textures.resize(decodeJobs.size());
+  for (size_t i = 0; i < decodeJobs.size(); ++i)
+  {
+    stopWatch.Reset();
+    auto decoded = decodeJobs[i].get();
+    m_loadTimings.textureWaitMs += stopWatch.GetElapsedMs();
+    m_loadTimings.textureDecodeMs += decoded.decodeMs;
+    if (decoded.pixels == nullptr)
+    {
+      m_textures[i].image = VK_NULL_HANDLE;
+      continue;
+    }
+
+    stopWatch.Reset();
+    uint32_t width = uint32_t(decoded.width), height = uint32_t(decoded.height);
+    auto texture = app->CreateTexture(width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    uint32_t bufferSize = width * height * sizeof(uint32_t);
+
+    VkBufferImageCopy region{};
+    region.imageExtent = { width, height, 1 };
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    uploader->UploadImage(texture.image, region, decoded.pixels, bufferSize);
+    stbi_image_free(decoded.pixels);
+    m_textures[i] = texture;
+    m_loadTimings.uploadMs += stopWatch.GetElapsedMs();
   }
 
   // }eAǂݍ
-  const uint32_t materialCount = loader.getMaterialCount();
   for (uint32_t i = 0; i < materialCount; ++i)
   {
     const auto& src = loader.getMaterial(i);
@@ -120,13 +206,8 @@ void Model::Load(const char* filename, VulkanAppBase* app)
     materialParams.useTexture.x = 0;
     materialParams.edgeFlag.x = src.getEdgeFlag();
 
-    auto textureFileName = src.getTexture();
-    auto hasSphereMap = textureFileName.find('*');
-    if (hasSphereMap != std::string::npos)
-    {
-      textureFileName = textureFileName.substr(0, hasSphereMap);
-    }
-    if (!textureFileName.empty())
+    auto textureIndex = materialTextures[i];
+    if (textureIndex >= 0 && m_textures[textureIndex].image != VK_NULL_HANDLE)
     {
       materialParams.useTexture.x = 1;
     }
@@ -138,21 +219,7 @@ void Model::Load(const char* filename, VulkanAppBase* app)
 
     if (materialParams.useTexture.x)
     {
-      int width, height;
-      auto pImage = stbi_load(textureFileName.c_str(), &width, &height, nullptr, 4);
-      auto texture = app->CreateTexture(width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
-      uint32_t bufferSize = width * height * sizeof(uint32_t);
-      auto bufferSrc = app->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-      app->WriteToHostVisibleMemory(bufferSrc.memory, bufferSize, pImage);
-
-      VkBufferImageCopy region{};
-      region.imageExtent = { uint32_t(width), uint32_t(height), 1 };
-      region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-      app->TransferStageBufferToImage(bufferSrc, texture, &region);
-      stbi_image_free(pImage);
-      app->DestroyBuffer(bufferSrc);
-
-      material.SetTexture(texture);
+      material.SetTexture(m_textures[textureIndex]);
     }
 
     material.Update(app);
@@ -172,6 +239,7 @@ void Model::Load(const char* filename, VulkanAppBase* app)
   }
  
   // {[\z.
+  stopWatch.Reset();
   uint32_t boneCount = loader.getBoneCount();
   m_bones.reserve(boneCount);
   for (uint32_t i = 0; i < boneCount; ++i)
@@ -211,7 +279,7 @@ void Model::Load(const char* filename, VulkanAppBase* app)
   // \[tǂݍ.
   {
     // \x[X.
-    auto baseFace = loader.getFaceBase();
+    const auto& baseFace = loader.getFaceBase();
     auto vertexCount = baseFace.getVertexCount();
     auto indexCount = baseFace.getIndexCount();
     m_faceBaseInfo.verticesPos.resize(vertexCount);
@@ -226,7 +294,7 @@ void Model::Load(const char* filename, VulkanAppBase* app)
     m_faceOffsetInfo.resize(faceCount);
     for (uint32_t i = 0; i < faceCount; ++i) // 1n߂̂ 0  base ̂.
     {
-      auto faceSrc = loader.getFace(i+1);
+      const auto& faceSrc = loader.getFace(i+1);
       auto& face = m_faceOffsetInfo[i];
       face.name = faceSrc.getName();
 
@@ -242,6 +310,14 @@ void Model::Load(const char* filename, VulkanAppBase* app)
 
     m_faceMorphWeights.resize(faceCount);
   }
+  if (m_morphMode == MorphMode::Compute)
+  {
+    PrepareMorphBuffers(app);
+  }
+  else
+  {
+    PrepareMorphEvaluator(imageCount);
+  }
 
   // IK{[ǂݍ.
   auto ikBoneCount = loader.getIkCount();
@@ -266,11 +342,62 @@ void Model::Load(const char* filename, VulkanAppBase* app)
     }
     boneIk.SetIkChains(ikChains);
   }
-  
+
+  // Aj[Vp̍i\z.
+  {
+    std::vector<Skeleton::BoneDesc> boneDescs(boneCount);
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+      auto parent = loader.getBone(i).getParent();
+      auto& desc = boneDescs[i];
+      desc.parent = parent != 0xFFFFu ? int32_t(parent) : int32_t(Skeleton::NoParent);
+      desc.translation = m_bones[i]->GetInitialTranslation();
+      desc.invBindMatrix = m_bones[i]->GetInvBindMatrix();
+    }
+    std::vector<Skeleton::IkChain> ikChains(ikBoneCount);
+    uint32_t kneeLinkCount = 0;
+    for (uint32_t i = 0; i < ikBoneCount; ++i)
+    {
+      const auto& ik = loader.getIk(i);
+      auto& chain = ikChains[i];
+      chain.target = ik.getTargetBoneId();
+      chain.effector = ik.getBoneEff();
+      chain.iterationCount = ik.getIterations();
+      chain.angleLimit = ik.getAngleLimit();
+      for (auto& id : ik.getChains())
+      {
+        auto knee = Skeleton::IsKneeBoneName(m_bones[id]->GetName());
+        chain.links.push_back(Skeleton::IkLink{ uint32_t(id), knee });
+        kneeLinkCount += knee ? 1 : 0;
+      }
+    }
+    if (ikBoneCount > 0 && kneeLinkCount == 0)
+    {
+      //  IK Ђ̐Ȃŉ̂ŁAO̔rĂȂ\.
+      book_util::OutputDebugMessage("Model: no IK link is marked as a knee.\n");
+    }
+    m_skeleton = std::make_shared<Skeleton>(boneDescs, ikChains);
+  }
+  m_loadTimings.skeletonMs = stopWatch.GetElapsedMs();
 
   uint32_t sizeVB = sizeof(PMDVertex) * vertexCount;
-  app->WriteToHostVisibleMemory(m_vertexBuffers[0].memory, sizeVB, m_hostMemVertices.data());
-  app->WriteToHostVisibleMemory(m_vertexBuffers[1].memory, sizeVB, m_hostMemVertices.data());
+  for (auto& vb : m_vertexBuffers)
+  {
+    if (m_morphMode == MorphMode::Compute)
+    {
+      uploader->UploadBuffer(vb.buffer, 0, m_hostMemVertices.data(), sizeVB);
+    }
+    else
+    {
+      app->WriteToHostVisibleMemory(vb, sizeVB, m_hostMemVertices.data());
+    }
+  }
+
+  // ͑҂Ȃ. ȍ~̃Tu~bg̓L[̏œ]ʂQƂł.
+  stopWatch.Reset();
+  m_uploadToken = uploader->Submit();
+  m_loadTimings.uploadMs += stopWatch.GetElapsedMs();
+  m_loadTimings.totalMs = totalTime.GetElapsedMs();
 }
 
 void Model::Prepare(VulkanAppBase* app)
@@ -280,8 +407,14 @@ void Model::Prepare(VulkanAppBase* app)
   PrepareDummyTexture(app);
   PreparePipelines(app);
   PrepareModelUniformBuffers(imageCount, app);
+  PrepareInstanceBuffers(imageCount, app);
+  book_util::StopWatch descriptorTime;
   PrepareDescriptorSets(app);
+  PrepareInstancedDescriptorSets(app);
+  PrepareMorphDescriptorSets(app);
+  m_loadTimings.descriptorMs = descriptorTime.GetElapsedMs();
   PrepareCommandBuffers(imageCount, app);
+  PrepareInstancedCommandBuffers(imageCount, app);
 }
 
 void Model::Cleanup(VulkanAppBase* app)
@@ -299,6 +432,18 @@ void Model::Cleanup(VulkanAppBase* app)
   {
     app->FreeCommandBufferSecondary(uint32_t(command.size()), command.data());
   }
+  for (auto& command : m_commandBuffersInstanced)
+  {
+    app->FreeCommandBufferSecondary(uint32_t(command.size()), command.data());
+  }
+  for (auto& command : m_commandBuffersInstancedOutline)
+  {
+    app->FreeCommandBufferSecondary(uint32_t(command.size()), command.data());
+  }
+  for (auto& command : m_commandBuffersInstancedShadow)
+  {
+    app->FreeCommandBufferSecondary(uint32_t(command.size()), command.data());
+  }
 
   for (auto& pipeline : m_pipelines)
   {
@@ -307,23 +452,37 @@ void Model::Cleanup(VulkanAppBase* app)
   for (auto& m : m_materials)
   {
     app->DestroyBuffer(m.GetUniformBuffer());
-    if (m.HasTexture())
+  }
+  for (auto& t : m_textures)
+  {
+    if (t.image != VK_NULL_HANDLE)
     {
-      app->DestroyImage(m.GetTexture());
+      app->DestroyImage(t);
     }
   }
-  for (auto& v : m_sceneParamUBO)
+  m_frameBuffer.Cleanup(app);
+  for (auto& v : m_vertexBuffers)
   {
     app->DestroyBuffer(v);
   }
-  for (auto& v : m_boneUBO)
+  for (auto& v : m_instanceBuffers)
   {
     app->DestroyBuffer(v);
   }
-  for (auto& v : m_vertexBuffers)
+  for (auto& v : m_paletteBuffers)
+  {
+    app->DestroyBuffer(v);
+  }
+  for (auto& v : m_indirectBuffers)
   {
     app->DestroyBuffer(v);
   }
+  if (m_morphVertexCount > 0)
+  {
+    app->DestroyBuffer(m_morphVertexBuffer);
+    app->DestroyBuffer(m_morphBasePosBuffer);
+    app->DestroyBuffer(m_morphDeltaBuffer);
+  }
   app->DestroyBuffer(m_indexBuffer);
   app->DestroyImage(m_dummyTexture);
   vkDestroySampler(device, m_sampler, nullptr);
@@ -335,6 +494,28 @@ void Model::Cleanup(VulkanAppBase* app)
   m_bones.clear();
 }
 
+void Model::RebuildPipelines(VulkanAppBase* app)
+{
+  // m_pipelines ̗vf̓VF[_[̊Ď̃L[ƂȂ̂ŁAɏ㏑.
+  auto imageCount = uint32_t(m_commandBuffers.size());
+  for (auto& pipeline : m_pipelines)
+  {
+    app->DestroyPipelineDeferred(pipeline.second);
+  }
+  PreparePipelines(app);
+  PrepareCommandBuffers(imageCount, app);
+  PrepareInstancedCommandBuffers(imageCount, app);
+}
+
+void Model::RebuildPipeline(const std::string& name, VulkanAppBase* app)
+{
+  auto imageCount = uint32_t(m_commandBuffers.size());
+  app->DestroyPipelineDeferred(m_pipelines[name]);
+  PreparePipelines(app, name);
+  PrepareCommandBuffers(imageCount, app, name);
+  PrepareInstancedCommandBuffers(imageCount, app, name);
+}
+
 int Model::GetFaceMorphIndex(const std::string& name) const
 {
   int ret = -1;
@@ -359,10 +540,17 @@ void Model::SetFaceMorphWeight(int index, float weight)
 
 void Model::PrepareModelUniformBuffers(uint32_t count, VulkanAppBase* app)
 {
-  auto sceneParamSize = uint32_t(sizeof(SceneParameter));
-  auto boneParamSize = uint32_t(sizeof(BoneParameter));
-  m_sceneParamUBO = app->CreateUniformBuffers(sceneParamSize, count);
-  m_boneUBO = app->CreateUniformBuffers(boneParamSize, count);
+  // \[t̃EFCg̓Rs[gŌvZꍇ̂ݖt[؂o.
+  uint32_t transientSize = 0;
+  if (m_morphMode == MorphMode::Compute && m_morphVertexCount > 0)
+  {
+    transientSize = uint32_t(sizeof(float) * m_faceMorphWeights.size());
+  }
+  m_frameBuffer = FrameRingBuffer();
+  m_sceneSlot = m_frameBuffer.Reserve(uint32_t(sizeof(SceneParameter)));
+  m_boneSlot = m_frameBuffer.Reserve(uint32_t(sizeof(BoneParameter)));
+  m_frameBuffer.Initialize(app, count, transientSize,
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 }
 
 Model::SecondaryCommandBuffers Model::GetCommandBuffers(uint32_t index)
@@ -377,10 +565,114 @@ Model::SecondaryCommandBuffers Model::GetCommandBuffersShadow(uint32_t index)
 {
   return m_commandBuffersShadow[index];
 }
+Model::SecondaryCommandBuffers Model::GetCommandBuffersInstanced(uint32_t index)
+{
+  return m_commandBuffersInstanced[index];
+}
+Model::SecondaryCommandBuffers Model::GetCommandBuffersInstancedOutline(uint32_t index)
+{
+  return m_commandBuffersInstancedOutline[index];
+}
+Model::SecondaryCommandBuffers Model::GetCommandBuffersInstancedShadow(uint32_t index)
+{
+  return m_commandBuffersInstancedShadow[index];
+}
 
-void Model::PreparePipelines(VulkanAppBase* app)
+void Model::SetInstanceCapacity(uint32_t instanceCapacity, uint32_t paletteCapacity)
 {
-  auto device = app->GetDevice();
+  m_instanceCapacity = instanceCapacity;
+  m_paletteCapacity = (std::max)(paletteCapacity, 1u);
+}
+
+void Model::ClearInstances()
+{
+  m_instances.clear();
+  m_bonePalettes.clear();
+}
+
+uint32_t Model::AddBonePalette(const glm::mat4* matrices)
+{
+  auto boneCount = GetBoneCount();
+  auto paletteCount = boneCount > 0 ? uint32_t(m_bonePalettes.size()) / boneCount : 0;
+  if (boneCount == 0 || paletteCount >= m_paletteCapacity)
+  {
+    return InvalidPalette;
+  }
+  m_bonePalettes.insert(m_bonePalettes.end(), matrices, matrices + boneCount);
+  return paletteCount;
+}
+
+bool Model::AddInstance(const glm::mat4& world, uint32_t palette)
+{
+  auto boneCount = GetBoneCount();
+  if (m_instances.size() >= m_instanceCapacity || size_t(palette) * boneCount >= m_bonePalettes.size())
+  {
+    return false;
+  }
+  m_instances.push_back(InstanceParameter{ world, uvec4(palette * boneCount, 0, 0, 0) });
+  return true;
+}
+
+void Model::UpdateInstances(uint32_t imageIndex, VulkanAppBase* app)
+{
+  if (!IsInstancingEnabled())
+  {
+    return;
+  }
+  auto instanceCount = uint32_t(m_instances.size());
+  if (instanceCount > 0)
+  {
+    app->WriteToHostVisibleMemory(m_instanceBuffers[imageIndex],
+      uint32_t(sizeof(InstanceParameter) * instanceCount), m_instances.data());
+    app->WriteToHostVisibleMemory(m_paletteBuffers[imageIndex],
+      uint32_t(sizeof(mat4) * m_bonePalettes.size()), m_bonePalettes.data());
+  }
+
+  // L^ς݂̃R}h͂̂܂܂ŁA`悷CX^X݂̂.
+  for (auto& command : m_indirectCommands)
+  {
+    command.instanceCount = instanceCount;
+  }
+  app->WriteToHostVisibleMemory(m_indirectBuffers[imageIndex],
+    uint32_t(sizeof(VkDrawIndexedIndirectCommand) * m_indirectCommands.size()), m_indirectCommands.data());
+}
+
+void Model::PrepareInstanceBuffers(uint32_t count, VulkanAppBase* app)
+{
+  if (!IsInstancingEnabled())
+  {
+    return;
+  }
+  auto boneCount = (std::max)(GetBoneCount(), 1u);
+  m_instances.reserve(m_instanceCapacity);
+  m_bonePalettes.reserve(size_t(m_paletteCapacity) * boneCount);
+
+  m_indirectCommands.clear();
+  for (const auto& mesh : m_meshes)
+  {
+    m_indirectCommands.push_back(VkDrawIndexedIndirectCommand{ mesh.indexCount, 0, mesh.startIndexOffset, 0, 0 });
+  }
+
+  // t[̂ŃzXg猩郁ɒu.
+  VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  auto sizeInstances = uint32_t(sizeof(InstanceParameter) * m_instanceCapacity);
+  auto sizePalettes = uint32_t(sizeof(mat4) * boneCount * m_paletteCapacity);
+  auto sizeIndirect = uint32_t(sizeof(VkDrawIndexedIndirectCommand) * m_indirectCommands.size());
+  m_instanceBuffers.resize(count);
+  m_paletteBuffers.resize(count);
+  m_indirectBuffers.resize(count);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    m_instanceBuffers[i] = app->CreateBuffer(sizeInstances, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+    m_paletteBuffers[i] = app->CreateBuffer(sizePalettes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+    m_indirectBuffers[i] = app->CreateBuffer(sizeIndirect, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, hostVisible);
+    app->WriteToHostVisibleMemory(m_indirectBuffers[i], sizeIndirect, m_indirectCommands.data());
+  }
+}
+
+void Model::PreparePipelines(VulkanAppBase* app, const std::string& pipeline)
+{
+  auto shaderLibrary = app->GetShaderLibrary();
   array<VkVertexInputAttributeDescription, 6> inputAttribs{ {
     { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(PMDVertex, position)},
     { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(PMDVertex, normal)},
@@ -407,16 +699,16 @@ void Model::PreparePipelines(VulkanAppBase* app)
   using ShaderStageInfo = std::vector<VkPipelineShaderStageCreateInfo>;
 
   ShaderStageInfo shaderStages{
-    book_util::LoadShader(device, "modelVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(device, "modelFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+    shaderLibrary->Load("modelVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    shaderLibrary->Load("modelFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
   };
   ShaderStageInfo shaderStagesOutline{
-    book_util::LoadShader(device, "modelOutlineVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(device, "modelOutlineFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+    shaderLibrary->Load("modelOutlineVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    shaderLibrary->Load("modelOutlineFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
   };
   ShaderStageInfo shaderStagesShadow{
-    book_util::LoadShader(device, "modelShadowVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
-    book_util::LoadShader(device, "modelShadowFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+    shaderLibrary->Load("modelShadowVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+    shaderLibrary->Load("modelShadowFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
   };
 
   auto extent = app->GetSwapchain()->GetSurfaceExtent();
@@ -457,57 +749,116 @@ void Model::PreparePipelines(VulkanAppBase* app)
     VK_NULL_HANDLE, 0
   };
 
-  VkResult result;
-  VkPipeline pipeline;
-  result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &pipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipelines Failed.");
-  m_pipelines["normalDraw"] = pipeline;
-
-  pipelineCI.pStages = shaderStagesOutline.data();
-  pipelineCI.pRasterizationState = &outlineRS;
-  result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &pipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipelines Failed.");
-  m_pipelines["outlineDraw"] = pipeline;
-
-
-  renderPass = app->GetRenderPass("shadow");
-  viewport = { 0, 0, 1024, 1024, 0, 1.0f };
-  scissor = { { 0 }, { 1024, 1024 } };
-  pipelineCI.renderPass = renderPass;
-  pipelineCI.pStages = shaderStagesShadow.data();
-  pipelineCI.pRasterizationState = &defaultRS;
-  result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &pipeline);
-  ThrowIfFailed(result, "vkCreateGraphicsPipelines Failed.");
-  m_pipelines["shadow"] = pipeline;
- 
-  book_util::DestroyShaderModules(device, shaderStages);
-  book_util::DestroyShaderModules(device, shaderStagesOutline);
-  book_util::DestroyShaderModules(device, shaderStagesShadow);
+  VkViewport shadowViewport{ 0, 0, 1024, 1024, 0, 1.0f };
+  VkRect2D shadowScissor{ { 0 }, { 1024, 1024 } };
+  auto shadowViewportCI = viewportCI;
+  shadowViewportCI.pViewports = &shadowViewport;
+  shadowViewportCI.pScissors = &shadowScissor;
+
+  // CX^X`p. _VF[_[ƃpCvCCAEĝ݂قȂ.
+  ShaderStageInfo shaderStagesInstanced, shaderStagesInstancedOutline, shaderStagesInstancedShadow;
+  if (IsInstancingEnabled())
+  {
+    shaderStagesInstanced = {
+      shaderLibrary->Load("modelInstancedVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+      shaderLibrary->Load("modelFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+    };
+    shaderStagesInstancedOutline = {
+      shaderLibrary->Load("modelInstancedOutlineVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+      shaderLibrary->Load("modelOutlineFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+    };
+    shaderStagesInstancedShadow = {
+      shaderLibrary->Load("modelInstancedShadowVS.spv", VK_SHADER_STAGE_VERTEX_BIT),
+      shaderLibrary->Load("modelShadowFS.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+    };
+  }
+
+  // ݂ɈˑȂ̂ŁASẴpCvC܂Ƃ߂ĕɐ.
+  // pipeline w肵ꍇ݂͂̂.
+  std::vector<std::string> names;
+  std::vector<VkGraphicsPipelineCreateInfo> createInfos;
+  auto addPipeline = [&](const char* name, const ShaderStageInfo& stages,
+    const VkPipelineRasterizationStateCreateInfo* rasterizerState, const VkPipelineViewportStateCreateInfo* viewportState,
+    VkRenderPass pass, VkPipelineLayout layout) {
+    if (!pipeline.empty() && pipeline != name)
+    {
+      return;
+    }
+    auto ci = pipelineCI;
+    ci.stageCount = uint32_t(stages.size());
+    ci.pStages = stages.data();
+    ci.pRasterizationState = rasterizerState;
+    ci.pViewportState = viewportState;
+    ci.renderPass = pass;
+    ci.layout = layout;
+    names.push_back(name);
+    createInfos.push_back(ci);
+  };
+  auto shadowPass = app->GetRenderPass("shadow");
+  addPipeline("normalDraw", shaderStages, &defaultRS, &viewportCI, renderPass, pipelineLayout);
+  addPipeline("outlineDraw", shaderStagesOutline, &outlineRS, &viewportCI, renderPass, pipelineLayout);
+  addPipeline("shadow", shaderStagesShadow, &defaultRS, &shadowViewportCI, shadowPass, pipelineLayout);
+  if (IsInstancingEnabled())
+  {
+    auto instancedLayout = app->GetPipelineLayout("modelInstanced");
+    addPipeline("instancedShadow", shaderStagesInstancedShadow, &defaultRS, &shadowViewportCI, shadowPass, instancedLayout);
+    addPipeline("instancedDraw", shaderStagesInstanced, &defaultRS, &viewportCI, renderPass, instancedLayout);
+    addPipeline("instancedOutlineDraw", shaderStagesInstancedOutline, &outlineRS, &viewportCI, renderPass, instancedLayout);
+  }
+
+  // VF[_[XVꂽAgpCvCƂL^R}hobt@݂̂蒼.
+  auto watch = [&](const std::string& name, const ShaderStageInfo& stages) {
+    shaderLibrary->Watch(&m_pipelines[name], stages, [this, app, name]() { RebuildPipeline(name, app); });
+  };
+  if (!createInfos.empty())
+  {
+    std::vector<VkPipeline> pipelines(createInfos.size());
+    app->GetPipelineManager()->CreateGraphicsPipelines(uint32_t(createInfos.size()), createInfos.data(), pipelines.data());
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+      m_pipelines[names[i]] = pipelines[i];
+      watch(names[i], ShaderStageInfo(createInfos[i].pStages, createInfos[i].pStages + createInfos[i].stageCount));
+    }
+  }
+
+  // \[tvZp.
+  if (m_morphMode == MorphMode::Compute && (pipeline.empty() || pipeline == "morph"))
+  {
+    VkComputePipelineCreateInfo computePipelineCI{
+      VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      nullptr, 0,
+      shaderLibrary->Load("modelMorphCS.spv", VK_SHADER_STAGE_COMPUTE_BIT),
+      app->GetPipelineLayout("morph"),
+      VK_NULL_HANDLE, 0
+    };
+    VkPipeline morphPipeline;
+    app->GetPipelineManager()->CreateComputePipelines(1, &computePipelineCI, &morphPipeline);
+    m_pipelines["morph"] = morphPipeline;
+    watch("morph", ShaderStageInfo{ computePipelineCI.stage });
+  }
 }
 
 void Model::PrepareDescriptorSets(VulkanAppBase* app)
 {
   auto device = app->GetDevice();
-  auto imageCount = app->GetSwapchain()->GetImageCount();
   for (auto& material : m_materials)
   {
     auto layout = app->GetDescriptorSetLayout("model");
-    std::vector<VkDescriptorSet> descriptorSets(imageCount);
-
-    std::vector<VkDescriptorSetLayout> layouts;
-    for (uint32_t i = 0; i < imageCount; ++i) { layouts.push_back(layout); }
+    VkDescriptorSet descriptorSet;
     VkDescriptorSetAllocateInfo descriptorSetAI{
       VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
       nullptr, app->GetDescriptorPool(),
-      uint32_t(layouts.size()), layouts.data()
+      1, &layout
     };
-    vkAllocateDescriptorSets(device, &descriptorSetAI, descriptorSets.data());
+    auto result = vkAllocateDescriptorSets(device, &descriptorSetAI, &descriptorSet);
+    ThrowIfFailed(result, "vkAllocateDescriptorSets Failed.");
 
+    // V[ƃ{[s̓t[Ƃ̗̈_Ci~bNItZbgőI.
     VkDescriptorBufferInfo sceneParamUBO{
-      m_sceneParamUBO[0].buffer, 0, VK_WHOLE_SIZE
+      m_frameBuffer.GetBuffer(), 0, sizeof(SceneParameter)
     };
     VkDescriptorBufferInfo boneUBO{
-      m_boneUBO[0].buffer, 0, VK_WHOLE_SIZE
+      m_frameBuffer.GetBuffer(), 0, sizeof(BoneParameter)
     };
     VkDescriptorBufferInfo materialUBO{
       material.GetUniformBuffer().buffer, 0, VK_WHOLE_SIZE
@@ -523,24 +874,74 @@ void Model::PrepareDescriptorSets(VulkanAppBase* app)
       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     };
 
+    if (material.HasTexture())
+    {
+      diffuseTexture.imageView = material.GetTexture().view;
+    }
+
+    const auto dynamicUniform = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    std::array<VkWriteDescriptorSet, 5> writeDescriptors{
+      book_util::CreateWriteDescriptorSet(descriptorSet, 0, &sceneParamUBO, dynamicUniform),
+      book_util::CreateWriteDescriptorSet(descriptorSet, 1, &boneUBO, dynamicUniform),
+      book_util::CreateWriteDescriptorSet(descriptorSet, 2, &materialUBO),
+      book_util::CreateWriteDescriptorSet(descriptorSet, 3, &diffuseTexture),
+      book_util::CreateWriteDescriptorSet(descriptorSet, 4, &shadowTexture),
+    };
+    vkUpdateDescriptorSets(device, uint32_t(writeDescriptors.size()), writeDescriptors.data(), 0, nullptr);
+    material.SetDescriptorSet(descriptorSet);
+  }
+}
+
+void Model::PrepareInstancedDescriptorSets(VulkanAppBase* app)
+{
+  if (!IsInstancingEnabled())
+  {
+    return;
+  }
+  auto device = app->GetDevice();
+  auto imageCount = app->GetSwapchain()->GetImageCount();
+  const auto storage = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (auto& material : m_materials)
+  {
+    std::vector<VkDescriptorSetLayout> layouts(imageCount, app->GetDescriptorSetLayout("modelInstanced"));
+    std::vector<VkDescriptorSet> descriptorSets(imageCount);
+    VkDescriptorSetAllocateInfo descriptorSetAI{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      nullptr, app->GetDescriptorPool(),
+      uint32_t(layouts.size()), layouts.data()
+    };
+    auto result = vkAllocateDescriptorSets(device, &descriptorSetAI, descriptorSets.data());
+    ThrowIfFailed(result, "vkAllocateDescriptorSets Failed.");
+
+    VkDescriptorBufferInfo materialUBO{
+      material.GetUniformBuffer().buffer, 0, VK_WHOLE_SIZE
+    };
+    VkDescriptorImageInfo diffuseTexture{
+      m_sampler,
+      material.HasTexture() ? material.GetTexture().view : m_dummyTexture.view,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    };
+    VkDescriptorImageInfo shadowTexture{
+      m_sampler,
+      m_shadowMap.view,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    };
+    VkDescriptorBufferInfo sceneParamUBO{ m_frameBuffer.GetBuffer(), 0, sizeof(SceneParameter) };
     for (uint32_t i = 0; i < imageCount; ++i)
     {
-      std::array<VkWriteDescriptorSet, 5> writeDescriptors{
-        book_util::CreateWriteDescriptorSet(descriptorSets[i], 0, &sceneParamUBO),
-        book_util::CreateWriteDescriptorSet(descriptorSets[i], 1, &boneUBO),
+      VkDescriptorBufferInfo instances{ m_instanceBuffers[i].buffer, 0, VK_WHOLE_SIZE };
+      VkDescriptorBufferInfo palettes{ m_paletteBuffers[i].buffer, 0, VK_WHOLE_SIZE };
+      std::array<VkWriteDescriptorSet, 6> writeDescriptors{
+        book_util::CreateWriteDescriptorSet(descriptorSets[i], 0, &sceneParamUBO, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC),
         book_util::CreateWriteDescriptorSet(descriptorSets[i], 2, &materialUBO),
         book_util::CreateWriteDescriptorSet(descriptorSets[i], 3, &diffuseTexture),
         book_util::CreateWriteDescriptorSet(descriptorSets[i], 4, &shadowTexture),
+        book_util::CreateWriteDescriptorSet(descriptorSets[i], 5, &instances, storage),
+        book_util::CreateWriteDescriptorSet(descriptorSets[i], 6, &palettes, storage),
       };
-
-      if (material.HasTexture())
-      {
-        diffuseTexture.imageView = material.GetTexture().view;
-      }
-
       vkUpdateDescriptorSets(device, uint32_t(writeDescriptors.size()), writeDescriptors.data(), 0, nullptr);
     }
-    material.SetDescriptorSet(descriptorSets);
+    material.SetInstancedDescriptorSet(descriptorSets);
   }
 }
 
@@ -559,48 +960,248 @@ void Model::UpdateMatrices()
 
 void Model::Update(uint32_t imageIndex, VulkanAppBase* app)
 {
-  app->WriteToHostVisibleMemory(m_sceneParamUBO[imageIndex].memory, sizeof(SceneParameter), &m_sceneParams);
+  m_frameBuffer.BeginFrame(imageIndex);
+  memcpy(m_frameBuffer.GetMapped(imageIndex, m_sceneSlot), &m_sceneParams, sizeof(SceneParameter));
 
-  // {[sjtH[obt@֏.
-  for (uint32_t i = 0; i < m_bones.size(); ++i)
+  // {[s̓}bvς݂̗̈֒ڏ. g{[̐΂悢.
+  auto boneMatrices = static_cast<BoneParameter*>(m_frameBuffer.GetMapped(imageIndex, m_boneSlot))->bone;
+  const auto capacity = uint32_t(sizeof(BoneParameter::bone) / sizeof(BoneParameter::bone[0]));
+  if (m_animationRuntime)
   {
-    auto bone = m_bones[i];
-    auto mtx = bone->GetWorldMatrix() * bone->GetInvBindMatrix();
-    m_boneMatrices.bone[i] = mtx;
+    m_animationRuntime->GetSkinMatrices(m_animationInstance, boneMatrices, capacity);
+  }
+  else
+  {
+    auto boneCount = std::min(uint32_t(m_bones.size()), capacity);
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+      auto bone = m_bones[i];
+      boneMatrices[i] = bone->GetWorldMatrix() * bone->GetInvBindMatrix();
+    }
+  }
+
+  // Rs[gŌvZꍇ̓EFCĝ݂].
+  if (m_morphMode == MorphMode::Compute)
+  {
+    if (m_morphVertexCount > 0)
+    {
+      auto weights = m_frameBuffer.Write(m_faceMorphWeights.data(), uint32_t(sizeof(float) * m_faceMorphWeights.size()));
+      m_morphWeightOffset = weights.offset;
+    }
+    return;
+  }
+
+  UpdateMorphVertices(imageIndex, app);
+}
+
+void Model::RecordMorphCommands(VkCommandBuffer command, uint32_t imageIndex, VulkanAppBase* app)
+{
+  if (m_morphMode != MorphMode::Compute || m_morphVertexCount == 0)
+  {
+    return;
   }
-  app->WriteToHostVisibleMemory(m_boneUBO[imageIndex].memory, sizeof(BoneParameter), &m_boneMatrices);
+  auto pipelineLayout = app->GetPipelineLayout("morph");
+  MorphParameter params{
+    m_morphVertexCount,
+    uint32_t(sizeof(PMDVertex) / sizeof(float)),
+    uint32_t(offsetof(PMDVertex, position) / sizeof(float)),
+    0
+  };
 
+  // ]ob`̃oA͌㑱̓ǂݍ݂ɑ΂. _̃Rs[̌Ɉʒuނ悤Aݓmt.
+  VkBufferMemoryBarrier uploadBarrier{
+    VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, nullptr,
+    VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+    m_vertexBuffers[imageIndex].buffer, 0, VK_WHOLE_SIZE
+  };
+  vkCmdPipelineBarrier(command,
+    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0, 0, nullptr,
+    1, &uploadBarrier,
+    0, nullptr);
+
+  vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines["morph"]);
+  vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+    0, 1, &m_morphDescriptorSets[imageIndex], 1, &m_morphWeightOffset);
+  vkCmdPushConstants(command, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+  vkCmdDispatch(command, (m_morphVertexCount + MorphGroupSize - 1) / MorphGroupSize, 1, 1);
+
+  // 񂾈ʒu𒸓_͂œǂ߂悤ɂ.
+  VkBufferMemoryBarrier barrier{
+    VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, nullptr,
+    VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+    m_vertexBuffers[imageIndex].buffer, 0, VK_WHOLE_SIZE
+  };
+  vkCmdPipelineBarrier(command,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+    0, 0, nullptr,
+    1, &barrier,
+    0, nullptr);
+}
 
-  // _obt@̍XV.
+void Model::PrepareMorphBuffers(VulkanAppBase* app)
+{
+  // x[X_Ƃɉe\̍܂Ƃ߂.
+  auto morphVertexCount = uint32_t(m_faceBaseInfo.verticesPos.size());
+  std::vector<uint32_t> deltaCounts(morphVertexCount, 0);
+  for (const auto& face : m_faceOffsetInfo)
   {
-    auto vertexCount = m_faceBaseInfo.verticesPos.size();
-    for (uint32_t i = 0; i < vertexCount; ++i)
+    for (auto baseVertexIndex : face.indices)
     {
-      auto offsetIndex = m_faceBaseInfo.indices[i];
-      m_hostMemVertices[offsetIndex].position = m_faceBaseInfo.verticesPos[i];
+      deltaCounts[baseVertexIndex]++;
     }
+  }
 
-    // EFCgɉĒ_ύX.
-    for (uint32_t faceIndex = 0; faceIndex < m_faceOffsetInfo.size(); ++faceIndex)
+  struct MorphVertex
+  {
+    uint32_t vertexIndex;
+    uint32_t deltaStart;
+    uint32_t deltaCount;
+    uint32_t reserved;
+  };
+  std::vector<MorphVertex> morphVertices(morphVertexCount);
+  std::vector<vec4> basePositions(morphVertexCount);
+  uint32_t deltaTotal = 0;
+  for (uint32_t i = 0; i < morphVertexCount; ++i)
+  {
+    morphVertices[i] = MorphVertex{ m_faceBaseInfo.indices[i], deltaTotal, 0, 0 };
+    basePositions[i] = vec4(m_faceBaseInfo.verticesPos[i], 1.0f);
+    deltaTotal += deltaCounts[i];
+  }
+  // w ɂ͕\̔ԍrbĝ܂܊i[.
+  std::vector<vec4> deltas(deltaTotal);
+  for (uint32_t faceIndex = 0; faceIndex < m_faceOffsetInfo.size(); ++faceIndex)
+  {
+    const auto& face = m_faceOffsetInfo[faceIndex];
+    for (uint32_t i = 0; i < face.indices.size(); ++i)
     {
-      const auto& face = m_faceOffsetInfo[faceIndex];
-      float w = m_faceMorphWeights[faceIndex];
+      auto& dst = morphVertices[face.indices[i]];
+      deltas[dst.deltaStart + dst.deltaCount++] = vec4(face.verticesOffset[i], uintBitsToFloat(faceIndex));
+    }
+  }
 
-      for(uint32_t i=0;i<face.indices.size();++i)
-      {
-        auto baseVertexIndex = face.indices[i];
-        auto displacement = face.verticesOffset[i];
+  m_morphVertexCount = (deltaTotal > 0) ? morphVertexCount : 0;
+  if (m_morphVertexCount == 0)
+  {
+    return;
+  }
+
+  auto uploader = app->GetUploadBatcher();
+  const auto usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  const auto deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  auto sizeVertices = uint32_t(sizeof(MorphVertex) * morphVertices.size());
+  auto sizeBasePositions = uint32_t(sizeof(vec4) * basePositions.size());
+  auto sizeDeltas = uint32_t(sizeof(vec4) * deltas.size());
+  m_morphVertexBuffer = app->CreateBuffer(sizeVertices, usage, deviceLocal);
+  m_morphBasePosBuffer = app->CreateBuffer(sizeBasePositions, usage, deviceLocal);
+  m_morphDeltaBuffer = app->CreateBuffer(sizeDeltas, usage, deviceLocal);
+  uploader->UploadBuffer(m_morphVertexBuffer.buffer, 0, morphVertices.data(), sizeVertices);
+  uploader->UploadBuffer(m_morphBasePosBuffer.buffer, 0, basePositions.data(), sizeBasePositions);
+  uploader->UploadBuffer(m_morphDeltaBuffer.buffer, 0, deltas.data(), sizeDeltas);
+}
+
+void Model::PrepareMorphEvaluator(uint32_t imageCount)
+{
+  auto baseCount = uint32_t(m_faceBaseInfo.verticesPos.size());
+  m_morphEvaluator.Initialize(m_faceBaseInfo.indices.data(), m_faceBaseInfo.verticesPos.data(), baseCount);
+  for (const auto& face : m_faceOffsetInfo)
+  {
+    m_morphEvaluator.AddMorph(face.indices.data(), face.verticesOffset.data(), uint32_t(face.indices.size()));
+  }
 
-        auto offsetIndex = m_faceBaseInfo.indices[baseVertexIndex];
-        m_hostMemVertices[offsetIndex].position += displacement * w;
+  // _obt@̏l̓x[X\̈ʒuƂ.
+  for (uint32_t i = 0; i < baseCount; ++i)
+  {
+    m_hostMemVertices[m_faceBaseInfo.indices[i]].position = m_faceBaseInfo.verticesPos[i];
+  }
+  m_morphSerial = 0;
+  m_morphBlockSerials.assign(m_morphEvaluator.GetBlockCount(), 0);
+  m_morphImageSerials.assign(imageCount, 0);
+}
+
+void Model::UpdateMorphVertices(uint32_t imageIndex, VulkanAppBase* app)
+{
+  // EFCgωubN̂ݍČvZăzXg̒_֔f.
+  if (m_morphEvaluator.Evaluate(m_faceMorphWeights.data()))
+  {
+    ++m_morphSerial;
+    for (auto block : m_morphEvaluator.GetChangedBlocks())
+    {
+      m_morphBlockSerials[block] = m_morphSerial;
+      auto first = block * MorphEvaluator::BlockSize;
+      auto last = std::min(first + MorphEvaluator::BlockSize, m_morphEvaluator.GetBaseCount());
+      for (auto i = first; i < last; ++i)
+      {
+        m_hostMemVertices[m_morphEvaluator.GetVertexIndex(i)].position = m_morphEvaluator.GetPosition(i);
       }
     }
+  }
 
-    auto bufferSize = sizeof(PMDVertex) * m_hostMemVertices.size();
+  // _obt@̓C[WƂɂ邽߁A
+  // ̃obt@֍ŌɔfɕωubN͈݂̔͂̂].
+  auto& imageSerial = m_morphImageSerials[imageIndex];
+  if (imageSerial == m_morphSerial)
+  {
+    return;
+  }
+  m_morphUploadBlocks.clear();
+  for (uint32_t block = 0; block < uint32_t(m_morphBlockSerials.size()); ++block)
+  {
+    if (m_morphBlockSerials[block] > imageSerial)
+    {
+      m_morphUploadBlocks.push_back(block);
+    }
+  }
+  m_morphEvaluator.BuildVertexRanges(m_morphUploadBlocks, MorphRangeMergeGap, m_morphUploadRanges);
+  for (const auto& range : m_morphUploadRanges)
+  {
     app->WriteToHostVisibleMemory(
-      m_vertexBuffers[imageIndex].memory,
-      uint32_t(bufferSize),
-      m_hostMemVertices.data());
+      m_vertexBuffers[imageIndex],
+      uint32_t(sizeof(PMDVertex) * range.first),
+      uint32_t(sizeof(PMDVertex) * range.count),
+      &m_hostMemVertices[range.first]);
+  }
+  imageSerial = m_morphSerial;
+}
+
+void Model::PrepareMorphDescriptorSets(VulkanAppBase* app)
+{
+  if (m_morphMode != MorphMode::Compute || m_morphVertexCount == 0)
+  {
+    return;
+  }
+  auto device = app->GetDevice();
+  auto imageCount = app->GetSwapchain()->GetImageCount();
+  std::vector<VkDescriptorSetLayout> layouts(imageCount, app->GetDescriptorSetLayout("morph"));
+  VkDescriptorSetAllocateInfo descriptorSetAI{
+    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+    nullptr, app->GetDescriptorPool(),
+    uint32_t(layouts.size()), layouts.data()
+  };
+  m_morphDescriptorSets.resize(imageCount);
+  auto result = vkAllocateDescriptorSets(device, &descriptorSetAI, m_morphDescriptorSets.data());
+  ThrowIfFailed(result, "vkAllocateDescriptorSets Failed.");
+
+  VkDescriptorBufferInfo morphVertices{ m_morphVertexBuffer.buffer, 0, VK_WHOLE_SIZE };
+  VkDescriptorBufferInfo basePositions{ m_morphBasePosBuffer.buffer, 0, VK_WHOLE_SIZE };
+  VkDescriptorBufferInfo deltas{ m_morphDeltaBuffer.buffer, 0, VK_WHOLE_SIZE };
+  // EFCg͖t[ FrameRingBuffer ؂oA_Ci~bNItZbgňʒuw肷.
+  VkDescriptorBufferInfo weights{ m_frameBuffer.GetBuffer(), 0, sizeof(float) * m_faceMorphWeights.size() };
+  const auto storage = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t i = 0; i < imageCount; ++i)
+  {
+    auto descriptorSet = m_morphDescriptorSets[i];
+    VkDescriptorBufferInfo vertices{ m_vertexBuffers[i].buffer, 0, VK_WHOLE_SIZE };
+    std::array<VkWriteDescriptorSet, 5> writeDescriptors{
+      book_util::CreateWriteDescriptorSet(descriptorSet, 0, &morphVertices, storage),
+      book_util::CreateWriteDescriptorSet(descriptorSet, 1, &basePositions, storage),
+      book_util::CreateWriteDescriptorSet(descriptorSet, 2, &deltas, storage),
+      book_util::CreateWriteDescriptorSet(descriptorSet, 3, &weights, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC),
+      book_util::CreateWriteDescriptorSet(descriptorSet, 4, &vertices, storage),
+    };
+    vkUpdateDescriptorSets(device, uint32_t(writeDescriptors.size()), writeDescriptors.data(), 0, nullptr);
   }
 }
 
@@ -610,16 +1211,13 @@ void Model::PrepareDummyTexture(VulkanAppBase* app)
   VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
   m_dummyTexture = app->CreateTexture(1, 1, VK_FORMAT_R8G8B8A8_UNORM, usage);
 
-  VkMemoryPropertyFlags bufferMemProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-  auto bufferSrc = app->CreateBuffer(4, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, bufferMemProps);
   uint32_t imagePixel = 0xffffffffu;
-  app->WriteToHostVisibleMemory(bufferSrc.memory, 4, &imagePixel);
 
   VkBufferImageCopy region{};
   region.imageExtent = { 1,1,1 };
   region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
 
-  app->TransferStageBufferToImage(bufferSrc, m_dummyTexture, &region);
+  m_uploadToken = app->GetUploadBatcher()->UploadImage(m_dummyTexture.image, region, &imagePixel, sizeof(imagePixel));
 
   VkSamplerCreateInfo samplerCI{
     VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
@@ -634,18 +1232,15 @@ void Model::PrepareDummyTexture(VulkanAppBase* app)
   };
   result = vkCreateSampler(app->GetDevice(), &samplerCI, nullptr, &m_sampler);
   ThrowIfFailed(result, "vkCreateSampler Failed.");
-
-  app->DestroyBuffer(bufferSrc);
 }
 
-void Model::PrepareCommandBuffers(uint32_t count, VulkanAppBase* app)
+void Model::PrepareCommandBuffers(uint32_t count, VulkanAppBase* app, const std::string& pipeline)
 {
-  auto renderPass = app->GetRenderPass("default");
   auto materialCount = uint32_t(m_materials.size());
  
   VkCommandBufferInheritanceInfo inheritInfo{
     VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
-    nullptr, renderPass,
+    nullptr, app->GetRenderPass("default"),
     0, VK_NULL_HANDLE, VK_FALSE, 0, 0
   };
   VkCommandBufferBeginInfo beginInfo{
@@ -654,96 +1249,162 @@ void Model::PrepareCommandBuffers(uint32_t count, VulkanAppBase* app)
     VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
     &inheritInfo
   };
+  auto pipelineLayout = app->GetPipelineLayout("model");
 
-  // ʏ`̃R}h\z.
-  m_commandBuffers.resize(count);
-  for (uint32_t index = 0; index < count; ++index)
+  // ʏ`E֊sEVhEpX̃R}h\z. ֊s͗֊s}eÂ݂`.
+  // pipeline w肵ꍇ͂ĝ蒼.
+  struct Pass
   {
-    auto& buffers = m_commandBuffers[index];
-    buffers.resize(materialCount);
-    app->AllocateCommandBufferSecondary(materialCount, buffers.data());
-
-    auto vertexBuffer = m_vertexBuffers[index];
-    VkPipeline usePipeline = m_pipelines["normalDraw"];
-    for (uint32_t i = 0; i < materialCount; ++i)
+    std::vector<SecondaryCommandBuffers>* commandBuffers;
+    const char* pipeline;
+    VkRenderPass renderPass;
+    bool edgeOnly;
+  };
+  std::array<Pass, 3> passes{ {
+    { &m_commandBuffers, "normalDraw", app->GetRenderPass("default"), false },
+    { &m_commandBuffersOutline, "outlineDraw", app->GetRenderPass("default"), true },
+    { &m_commandBuffersShadow, "shadow", app->GetRenderPass("shadow"), false },
+  } };
+  for (auto& pass : passes)
+  {
+    if (!pipeline.empty() && pipeline != pass.pipeline)
     {
-      auto descriptorSet = m_materials[i].GetDescriptorSet(index);
-      auto pipelineLayout = app->GetPipelineLayout("model");
-      auto mesh = m_meshes[i];
-      auto command = buffers[i];
-
-      vkBeginCommandBuffer(command, &beginInfo);
-      VkDeviceSize offsets[] = { 0 };
-      vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, usePipeline);
-      vkCmdBindIndexBuffer(command, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-      vkCmdBindVertexBuffers(command, 0, 1, &vertexBuffer.buffer, offsets);
-      vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
-      vkCmdDrawIndexed(command, mesh.indexCount, 1, mesh.startIndexOffset, 0, 0);
-      vkEndCommandBuffer(command);
+      continue;
     }
-  }
-
-  // ֊s`p̃R}h\z.
-  m_commandBuffersOutline.resize(count);
-  for (uint32_t index = 0; index < count; ++index)
-  {
-    auto& buffers = m_commandBuffersOutline[index];
-    buffers.resize(materialCount);
-    app->AllocateCommandBufferSecondary(materialCount, buffers.data());
-
-    auto vertexBuffer = m_vertexBuffers[index];
-    VkPipeline usePipeline = m_pipelines["outlineDraw"];
-    uint32_t commandIndex = 0;
-    for (uint32_t i = 0; i < materialCount; ++i)
+    FreeCommandBuffers(*pass.commandBuffers, app);
+    inheritInfo.renderPass = pass.renderPass;
+    auto usePipeline = m_pipelines[pass.pipeline];
+    pass.commandBuffers->resize(count);
+    for (uint32_t index = 0; index < count; ++index)
     {
-      auto descriptorSet = m_materials[i].GetDescriptorSet(index);
-      auto pipelineLayout = app->GetPipelineLayout("model");
-      auto mesh = m_meshes[i];
-      auto material = m_materials[i];
-      if (material.GetEdgeFlag() == 0)
+      auto& buffers = (*pass.commandBuffers)[index];
+      buffers.resize(materialCount);
+      app->AllocateCommandBufferSecondary(materialCount, buffers.data());
+
+      auto vertexBuffer = m_vertexBuffers[index];
+      std::array<uint32_t, 2> dynamicOffsets{ m_frameBuffer.GetOffset(index, m_sceneSlot), m_frameBuffer.GetOffset(index, m_boneSlot) };
+      uint32_t commandIndex = 0;
+      for (uint32_t i = 0; i < materialCount; ++i)
       {
-        continue;
+        if (pass.edgeOnly && m_materials[i].GetEdgeFlag() == 0)
+        {
+          continue;
+        }
+        auto descriptorSet = m_materials[i].GetDescriptorSet();
+        auto mesh = m_meshes[i];
+        auto command = buffers[commandIndex++];
+
+        vkBeginCommandBuffer(command, &beginInfo);
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, usePipeline);
+        vkCmdBindIndexBuffer(command, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdBindVertexBuffers(command, 0, 1, &vertexBuffer.buffer, offsets);
+        vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet,
+          uint32_t(dynamicOffsets.size()), dynamicOffsets.data());
+        vkCmdDrawIndexed(command, mesh.indexCount, 1, mesh.startIndexOffset, 0, 0);
+        vkEndCommandBuffer(command);
+      }
+      // gȂ͉.
+      if (commandIndex < materialCount)
+      {
+        app->FreeCommandBufferSecondary(materialCount - commandIndex, buffers.data() + commandIndex);
       }
-      auto command = buffers[commandIndex++];
+      buffers.resize(commandIndex);
+    }
+  }
+}
 
-      vkBeginCommandBuffer(command, &beginInfo);
-      VkDeviceSize offsets[] = { 0 };
-      vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, usePipeline);
-      vkCmdBindIndexBuffer(command, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-      vkCmdBindVertexBuffers(command, 0, 1, &vertexBuffer.buffer, offsets);
-      vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
-      vkCmdDrawIndexed(command, mesh.indexCount, 1, mesh.startIndexOffset, 0, 0);
-      vkEndCommandBuffer(command);
+void Model::FreeCommandBuffers(std::vector<SecondaryCommandBuffers>& commandBuffers, VulkanAppBase* app)
+{
+  // 蒼ꍇAÂ͕̂`撆̃t[gIĂ.
+  for (auto& buffers : commandBuffers)
+  {
+    if (!buffers.empty())
+    {
+      app->FreeCommandBufferSecondaryDeferred(uint32_t(buffers.size()), buffers.data());
     }
-    buffers.resize(commandIndex);
   }
+  commandBuffers.clear();
+}
 
-  // VhEpXp̃R}h\z.
-  m_commandBuffersShadow.resize(count);
-  inheritInfo.renderPass = app->GetRenderPass("shadow");
-  for (uint32_t index = 0; index < count; ++index)
+void Model::PrepareInstancedCommandBuffers(uint32_t count, VulkanAppBase* app, const std::string& pipeline)
+{
+  if (!IsInstancingEnabled())
   {
-    auto& buffers = m_commandBuffersShadow[index];
-    buffers.resize(materialCount);
-    app->AllocateCommandBufferSecondary(materialCount, buffers.data());
+    return;
+  }
+  auto materialCount = uint32_t(m_materials.size());
+  VkCommandBufferInheritanceInfo inheritInfo{
+    VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+    nullptr, app->GetRenderPass("default"),
+    0, VK_NULL_HANDLE, VK_FALSE, 0, 0
+  };
+  VkCommandBufferBeginInfo beginInfo{
+    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    nullptr,
+    VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+    &inheritInfo
+  };
+  auto pipelineLayout = app->GetPipelineLayout("modelInstanced");
+  const auto stride = uint32_t(sizeof(VkDrawIndexedIndirectCommand));
 
-    auto vertexBuffer = m_vertexBuffers[index];
-    VkPipeline usePipeline = m_pipelines["shadow"];
-    for (uint32_t i = 0; i < materialCount; ++i)
+  // ʏ`E֊sEVhEpX̂A}eAƂ 1 ̊Ԑڕ`őSCX^X`.
+  struct Pass
+  {
+    std::vector<SecondaryCommandBuffers>* commandBuffers;
+    const char* pipeline;
+    VkRenderPass renderPass;
+    bool edgeOnly;
+  };
+  std::array<Pass, 3> passes{ {
+    { &m_commandBuffersInstanced, "instancedDraw", app->GetRenderPass("default"), false },
+    { &m_commandBuffersInstancedOutline, "instancedOutlineDraw", app->GetRenderPass("default"), true },
+    { &m_commandBuffersInstancedShadow, "instancedShadow", app->GetRenderPass("shadow"), false },
+  } };
+  for (auto& pass : passes)
+  {
+    if (!pipeline.empty() && pipeline != pass.pipeline)
+    {
+      continue;
+    }
+    FreeCommandBuffers(*pass.commandBuffers, app);
+    inheritInfo.renderPass = pass.renderPass;
+    auto usePipeline = m_pipelines[pass.pipeline];
+    pass.commandBuffers->resize(count);
+    for (uint32_t index = 0; index < count; ++index)
     {
-      auto descriptorSet = m_materials[i].GetDescriptorSet(index);
-      auto pipelineLayout = app->GetPipelineLayout("model");
-      auto mesh = m_meshes[i];
-      auto command = buffers[i];
-
-      vkBeginCommandBuffer(command, &beginInfo);
-      VkDeviceSize offsets[] = { 0 };
-      vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, usePipeline);
-      vkCmdBindIndexBuffer(command, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-      vkCmdBindVertexBuffers(command, 0, 1, &vertexBuffer.buffer, offsets);
-      vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
-      vkCmdDrawIndexed(command, mesh.indexCount, 1, mesh.startIndexOffset, 0, 0);
-      vkEndCommandBuffer(command);
+      auto& buffers = (*pass.commandBuffers)[index];
+      buffers.resize(materialCount);
+      app->AllocateCommandBufferSecondary(materialCount, buffers.data());
+
+      auto vertexBuffer = m_vertexBuffers[index];
+      auto indirectBuffer = m_indirectBuffers[index];
+      auto sceneOffset = m_frameBuffer.GetOffset(index, m_sceneSlot);
+      uint32_t commandIndex = 0;
+      for (uint32_t i = 0; i < materialCount; ++i)
+      {
+        if (pass.edgeOnly && m_materials[i].GetEdgeFlag() == 0)
+        {
+          continue;
+        }
+        auto descriptorSet = m_materials[i].GetInstancedDescriptorSet(index);
+        auto command = buffers[commandIndex++];
+
+        vkBeginCommandBuffer(command, &beginInfo);
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, usePipeline);
+        vkCmdBindIndexBuffer(command, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdBindVertexBuffers(command, 0, 1, &vertexBuffer.buffer, offsets);
+        vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &sceneOffset);
+        vkCmdDrawIndexedIndirect(command, indirectBuffer.buffer, VkDeviceSize(stride) * i, 1, stride);
+        vkEndCommandBuffer(command);
+      }
+      // gȂ͉.
+      if (commandIndex < materialCount)
+      {
+        app->FreeCommandBufferSecondary(materialCount - commandIndex, buffers.data() + commandIndex);
+      }
+      buffers.resize(commandIndex);
     }
   }
 }
\ No newline at end of file
@@ -0,0 +1,254 @@
+// \[t CPU ]ɂāA]̑S_[v MorphEvaluator r.
+//  12_Animation_MorphBenchmark [PMDt@C] [t[]
+#include "MorphEvaluator.h"
+#include "VulkanBookUtil.h"
+#include "loader/PMDloader.h"
+#include "loader/MappedFile.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace glm;
+
+namespace
+{
+  // Model::PMDVertex Ɠzu.
+  struct PMDVertex
+  {
+    vec3 position;
+    vec3 normal;
+    vec2 uv;
+    uvec2 boneIndices;
+    vec2 boneWeights;
+    uint32_t edgeFlag;
+  };
+
+  struct FaceData
+  {
+    std::vector<uint32_t> baseIndices;
+    std::vector<vec3> basePositions;
+    std::vector<std::vector<uint32_t>> indices;
+    std::vector<std::vector<vec3>> offsets;
+  };
+
+  // Xbv`FC̃C[Wɑ钸_obt@̐.
+  const uint32_t BufferCount = 3;
+  const uint32_t MergeGap = 16;
+
+  struct Result
+  {
+    double ms;
+    double bytesPerFrame;
+  };
+
+  // ]̕@. t[ׂẴx[X_߂AׂĂ̕\ZđŜ].
+  Result RunLegacy(const FaceData& faces, std::vector<PMDVertex>& vertices,
+    std::vector<std::vector<PMDVertex>>& buffers, const std::function<void(uint32_t, std::vector<float>&)>& animate, uint32_t frames)
+  {
+    std::vector<float> weights(faces.indices.size(), 0.0f);
+    size_t bytes = 0;
+    book_util::StopWatch stopWatch;
+    for (uint32_t frame = 0; frame < frames; ++frame)
+    {
+      animate(frame, weights);
+      for (size_t i = 0; i < faces.baseIndices.size(); ++i)
+      {
+        vertices[faces.baseIndices[i]].position = faces.basePositions[i];
+      }
+      for (size_t faceIndex = 0; faceIndex < faces.indices.size(); ++faceIndex)
+      {
+        const auto& indices = faces.indices[faceIndex];
+        const auto& offsets = faces.offsets[faceIndex];
+        float w = weights[faceIndex];
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+          vertices[faces.baseIndices[indices[i]]].position += offsets[i] * w;
+        }
+      }
+      auto& dst = buffers[frame % BufferCount];
+      memcpy(dst.data(), vertices.data(), sizeof(PMDVertex) * vertices.size());
+      bytes += sizeof(PMDVertex) * vertices.size();
+    }
+    return Result{ stopWatch.GetElapsedMs() / frames, double(bytes) / frames };
+  }
+
+  // MorphEvaluator gAῶ͈݂̂eobt@֓] (Model::UpdateMorphVertices Ɠ菇).
+  Result RunEvaluator(const FaceData& faces, std::vector<PMDVertex>& vertices,
+    std::vector<std::vector<PMDVertex>>& buffers, const std::function<void(uint32_t, std::vector<float>&)>& animate, uint32_t frames)
+  {
+    MorphEvaluator evaluator;
+    evaluator.Initialize(faces.baseIndices.data(), faces.basePositions.data(), uint32_t(faces.baseIndices.size()));
+    for (size_t i = 0; i < faces.indices.size(); ++i)
+    {
+      evaluator.AddMorph(faces.indices[i].data(), faces.offsets[i].data(), uint32_t(faces.indices[i].size()));
+    }
+    for (size_t i = 0; i < faces.baseIndices.size(); ++i)
+    {
+      vertices[faces.baseIndices[i]].position = faces.basePositions[i];
+    }
+    for (auto& dst : buffers)
+    {
+      dst = vertices;
+    }
+
+    std::vector<float> weights(faces.indices.size(), 0.0f);
+    uint32_t serial = 0;
+    std::vector<uint32_t> blockSerials(evaluator.GetBlockCount(), 0);
+    std::vector<uint32_t> bufferSerials(BufferCount, 0);
+    std::vector<uint32_t> blocks;
+    std::vector<MorphEvaluator::Range> ranges;
+    size_t bytes = 0;
+    book_util::StopWatch stopWatch;
+    for (uint32_t frame = 0; frame < frames; ++frame)
+    {
+      animate(frame, weights);
+      if (evaluator.Evaluate(weights.data()))
+      {
+        ++serial;
+        for (auto block : evaluator.GetChangedBlocks())
+        {
+          blockSerials[block] = serial;
+          auto first = block * MorphEvaluator::BlockSize;
+          auto last = std::min(first + MorphEvaluator::BlockSize, evaluator.GetBaseCount());
+          for (auto i = first; i < last; ++i)
+          {
+            vertices[evaluator.GetVertexIndex(i)].position = evaluator.GetPosition(i);
+          }
+        }
+      }
+
+      auto bufferIndex = frame % BufferCount;
+      if (bufferSerials[bufferIndex] == serial)
+      {
+        continue;
+      }
+      blocks.clear();
+      for (uint32_t block = 0; block < uint32_t(blockSerials.size()); ++block)
+      {
+        if (blockSerials[block] > bufferSerials[bufferIndex])
+        {
+          blocks.push_back(block);
+        }
+      }
+      evaluator.BuildVertexRanges(blocks, MergeGap, ranges);
+      auto& dst = buffers[bufferIndex];
+      for (const auto& range : ranges)
+      {
+        memcpy(&dst[range.first], &vertices[range.first], sizeof(PMDVertex) * range.count);
+        bytes += sizeof(PMDVertex) * range.count;
+      }
+      bufferSerials[bufferIndex] = serial;
+    }
+    return Result{ stopWatch.GetElapsedMs() / frames, double(bytes) / frames };
+  }
+
+  float MaxDifference(const std::vector<std::vector<PMDVertex>>& a, const std::vector<std::vector<PMDVertex>>& b)
+  {
+    float diff = 0.0f;
+    for (size_t n = 0; n < a.size(); ++n)
+    {
+      for (size_t i = 0; i < a[n].size(); ++i)
+      {
+        auto d = a[n][i].position - b[n][i].position;
+        diff = std::max({ diff, std::fabs(d.x), std::fabs(d.y), std::fabs(d.z) });
+      }
+    }
+    return diff;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* fileName = argc > 1 ? argv[1] : "~N.pmd";
+  uint32_t frames = argc > 2 ? uint32_t(std::atoi(argv[2])) : 2000;
+  frames = std::max(frames, 1u);
+
+  loader::MappedFile file(fileName);
+  if (!file.isOpen())
+  {
+    printf("Failed to open %s\n", fileName);
+    return 1;
+  }
+  loader::PMDFile loader(file);
+
+  std::vector<PMDVertex> vertices(loader.getVertexCount());
+  const loader::PMDVertexLayout vertexLayout{
+    sizeof(PMDVertex),
+    offsetof(PMDVertex, position),
+    offsetof(PMDVertex, normal),
+    offsetof(PMDVertex, uv),
+    offsetof(PMDVertex, boneIndices),
+    offsetof(PMDVertex, boneWeights),
+    offsetof(PMDVertex, edgeFlag),
+  };
+  loader.decodeVertices(vertices.data(), vertexLayout);
+
+  // Model::Load Ɠ 0 Ԃx[XƂĈ.
+  FaceData faces;
+  const auto& baseFace = loader.getFaceBase();
+  faces.baseIndices.assign(baseFace.getFaceIndices(), baseFace.getFaceIndices() + baseFace.getIndexCount());
+  faces.basePositions.assign(baseFace.getFaceVertices(), baseFace.getFaceVertices() + baseFace.getVertexCount());
+  auto faceCount = loader.getFaceCount() > 0 ? loader.getFaceCount() - 1 : 0;
+  for (uint32_t i = 0; i < faceCount; ++i)
+  {
+    const auto& face = loader.getFace(i + 1);
+    faces.indices.emplace_back(face.getFaceIndices(), face.getFaceIndices() + face.getIndexCount());
+    faces.offsets.emplace_back(face.getFaceVertices(), face.getFaceVertices() + face.getVertexCount());
+  }
+  if (faceCount == 0)
+  {
+    printf("%s has no face morphs.\n", fileName);
+    return 1;
+  }
+
+  printf("%s: vertices %u, base vertices %u, morphs %u, frames %u\n",
+    fileName, uint32_t(vertices.size()), uint32_t(faces.baseIndices.size()), faceCount, frames);
+
+  struct Scenario
+  {
+    const char* name;
+    std::function<void(uint32_t, std::vector<float>&)> animate;
+  };
+  const Scenario scenarios[] = {
+    // \𓮂Ȃ.
+    { "idle", [](uint32_t, std::vector<float>&) {} },
+    // ܂΂ƌ̊J̂悤ɐ̕\𓮂.
+    { "few", [](uint32_t frame, std::vector<float>& w) {
+      for (size_t i = 0; i < std::min<size_t>(w.size(), 3); ++i)
+      {
+        w[i] = 0.5f + 0.5f * std::sin(frame * 0.1f + float(i));
+      }
+    } },
+    // ׂĂ̕\𖈃t[.
+    { "all", [](uint32_t frame, std::vector<float>& w) {
+      for (size_t i = 0; i < w.size(); ++i)
+      {
+        w[i] = 0.5f + 0.5f * std::sin(frame * 0.1f + float(i));
+      }
+    } },
+  };
+
+  printf("%-6s %12s %12s %14s %14s %10s\n", "case", "legacy ms", "eval ms", "legacy KB/f", "eval KB/f", "max diff");
+  for (const auto& scenario : scenarios)
+  {
+    std::vector<std::vector<PMDVertex>> legacyBuffers(BufferCount, vertices);
+    std::vector<std::vector<PMDVertex>> evalBuffers(BufferCount, vertices);
+    auto legacyVertices = vertices;
+    auto evalVertices = vertices;
+
+    auto legacy = RunLegacy(faces, legacyVertices, legacyBuffers, scenario.animate, frames);
+    auto eval = RunEvaluator(faces, evalVertices, evalBuffers, scenario.animate, frames);
+    printf("%-6s %12.4f %12.4f %14.1f %14.1f %10.2e\n", scenario.name,
+      legacy.ms, eval.ms, legacy.bytesPerFrame / 1024.0, eval.bytesPerFrame / 1024.0,
+      MaxDifference(legacyBuffers, evalBuffers));
+  }
+  return 0;
+}
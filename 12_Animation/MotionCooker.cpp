@@ -0,0 +1,223 @@
+// VMD [VLbV֕ϊAǂݍݎԂr.
+//  12_Animation_MotionCooker VMDt@C [o̓t@C] [--quantize] [--model PMDt@C]
+// o̓t@CȗƁA--motion-cache ŋN 12_Animation TO (motion_cache/VMDt@C.cache) ŏo.
+// --model w肷ƃgbÑf̃{[E\̔ԍ֌ѕtĕۑA
+// fւ Attach ł͖ǑȂ.
+#include "BezierCurveTable.h"
+#include "VulkanBookUtil.h"
+#include "loader/MotionCache.h"
+#include "loader/PMDloader.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const uint32_t Iterations = 20;
+
+  // Animator::Prepare  VMD ̕ϊƓ.
+  uint32_t LoadFromVMD(const char* fileName, BezierCurveTable& curves)
+  {
+    std::ifstream infile(fileName, std::ios::binary);
+    loader::VMDFile vmd(infile);
+    curves.Clear();
+    uint32_t keyCount = 0;
+    for (uint32_t i = 0; i < vmd.getNodeCount(); ++i)
+    {
+      auto framesSrc = vmd.getKeyframes(vmd.getNodeName(i));
+      std::vector<loader::motioncache::NodeKey> frames(framesSrc.size());
+      for (size_t j = 0; j < framesSrc.size(); ++j)
+      {
+        auto& dst = frames[j];
+        const auto& src = framesSrc[j];
+        dst.frame = src.getKeyframeNumber();
+        memcpy(dst.translation, &src.getLocation(), sizeof(dst.translation));
+        memcpy(dst.rotation, &src.getRotation(), sizeof(dst.rotation));
+        for (int c = 0; c < 4; ++c)
+        {
+          dst.curves[c] = curves.Register(src.getBezierParam(c));
+        }
+      }
+      keyCount += uint32_t(frames.size());
+    }
+    for (uint32_t i = 0; i < vmd.getMorphCount(); ++i)
+    {
+      keyCount += uint32_t(vmd.getMorphKeyframes(vmd.getMorphName(i)).size());
+    }
+    return keyCount;
+  }
+
+  // Animator::PrepareCache Ɠ. ʎqĂȂ΃L[͕Ȃ.
+  uint32_t LoadFromCache(const char* fileName, BezierCurveTable& curves)
+  {
+    loader::MotionCache cache(fileName);
+    if (!cache.isValid())
+    {
+      return 0;
+    }
+    curves.Clear();
+    for (uint32_t i = 0; i < cache.getCurveCount(); ++i)
+    {
+      const auto& c = cache.getCurve(i);
+      curves.Register(c.x1, c.y1, c.x2, c.y2);
+    }
+    std::vector<loader::motioncache::NodeKey> frames;
+    for (uint32_t i = 0; i < cache.getNodeTrackCount(); ++i)
+    {
+      const auto& track = cache.getNodeTrack(i);
+      if (cache.isQuantized())
+      {
+        frames.resize(track.keyCount);
+        cache.decodeNodeKeys(track, frames.data());
+      }
+    }
+    const auto& header = cache.getHeader();
+    return header.nodeKeyCount + header.morphKeyCount;
+  }
+
+  long GetFileSize(const char* fileName)
+  {
+    std::ifstream infile(fileName, std::ios::binary | std::ios::ate);
+    return infile ? long(infile.tellg()) : 0;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* vmdFile = nullptr;
+  const char* modelFile = nullptr;
+  std::string cacheFile;
+  loader::motioncache::CookOptions options;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--quantize") == 0)
+    {
+      options.quantize = true;
+    }
+    else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc)
+    {
+      modelFile = argv[++i];
+    }
+    else if (vmdFile == nullptr)
+    {
+      vmdFile = argv[i];
+    }
+    else
+    {
+      cacheFile = argv[i];
+    }
+  }
+  if (vmdFile == nullptr)
+  {
+    printf("usage: 12_Animation_MotionCooker VMDt@C [o̓t@C] [--quantize] [--model PMDt@C]\n");
+    return 1;
+  }
+  if (cacheFile.empty())
+  {
+    // RenderPMDApp::Prepare  Animator::SetCacheDirectory Ɠꏊ.
+    loader::motioncache::createDirectory("motion_cache");
+    cacheFile = loader::motioncache::getCachePath("motion_cache", vmdFile);
+  }
+
+  std::ifstream infile(vmdFile, std::ios::binary);
+  if (!infile || !loader::motioncache::getFileStamp(vmdFile, options.sourceSize, options.sourceTime))
+  {
+    printf("Failed to open %s\n", vmdFile);
+    return 1;
+  }
+  loader::VMDFile vmd(infile);
+
+  std::vector<std::string> boneNames, morphNames;
+  if (modelFile != nullptr)
+  {
+    std::ifstream modelStream(modelFile, std::ios::binary);
+    if (!modelStream)
+    {
+      printf("Failed to open %s\n", modelFile);
+      return 1;
+    }
+    loader::PMDFile model(modelStream);
+    for (uint32_t i = 0; i < model.getBoneCount(); ++i)
+    {
+      boneNames.push_back(model.getBone(i).getName());
+    }
+    // Model Ɠ擪 base ԍ.
+    for (uint32_t i = 1; i < model.getFaceCount(); ++i)
+    {
+      morphNames.push_back(model.getFace(i).getName());
+    }
+    options.boneNames = &boneNames;
+    options.morphNames = &morphNames;
+  }
+
+  if (!loader::motioncache::cook(vmd, cacheFile.c_str(), options))
+  {
+    printf("Failed to write %s\n", cacheFile.c_str());
+    return 1;
+  }
+  loader::MotionCache cache(cacheFile.c_str());
+  if (!cache.isValid())
+  {
+    printf("Failed to validate %s\n", cacheFile.c_str());
+    return 1;
+  }
+  const auto& header = cache.getHeader();
+  printf("%s -> %s\n", vmdFile, cacheFile.c_str());
+  printf("  %u node tracks, %u morph tracks, %u node keys, %u morph keys, %u curves, %u frames\n",
+    header.nodeTrackCount, header.morphTrackCount, header.nodeKeyCount, header.morphKeyCount, header.curveCount, header.frameCount);
+  printf("  size %ld -> %ld bytes%s%s\n", GetFileSize(vmdFile), GetFileSize(cacheFile.c_str()),
+    cache.isQuantized() ? ", quantized" : "", cache.isResolved() ? ", resolved" : "");
+
+  // ʎq̌덷.
+  if (cache.isQuantized())
+  {
+    float maxTranslation = 0.0f, maxRotation = 0.0f;
+    std::vector<loader::motioncache::NodeKey> decoded;
+    for (uint32_t i = 0; i < cache.getNodeTrackCount(); ++i)
+    {
+      const auto& track = cache.getNodeTrack(i);
+      decoded.resize(track.keyCount);
+      cache.decodeNodeKeys(track, decoded.data());
+      auto frames = vmd.getKeyframes(cache.getName(track));
+      for (uint32_t j = 0; j < track.keyCount; ++j)
+      {
+        auto t = frames[j].getLocation();
+        auto r = frames[j].getRotation();
+        // q  -q ͓]Ȃ̂œςpx̍߂.
+        auto dot = std::fabs(r.x * decoded[j].rotation[0] + r.y * decoded[j].rotation[1] + r.z * decoded[j].rotation[2] + r.w * decoded[j].rotation[3]);
+        maxRotation = std::max(maxRotation, 2.0f * std::acos(std::min(dot, 1.0f)));
+        for (int c = 0; c < 3; ++c)
+        {
+          maxTranslation = std::max(maxTranslation, std::fabs(t[c] - decoded[j].translation[c]));
+        }
+      }
+    }
+    printf("  quantization error: translation %.2e, rotation %.2e rad\n", maxTranslation, maxRotation);
+  }
+
+  BezierCurveTable curves;
+  uint32_t keyCount = 0;
+  book_util::StopWatch stopWatch;
+  for (uint32_t i = 0; i < Iterations; ++i)
+  {
+    keyCount += LoadFromVMD(vmdFile, curves);
+  }
+  double vmdMs = stopWatch.GetElapsedMs() / Iterations;
+
+  stopWatch.Reset();
+  for (uint32_t i = 0; i < Iterations; ++i)
+  {
+    keyCount += LoadFromCache(cacheFile.c_str(), curves);
+  }
+  double cacheMs = stopWatch.GetElapsedMs() / Iterations;
+  printf("  load: VMD %.3f ms, cache %.3f ms (%.1fx, %u keys)\n", vmdMs, cacheMs, vmdMs / cacheMs, keyCount / (2 * Iterations));
+  return 0;
+}
@@ -0,0 +1,235 @@
+// L[t[̋Ԍ̃x`}[N.
+//  12_Animation_SamplingBenchmark [VMDt@C] [JԂ]
+// ] upper_bound ŒTăL[𕡐@ƁAgbNƂ̃J[\TăL[̔ԍԂ
+// Animation::FindSegment A̍Đƃ_ȃV[NŔr.
+// VMD ȗ邩 - w肷ƁAt[ɃL[[V (200 gbNA36000 t[) g.
+#include "Keyframe.h"
+#include "BenchmarkMotion.h"
+#include "BezierCurveTable.h"
+#include "VulkanBookUtil.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace glm;
+
+namespace
+{
+  using Track = NodeTrack;
+
+  // [VLv`̂悤ɖt[ɃL[gbN. ꕔ̃gbN̓L[Ԉ.
+  void MakeTracks(std::vector<Track>& tracks)
+  {
+    const uint32_t TrackCount = 200, FrameCount = 36000;
+    std::mt19937 rng(16);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (uint32_t i = 0; i < TrackCount; ++i)
+    {
+      uint32_t step = i % 4 == 3 ? 30 : 1;
+      auto axis = glm::normalize(vec3(dist(rng), dist(rng), dist(rng)));
+      Track track;
+      for (uint32_t f = 0; f < FrameCount; f += step)
+      {
+        NodeAnimeFrame key;
+        key.frame = f;
+        key.rotation = glm::angleAxis(dist(rng), axis);
+        key.translation = vec3(dist(rng), dist(rng), dist(rng));
+        key.curveX = key.curveY = key.curveZ = key.curveR = BezierCurveTable::LinearCurve;
+        track.push_back(key);
+      }
+      tracks.push_back(track);
+    }
+  }
+
+  // ] Animation::FindSegment Ɠ.
+  std::tuple<NodeAnimeFrame, NodeAnimeFrame> FindSegmentCopy(const Track& track, uint32_t frame)
+  {
+    const NodeAnimeFrame refValue{ frame };
+    auto begin = track.begin(), end = track.end();
+    auto last = std::upper_bound(begin, end, refValue, [](const NodeAnimeFrame& a, const NodeAnimeFrame& b) { return a.frame < b.frame; });
+    auto first = last == begin ? last : last - 1;
+    if (last == end)
+    {
+      last = first;
+    }
+    return std::make_tuple(*first, *last);
+  }
+
+  // Animator::SampleNode Ɠ.
+  void Sample(const NodeAnimeFrame& start, const NodeAnimeFrame& last, uint32_t frame, const BezierCurveTable& curves, vec3& translation, quat& rotation)
+  {
+    auto range = float(last.frame - start.frame);
+    if (range == 0)
+    {
+      translation = start.translation;
+      rotation = start.rotation;
+      return;
+    }
+    auto rate = float(frame - start.frame) / range;
+    vec3 k(curves.Evaluate(start.curveX, rate), curves.Evaluate(start.curveY, rate), curves.Evaluate(start.curveZ, rate));
+    translation = start.translation + (last.translation - start.translation) * k;
+    rotation = glm::slerp(start.rotation, last.rotation, curves.Evaluate(start.curveR, rate));
+  }
+
+  struct Result
+  {
+    double searchNs;
+    double sampleNs;
+    float checksum;
+  };
+
+  // frames ̏ɑSgbN]. cursors Ȃ]̕@.
+  Result Run(const std::vector<Track>& tracks, const std::vector<uint32_t>& frames, const BezierCurveTable& curves, std::vector<uint32_t>* cursors)
+  {
+    Result result{};
+    auto sampleCount = double(tracks.size()) * frames.size();
+    book_util::StopWatch stopWatch;
+
+    // Ԃ̌̂.
+    uint32_t sum = 0;
+    stopWatch.Reset();
+    for (auto frame : frames)
+    {
+      for (size_t i = 0; i < tracks.size(); ++i)
+      {
+        const auto& track = tracks[i];
+        if (cursors)
+        {
+          auto segment = FindKeySegment(uint32_t(track.size()), frame, (*cursors)[i], [&track](uint32_t n) { return track[n].frame; });
+          sum += track[segment.start].frame + track[segment.last].frame;
+        }
+        else
+        {
+          auto segment = FindSegmentCopy(track, frame);
+          sum += std::get<0>(segment).frame + std::get<1>(segment).frame;
+        }
+      }
+    }
+    result.searchNs = stopWatch.GetElapsedMs() * 1.0e6 / sampleCount;
+
+    // ƕ.
+    vec3 sumT(0.0f);
+    stopWatch.Reset();
+    for (auto frame : frames)
+    {
+      for (size_t i = 0; i < tracks.size(); ++i)
+      {
+        const auto& track = tracks[i];
+        vec3 t;
+        quat r;
+        if (cursors)
+        {
+          auto segment = FindKeySegment(uint32_t(track.size()), frame, (*cursors)[i], [&track](uint32_t n) { return track[n].frame; });
+          Sample(track[segment.start], track[segment.last], frame, curves, t, r);
+        }
+        else
+        {
+          auto segment = FindSegmentCopy(track, frame);
+          Sample(std::get<0>(segment), std::get<1>(segment), frame, curves, t, r);
+        }
+        sumT += t + vec3(r.w);
+      }
+    }
+    result.sampleNs = stopWatch.GetElapsedMs() * 1.0e6 / sampleCount;
+    result.checksum = sumT.x + sumT.y + sumT.z + float(sum % 1000);
+    return result;
+  }
+
+  // ̕@ frames ̏ɑSgbN̋Ԃv邩.
+  bool Verify(const std::vector<Track>& tracks, const std::vector<uint32_t>& frames)
+  {
+    std::vector<uint32_t> cursors(tracks.size(), 0);
+    for (auto frame : frames)
+    {
+      for (size_t i = 0; i < tracks.size(); ++i)
+      {
+        const auto& track = tracks[i];
+        auto expected = FindSegmentCopy(track, frame);
+        auto segment = FindKeySegment(uint32_t(track.size()), frame, cursors[i], [&track](uint32_t n) { return track[n].frame; });
+        if (track[segment.start].frame != std::get<0>(expected).frame || track[segment.last].frame != std::get<1>(expected).frame)
+        {
+          printf("Mismatch: track %zu, frame %u\n", i, frame);
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  BezierCurveTable curves;
+  std::vector<Track> tracks;
+  if (argc > 1 && strcmp(argv[1], "-") != 0)
+  {
+    if (!LoadNodeTracks(argv[1], curves, tracks))
+    {
+      printf("Failed to open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  else
+  {
+    MakeTracks(tracks);
+  }
+  int iterations = argc > 2 ? std::max(atoi(argv[2]), 1) : 1;
+
+  uint32_t lastFrame = 0;
+  size_t keyCount = 0;
+  for (const auto& track : tracks)
+  {
+    lastFrame = std::max(lastFrame, track.back().frame);
+    keyCount += track.size();
+  }
+
+  // ̍Đ (30fps  1 t[) ƁA񐔂̃_ȃV[N.
+  std::vector<uint32_t> playback, seek;
+  for (int n = 0; n < iterations; ++n)
+  {
+    for (uint32_t frame = 0; frame <= lastFrame; ++frame)
+    {
+      playback.push_back(frame);
+    }
+  }
+  std::mt19937 rng(32);
+  std::uniform_int_distribution<uint32_t> dist(0, lastFrame + 10);
+  seek.resize(playback.size());
+  for (auto& frame : seek)
+  {
+    frame = dist(rng);
+  }
+
+  printf("%zu tracks, %zu keys, %u frames\n", tracks.size(), keyCount, lastFrame + 1);
+  if (!Verify(tracks, playback) || !Verify(tracks, seek))
+  {
+    return 1;
+  }
+
+  const struct
+  {
+    const char* name;
+    const std::vector<uint32_t>* frames;
+  } cases[] = {
+    { "playback", &playback },
+    { "seek", &seek },
+  };
+  printf("%-10s %22s %22s\n", "", "search (copy -> cursor)", "sample (copy -> cursor)");
+  for (const auto& c : cases)
+  {
+    std::vector<uint32_t> cursors(tracks.size(), 0);
+    auto copy = Run(tracks, *c.frames, curves, nullptr);
+    auto cursor = Run(tracks, *c.frames, curves, &cursors);
+    printf("%-10s %8.1f -> %8.1f ns  %8.1f -> %8.1f ns  (checksum %.3f / %.3f)\n",
+      c.name, copy.searchNs, cursor.searchNs, copy.sampleNs, cursor.sampleNs, copy.checksum, cursor.checksum);
+  }
+  return 0;
+}
@@ -0,0 +1,263 @@
+// LN^[̎pvZ̃x`}[N.
+//  12_Animation_SkeletonBenchmark [PMDt@C] [LN^[]
+// {[ƂɃ|C^Őeqԏ]̕@ (Model  Bone ƓvZ) ƁA
+// AnimationRuntime őSLN^[ꊇŌvZ@r.
+// PMD t@Cȗꍇ͗ōig.
+#include "AnimationRuntime.h"
+#include "BenchmarkSkeleton.h"
+#include "VulkanBookUtil.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace glm;
+
+namespace
+{
+  // ] Bone ƓAq|C^łǂčsvZ.
+  struct PointerBone
+  {
+    vec3 translation;
+    quat rotation;
+    mat4 local;
+    mat4 world;
+    PointerBone* parent = nullptr;
+    std::vector<PointerBone*> children;
+
+    void UpdateWorldMatrix()
+    {
+      local = glm::translate(translation) * glm::toMat4(rotation);
+      world = parent ? parent->world * local : local;
+    }
+    void UpdateMatrices()
+    {
+      UpdateWorldMatrix();
+      for (auto c : children)
+      {
+        c->UpdateMatrices();
+      }
+    }
+  };
+
+  // ] Animator::SolveIK ƓvZ. 񐔂Ԃ.
+  uint32_t SolveIKPointer(std::vector<PointerBone*>& bones, const Skeleton::IkChain& chain, const Skeleton& skeleton)
+  {
+    auto target = bones[skeleton.GetBoneIndex(chain.target)];
+    auto eff = bones[skeleton.GetBoneIndex(chain.effector)];
+    for (uint32_t ite = 0; ite < chain.iterationCount; ++ite)
+    {
+      for (uint32_t i = 0; i < uint32_t(chain.links.size()); ++i)
+      {
+        auto bone = bones[skeleton.GetBoneIndex(chain.links[i].bone)];
+        auto mtxInvBone = glm::inverse(bone->world);
+        auto effectorPos = vec3(mtxInvBone * eff->world[3]);
+        auto targetPos = vec3(mtxInvBone * target->world[3]);
+        auto len = glm::length(targetPos - effectorPos);
+        if (len * len < 0.0001f)
+        {
+          return ite + 1;
+        }
+        auto vecToEff = glm::normalize(effectorPos);
+        auto vecToTarget = glm::normalize(targetPos);
+        float radian = acosf(glm::clamp(glm::dot(vecToEff, vecToTarget), -1.0f, 1.0f));
+        if (radian < 0.0001f)
+        {
+          continue;
+        }
+        radian = glm::clamp(radian, -chain.angleLimit, chain.angleLimit);
+        auto axis = glm::normalize(glm::cross(vecToTarget, vecToEff));
+        if (radian < 0.001f)
+        {
+          continue;
+        }
+        auto rotation = glm::angleAxis(radian, axis);
+        if (chain.links[i].kneeConstraint)
+        {
+          auto eulerAngle = glm::eulerAngles(rotation);
+          eulerAngle.y = 0.0f; eulerAngle.z = 0.0f;
+          eulerAngle.x = glm::clamp(eulerAngle.x, 0.002f, glm::pi<float>());
+          rotation = glm::quat(eulerAngle);
+        }
+        bone->rotation = glm::normalize(bone->rotation * rotation);
+        for (int j = int(i); j >= 0; --j)
+        {
+          bones[skeleton.GetBoneIndex(chain.links[j].bone)]->UpdateWorldMatrix();
+        }
+        eff->UpdateWorldMatrix();
+        target->UpdateWorldMatrix();
+      }
+    }
+    return chain.iterationCount;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::shared_ptr<Skeleton> skeleton;
+  if (argc > 1)
+  {
+    skeleton = LoadSkeleton(argv[1]);
+    if (!skeleton)
+    {
+      printf("Failed to open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  else
+  {
+    skeleton = MakeRandomSkeleton(128);
+  }
+  uint32_t characterCount = argc > 2 ? uint32_t(std::max(1, atoi(argv[2]))) : 64;
+  const uint32_t frames = 120;
+  auto boneCount = skeleton->GetBoneCount();
+  if (boneCount == 0)
+  {
+    printf("No bones\n");
+    return 1;
+  }
+
+  // et[ŗ^郍[J̉] (SLN^[ʂ̗񂩂o).
+  auto rotations = MakeRandomRotations();
+  auto rotationOf = [&](uint32_t character, uint32_t frame, uint32_t bone) {
+    return rotations[(character * 131 + frame * 17 + bone) % rotations.size()];
+  };
+
+  // ]̕@. Model Ɠ{[ʂɊmۂ.
+  std::vector<std::vector<PointerBone*>> pointerCharacters(characterCount);
+  for (auto& bones : pointerCharacters)
+  {
+    bones.resize(boneCount);
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+      bones[i] = new PointerBone();
+      bones[i]->translation = skeleton->GetTranslations()[skeleton->GetSortedIndex(i)];
+    }
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+      auto parent = skeleton->GetParents()[skeleton->GetSortedIndex(i)];
+      if (parent != Skeleton::NoParent)
+      {
+        bones[i]->parent = bones[skeleton->GetBoneIndex(parent)];
+        bones[i]->parent->children.push_back(bones[i]);
+      }
+    }
+  }
+
+  AnimationRuntime runtime;
+  for (uint32_t c = 0; c < characterCount; ++c)
+  {
+    runtime.AddInstance(skeleton);
+  }
+
+  // ŜƁÂ IK ɂԂv.
+  book_util::StopWatch stopWatch, ikStopWatch;
+  double pointerIkMs = 0.0, runtimeIkMs = 0.0;
+  uint64_t pointerIterations = 0;
+  for (uint32_t frame = 0; frame < frames; ++frame)
+  {
+    for (uint32_t c = 0; c < characterCount; ++c)
+    {
+      auto& bones = pointerCharacters[c];
+      for (uint32_t i = 0; i < boneCount; ++i)
+      {
+        bones[i]->rotation = rotationOf(c, frame, i);
+      }
+      for (auto bone : bones)
+      {
+        if (bone->parent == nullptr)
+        {
+          bone->UpdateMatrices();
+        }
+      }
+      ikStopWatch.Reset();
+      for (const auto& chain : skeleton->GetIkChains())
+      {
+        pointerIterations += SolveIKPointer(bones, chain, *skeleton);
+      }
+      pointerIkMs += ikStopWatch.GetElapsedMs();
+      for (auto bone : bones)
+      {
+        if (bone->parent == nullptr)
+        {
+          bone->UpdateMatrices();
+        }
+      }
+    }
+  }
+  double pointerMs = stopWatch.GetElapsedMs();
+
+  stopWatch.Reset();
+  for (uint32_t frame = 0; frame < frames; ++frame)
+  {
+    for (uint32_t c = 0; c < characterCount; ++c)
+    {
+      for (uint32_t i = 0; i < boneCount; ++i)
+      {
+        runtime.SetLocalRotation(c, i, rotationOf(c, frame, i));
+      }
+    }
+    runtime.UpdateWorldMatrices();
+    ikStopWatch.Reset();
+    for (uint32_t c = 0; c < characterCount; ++c)
+    {
+      runtime.SolveIK(c);
+    }
+    runtimeIkMs += ikStopWatch.GetElapsedMs();
+  }
+  double runtimeMs = stopWatch.GetElapsedMs();
+
+  // ŏIt[̌ʂr.
+  float maxDiff = 0.0f;
+  for (uint32_t c = 0; c < characterCount; ++c)
+  {
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+      const auto& a = pointerCharacters[c][i]->world;
+      const auto& b = runtime.GetWorldMatrix(c, i);
+      for (int col = 0; col < 4; ++col)
+      {
+        for (int row = 0; row < 4; ++row)
+        {
+          maxDiff = std::max(maxDiff, std::fabs(a[col][row] - b[col][row]));
+        }
+      }
+    }
+  }
+
+  double boneFrames = double(characterCount) * boneCount * frames;
+  printf("Skeleton: %u bones, %u IK chains, %u characters, %u frames\n",
+    boneCount, uint32_t(skeleton->GetIkChains().size()), characterCount, frames);
+  printf("  %-8s %8.2f ms/frame  %6.1f ns/bone  (IK %.2f ms/frame)\n",
+    "pointer", pointerMs / frames, pointerMs * 1.0e6 / boneFrames, pointerIkMs / frames);
+  printf("  %-8s %8.2f ms/frame  %6.1f ns/bone  (IK %.2f ms/frame)\n",
+    "runtime", runtimeMs / frames, runtimeMs * 1.0e6 / boneFrames, runtimeIkMs / frames);
+  printf("  max matrix difference %.2e\n", maxDiff);
+
+  auto ik = runtime.GetIkStatistics();
+  if (ik.solveCount > 0)
+  {
+    printf("IK: %llu solves\n", (unsigned long long)ik.solveCount);
+    printf("  %-8s %5.2f iterations/solve\n", "pointer", double(pointerIterations) / ik.solveCount);
+    printf("  %-8s %5.2f iterations/solve  %5.2f rotations/solve  %5.1f%% converged  %6.2f us/solve\n",
+      "runtime", double(ik.iterationCount) / ik.solveCount, double(ik.rotationCount) / ik.solveCount,
+      100.0 * ik.convergedCount / ik.solveCount, ik.solveMs * 1.0e3 / ik.solveCount);
+  }
+
+  for (auto& bones : pointerCharacters)
+  {
+    for (auto bone : bones)
+    {
+      delete bone;
+    }
+  }
+  return 0;
+}
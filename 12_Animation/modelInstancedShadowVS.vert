@@ -0,0 +1,65 @@
+#version 450
+
+layout(location=0) in vec4 inPosition;
+layout(location=1) in vec3 inNormal;
+layout(location=2) in vec2 inUV;
+layout(location=3) in uvec2 inBlendIndices;
+layout(location=4) in vec2 inBlendWeights;
+layout(location=5) in uint inEdgeFlag;
+
+layout(location=0) out vec4 outColor;
+
+out gl_PerVertex
+{
+  vec4 gl_Position;
+};
+
+
+layout(set=0, binding=0)
+uniform SceneParameter
+{
+  mat4  view;
+  mat4  proj;
+  vec4  lightDirection;
+  vec4  eyePosition;
+  vec4  outlineColor;
+  mat4  lightViewProj;
+  mat4  lightViewProjBias;
+};
+
+struct Instance
+{
+  mat4  world;
+  uvec4 palette;  // x: offset of the bone palette in boneMatrices.
+};
+
+layout(set=0, binding=5)
+readonly buffer InstanceParameter
+{
+  Instance instances[];
+};
+
+layout(set=0, binding=6)
+readonly buffer BonePalette
+{
+  mat4 boneMatrices[];
+};
+
+vec4 TransformPosition( vec4 position, uint paletteOffset )
+{
+  vec4 pos = vec4(0);
+  for( int i=0;i<2;++i)
+  {
+    mat4 mtx = boneMatrices[ paletteOffset + inBlendIndices[i] ];
+    pos += (mtx * position) * inBlendWeights[i];
+  }
+  return pos;
+}
+
+void main()
+{
+  Instance inst = instances[gl_InstanceIndex];
+  vec4 worldPos = inst.world * TransformPosition(inPosition, inst.palette.x);
+  gl_Position = lightViewProj * worldPos;
+  outColor = gl_Position;
+}
@@ -35,8 +35,8 @@ private:
   void PrepareTeapot();
   void PreparePlane();
   
-  void CreatePipelineTeapot();
-  void CreatePipelinePlane();
+  // target w肷Ƃ̃pCvĈ݂.
+  void CreatePipelines(const VkPipeline* target = nullptr);
 
   void PrepareRenderTexture();
   void PrepareMsaaTexture();
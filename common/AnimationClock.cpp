@@ -0,0 +1,47 @@
+#include "AnimationClock.h"
+#include <algorithm>
+#include <cmath>
+
+const double AnimationClock::MotionFrameRate = 30.0;
+const double AnimationClock::MaxAdvanceSeconds = 0.25;
+
+AnimationClock::AnimationClock(double stepRate)
+  : m_stepRate(stepRate), m_speed(1.0), m_steps(0), m_fraction(0.0)
+{
+}
+
+void AnimationClock::SetStepRate(double stepsPerSecond)
+{
+  auto time = GetTime();
+  m_stepRate = stepsPerSecond;
+  m_steps = uint64_t(std::floor(time * m_stepRate));
+  m_fraction = time * m_stepRate - double(m_steps);
+}
+
+uint32_t AnimationClock::Advance(double seconds)
+{
+  seconds = (std::min)((std::max)(seconds, 0.0), MaxAdvanceSeconds);
+  m_fraction += seconds * m_speed * m_stepRate;
+  auto steps = std::floor(m_fraction);
+  m_fraction -= steps;
+  m_steps += uint64_t(steps);
+  return uint32_t(steps);
+}
+
+void AnimationClock::Step(uint32_t count)
+{
+  m_steps += count;
+  m_fraction = 0.0;
+}
+
+void AnimationClock::SetFrame(double frame)
+{
+  auto steps = (std::max)(frame, 0.0) / MotionFrameRate * m_stepRate;
+  m_steps = uint64_t(std::floor(steps));
+  m_fraction = steps - double(m_steps);
+}
+
+double AnimationClock::GetTime() const
+{
+  return (double(m_steps) + m_fraction) / m_stepRate;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+// `̃t[[gƐ؂藣ăAj[V̎i߂鎞v.
+// ͌Œ蒷̃Xebv̐ () Ŏ̂ŁAĐĂ덷ς炸A
+// Ăяo̕т͏ɓɂȂ.
+//  - ԂōĐꍇ͕`悲ƂɌoߎԂ Advance ɓn.
+//  - ItC`ł SetStepRate ɏo͂̃t[[gw肵A`悲Ƃ Step Ă.
+class AnimationClock
+{
+public:
+  // VMD ̃L[t[ 30fps.
+  static const double MotionFrameRate;
+  // x Advance Ői߂鎞 (b) ̏. EBhȆȂǂŎ~܂ĂԂ܂Ƃ߂Đi߂Ȃ.
+  static const double MaxAdvanceSeconds;
+
+  explicit AnimationClock(double stepRate = 120.0);
+
+  // 1 b̃Xebv. ݂͕̎ۂ.
+  void SetStepRate(double stepsPerSecond);
+  double GetStepRate() const { return m_stepRate; }
+  // Đx (1.0 œ). Advance ɂ̂݉e. tĐ͂łȂ߁A̒l 0 (~) Ƃ.
+  void SetSpeed(double speed) { m_speed = speed > 0.0 ? speed : 0.0; }
+  double GetSpeed() const { return m_speed; }
+
+  // o߂ (b) i߁Ai߂XebvԂ.
+  // XebvɖȂ[͎֎zAGetTime ɂ܂߂.
+  uint32_t Advance(double seconds);
+  // count Xebvi߂. [͎̂Ă.
+  void Step(uint32_t count = 1);
+
+  // [Ṽt[ԍōĐʒuw肷.
+  void SetFrame(double frame);
+  void Reset() { SetFrame(0.0); }
+
+  uint64_t GetStepCount() const { return m_steps; }
+  // bPʂ̎.
+  double GetTime() const;
+  // [Ṽt[ԍ (܂). Animator::UpdateAnimation ֓nl.
+  float GetFrame() const { return float(GetTime() * MotionFrameRate); }
+
+private:
+  double m_stepRate;
+  double m_speed;
+  uint64_t m_steps;
+  double m_fraction; // XebvɖȂ[ (XebvP).
+};
@@ -0,0 +1,289 @@
+#include "AnimationRuntime.h"
+#include "VulkanBookUtil.h"
+
+#include <glm/gtc/constants.hpp>
+
+namespace
+{
+  // {[̍s͉]ƕsړ݂̂Ȃ̂ŁAts͉]̓]uƕsړ̑łŋ܂.
+  glm::vec3 InverseTransformPoint(const glm::mat4& m, const glm::vec3& p)
+  {
+    auto d = p - glm::vec3(m[3]);
+    return glm::vec3(glm::dot(glm::vec3(m[0]), d), glm::dot(glm::vec3(m[1]), d), glm::dot(glm::vec3(m[2]), d));
+  }
+}
+
+AnimationRuntime::InstanceId AnimationRuntime::AddInstance(std::shared_ptr<const Skeleton> skeleton)
+{
+  auto first = GetTotalBoneCount();
+  auto boneCount = skeleton->GetBoneCount();
+  auto total = first + boneCount;
+
+  m_parents.resize(total);
+  const auto& parents = skeleton->GetParents();
+  for (uint32_t i = 0; i < boneCount; ++i)
+  {
+    m_parents[first + i] = parents[i] == Skeleton::NoParent ? Skeleton::NoParent : int32_t(first) + parents[i];
+  }
+  for (auto v : { &m_translationX, &m_translationY, &m_translationZ, &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW })
+  {
+    v->resize(total);
+  }
+  m_worldMatrices.resize(total, glm::mat4(1.0f));
+
+  auto instance = InstanceId(m_instances.size());
+  m_instances.push_back(Instance{ std::move(skeleton), first });
+  ResetPose(instance);
+  UpdateWorldMatrices(instance);
+  return instance;
+}
+
+void AnimationRuntime::Clear()
+{
+  m_instances.clear();
+  for (auto v : { &m_translationX, &m_translationY, &m_translationZ, &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW })
+  {
+    v->clear();
+  }
+  m_parents.clear();
+  m_worldMatrices.clear();
+}
+
+void AnimationRuntime::ResetPose(InstanceId instance)
+{
+  const auto& inst = m_instances[instance];
+  const auto& translations = inst.skeleton->GetTranslations();
+  for (uint32_t i = 0; i < uint32_t(translations.size()); ++i)
+  {
+    auto index = inst.first + i;
+    m_translationX[index] = translations[i].x;
+    m_translationY[index] = translations[i].y;
+    m_translationZ[index] = translations[i].z;
+    m_rotationX[index] = 0.0f;
+    m_rotationY[index] = 0.0f;
+    m_rotationZ[index] = 0.0f;
+    m_rotationW[index] = 1.0f;
+  }
+}
+
+void AnimationRuntime::UpdateWorldMatrices()
+{
+  UpdateWorldMatrices(0, GetTotalBoneCount());
+}
+
+void AnimationRuntime::UpdateWorldMatrices(InstanceId instance)
+{
+  const auto& inst = m_instances[instance];
+  UpdateWorldMatrices(inst.first, inst.first + inst.skeleton->GetBoneCount());
+}
+
+void AnimationRuntime::UpdateWorldMatrices(uint32_t first, uint32_t last)
+{
+  for (uint32_t i = first; i < last; ++i)
+  {
+    UpdateWorldMatrix(i);
+  }
+}
+
+glm::mat4 AnimationRuntime::ComposeLocalMatrix(uint32_t index) const
+{
+  // translate(t) * toMat4(q) 𒼐ڑgݗĂ.
+  float x = m_rotationX[index], y = m_rotationY[index], z = m_rotationZ[index], w = m_rotationW[index];
+  float xx = x * x, yy = y * y, zz = z * z;
+  float xy = x * y, xz = x * z, yz = y * z;
+  float wx = w * x, wy = w * y, wz = w * z;
+  return glm::mat4(
+    1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f,
+    2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f,
+    2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+    m_translationX[index], m_translationY[index], m_translationZ[index], 1.0f);
+}
+
+void AnimationRuntime::UpdateWorldMatrix(uint32_t index)
+{
+  SetWorldMatrix(index, ComposeLocalMatrix(index));
+}
+
+void AnimationRuntime::SetWorldMatrix(uint32_t index, const glm::mat4& local)
+{
+  auto parent = m_parents[index];
+  m_worldMatrices[index] = parent == Skeleton::NoParent ? local : m_worldMatrices[parent] * local;
+}
+
+void AnimationRuntime::GetSkinMatrices(InstanceId instance, glm::mat4* dst, uint32_t count) const
+{
+  const auto& inst = m_instances[instance];
+  const auto& skeleton = *inst.skeleton;
+  const auto& invBindMatrices = skeleton.GetInvBindMatrices();
+  for (uint32_t i = 0; i < skeleton.GetBoneCount(); ++i)
+  {
+    auto bone = skeleton.GetBoneIndex(i);
+    if (bone < count)
+    {
+      dst[bone] = m_worldMatrices[inst.first + i] * invBindMatrices[i];
+    }
+  }
+}
+
+void AnimationRuntime::SolveIK(InstanceId instance)
+{
+  const auto& inst = m_instances[instance];
+  for (const auto& chain : inst.skeleton->GetIkChains())
+  {
+    SolveIkChain(inst.first, chain);
+  }
+  // `FCɊ܂܂Ȃq̃{[ɂʂ𔽉f.
+  UpdateWorldMatrices(instance);
+}
+
+void AnimationRuntime::SolveIK(InstanceId instance, uint32_t chainIndex)
+{
+  const auto& inst = m_instances[instance];
+  SolveIkChain(inst.first, inst.skeleton->GetIkChains()[chainIndex]);
+}
+
+JobGraph::JobId AnimationRuntime::AddUpdateJobs(JobGraph& graph, InstanceId instance, JobGraph::JobId dependency)
+{
+  auto propagate = graph.Add([this, instance]() { UpdateWorldMatrices(instance); }, { dependency });
+
+  const auto& ikDependencies = m_instances[instance].skeleton->GetIkDependencies();
+  auto chainCount = uint32_t(ikDependencies.size());
+  std::vector<JobGraph::JobId> chainJobs(chainCount);
+  std::vector<JobGraph::JobId> solved{ propagate };
+  for (uint32_t i = 0; i < chainCount; ++i)
+  {
+    std::vector<JobGraph::JobId> dependencies{ propagate };
+    for (auto j : ikDependencies[i])
+    {
+      dependencies.push_back(chainJobs[j]);
+    }
+    chainJobs[i] = graph.Add([this, instance, i]() { SolveIK(instance, i); }, dependencies);
+    solved.push_back(chainJobs[i]);
+  }
+  return graph.Add([this, instance]() { UpdateWorldMatrices(instance); }, solved);
+}
+
+AnimationRuntime::IkStatistics AnimationRuntime::GetIkStatistics() const
+{
+  IkStatistics stats;
+  stats.solveCount = m_ikSolveCount.load();
+  stats.iterationCount = m_ikIterationCount.load();
+  stats.rotationCount = m_ikRotationCount.load();
+  stats.convergedCount = m_ikConvergedCount.load();
+  stats.solveMs = m_ikSolveNs.load() * 1.0e-6;
+  return stats;
+}
+
+void AnimationRuntime::ResetIkStatistics()
+{
+  m_ikSolveCount = 0;
+  m_ikIterationCount = 0;
+  m_ikRotationCount = 0;
+  m_ikConvergedCount = 0;
+  m_ikSolveNs = 0;
+}
+
+void AnimationRuntime::SolveIkChain(uint32_t first, const Skeleton::IkChain& chain)
+{
+  book_util::StopWatch stopWatch;
+  auto target = first + chain.target;
+  auto effector = first + chain.effector;
+  auto linkCount = uint32_t(chain.links.size());
+
+  // NƃGtFN^̃[Js. ]NȊO͑gݗĒɎg.
+  thread_local std::vector<glm::mat4> localMatrices;
+  localMatrices.resize(linkCount + 1);
+  auto targetFollowsChain = m_parents[target] == int32_t(effector);
+  for (uint32_t i = 0; i < linkCount; ++i)
+  {
+    auto bone = first + chain.links[i].bone;
+    localMatrices[i] = ComposeLocalMatrix(bone);
+    targetFollowsChain |= m_parents[target] == int32_t(bone);
+  }
+  localMatrices[linkCount] = ComposeLocalMatrix(effector);
+
+  uint32_t iterations = 0, rotations = 0;
+  bool converged = false;
+  for (uint32_t ite = 0; ite < chain.iterationCount && !converged; ++ite)
+  {
+    ++iterations;
+    bool rotated = false;
+    for (uint32_t i = 0; i < linkCount; ++i)
+    {
+      const auto& link = chain.links[i];
+      auto bone = first + link.bone;
+      auto effectorWorld = glm::vec3(m_worldMatrices[effector][3]);
+      auto targetWorld = glm::vec3(m_worldMatrices[target][3]);
+
+      // ͍̕ϊŕςȂ̂Ń[hԂ̂܂ܔ肷.
+      auto diff = targetWorld - effectorWorld;
+      if (glm::dot(diff, diff) < 0.0001f)
+      {
+        converged = true;
+        break;
+      }
+      // GtFN^ƃ^[Qbg̈ʒuA݃{[ł̃[JԂɂ.
+      const auto& mtxBone = m_worldMatrices[bone];
+      auto effectorPos = InverseTransformPoint(mtxBone, effectorWorld);
+      auto targetPos = InverseTransformPoint(mtxBone, targetWorld);
+
+      // {[^[QbgуGtFN^֌xNg𐶐.
+      auto vecToEff = glm::normalize(effectorPos);
+      auto vecToTarget = glm::normalize(targetPos);
+
+      auto dot = glm::clamp(glm::dot(vecToEff, vecToTarget), -1.0f, 1.0f);
+      float radian = acosf(dot);
+      if (radian < 0.0001f)
+      {
+        continue;
+      }
+      radian = glm::clamp(radian, -chain.angleLimit, chain.angleLimit);
+
+      // ]߂.
+      auto axis = glm::normalize(glm::cross(vecToTarget, vecToEff));
+      if (radian < 0.001f)
+      {
+        continue;
+      }
+
+      auto rotation = glm::angleAxis(radian, axis);
+      if (link.kneeConstraint)
+      {
+        auto eulerAngle = glm::eulerAngles(rotation);
+        eulerAngle.y = 0.0f; eulerAngle.z = 0.0f;
+        eulerAngle.x = glm::clamp(eulerAngle.x, 0.002f, glm::pi<float>());
+        rotation = glm::quat(eulerAngle);
+      }
+      rotation = glm::normalize(GetRotation(bone) * rotation);
+      m_rotationX[bone] = rotation.x;
+      m_rotationY[bone] = rotation.y;
+      m_rotationZ[bone] = rotation.z;
+      m_rotationW[bone] = rotation.w;
+      localMatrices[i] = ComposeLocalMatrix(bone);
+      rotated = true;
+      ++rotations;
+
+      // ]NGtFN^܂ł̈ʒuWXV.
+      for (int j = int(i); j >= 0; --j)
+      {
+        SetWorldMatrix(first + chain.links[j].bone, localMatrices[j]);
+      }
+      SetWorldMatrix(effector, localMatrices[linkCount]);
+      if (targetFollowsChain)
+      {
+        UpdateWorldMatrix(target);
+      }
+    }
+    // ǂ̃N]ȂΈȍ~̔ʂɂȂ.
+    if (!rotated)
+    {
+      break;
+    }
+  }
+
+  m_ikSolveCount += 1;
+  m_ikIterationCount += iterations;
+  m_ikRotationCount += rotations;
+  m_ikConvergedCount += converged ? 1 : 0;
+  m_ikSolveNs += uint64_t(stopWatch.GetElapsedMs() * 1.0e6);
+}
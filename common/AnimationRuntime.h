@@ -0,0 +1,134 @@
+#pragma once
+#include "Skeleton.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+// LN^[̍i̎p܂Ƃ߂ĕێAꊇōsvZ.
+// SCX^X̃{[ 1 ̔zɘAĕׁA[J̎p SoA Ŏ.
+// ei͐eqOɕł邽߁ASLN^[̃[hs͑O 1 񑖍邾ŋ܂.
+//
+// 1 t[̗:
+//  1. eLN^[̃[Jpݒ肷 (Animator::SampleAnimation).
+//  2. UpdateWorldMatrices() őSCX^X̃[hsXV.
+//  3. eCX^X SolveIK Ă.
+//  4. GetSkinMatrices ŃXLjOp̍so.
+class AnimationRuntime
+{
+public:
+  using InstanceId = uint32_t;
+
+  // skeleton ̎pCX^Xǉ. p͏pƂȂ.
+  InstanceId AddInstance(std::shared_ptr<const Skeleton> skeleton);
+  void Clear();
+
+  uint32_t GetInstanceCount() const { return uint32_t(m_instances.size()); }
+  uint32_t GetTotalBoneCount() const { return uint32_t(m_parents.size()); }
+  const Skeleton& GetSkeleton(InstanceId instance) const { return *m_instances[instance].skeleton; }
+
+  // ȉ̃{[̔ԍ͌(f)ԍ.
+  void SetLocalTranslation(InstanceId instance, uint32_t bone, const glm::vec3& translation)
+  {
+    auto index = GetIndex(instance, bone);
+    m_translationX[index] = translation.x;
+    m_translationY[index] = translation.y;
+    m_translationZ[index] = translation.z;
+  }
+  void SetLocalRotation(InstanceId instance, uint32_t bone, const glm::quat& rotation)
+  {
+    auto index = GetIndex(instance, bone);
+    m_rotationX[index] = rotation.x;
+    m_rotationY[index] = rotation.y;
+    m_rotationZ[index] = rotation.z;
+    m_rotationW[index] = rotation.w;
+  }
+  glm::vec3 GetLocalTranslation(InstanceId instance, uint32_t bone) const
+  {
+    auto index = GetIndex(instance, bone);
+    return glm::vec3(m_translationX[index], m_translationY[index], m_translationZ[index]);
+  }
+  glm::quat GetLocalRotation(InstanceId instance, uint32_t bone) const
+  {
+    return GetRotation(GetIndex(instance, bone));
+  }
+  const glm::mat4& GetWorldMatrix(InstanceId instance, uint32_t bone) const
+  {
+    return m_worldMatrices[GetIndex(instance, bone)];
+  }
+
+  // pɖ߂.
+  void ResetPose(InstanceId instance);
+
+  // SCX^X̃[hsXV.
+  void UpdateWorldMatrices();
+  void UpdateWorldMatrices(InstanceId instance);
+
+  // i IK ACX^X̃[hsXV.
+  // ĂяoOɃ[hs񂪍XVĂ邱.
+  void SolveIK(InstanceId instance);
+  // chainIndex Ԗڂ̃`FĈ݂. Skeleton::GetIkDependencies() ̏邱.
+  // SẴ`FC UpdateWorldMatrices(instance) Ă.
+  void SolveIK(InstanceId instance, uint32_t chainIndex);
+
+  // CX^X̍sXV IK ̃Wu dependency ̌ɒǉASĊWuԂ.
+  // IK ݂͌ɉeȂ`FCƂɕʂ̃WuƂȂ.
+  // Wu̎sɃCX^XǉE폜Ȃ.
+  JobGraph::JobId AddUpdateJobs(JobGraph& graph, InstanceId instance, JobGraph::JobId dependency);
+
+  // IK ̌vl. SCX^XES`FC̍v.
+  struct IkStatistics
+  {
+    uint64_t solveCount;      // `FC.
+    uint64_t iterationCount;  // ̍v.
+    uint64_t rotationCount;   // N].
+    uint64_t convergedCount;  // e덷Ɏ܂đł؂.
+    double solveMs;           // Ԃ̍v.
+  };
+  IkStatistics GetIkStatistics() const;
+  void ResetIkStatistics();
+
+  // XLjOp̍s([hs * oChts)̃{[ԍ̈ʒu֏o.
+  void GetSkinMatrices(InstanceId instance, glm::mat4* dst, uint32_t count) const;
+
+private:
+  struct Instance
+  {
+    std::shared_ptr<const Skeleton> skeleton;
+    uint32_t first; // Ŝ̔zł̐擪.
+  };
+
+  uint32_t GetIndex(InstanceId instance, uint32_t bone) const
+  {
+    const auto& inst = m_instances[instance];
+    return inst.first + inst.skeleton->GetSortedIndex(bone);
+  }
+  glm::quat GetRotation(uint32_t index) const
+  {
+    return glm::quat(m_rotationW[index], m_rotationX[index], m_rotationY[index], m_rotationZ[index]);
+  }
+  void UpdateWorldMatrices(uint32_t first, uint32_t last);
+  void UpdateWorldMatrix(uint32_t index);
+  glm::mat4 ComposeLocalMatrix(uint32_t index) const;
+  void SetWorldMatrix(uint32_t index, const glm::mat4& local);
+  void SolveIkChain(uint32_t first, const Skeleton::IkChain& chain);
+
+  std::vector<Instance> m_instances;
+
+  std::vector<int32_t> m_parents; // Ŝ̔zł̐ëʒu.
+  std::vector<float> m_translationX, m_translationY, m_translationZ;
+  std::vector<float> m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+  std::vector<glm::mat4> m_worldMatrices;
+
+  // `FC̓WuƂĕɉ̂Ōvl̓Ag~bNɉZ.
+  std::atomic<uint64_t> m_ikSolveCount{ 0 };
+  std::atomic<uint64_t> m_ikIterationCount{ 0 };
+  std::atomic<uint64_t> m_ikRotationCount{ 0 };
+  std::atomic<uint64_t> m_ikConvergedCount{ 0 };
+  std::atomic<uint64_t> m_ikSolveNs{ 0 };
+};
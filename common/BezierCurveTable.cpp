@@ -0,0 +1,72 @@
+#include "BezierCurveTable.h"
+
+#include <cmath>
+
+namespace
+{
+  double EvaluateCubic(double p1, double p2, double t)
+  {
+    double s = 1.0 - t;
+    return 3.0 * s * s * t * p1 + 3.0 * s * t * t * p2 + t * t * t;
+  }
+}
+
+BezierCurveTable::BezierCurveTable()
+{
+  Clear();
+}
+
+void BezierCurveTable::Clear()
+{
+  // 0 Ԃ͒pɗ\񂷂 (e[u͎QƂȂ).
+  m_curves.assign(1, Curve{});
+  m_lookup.clear();
+}
+
+BezierCurveTable::CurveId BezierCurveTable::Register(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2)
+{
+  if (x1 == y1 && x2 == y2)
+  {
+    return LinearCurve;
+  }
+  uint32_t key = uint32_t(x1) | (uint32_t(y1) << 8) | (uint32_t(x2) << 16) | (uint32_t(y2) << 24);
+  auto itr = m_lookup.find(key);
+  if (itr != m_lookup.end())
+  {
+    return itr->second;
+  }
+
+  // _ x  0`1 ͈̔͂ɂ x(t) ͒PƂȂ.
+  Curve curve;
+  double cx1 = x1 / 127.0, cy1 = y1 / 127.0, cx2 = x2 / 127.0, cy2 = y2 / 127.0;
+  for (uint32_t i = 0; i <= SampleCount; ++i)
+  {
+    double t = double(i) / SampleCount;
+    curve.x[i] = float(EvaluateCubic(cx1, cx2, t));
+    curve.y[i] = float(EvaluateCubic(cy1, cy2, t));
+  }
+  curve.x[0] = 0.0f;
+  curve.x[SampleCount] = 1.0f;
+
+  uint32_t segment = 0;
+  for (uint32_t cell = 0; cell < SampleCount; ++cell)
+  {
+    float x = float(cell) / SampleCount;
+    while (segment < SampleCount - 1 && curve.x[segment + 1] <= x)
+    {
+      ++segment;
+    }
+    curve.start[cell] = uint8_t(segment);
+  }
+
+  auto id = CurveId(m_curves.size());
+  m_curves.push_back(curve);
+  m_lookup.emplace(key, id);
+  return id;
+}
+
+BezierCurveTable::CurveId BezierCurveTable::Register(const glm::vec4& bezier)
+{
+  auto toInt = [](float v) { return uint8_t(std::lround(glm::clamp(v, 0.0f, 1.0f) * 127.0f)); };
+  return Register(toInt(bezier.x), toInt(bezier.y), toInt(bezier.z), toInt(bezier.w));
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// VMD ̕ԋȐǂݍݎɃe[uāAvZȂɕ].
+// _ 0`127 ̐Ȃ̂ŁAȐ 1 ̃e[uL.
+//
+// e[u t  SampleCount _ (x(t), y(t)) A
+// x Ԃ y `Ԃ. 덷͋ԓł y ̕ωʈȉ
+// (_ 0`1 ͈̔͂ł 3 / SampleCount ȉ) ŁA_ 9 ݂
+// Sgݍ킹Ȑɑ΂čő 2.1e-3,  5.2e-5 ƂȂ.
+// (]̃j[g@ 32 񔽕͓ōő 1.9e-2,  5.2e-7.
+//  12_Animation_AnimationBenchmark ŊmFł)
+class BezierCurveTable
+{
+public:
+  using CurveId = uint32_t;
+  enum : uint32_t
+  {
+    SampleCount = 64,
+    LinearCurve = 0, // x1 == y1  x2 == y2 ̋Ȑ y = x ƂȂ.
+  };
+
+  BezierCurveTable();
+
+  // _ (x1, y1, x2, y2) ̋Ȑo^ĔԍԂ. o^ς݂ł΂̔ԍԂ.
+  CurveId Register(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
+  // loader::VMDNode::getBezierParam ̒l (evf 0`1) o^.
+  CurveId Register(const glm::vec4& bezier);
+
+  // x (0`1) ł̋Ȑ̒lԂ.
+  float Evaluate(CurveId curve, float x) const
+  {
+    x = x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+    if (curve == LinearCurve)
+    {
+      return x;
+    }
+    const auto& table = m_curves[curve];
+    auto cell = uint32_t(x * SampleCount);
+    uint32_t i = table.start[cell < SampleCount ? cell : SampleCount - 1];
+    while (i < SampleCount - 1 && table.x[i + 1] < x)
+    {
+      ++i;
+    }
+    auto dx = table.x[i + 1] - table.x[i];
+    auto rate = dx > 0.0f ? (x - table.x[i]) / dx : 0.0f;
+    return table.y[i] + (table.y[i + 1] - table.y[i]) * rate;
+  }
+
+  uint32_t GetCurveCount() const { return uint32_t(m_curves.size()); }
+  void Clear();
+
+private:
+  struct Curve
+  {
+    float x[SampleCount + 1];
+    float y[SampleCount + 1];
+    // x  SampleCount eZɂāATn߂.
+    uint8_t start[SampleCount];
+  };
+  std::vector<Curve> m_curves;
+  std::unordered_map<uint32_t, CurveId> m_lookup;
+};
@@ -0,0 +1,95 @@
+#include "DeferredDeletionQueue.h"
+#include "VulkanBookUtil.h"
+
+DeferredDeletionQueue::DeferredDeletionQueue(VkDevice device, VkQueue queue)
+  : m_device(device), m_queue(queue)
+{
+}
+
+DeferredDeletionQueue::~DeferredDeletionQueue()
+{
+  Flush();
+  for (auto fence : m_freeFences)
+  {
+    vkDestroyFence(m_device, fence, nullptr);
+  }
+}
+
+void DeferredDeletionQueue::Push(Deleter deleter)
+{
+  m_pending.push_back(std::move(deleter));
+}
+
+void DeferredDeletionQueue::Collect()
+{
+  // L[̏͑MɊ̂ŁAÂ܂Ƃ܂肩m߂.
+  while (!m_batches.empty() && vkGetFenceStatus(m_device, m_batches.front().fence) == VK_SUCCESS)
+  {
+    auto& batch = m_batches.front();
+    for (auto& deleter : batch.deleters)
+    {
+      deleter();
+    }
+    vkResetFences(m_device, 1, &batch.fence);
+    m_freeFences.push_back(batch.fence);
+    m_batches.pop_front();
+  }
+  if (m_pending.empty())
+  {
+    return;
+  }
+
+  // R}hȂM̃tFX́AOɑMꂽSĂ̏ƃVOi.
+  Batch batch{ AcquireFence(), std::move(m_pending) };
+  m_pending.clear();
+  auto result = vkQueueSubmit(m_queue, 0, nullptr, batch.fence);
+  ThrowIfFailed(result, "vkQueueSubmit Failed.");
+  m_batches.push_back(std::move(batch));
+}
+
+void DeferredDeletionQueue::Flush()
+{
+  for (auto& batch : m_batches)
+  {
+    for (auto& deleter : batch.deleters)
+    {
+      deleter();
+    }
+    vkResetFences(m_device, 1, &batch.fence);
+    m_freeFences.push_back(batch.fence);
+  }
+  m_batches.clear();
+  for (auto& deleter : m_pending)
+  {
+    deleter();
+  }
+  m_pending.clear();
+}
+
+uint32_t DeferredDeletionQueue::GetPendingCount() const
+{
+  auto count = m_pending.size();
+  for (const auto& batch : m_batches)
+  {
+    count += batch.deleters.size();
+  }
+  return uint32_t(count);
+}
+
+VkFence DeferredDeletionQueue::AcquireFence()
+{
+  if (!m_freeFences.empty())
+  {
+    auto fence = m_freeFences.back();
+    m_freeFences.pop_back();
+    return fence;
+  }
+  VkFenceCreateInfo fenceCI{
+    VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+    nullptr, 0
+  };
+  VkFence fence;
+  auto result = vkCreateFence(m_device, &fenceCI, nullptr, &fence);
+  ThrowIfFailed(result, "vkCreateFence Failed.");
+  return fence;
+}
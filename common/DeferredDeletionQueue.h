@@ -0,0 +1,47 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+// GPU gI܂Ń\[X̔jx点.
+// Push j̓t[ (Collect ) ̂܂Ƃ܂ɂACollect ̎_܂łɃL[֑Mꂽ
+// SĂ̏ƂtFXŊm߂Ăs.
+// `撆̃t[҂Ƀ\[X蒼ꍇ (Xbv`FC̍ĐȂ) Ɏg.
+// L[֑MXbhƓXbhg.
+class DeferredDeletionQueue
+{
+public:
+  using Deleter = std::function<void()>;
+
+  DeferredDeletionQueue(VkDevice device, VkQueue queue);
+  // cSĔj. foCXACh̏ԂŔj邱.
+  ~DeferredDeletionQueue();
+
+  DeferredDeletionQueue(const DeferredDeletionQueue&) = delete;
+  DeferredDeletionQueue& operator=(const DeferredDeletionQueue&) = delete;
+
+  void Push(Deleter deleter);
+  // ܂Ƃ܂jAO񂩂 Push tFXƋɐV܂Ƃ܂ɂ. t[Ăяo.
+  void Collect();
+  // GPU ҂ɑSĂj. vkDeviceWaitIdle ̌ɌĂяo.
+  void Flush();
+
+  // ܂jĂȂ̂̐.
+  uint32_t GetPendingCount() const;
+private:
+  struct Batch
+  {
+    VkFence fence;
+    std::vector<Deleter> deleters;
+  };
+  VkFence AcquireFence();
+
+  VkDevice m_device;
+  VkQueue m_queue;
+  std::vector<Deleter> m_pending; //  Collect ł܂Ƃ߂.
+  std::deque<Batch> m_batches;    // M.
+  std::vector<VkFence> m_freeFences;
+};
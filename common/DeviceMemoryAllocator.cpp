@@ -0,0 +1,348 @@
+#include "DeviceMemoryAllocator.h"
+#include "VulkanBookUtil.h"
+
+#include <algorithm>
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// 2̃AhX bufferImageGranularity ŋ؂ꂽy[WɊ܂܂邩.
+static bool IsOnSamePage(VkDeviceSize a, VkDeviceSize b, VkDeviceSize granularity)
+{
+  return (a & ~(granularity - 1)) == (b & ~(granularity - 1));
+}
+
+DeviceMemoryAllocator::DeviceMemoryAllocator(VkDevice device, VkPhysicalDevice physDev, VkDeviceSize blockSize)
+  : m_device(device), m_blockSize(blockSize)
+{
+  vkGetPhysicalDeviceMemoryProperties(physDev, &m_memProps);
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(physDev, &props);
+  m_bufferImageGranularity = (std::max)(VkDeviceSize(1), props.limits.bufferImageGranularity);
+  m_blocks.resize(m_memProps.memoryTypeCount);
+}
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator()
+{
+}
+
+DeviceMemoryAllocator::Allocation DeviceMemoryAllocator::Allocate(const VkMemoryRequirements& reqs, uint32_t memoryTypeIndex, ResourceType type)
+{
+  if (memoryTypeIndex >= m_memProps.memoryTypeCount)
+  {
+    throw book_util::VulkanException("DeviceMemoryAllocator: invalid memory type.");
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Allocation allocation;
+
+  // ubN̔𒴂̂͐pɊmۂ.
+  auto blockSize = GetPreferredBlockSize(memoryTypeIndex);
+  if (reqs.size > blockSize / 2)
+  {
+    auto block = CreateBlock(memoryTypeIndex, reqs.size, true);
+    block->freeRanges.clear();
+    block->usedRanges[0] = Block::Range{ reqs.size, type };
+    block->usedBytes = reqs.size;
+    allocation.memory = block->memory;
+    allocation.offset = 0;
+    allocation.size = reqs.size;
+    allocation.mapped = block->mapped;
+    allocation.block = block;
+    return allocation;
+  }
+
+  for (auto& block : m_blocks[memoryTypeIndex])
+  {
+    if (!block->dedicated && TryAllocate(block.get(), reqs, type, allocation))
+    {
+      return allocation;
+    }
+  }
+
+  auto block = CreateBlock(memoryTypeIndex, blockSize, false);
+  if (!TryAllocate(block, reqs, type, allocation))
+  {
+    throw book_util::VulkanException("DeviceMemoryAllocator: allocation failed.");
+  }
+  return allocation;
+}
+
+void DeviceMemoryAllocator::Free(const Allocation& allocation)
+{
+  auto block = allocation.block;
+  if (block == nullptr)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (block->dedicated)
+  {
+    DestroyBlock(block);
+    return;
+  }
+
+  auto used = block->usedRanges.find(allocation.offset);
+  if (used == block->usedRanges.end())
+  {
+    return;
+  }
+  auto offset = used->first;
+  auto size = used->second.size;
+  block->usedRanges.erase(used);
+  block->usedBytes -= size;
+
+  // Ő󂫗̈ƌ.
+  auto next = block->freeRanges.find(offset + size);
+  if (next != block->freeRanges.end())
+  {
+    size += next->second;
+    block->freeRanges.erase(next);
+  }
+  auto prev = block->freeRanges.lower_bound(offset);
+  if (prev != block->freeRanges.begin())
+  {
+    --prev;
+    if (prev->first + prev->second == offset)
+    {
+      offset = prev->first;
+      size += prev->second;
+      block->freeRanges.erase(prev);
+    }
+  }
+  block->freeRanges[offset] = size;
+
+  // ̃ubN1cAȊO͉.
+  if (block->usedRanges.empty())
+  {
+    const auto& blocks = m_blocks[block->memoryTypeIndex];
+    auto emptyCount = std::count_if(blocks.begin(), blocks.end(),
+      [](const std::unique_ptr<Block>& b) { return !b->dedicated && b->usedRanges.empty(); });
+    if (emptyCount > 1)
+    {
+      DestroyBlock(block);
+    }
+  }
+}
+
+void DeviceMemoryAllocator::Cleanup()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& blocks : m_blocks)
+  {
+    for (auto& block : blocks)
+    {
+      if (block->mapped)
+      {
+        vkUnmapMemory(m_device, block->memory);
+      }
+      vkFreeMemory(m_device, block->memory, nullptr);
+    }
+    blocks.clear();
+  }
+}
+
+uint32_t DeviceMemoryAllocator::FindMemoryTypeIndex(uint32_t requestBits, VkMemoryPropertyFlags props) const
+{
+  for (uint32_t i = 0; i < m_memProps.memoryTypeCount; ++i)
+  {
+    if ((requestBits & (1u << i)) && (m_memProps.memoryTypes[i].propertyFlags & props) == props)
+    {
+      return i;
+    }
+  }
+  return ~0u;
+}
+
+std::vector<DeviceMemoryAllocator::HeapStats> DeviceMemoryAllocator::GetHeapStats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<HeapStats> stats(m_memProps.memoryHeapCount, HeapStats{});
+  std::vector<VkDeviceSize> freeBytes(m_memProps.memoryHeapCount, 0);
+  for (uint32_t i = 0; i < m_memProps.memoryHeapCount; ++i)
+  {
+    stats[i].heapSize = m_memProps.memoryHeaps[i].size;
+  }
+  for (uint32_t typeIndex = 0; typeIndex < uint32_t(m_blocks.size()); ++typeIndex)
+  {
+    auto heapIndex = m_memProps.memoryTypes[typeIndex].heapIndex;
+    auto& s = stats[heapIndex];
+    for (const auto& block : m_blocks[typeIndex])
+    {
+      s.blockBytes += block->size;
+      s.usedBytes += block->usedBytes;
+      s.allocationCount += uint32_t(block->usedRanges.size());
+      s.blockCount++;
+      if (block->dedicated)
+      {
+        s.dedicatedCount++;
+      }
+      for (const auto& range : block->freeRanges)
+      {
+        s.freeRangeCount++;
+        s.largestFreeRange = (std::max)(s.largestFreeRange, range.second);
+        freeBytes[heapIndex] += range.second;
+      }
+    }
+  }
+  for (uint32_t i = 0; i < m_memProps.memoryHeapCount; ++i)
+  {
+    if (freeBytes[i] > 0)
+    {
+      stats[i].fragmentation = 1.0f - float(double(stats[i].largestFreeRange) / double(freeBytes[i]));
+    }
+  }
+  return stats;
+}
+
+uint32_t DeviceMemoryAllocator::GetDeviceMemoryCount() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint32_t count = 0;
+  for (const auto& blocks : m_blocks)
+  {
+    count += uint32_t(blocks.size());
+  }
+  return count;
+}
+
+DeviceMemoryAllocator::Block* DeviceMemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated)
+{
+  VkMemoryAllocateInfo info{
+    VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+    nullptr,
+    size,
+    memoryTypeIndex
+  };
+  VkDeviceMemory memory;
+  auto result = vkAllocateMemory(m_device, &info, nullptr, &memory);
+  ThrowIfFailed(result, "vkAllocateMemory Failed.");
+
+  auto block = std::make_unique<Block>();
+  block->memory = memory;
+  block->size = size;
+  block->memoryTypeIndex = memoryTypeIndex;
+  block->mapped = nullptr;
+  block->dedicated = dedicated;
+  block->usedBytes = 0;
+  block->freeRanges[0] = size;
+
+  // zXg猩郁͊mێɃ}bv܂܂ɂĂ.
+  auto props = m_memProps.memoryTypes[memoryTypeIndex].propertyFlags;
+  if (props & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+  {
+    void* p = nullptr;
+    result = vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &p);
+    ThrowIfFailed(result, "vkMapMemory Failed.");
+    block->mapped = static_cast<char*>(p);
+  }
+
+  auto ptr = block.get();
+  m_blocks[memoryTypeIndex].push_back(std::move(block));
+  return ptr;
+}
+
+void DeviceMemoryAllocator::DestroyBlock(Block* block)
+{
+  auto& blocks = m_blocks[block->memoryTypeIndex];
+  auto it = std::find_if(blocks.begin(), blocks.end(),
+    [block](const std::unique_ptr<Block>& b) { return b.get() == block; });
+  if (it == blocks.end())
+  {
+    return;
+  }
+  if (block->mapped)
+  {
+    vkUnmapMemory(m_device, block->memory);
+  }
+  vkFreeMemory(m_device, block->memory, nullptr);
+  blocks.erase(it);
+}
+
+bool DeviceMemoryAllocator::TryAllocate(Block* block, const VkMemoryRequirements& reqs, ResourceType type, Allocation& out)
+{
+  auto granularity = m_bufferImageGranularity;
+  auto alignment = (std::max)(VkDeviceSize(1), reqs.alignment);
+
+  // ܂󂫗̈̂ł̂I.
+  auto best = block->freeRanges.end();
+  VkDeviceSize bestOffset = 0;
+  for (auto it = block->freeRanges.begin(); it != block->freeRanges.end(); ++it)
+  {
+    auto rangeBegin = it->first;
+    auto rangeEnd = it->first + it->second;
+    if (it->second < reqs.size)
+    {
+      continue;
+    }
+    auto offset = AlignUp(rangeBegin, alignment);
+
+    // O̊蓖ĂƎނقȂAy[Wɏꍇ̓y[WE܂ł炷.
+    if (granularity > 1)
+    {
+      auto prev = block->usedRanges.lower_bound(rangeBegin);
+      if (prev != block->usedRanges.begin())
+      {
+        --prev;
+        auto prevLast = prev->first + prev->second.size - 1;
+        if (prev->second.type != type && IsOnSamePage(prevLast, offset, granularity))
+        {
+          offset = AlignUp(offset, granularity);
+        }
+      }
+    }
+    if (offset + reqs.size > rangeEnd)
+    {
+      continue;
+    }
+    // ̊蓖ĂɂĂlɊmF.
+    if (granularity > 1)
+    {
+      auto next = block->usedRanges.find(rangeEnd);
+      if (next != block->usedRanges.end() && next->second.type != type &&
+        IsOnSamePage(offset + reqs.size - 1, next->first, granularity))
+      {
+        continue;
+      }
+    }
+    if (best == block->freeRanges.end() || it->second < best->second)
+    {
+      best = it;
+      bestOffset = offset;
+    }
+  }
+  if (best == block->freeRanges.end())
+  {
+    return false;
+  }
+
+  auto rangeBegin = best->first;
+  auto rangeEnd = best->first + best->second;
+  block->freeRanges.erase(best);
+  if (bestOffset > rangeBegin)
+  {
+    block->freeRanges[rangeBegin] = bestOffset - rangeBegin;
+  }
+  if (bestOffset + reqs.size < rangeEnd)
+  {
+    block->freeRanges[bestOffset + reqs.size] = rangeEnd - (bestOffset + reqs.size);
+  }
+  block->usedRanges[bestOffset] = Block::Range{ reqs.size, type };
+  block->usedBytes += reqs.size;
+
+  out.memory = block->memory;
+  out.offset = bestOffset;
+  out.size = reqs.size;
+  out.mapped = block->mapped ? block->mapped + bestOffset : nullptr;
+  out.block = block;
+  return true;
+}
+
+VkDeviceSize DeviceMemoryAllocator::GetPreferredBlockSize(uint32_t memoryTypeIndex) const
+{
+  // ȃq[v(BAR ̈Ȃ)g؂Ȃ悤Ƀq[v 1/8 Ƃ.
+  auto heapIndex = m_memProps.memoryTypes[memoryTypeIndex].heapIndex;
+  auto heapSize = m_memProps.memoryHeaps[heapIndex].size;
+  return (std::min)(m_blockSize, AlignUp(heapSize / 8, 1024 * 1024));
+}
@@ -0,0 +1,95 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// vkAllocateMemory ^CvƂ̑傫ȃubNPʂōsA
+// obt@C[Wɂ͂̈ꕔ؂oĊ蓖Ă.
+class DeviceMemoryAllocator
+{
+public:
+  struct Block;
+  struct Allocation
+  {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr; // zXg猩郁̏ꍇ̓}bvς݂̃AhX.
+    Block* block = nullptr;
+  };
+
+  // \[X̎. bufferImageGranularity ̍lɎgp.
+  enum class ResourceType
+  {
+    Linear,   // obt@AjA^CÕC[W.
+    Optimal,  // œK^CÕC[W.
+  };
+
+  // q[vƂ̎gp.
+  struct HeapStats
+  {
+    VkDeviceSize heapSize;
+    VkDeviceSize blockBytes;      // vkAllocateMemory Ŋmۂ.
+    VkDeviceSize usedBytes;       // 蓖čς݂̑.
+    VkDeviceSize largestFreeRange;
+    uint32_t blockCount;
+    uint32_t dedicatedCount;
+    uint32_t allocationCount;
+    uint32_t freeRangeCount;
+    float fragmentation;          // 0 Ȃ󂫗̈悪AĂ. 1 ɋ߂قǒfЉĂ.
+  };
+
+  DeviceMemoryAllocator(VkDevice device, VkPhysicalDevice physDev, VkDeviceSize blockSize = DefaultBlockSize);
+  ~DeviceMemoryAllocator();
+
+  Allocation Allocate(const VkMemoryRequirements& reqs, uint32_t memoryTypeIndex, ResourceType type);
+  void Free(const Allocation& allocation);
+
+  // SẴubN. foCXjOɌĂяo.
+  void Cleanup();
+
+  // requestBits ̒ props 𖞂^CvԂ. Ȃꍇ ~0u.
+  uint32_t FindMemoryTypeIndex(uint32_t requestBits, VkMemoryPropertyFlags props) const;
+
+  std::vector<HeapStats> GetHeapStats() const;
+  uint32_t GetDeviceMemoryCount() const;
+
+  enum : VkDeviceSize
+  {
+    DefaultBlockSize = 64 * 1024 * 1024,
+  };
+
+  struct Block
+  {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint32_t memoryTypeIndex;
+    char* mapped;
+    bool dedicated;
+
+    struct Range
+    {
+      VkDeviceSize size;
+      ResourceType type;
+    };
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges; // offset -> size
+    std::map<VkDeviceSize, Range> usedRanges;        // offset -> 蓖ď
+    VkDeviceSize usedBytes;
+  };
+private:
+  Block* CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated);
+  void DestroyBlock(Block* block);
+  bool TryAllocate(Block* block, const VkMemoryRequirements& reqs, ResourceType type, Allocation& out);
+  VkDeviceSize GetPreferredBlockSize(uint32_t memoryTypeIndex) const;
+
+  VkDevice m_device;
+  VkPhysicalDeviceMemoryProperties m_memProps;
+  VkDeviceSize m_bufferImageGranularity;
+  VkDeviceSize m_blockSize;
+  std::vector<std::vector<std::unique_ptr<Block>>> m_blocks; // ^CvƂ̃ubN.
+  mutable std::mutex m_mutex;
+};
@@ -0,0 +1,278 @@
+#include "FramePacer.h"
+#include "VulkanBookUtil.h"
+
+#include <algorithm>
+#include <array>
+
+FramePacer::FramePacer(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, uint32_t queueFamilyIndex,
+  uint32_t framesInFlight, bool useTimelineSemaphore)
+  : m_device(device), m_queue(queue), m_contextIndex(0), m_frameNumber(0), m_completedFrame(0), m_imageIndex(~0u),
+  m_timeline(VK_NULL_HANDLE), m_waitSemaphores(nullptr),
+  m_hasTimestamps(false), m_timestampPeriodMs(0.0), m_timestampMask(0), m_lastGpuEnd(0), m_statistics()
+{
+  framesInFlight = (std::min)((std::max)(framesInFlight, 1u), uint32_t(MaxFramesInFlight));
+
+  // GPU ̎̓L[^CX^vɑΉĂꍇ̂ݎ擾.
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(physicalDevice, &props);
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+  auto validBits = queueFamilyIndex < familyCount ? families[queueFamilyIndex].timestampValidBits : 0;
+  if (validBits > 0 && props.limits.timestampPeriod > 0.0f)
+  {
+    m_hasTimestamps = true;
+    m_timestampPeriodMs = double(props.limits.timestampPeriod) / 1000000.0;
+    m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+  }
+
+  VkResult result;
+#if defined(VK_KHR_timeline_semaphore)
+  if (useTimelineSemaphore)
+  {
+    m_waitSemaphores = vkGetDeviceProcAddr(m_device, "vkWaitSemaphoresKHR");
+  }
+  if (m_waitSemaphores != nullptr)
+  {
+    VkSemaphoreTypeCreateInfoKHR semTypeCI{
+      VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR, nullptr,
+      VK_SEMAPHORE_TYPE_TIMELINE_KHR, 0
+    };
+    VkSemaphoreCreateInfo timelineCI{
+      VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+      &semTypeCI, 0,
+    };
+    result = vkCreateSemaphore(m_device, &timelineCI, nullptr, &m_timeline);
+    ThrowIfFailed(result, "vkCreateSemaphore Failed.");
+  }
+#endif
+
+  VkSemaphoreCreateInfo semCI{
+    VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    nullptr, 0,
+  };
+  VkFenceCreateInfo fenceCI{
+    VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+    nullptr, VK_FENCE_CREATE_SIGNALED_BIT
+  };
+  VkCommandPoolCreateInfo cmdPoolCI{
+    VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+    nullptr,
+    VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+    queueFamilyIndex
+  };
+  VkQueryPoolCreateInfo queryPoolCI{
+    VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+    nullptr, 0,
+    VK_QUERY_TYPE_TIMESTAMP, 2, 0
+  };
+  m_contexts.resize(framesInFlight);
+  for (auto& context : m_contexts)
+  {
+    context = FrameContext();
+    result = vkCreateSemaphore(m_device, &semCI, nullptr, &context.imageAcquired);
+    ThrowIfFailed(result, "vkCreateSemaphore Failed.");
+    result = vkCreateSemaphore(m_device, &semCI, nullptr, &context.renderCompleted);
+    ThrowIfFailed(result, "vkCreateSemaphore Failed.");
+    if (m_timeline == VK_NULL_HANDLE)
+    {
+      result = vkCreateFence(m_device, &fenceCI, nullptr, &context.fence);
+      ThrowIfFailed(result, "vkCreateFence Failed.");
+    }
+    result = vkCreateCommandPool(m_device, &cmdPoolCI, nullptr, &context.commandPool);
+    ThrowIfFailed(result, "vkCreateCommandPool Failed.");
+    VkCommandBufferAllocateInfo commandAI{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, nullptr,
+      context.commandPool,
+      VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1
+    };
+    result = vkAllocateCommandBuffers(m_device, &commandAI, &context.command);
+    ThrowIfFailed(result, "vkAllocateCommandBuffers Failed.");
+    if (m_hasTimestamps)
+    {
+      result = vkCreateQueryPool(m_device, &queryPoolCI, nullptr, &context.queryPool);
+      ThrowIfFailed(result, "vkCreateQueryPool Failed.");
+    }
+  }
+}
+
+FramePacer::~FramePacer()
+{
+  WaitIdle();
+  for (auto& context : m_contexts)
+  {
+    vkDestroySemaphore(m_device, context.imageAcquired, nullptr);
+    vkDestroySemaphore(m_device, context.renderCompleted, nullptr);
+    if (context.fence != VK_NULL_HANDLE)
+    {
+      vkDestroyFence(m_device, context.fence, nullptr);
+    }
+    if (context.queryPool != VK_NULL_HANDLE)
+    {
+      vkDestroyQueryPool(m_device, context.queryPool, nullptr);
+    }
+    // R}hobt@̓v[ƈꏏɉ.
+    vkDestroyCommandPool(m_device, context.commandPool, nullptr);
+  }
+  m_contexts.clear();
+  if (m_timeline != VK_NULL_HANDLE)
+  {
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+  }
+}
+
+FramePacer::FrameContext& FramePacer::BeginFrame()
+{
+  ++m_frameNumber;
+  m_contextIndex = uint32_t(m_frameNumber % m_contexts.size());
+  m_imageIndex = ~0u;
+  m_statistics.cpuWaitMs = 0.0;
+
+  auto& context = m_contexts[m_contextIndex];
+  WaitForFrame(context.submittedFrame);
+  ReadTimestamps(context);
+  vkResetCommandPool(m_device, context.commandPool, 0);
+  return context;
+}
+
+void FramePacer::WaitForImage(uint32_t imageIndex)
+{
+  m_imageIndex = imageIndex;
+  if (imageIndex >= m_imageFrames.size())
+  {
+    m_imageFrames.resize(imageIndex + 1, 0);
+  }
+  WaitForFrame(m_imageFrames[imageIndex]);
+}
+
+VkCommandBuffer FramePacer::BeginCommand()
+{
+  auto& context = GetContext();
+  VkCommandBufferBeginInfo commandBI{
+    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    nullptr, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr
+  };
+  vkBeginCommandBuffer(context.command, &commandBI);
+  if (m_hasTimestamps)
+  {
+    vkCmdResetQueryPool(context.command, context.queryPool, 0, 2);
+    vkCmdWriteTimestamp(context.command, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, context.queryPool, 0);
+  }
+  return context.command;
+}
+
+void FramePacer::Submit(VkPipelineStageFlags waitStage)
+{
+  auto& context = GetContext();
+  if (m_hasTimestamps)
+  {
+    vkCmdWriteTimestamp(context.command, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, context.queryPool, 1);
+  }
+  vkEndCommandBuffer(context.command);
+
+  VkSubmitInfo submitInfo{
+    VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    nullptr,
+    1, &context.imageAcquired, // WaitSemaphore
+    &waitStage, // DstStageMask
+    1, &context.command, // CommandBuffer
+    1, &context.renderCompleted, // SignalSemaphore
+  };
+  VkFence fence = VK_NULL_HANDLE;
+#if defined(VK_KHR_timeline_semaphore)
+  // ^CCZ}tHփt[ԍʒm. oCiZ}tH̒l͎gȂ.
+  std::array<VkSemaphore, 2> signalSemaphores{ context.renderCompleted, m_timeline };
+  std::array<uint64_t, 2> signalValues{ 0, m_frameNumber };
+  uint64_t waitValue = 0;
+  VkTimelineSemaphoreSubmitInfoKHR timelineInfo{
+    VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr,
+    1, &waitValue,
+    uint32_t(signalValues.size()), signalValues.data()
+  };
+  if (m_timeline != VK_NULL_HANDLE)
+  {
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.signalSemaphoreCount = uint32_t(signalSemaphores.size());
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+  }
+  else
+#endif
+  {
+    fence = context.fence;
+    vkResetFences(m_device, 1, &fence);
+  }
+  auto result = vkQueueSubmit(m_queue, 1, &submitInfo, fence);
+  ThrowIfFailed(result, "vkQueueSubmit Failed.");
+
+  context.submittedFrame = m_frameNumber;
+  if (m_imageIndex < m_imageFrames.size())
+  {
+    m_imageFrames[m_imageIndex] = m_frameNumber;
+  }
+}
+
+void FramePacer::WaitIdle()
+{
+  uint64_t lastFrame = 0;
+  for (const auto& context : m_contexts)
+  {
+    lastFrame = (std::max)(lastFrame, context.submittedFrame);
+  }
+  WaitForFrame(lastFrame);
+}
+
+void FramePacer::WaitForFrame(uint64_t frame)
+{
+  if (frame <= m_completedFrame)
+  {
+    return;
+  }
+  book_util::StopWatch waitTime;
+#if defined(VK_KHR_timeline_semaphore)
+  if (m_timeline != VK_NULL_HANDLE)
+  {
+    VkSemaphoreWaitInfoKHR waitInfo{
+      VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR, nullptr, 0,
+      1, &m_timeline, &frame
+    };
+    auto waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(m_waitSemaphores);
+    auto result = waitSemaphores(m_device, &waitInfo, UINT64_MAX);
+    ThrowIfFailed(result, "vkWaitSemaphores Failed.");
+  }
+  else
+#endif
+  {
+    // frame 𑗐MReLXgėpĂ΁A̎_Ŋ҂Ă.
+    auto& context = m_contexts[frame % m_contexts.size()];
+    if (context.submittedFrame == frame)
+    {
+      auto result = vkWaitForFences(m_device, 1, &context.fence, VK_TRUE, UINT64_MAX);
+      ThrowIfFailed(result, "vkWaitForFences Failed.");
+    }
+  }
+  // 1 ̃L[֑MĂ̂ŁAÕt[Ă.
+  m_completedFrame = frame;
+  m_statistics.cpuWaitMs += waitTime.GetElapsedMs();
+}
+
+void FramePacer::ReadTimestamps(FrameContext& context)
+{
+  if (!m_hasTimestamps || context.submittedFrame <= m_statistics.gpuFrame)
+  {
+    return;
+  }
+  std::array<uint64_t, 2> timestamps{};
+  auto result = vkGetQueryPoolResults(m_device, context.queryPool, 0, 2,
+    sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS)
+  {
+    return;
+  }
+  auto begin = timestamps[0] & m_timestampMask;
+  auto end = timestamps[1] & m_timestampMask;
+  m_statistics.gpuBusyMs = end >= begin ? double(end - begin) * m_timestampPeriodMs : 0.0;
+  m_statistics.gpuIdleMs = (m_lastGpuEnd != 0 && begin >= m_lastGpuEnd) ? double(begin - m_lastGpuEnd) * m_timestampPeriodMs : 0.0;
+  m_statistics.gpuFrame = context.submittedFrame;
+  m_lastGpuEnd = end;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+// ɏt[ (frames in flight) ̐ReLXgAt[Ɋ蓖Ă.
+// Xbv`FC̃C[WƂ͓ƗɁAGPU ̊҂ɐsċL^łt[߂.
+//
+// 1 t[̗:
+//  1. BeginFrame()         ̃ReLXgőO񑗐Mt[̊҂AR}hv[Zbg.
+//  2. AcquireNextImage     ReLXg imageAcquired n.
+//  3. WaitForImage(index)  ̃C[WŌɎgt[̊҂. C[WƂ̃\[X͂̌ɏ.
+//  4. BeginCommand()       ReLXg̃R}hobt@֋L^n߂.
+//  5. Submit()             imageAcquired ҂ArenderCompleted Ɗʒm.
+//  6. QueuePresent         ReLXg renderCompleted n.
+// ̒ʒm̓^CCZ}tH (t[ԍlƂ) gAgȂꍇ̓ReLXgƂ̃tFXg.
+class FramePacer
+{
+public:
+  struct FrameContext
+  {
+    VkSemaphore imageAcquired;
+    VkSemaphore renderCompleted;
+    VkFence fence;              // ^CCZ}tHgȂꍇ̂.
+    VkCommandPool commandPool;  // BeginFrame ŃZbg.
+    VkCommandBuffer command;
+    VkQueryPool queryPool;      // R}hobt@̊JnƏI GPU .
+    uint64_t submittedFrame;    // ̃ReLXgōŌɑMt[ԍ. 0 ͖M.
+  };
+  // CPU ̒l݂͌̃t[AGPU ̒l͊mFŐṼt[ (gpuFrame) ̂.
+  struct Statistics
+  {
+    double cpuWaitMs;   // BeginFrame  WaitForImage  GPU ̊҂.
+    double gpuBusyMs;   // R}hobt@̊JnI܂.
+    double gpuIdleMs;   // Õt[̏IJn܂. CPU ̋L^⑗MԂɍȂƑ.
+    uint64_t gpuFrame;
+  };
+
+  enum
+  {
+    MaxFramesInFlight = 4,
+  };
+
+  // useTimelineSemaphore ̓foCX VK_KHR_timeline_semaphore ̋@\Lɂꍇ true Ƃ.
+  FramePacer(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, uint32_t queueFamilyIndex,
+    uint32_t framesInFlight, bool useTimelineSemaphore);
+  ~FramePacer();
+
+  FramePacer(const FramePacer&) = delete;
+  FramePacer& operator=(const FramePacer&) = delete;
+
+  FrameContext& BeginFrame();
+  void WaitForImage(uint32_t imageIndex);
+  VkCommandBuffer BeginCommand();
+  void Submit(VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+  // Mς݂̑SẴt[̊҂.
+  void WaitIdle();
+
+  FrameContext& GetContext() { return m_contexts[m_contextIndex]; }
+  uint32_t GetFramesInFlight() const { return uint32_t(m_contexts.size()); }
+  // ݂̃ReLXg̔ԍ. t[Ƃ̃\[X GetFramesInFlight() ꍇ̓YɎg.
+  uint32_t GetContextIndex() const { return m_contextIndex; }
+  // ݋L^̃t[ԍ (1 ).
+  uint64_t GetFrameNumber() const { return m_frameNumber; }
+  bool IsTimelineSemaphoreEnabled() const { return m_timeline != VK_NULL_HANDLE; }
+  const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+  void WaitForFrame(uint64_t frame);
+  void ReadTimestamps(FrameContext& context);
+
+  VkDevice m_device;
+  VkQueue m_queue;
+  std::vector<FrameContext> m_contexts;
+  uint32_t m_contextIndex;
+  uint64_t m_frameNumber;
+  uint64_t m_completedFrame;          // mFt[ԍ.
+  uint32_t m_imageIndex;
+  std::vector<uint64_t> m_imageFrames; // C[WƂɍŌɎgt[ԍ.
+
+  VkSemaphore m_timeline;
+  PFN_vkVoidFunction m_waitSemaphores; // vkWaitSemaphoresKHR. Âwb_[łrhł悤^Ȃ.
+
+  bool m_hasTimestamps;
+  double m_timestampPeriodMs;
+  uint64_t m_timestampMask;
+  uint64_t m_lastGpuEnd;
+  Statistics m_statistics;
+};
@@ -0,0 +1,80 @@
+#include "FrameRingBuffer.h"
+#include "VulkanBookUtil.h"
+
+#include <algorithm>
+
+FrameRingBuffer::Slot FrameRingBuffer::Reserve(uint32_t size)
+{
+  auto slot = m_reservedSize;
+  m_reservedSize = AlignUp(m_reservedSize + size, SlotAlignment);
+  return slot;
+}
+
+void FrameRingBuffer::Initialize(VulkanAppBase* app, uint32_t frameCount, uint32_t transientSize, VkBufferUsageFlags usage)
+{
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(app->GetPhysicalDevice(), &props);
+  const auto& limits = props.limits;
+  VkDeviceSize alignment = 16;
+  if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+  {
+    alignment = (std::max)(alignment, limits.minUniformBufferOffsetAlignment);
+  }
+  if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+  {
+    alignment = (std::max)(alignment, limits.minStorageBufferOffsetAlignment);
+  }
+  m_alignment = uint32_t(alignment);
+
+  // Ԃ̐擪 Reserve ̈ʒuƓ SlotAlignment ɑ.
+  m_frameCount = (std::max)(frameCount, 1u);
+  m_frameSize = AlignUp(m_reservedSize + AlignUp(transientSize, m_alignment), SlotAlignment);
+  m_frameSize = (std::max)(m_frameSize, uint32_t(SlotAlignment));
+  m_buffer = app->CreateBuffer(m_frameSize * m_frameCount, usage,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (m_buffer.mapped == nullptr)
+  {
+    // ʂɊmۂꂽꍇŏ 1 񂾂}bv.
+    auto result = vkMapMemory(app->GetDevice(), m_buffer.memory, m_buffer.offset, VK_WHOLE_SIZE, 0, &m_buffer.mapped);
+    ThrowIfFailed(result, "vkMapMemory Failed.");
+    m_isMappedHere = true;
+  }
+  m_frameIndex = 0;
+  m_head = m_reservedSize;
+  m_peakUsage = 0;
+}
+
+void FrameRingBuffer::Cleanup(VulkanAppBase* app)
+{
+  if (m_buffer.buffer == VK_NULL_HANDLE)
+  {
+    return;
+  }
+  if (m_isMappedHere)
+  {
+    vkUnmapMemory(app->GetDevice(), m_buffer.memory);
+    m_isMappedHere = false;
+  }
+  app->DestroyBuffer(m_buffer);
+  m_buffer = VulkanAppBase::BufferObject();
+}
+
+void FrameRingBuffer::BeginFrame(uint32_t frameIndex)
+{
+  m_frameIndex = frameIndex % m_frameCount;
+  m_head = m_reservedSize;
+}
+
+FrameRingBuffer::Allocation FrameRingBuffer::Allocate(uint32_t size)
+{
+  auto offset = AlignUp(m_head, m_alignment);
+  if (offset + size > m_frameSize)
+  {
+    throw book_util::VulkanException("FrameRingBuffer: out of transient space.");
+  }
+  m_head = offset + size;
+  m_peakUsage = (std::max)(m_peakUsage, m_head - m_reservedSize);
+
+  auto bufferOffset = m_frameIndex * m_frameSize + offset;
+  return Allocation{ static_cast<char*>(m_buffer.mapped) + bufferOffset, bufferOffset };
+}
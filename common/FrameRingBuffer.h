@@ -0,0 +1,71 @@
+#pragma once
+#include "VulkanAppBase.h"
+
+#include <cstring>
+
+// t[Ƃɏf[^ (jtH[AXg[WA_) uA}bv܂܂ 1 ̃obt@.
+// obt@̓t[̋ԂɕAeԂ͎ 2 ̗̈悩Ȃ.
+//  - Reserve ŊmۂŒ̗̈. ǂ̃t[ԓ̓ʒuɂ̂ŁA
+//    L^ς݂̃R}h_Ci~bNItZbg GetOffset(frame, slot) ŎQƂł.
+//  - Allocate Ő擪؂ö. BeginFrame Ő擪֖߂̂ŁAt[L^R}hŎg.
+// ݂̓}bvς݂̃AhXւ memcpy ݂̂ŁAt[obt@Ƃ map/unmap ͍sȂ.
+// Ԃ̂́A frameIndex őMR}h̊ (tFX) ҂ɂ邱.
+// fBXNv^ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC (STORAGE_BUFFER_DYNAMIC) ƂA
+// ItZbg 0A͈͂Ƀf[^̑傫w肷.
+class FrameRingBuffer
+{
+public:
+  using Slot = uint32_t; // Reserve ̈̋ԓł̈ʒu.
+  struct Allocation
+  {
+    void* mapped;
+    uint32_t offset; // obt@擪̃oCg. _Ci~bNItZbgⒸ_obt@̃ItZbgɎg.
+  };
+
+  FrameRingBuffer() : m_buffer(), m_alignment(1), m_reservedSize(0), m_frameSize(0), m_frameCount(0),
+    m_frameIndex(0), m_head(0), m_peakUsage(0), m_isMappedHere(false) { }
+
+  // Initialize OɌĂяo. SẴt[ size oCg̗̈mۂ.
+  // ʒu̓foCXɂ炸 SlotAlignment ɑ.
+  Slot Reserve(uint32_t size);
+  // transientSize  1 t[ Allocate łoCg.
+  // usage ̎ނɍ킹āAë̐擪foCX̃ItZbg֑̐.
+  void Initialize(VulkanAppBase* app, uint32_t frameCount, uint32_t transientSize, VkBufferUsageFlags usage);
+  void Cleanup(VulkanAppBase* app);
+
+  // frameIndex ̋Ԃւ݂̏n߂. Allocate ̗̈͐擪ɖ߂.
+  void BeginFrame(uint32_t frameIndex);
+  // ݂̃t[̋Ԃ size oCg؂o. Ȃꍇ͗O𓊂.
+  Allocation Allocate(uint32_t size);
+  Allocation Write(const void* data, uint32_t size)
+  {
+    auto allocation = Allocate(size);
+    memcpy(allocation.mapped, data, size);
+    return allocation;
+  }
+
+  void* GetMapped(uint32_t frameIndex, Slot slot) const { return static_cast<char*>(m_buffer.mapped) + GetOffset(frameIndex, slot); }
+  uint32_t GetOffset(uint32_t frameIndex, Slot slot) const { return frameIndex * m_frameSize + slot; }
+  VkBuffer GetBuffer() const { return m_buffer.buffer; }
+
+  // ݂̃t[ƁA܂ł̍ő Allocate ̎gp.
+  uint32_t GetTransientUsage() const { return m_head - m_reservedSize; }
+  uint32_t GetPeakTransientUsage() const { return m_peakUsage; }
+
+  enum
+  {
+    SlotAlignment = 256, // minUniformBufferOffsetAlignment, minStorageBufferOffsetAlignment ̏.
+  };
+private:
+  static uint32_t AlignUp(uint32_t value, uint32_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+  VulkanAppBase::BufferObject m_buffer;
+  uint32_t m_alignment;
+  uint32_t m_reservedSize;
+  uint32_t m_frameSize;
+  uint32_t m_frameCount;
+  uint32_t m_frameIndex;
+  uint32_t m_head;       // Allocate ̎̈ʒu (Ԃ̐擪).
+  uint32_t m_peakUsage;
+  bool m_isMappedHere;   // AP[^[ł͂ȂAŃ}bv.
+};
@@ -0,0 +1,339 @@
+#include "HeadlessRunner.h"
+#include "VulkanBookUtil.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace book_util
+{
+  static void PrintMessage(const std::string& msg)
+  {
+    fputs(msg.c_str(), stdout);
+    fflush(stdout);
+#if defined(_WIN32)
+    OutputDebugStringA(msg.c_str());
+#endif
+  }
+
+  static bool WritePPM(const std::string& fileName, const HeadlessSwapchain::FrameImage& frame)
+  {
+    bool isBGR = false;
+    switch (frame.format)
+    {
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+      isBGR = true;
+      break;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+      break;
+    default:
+      // 8bit ȊÕtH[}bg͕ۑΏۊO.
+      return false;
+    }
+
+    std::ofstream outfile(fileName, std::ios::binary);
+    if (!outfile)
+    {
+      return false;
+    }
+    outfile << "P6\n" << frame.width << " " << frame.height << "\n255\n";
+    std::vector<char> line(frame.width * 3);
+    for (uint32_t y = 0; y < frame.height; ++y)
+    {
+      auto src = frame.pixels + size_t(y) * frame.rowPitch;
+      for (uint32_t x = 0; x < frame.width; ++x)
+      {
+        line[x * 3 + 0] = char(src[x * 4 + (isBGR ? 2 : 0)]);
+        line[x * 3 + 1] = char(src[x * 4 + 1]);
+        line[x * 3 + 2] = char(src[x * 4 + (isBGR ? 0 : 2)]);
+      }
+      outfile.write(line.data(), line.size());
+    }
+    return true;
+  }
+
+  static void MakeDirectory(const std::string& path)
+  {
+#if defined(_WIN32)
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+  }
+
+  static VkPresentModeKHR ParsePresentMode(const std::string& name)
+  {
+    if (name == "mailbox")
+    {
+      return VK_PRESENT_MODE_MAILBOX_KHR;
+    }
+    if (name == "immediate")
+    {
+      return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    }
+    if (name == "fifo_relaxed")
+    {
+      return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;
+  }
+
+  static PipelineManager::CacheMode ParsePipelineCacheMode(const std::string& name)
+  {
+    if (name == "cold")
+    {
+      return PipelineManager::CacheMode::Cold;
+    }
+    if (name == "off")
+    {
+      return PipelineManager::CacheMode::Disabled;
+    }
+    return PipelineManager::CacheMode::Enabled;
+  }
+
+  // 0 ␔lłȂw͎󂯕tAvalue ςȂ.
+  static void ParseSize(const std::string& name, const std::string& arg, uint32_t& value)
+  {
+    auto size = uint32_t(strtoul(arg.c_str(), nullptr, 10));
+    if (size == 0)
+    {
+      PrintMessage(name + " " + arg + " is ignored: the size must be greater than 0.\n");
+      return;
+    }
+    value = size;
+  }
+
+  HeadlessOptions ParseHeadlessOptions(int argc, char** argv, uint32_t defaultWidth, uint32_t defaultHeight)
+  {
+    HeadlessOptions options;
+    options.width = defaultWidth;
+    options.height = defaultHeight;
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+      const auto& arg = args[i];
+      bool hasValue = (i + 1) < args.size();
+      if (arg == "--headless")
+      {
+        options.enabled = true;
+      }
+      else if (arg == "--frames" && hasValue)
+      {
+        options.frameCount = uint32_t(strtoul(args[++i].c_str(), nullptr, 10));
+      }
+      else if (arg == "--width" && hasValue)
+      {
+        ParseSize(arg, args[++i], options.width);
+      }
+      else if (arg == "--height" && hasValue)
+      {
+        ParseSize(arg, args[++i], options.height);
+      }
+      else if (arg == "--output" && hasValue)
+      {
+        options.outputDir = args[++i];
+      }
+      else if (arg == "--fps" && hasValue)
+      {
+        options.frameRate = strtod(args[++i].c_str(), nullptr);
+      }
+    }
+    if (!(options.frameRate > 0.0))
+    {
+      options.frameRate = 30.0;
+    }
+    return options;
+  }
+
+  AppOptions ParseAppOptions(int argc, char** argv)
+  {
+    AppOptions options;
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+      const auto& arg = args[i];
+      bool hasValue = (i + 1) < args.size();
+      if (arg == "--crowd" && hasValue)
+      {
+        options.crowdCount = uint32_t(strtoul(args[++i].c_str(), nullptr, 10));
+      }
+      else if (arg == "--frames-in-flight" && hasValue)
+      {
+        options.framesInFlight = uint32_t(strtoul(args[++i].c_str(), nullptr, 10));
+      }
+      else if (arg == "--present-mode" && hasValue)
+      {
+        options.presentMode = ParsePresentMode(args[++i]);
+      }
+      else if (arg == "--swapchain-images" && hasValue)
+      {
+        options.swapchainImageCount = uint32_t(strtoul(args[++i].c_str(), nullptr, 10));
+      }
+      else if (arg == "--pipeline-cache" && hasValue)
+      {
+        options.pipelineCacheMode = ParsePipelineCacheMode(args[++i]);
+      }
+      else if (arg == "--compile-shaders")
+      {
+        options.compileShaders = true;
+      }
+      else if (arg == "--motion-cache")
+      {
+        options.motionCache = true;
+      }
+    }
+    return options;
+  }
+
+  int RunHeadless(VulkanAppBase& app, const HeadlessOptions& options, const AppOptions& appOptions, VkFormat format)
+  {
+#if defined(_WIN32)
+    // R\[Nꂽꍇ͌ʂ֏o͂.
+    if (GetConsoleWindow() == nullptr && AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+      FILE* fp = nullptr;
+      freopen_s(&fp, "CONOUT$", "w", stdout);
+    }
+#endif
+
+    char buf[512];
+    try
+    {
+      StopWatch initTimer;
+      app.SetFramesInFlight(appOptions.framesInFlight);
+      app.SetSwapchainImageCount(appOptions.swapchainImageCount);
+      app.SetPipelineCacheMode(appOptions.pipelineCacheMode);
+      app.SetShaderSourceCompileEnabled(appOptions.compileShaders);
+      app.InitializeHeadless(options.width, options.height, format);
+      auto initMs = initTimer.GetElapsedMs();
+
+      uint32_t savedCount = 0;
+      if (!options.outputDir.empty())
+      {
+        MakeDirectory(options.outputDir);
+        app.SetHeadlessFrameCallback([&](const HeadlessSwapchain::FrameImage& frame) {
+          char fileName[64];
+          snprintf(fileName, sizeof(fileName), "frame_%05llu.ppm", (unsigned long long)frame.frameNumber);
+          if (WritePPM(options.outputDir + "/" + fileName, frame))
+          {
+            ++savedCount;
+          }
+        });
+      }
+
+      std::vector<double> frameTimes;
+      frameTimes.reserve(options.frameCount);
+      // FramePacer gTvł́AGPU ҂Ԃ GPU ̋󂫎ԂWv.
+      auto pacer = app.GetFramePacer();
+      double cpuWaitMs = 0.0, gpuBusyMs = 0.0, gpuIdleMs = 0.0;
+      uint32_t gpuSampleCount = 0;
+      uint64_t lastGpuFrame = 0;
+      StopWatch totalTimer;
+      for (uint32_t i = 0; i < options.frameCount; ++i)
+      {
+        StopWatch frameTimer;
+        app.Render();
+        frameTimes.push_back(frameTimer.GetElapsedMs());
+
+        const auto& stats = pacer->GetStatistics();
+        cpuWaitMs += stats.cpuWaitMs;
+        if (stats.gpuFrame != lastGpuFrame)
+        {
+          lastGpuFrame = stats.gpuFrame;
+          gpuBusyMs += stats.gpuBusyMs;
+          gpuIdleMs += stats.gpuIdleMs;
+          ++gpuSampleCount;
+        }
+      }
+      vkDeviceWaitIdle(app.GetDevice());
+      auto totalMs = totalTimer.GetElapsedMs();
+
+      // foCX̎gp.
+      auto allocator = app.GetMemoryAllocator();
+      auto heapStats = allocator->GetHeapStats();
+      for (size_t i = 0; i < heapStats.size(); ++i)
+      {
+        const auto& heap = heapStats[i];
+        if (heap.blockCount == 0)
+        {
+          continue;
+        }
+        snprintf(buf, sizeof(buf),
+          "Heap%zu blocks=%u (dedicated=%u) allocations=%u used=%.2fMB/%.2fMB largestFree=%.2fMB fragmentation=%.2f\n",
+          i, heap.blockCount, heap.dedicatedCount, heap.allocationCount,
+          heap.usedBytes / (1024.0 * 1024.0), heap.blockBytes / (1024.0 * 1024.0),
+          heap.largestFreeRange / (1024.0 * 1024.0), heap.fragmentation);
+        PrintMessage(buf);
+      }
+      snprintf(buf, sizeof(buf), "DeviceMemory objects=%u\n", allocator->GetDeviceMemoryCount());
+      PrintMessage(buf);
+
+      // FramePacer  Terminate ŔĵŐɏo͂.
+      if (pacer->GetFrameNumber() > 0 && !frameTimes.empty())
+      {
+        snprintf(buf, sizeof(buf),
+          "FramePacer inFlight=%u timeline=%s cpuWait(avg=%.3fms) gpu(busy=%.3fms idle=%.3fms, %u frames)\n",
+          pacer->GetFramesInFlight(), pacer->IsTimelineSemaphoreEnabled() ? "yes" : "no",
+          cpuWaitMs / frameTimes.size(),
+          gpuSampleCount > 0 ? gpuBusyMs / gpuSampleCount : 0.0,
+          gpuSampleCount > 0 ? gpuIdleMs / gpuSampleCount : 0.0, gpuSampleCount);
+        PrintMessage(buf);
+      }
+
+      // wbhXł͓ǂݖ߂̃R}h𑗐M_\Ƃ.
+      const auto& latency = app.GetSwapchain()->GetLatencyStatistics();
+      if (latency.frameCount > 0)
+      {
+        snprintf(buf, sizeof(buf),
+          "Swapchain images=%u latency(acquire->present=%.3fms submit->present=%.3fms max=%.3fms, %u frames)\n",
+          app.GetSwapchain()->GetImageCount(), latency.acquireToPresentMs,
+          latency.submitToPresentMs, latency.maxSubmitToPresentMs, latency.frameCount);
+        PrintMessage(buf);
+      }
+
+      // init ̎ԂLbV̗LŔׂ. Ԃ init Ɋ܂܂.
+      auto pipelineManager = app.GetPipelineManager();
+      const auto& pipelineStats = pipelineManager->GetStatistics();
+      snprintf(buf, sizeof(buf),
+        "PipelineCache %s loaded=%.1fKB (%.2fms) pipelines=%u create=%.2fms threads=%u\n",
+        pipelineStats.isWarm ? "warm" : "cold", pipelineStats.loadedBytes / 1024.0, pipelineStats.loadMs,
+        pipelineStats.pipelineCount, pipelineStats.createMs, app.GetThreadPool()->GetThreadCount());
+      PrintMessage(buf);
+      const auto& shaderStats = app.GetShaderLibrary()->GetStatistics();
+      snprintf(buf, sizeof(buf), "ShaderLibrary loads=%u modules=%u compiled=%u cached=%u\n",
+        shaderStats.loadCount, shaderStats.moduleCount, shaderStats.compileCount, shaderStats.cacheHitCount);
+      PrintMessage(buf);
+
+      // ǂݖ߂҂̃t[͂ŕۑ.
+      app.Terminate();
+
+      if (!frameTimes.empty())
+      {
+        auto minmax = std::minmax_element(frameTimes.begin(), frameTimes.end());
+        auto averageMs = totalMs / frameTimes.size();
+        snprintf(buf, sizeof(buf),
+          "Headless %ux%u frames=%u init=%.2fms total=%.2fms avg=%.3fms (%.1f fps) cpu(min=%.3fms max=%.3fms) saved=%u\n",
+          options.width, options.height, options.frameCount,
+          initMs, totalMs, averageMs, 1000.0 / averageMs,
+          *minmax.first, *minmax.second, savedCount);
+        PrintMessage(buf);
+      }
+    }
+    catch (std::runtime_error e)
+    {
+      PrintMessage(e.what());
+      PrintMessage("\n");
+      return 1;
+    }
+    return 0;
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "VulkanAppBase.h"
+#include <string>
+#include <vector>
+
+namespace book_util
+{
+  // R}hCw肷wbhXs̐ݒ.
+  //  --headless         EBhE炸ɕ`悷
+  //  --frames N         `悷t[
+  //  --width W          `𑜓x(). 0 ͎󂯕tEBhEƓlƂ
+  //  --height H         `𑜓x(). 0 ͎󂯕tEBhEƓlƂ
+  //  --output DIR       ǂݖ߂t[ PPM `ŕۑfBNg
+  //  --fps N            1 t[̕`ŃAj[V 1/N bi߂ (Aj[VTv̂)
+  struct HeadlessOptions
+  {
+    bool enabled = false;
+    uint32_t frameCount = 60;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::string outputDir;
+    double frameRate = 30.0;
+  };
+
+  // wbhXsƃEBhE\̂ǂłgݒ.
+  //  --crowd N          f N ׂ̕ăCX^X`悷 (12_Animation ̂)
+  //  --frames-in-flight N  GPU ̊҂ɋL^łt[ (1-4, FramePacer gTv̂)
+  //  --present-mode MODE   fifo / fifo_relaxed / mailbox / immediate (EBhE\̂)
+  //  --swapchain-images N  Xbv`FC̃C[W (0 ͊)
+  //  --pipeline-cache MODE on / cold / off. cold ͕ۑς݂̃LbVǂ܂ɋN (ۑ͂)
+  //  --compile-shaders     .spv ̑ɃVF[_[̃\[XsɃRpC
+  //  --motion-cache        VMD ̕ϊʂ motion_cache fBNgɕۑĎ񂩂g (12_Animation ̂)
+  struct AppOptions
+  {
+    uint32_t crowdCount = 0;
+    uint32_t framesInFlight = 2;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t swapchainImageCount = 0;
+    PipelineManager::CacheMode pipelineCacheMode = PipelineManager::CacheMode::Enabled;
+    bool compileShaders = false;
+    bool motionCache = false;
+  };
+
+  HeadlessOptions ParseHeadlessOptions(int argc, char** argv, uint32_t defaultWidth, uint32_t defaultHeight);
+  AppOptions ParseAppOptions(int argc, char** argv);
+
+  // wt[`悵ďԂo͂. ߂l̓vZX̏IR[h.
+  int RunHeadless(VulkanAppBase& app, const HeadlessOptions& options, const AppOptions& appOptions, VkFormat format);
+}
@@ -0,0 +1,337 @@
+#include "HeadlessSwapchain.h"
+#include "VulkanBookUtil.h"
+#include <algorithm>
+
+static uint32_t GetBytesPerPixel(VkFormat format)
+{
+  switch (format)
+  {
+  case VK_FORMAT_R16G16B16A16_SFLOAT:
+  case VK_FORMAT_R16G16B16A16_UNORM:
+    return 8;
+  case VK_FORMAT_R32G32B32A32_SFLOAT:
+    return 16;
+  default:
+    return 4;
+  }
+}
+
+HeadlessSwapchain::HeadlessSwapchain(VkDevice device, VkQueue queue, uint32_t imageCount)
+  : Swapchain(VK_NULL_HANDLE, device, VK_NULL_HANDLE),
+  m_queue(queue), m_commandPool(VK_NULL_HANDLE),
+  m_nextIndex(0), m_frameNumber(0)
+{
+  SetImageCount(imageCount);
+}
+
+HeadlessSwapchain::~HeadlessSwapchain()
+{
+}
+
+void HeadlessSwapchain::Prepare(VkPhysicalDevice physDev, uint32_t graphicsQueueIndex, uint32_t width, uint32_t height, VkFormat desireFormat)
+{
+  // 蒼̏ꍇ͓ǂݖ߂r̂̂Ăj.
+  if (!m_slots.empty())
+  {
+    Flush();
+    DestroySlots();
+  }
+  vkGetPhysicalDeviceMemoryProperties(physDev, &m_memProps);
+
+  // `ƂĎgȂtH[}bg͕Ŵ̂ɒu.
+  VkFormatProperties formatProps;
+  vkGetPhysicalDeviceFormatProperties(physDev, desireFormat, &formatProps);
+  VkFormatFeatureFlags requestFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+  VkFormat format = desireFormat;
+  if ((formatProps.optimalTilingFeatures & requestFeatures) != requestFeatures)
+  {
+    format = VK_FORMAT_B8G8R8A8_UNORM;
+  }
+  m_selectFormat = VkSurfaceFormatKHR{ format, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+  m_surfaceExtent = VkExtent2D{ width, height };
+
+  VkResult result;
+  if (m_commandPool == VK_NULL_HANDLE)
+  {
+    VkCommandPoolCreateInfo cmdPoolCI{
+      VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+      nullptr,
+      VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+      graphicsQueueIndex
+    };
+    result = vkCreateCommandPool(m_device, &cmdPoolCI, nullptr, &m_commandPool);
+    ThrowIfFailed(result, "vkCreateCommandPool Failed.");
+  }
+
+  auto imageCount = (std::max)(2u, m_requestImageCount);
+  auto readbackSize = VkDeviceSize(width) * height * GetBytesPerPixel(format);
+  m_images.resize(imageCount);
+  m_imageViews.resize(imageCount);
+  m_slots.resize(imageCount);
+  for (uint32_t i = 0; i < imageCount; ++i)
+  {
+    auto& slot = m_slots[i];
+    VkImageCreateInfo imageCI{
+      VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      nullptr, 0,
+      VK_IMAGE_TYPE_2D,
+      format, { width, height, 1 },
+      1, 1, VK_SAMPLE_COUNT_1_BIT,
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+      VK_SHARING_MODE_EXCLUSIVE,
+      0, nullptr,
+      VK_IMAGE_LAYOUT_UNDEFINED
+    };
+    result = vkCreateImage(m_device, &imageCI, nullptr, &m_images[i]);
+    ThrowIfFailed(result, "vkCreateImage Failed.");
+
+    VkMemoryRequirements reqs;
+    vkGetImageMemoryRequirements(m_device, m_images[i], &reqs);
+    VkMemoryAllocateInfo info{
+      VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      nullptr,
+      reqs.size,
+      FindMemoryType(reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    result = vkAllocateMemory(m_device, &info, nullptr, &slot.imageMemory);
+    ThrowIfFailed(result, "vkAllocateMemory Failed.");
+    vkBindImageMemory(m_device, m_images[i], slot.imageMemory, 0);
+
+    VkImageViewCreateInfo viewCI{
+      VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      nullptr, 0,
+      m_images[i],
+      VK_IMAGE_VIEW_TYPE_2D,
+      format,
+      book_util::DefaultComponentMapping(),
+      { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+    };
+    result = vkCreateImageView(m_device, &viewCI, nullptr, &m_imageViews[i]);
+    ThrowIfFailed(result, "vkCreateImageView Failed.");
+
+    // ǂݖ߂p̃obt@. Ƀ}bv܂܂ɂĂ.
+    VkBufferCreateInfo bufferCI{
+      VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      nullptr, 0,
+      readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_SHARING_MODE_EXCLUSIVE,
+      0, nullptr
+    };
+    result = vkCreateBuffer(m_device, &bufferCI, nullptr, &slot.readbackBuffer);
+    ThrowIfFailed(result, "vkCreateBuffer Failed.");
+    vkGetBufferMemoryRequirements(m_device, slot.readbackBuffer, &reqs);
+    VkMemoryPropertyFlags hostProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    auto memoryType = FindMemoryType(reqs.memoryTypeBits, hostProps | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    if (memoryType == ~0u)
+    {
+      memoryType = FindMemoryType(reqs.memoryTypeBits, hostProps);
+    }
+    info.allocationSize = reqs.size;
+    info.memoryTypeIndex = memoryType;
+    result = vkAllocateMemory(m_device, &info, nullptr, &slot.readbackMemory);
+    ThrowIfFailed(result, "vkAllocateMemory Failed.");
+    vkBindBufferMemory(m_device, slot.readbackBuffer, slot.readbackMemory, 0);
+    result = vkMapMemory(m_device, slot.readbackMemory, 0, VK_WHOLE_SIZE, 0, &slot.mapped);
+    ThrowIfFailed(result, "vkMapMemory Failed.");
+
+    VkCommandBufferAllocateInfo commandAI{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      nullptr, m_commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      1
+    };
+    result = vkAllocateCommandBuffers(m_device, &commandAI, &slot.command);
+    ThrowIfFailed(result, "vkAllocateCommandBuffers Failed.");
+
+    VkFenceCreateInfo fenceCI{
+      VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+      nullptr, VK_FENCE_CREATE_SIGNALED_BIT
+    };
+    result = vkCreateFence(m_device, &fenceCI, nullptr, &slot.fence);
+    ThrowIfFailed(result, "vkCreateFence Failed.");
+    slot.pending = false;
+    slot.frameNumber = 0;
+  }
+  m_nextIndex = 0;
+  ResetPresentTimings();
+}
+
+void HeadlessSwapchain::Cleanup()
+{
+  if (m_device == VK_NULL_HANDLE)
+  {
+    return;
+  }
+  Flush();
+  DestroySlots();
+  if (m_commandPool != VK_NULL_HANDLE)
+  {
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    m_commandPool = VK_NULL_HANDLE;
+  }
+}
+
+VkResult HeadlessSwapchain::AcquireNextImage(uint32_t* pImageIndex, VkSemaphore semaphore, uint64_t timeout)
+{
+  auto index = m_nextIndex;
+  auto& slot = m_slots[index];
+
+  // ̃C[W̑O̓ǂݖ߂I܂ōėpłȂ.
+  auto result = vkWaitForFences(m_device, 1, &slot.fence, VK_TRUE, timeout);
+  if (result != VK_SUCCESS)
+  {
+    return result;
+  }
+  WaitSlot(slot, timeout);
+  BeginFrame();
+
+  // ʏ̃Xbv`FCƓlɎ擾Z}tHŒʒm.
+  VkSubmitInfo submitInfo{
+    VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    nullptr,
+    0, nullptr, nullptr,
+    0, nullptr,
+    1, &semaphore,
+  };
+  result = vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE);
+  ThrowIfFailed(result, "vkQueueSubmit Failed.");
+
+  m_nextIndex = (index + 1) % uint32_t(m_slots.size());
+  *pImageIndex = index;
+  OnImageAcquired(index);
+  return VK_SUCCESS;
+}
+
+void HeadlessSwapchain::QueuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitRenderComplete)
+{
+  auto present = BeginPresent(imageIndex);
+  auto& slot = m_slots[imageIndex];
+  auto command = slot.command;
+  vkResetFences(m_device, 1, &slot.fence);
+
+  VkCommandBufferBeginInfo beginInfo{
+    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    nullptr, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr
+  };
+  vkBeginCommandBuffer(command, &beginInfo);
+
+  VkImageMemoryBarrier imageBarrier{
+    VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+    nullptr,
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+    VK_ACCESS_TRANSFER_READ_BIT,
+    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+    m_images[imageIndex],
+    { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+  };
+  vkCmdPipelineBarrier(command,
+    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+    0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+  VkBufferImageCopy region{};
+  region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+  region.imageExtent = { m_surfaceExtent.width, m_surfaceExtent.height, 1 };
+  vkCmdCopyImageToBuffer(command,
+    m_images[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+    slot.readbackBuffer, 1, &region);
+
+  // ̕`̂߂ɃCAEg߂Ă.
+  imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  imageBarrier.dstAccessMask = 0;
+  imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  imageBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  VkBufferMemoryBarrier bufferBarrier{
+    VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+    nullptr,
+    VK_ACCESS_TRANSFER_WRITE_BIT,
+    VK_ACCESS_HOST_READ_BIT,
+    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+    slot.readbackBuffer, 0, VK_WHOLE_SIZE
+  };
+  vkCmdPipelineBarrier(command,
+    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+    0, 0, nullptr, 1, &bufferBarrier, 1, &imageBarrier);
+  vkEndCommandBuffer(command);
+
+  VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  VkSubmitInfo submitInfo{
+    VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    nullptr,
+    1, &waitRenderComplete,
+    &waitStageMask,
+    1, &command,
+    0, nullptr,
+  };
+  auto result = vkQueueSubmit(queue, 1, &submitInfo, slot.fence);
+  ThrowIfFailed(result, "vkQueueSubmit Failed.");
+
+  slot.pending = true;
+  slot.frameNumber = m_frameNumber++;
+  AddPresentTiming(present, GetTimeNs(), false);
+}
+
+void HeadlessSwapchain::Flush()
+{
+  // Ât[珇ɏ.
+  auto count = uint32_t(m_slots.size());
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    WaitSlot(m_slots[(m_nextIndex + i) % count], UINT64_MAX);
+  }
+}
+
+void HeadlessSwapchain::WaitSlot(Slot& slot, uint64_t timeout)
+{
+  if (!slot.pending)
+  {
+    return;
+  }
+  auto result = vkWaitForFences(m_device, 1, &slot.fence, VK_TRUE, timeout);
+  ThrowIfFailed(result, "vkWaitForFences Failed.");
+  slot.pending = false;
+
+  if (m_frameCallback)
+  {
+    FrameImage frame{
+      slot.frameNumber,
+      m_surfaceExtent.width, m_surfaceExtent.height,
+      m_surfaceExtent.width * GetBytesPerPixel(m_selectFormat.format),
+      m_selectFormat.format,
+      static_cast<const uint8_t*>(slot.mapped)
+    };
+    m_frameCallback(frame);
+  }
+}
+
+void HeadlessSwapchain::DestroySlots()
+{
+  for (uint32_t i = 0; i < uint32_t(m_slots.size()); ++i)
+  {
+    auto& slot = m_slots[i];
+    vkDestroyFence(m_device, slot.fence, nullptr);
+    vkFreeCommandBuffers(m_device, m_commandPool, 1, &slot.command);
+    vkUnmapMemory(m_device, slot.readbackMemory);
+    vkDestroyBuffer(m_device, slot.readbackBuffer, nullptr);
+    vkFreeMemory(m_device, slot.readbackMemory, nullptr);
+    vkDestroyImageView(m_device, m_imageViews[i], nullptr);
+    vkDestroyImage(m_device, m_images[i], nullptr);
+    vkFreeMemory(m_device, slot.imageMemory, nullptr);
+  }
+  m_slots.clear();
+  m_images.clear();
+  m_imageViews.clear();
+}
+
+uint32_t HeadlessSwapchain::FindMemoryType(uint32_t requestBits, VkMemoryPropertyFlags props) const
+{
+  for (uint32_t i = 0; i < m_memProps.memoryTypeCount; ++i)
+  {
+    if ((requestBits & (1u << i)) && (m_memProps.memoryTypes[i].propertyFlags & props) == props)
+    {
+      return i;
+    }
+  }
+  return ~0u;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "Swapchain.h"
+#include <functional>
+
+// EBhE(T[tF[X)ɃItXN[̃C[WɎg񂷃Xbv`FC.
+// Present ɕ`挋ʂzXg̃obt@֓ǂݖ߂.
+class HeadlessSwapchain : public Swapchain
+{
+public:
+  struct FrameImage
+  {
+    uint64_t frameNumber;
+    uint32_t width;
+    uint32_t height;
+    uint32_t rowPitch;
+    VkFormat format;
+    const uint8_t* pixels;
+  };
+  using FrameCallback = std::function<void(const FrameImage&)>;
+
+  HeadlessSwapchain(VkDevice device, VkQueue queue, uint32_t imageCount = 3);
+  virtual ~HeadlessSwapchain();
+
+  virtual void Prepare(VkPhysicalDevice physDev, uint32_t graphicsQueueIndex, uint32_t width, uint32_t height, VkFormat desireFormat);
+  virtual void Cleanup();
+
+  virtual VkResult AcquireNextImage(uint32_t* pImageIndex, VkSemaphore semaphore, uint64_t timeout = UINT64_MAX);
+  // x̌vł́Aǂݖ߂̃R}h𑗐M\̎Ƃ.
+  virtual void QueuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitRenderComplete);
+
+  // ǂݖ߂t[ƂɌĂяo.
+  void SetFrameCallback(FrameCallback callback) { m_frameCallback = callback; }
+
+  // ̓ǂݖ߂Sđ҂ăR[obN֓n.
+  void Flush();
+
+  uint64_t GetPresentedFrameCount() const { return m_frameNumber; }
+private:
+  struct Slot
+  {
+    VkDeviceMemory imageMemory;
+    VkBuffer readbackBuffer;
+    VkDeviceMemory readbackMemory;
+    void* mapped;
+    VkCommandBuffer command;
+    VkFence fence;
+    bool pending;
+    uint64_t frameNumber;
+  };
+  void DestroySlots();
+  void WaitSlot(Slot& slot, uint64_t timeout);
+  uint32_t FindMemoryType(uint32_t requestBits, VkMemoryPropertyFlags props) const;
+
+  VkQueue m_queue;
+  VkCommandPool m_commandPool;
+  VkPhysicalDeviceMemoryProperties m_memProps;
+  uint32_t m_nextIndex;
+  uint64_t m_frameNumber;
+  std::vector<Slot> m_slots;
+  FrameCallback m_frameCallback;
+};
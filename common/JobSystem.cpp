@@ -0,0 +1,222 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+JobGraph::JobId JobGraph::Add(std::function<void()> func, std::initializer_list<JobId> dependencies)
+{
+  return Add(std::move(func), std::vector<JobId>(dependencies));
+}
+
+JobGraph::JobId JobGraph::Add(std::function<void()> func, const std::vector<JobId>& dependencies)
+{
+  auto id = JobId(m_jobs.size());
+  m_jobs.emplace_back();
+  auto& job = m_jobs.back();
+  job.func = std::move(func);
+  job.graph = this;
+  for (auto dependency : dependencies)
+  {
+    m_jobs[dependency].successors.push_back(id);
+    ++job.dependencyCount;
+  }
+  return id;
+}
+
+void JobGraph::Clear()
+{
+  m_jobs.clear();
+  m_remaining = 0;
+}
+
+JobSystem::JobSystem(uint32_t threadCount) : m_nextQueue(0), m_signal(0), m_sleepCount(0), m_waitCount(0), m_stop(false)
+{
+  if (threadCount == 0)
+  {
+    auto hardwareThreads = std::thread::hardware_concurrency();
+    threadCount = (std::max)(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+  }
+  for (uint32_t i = 0; i < threadCount + 1; ++i)
+  {
+    m_queues.emplace_back(std::make_unique<WorkQueue>());
+  }
+  m_threads.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; ++i)
+  {
+    m_threads.emplace_back([this, i]() { WorkerMain(i); });
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_workCondition.notify_all();
+  for (auto& t : m_threads)
+  {
+    t.join();
+  }
+}
+
+void JobSystem::Dispatch(JobGraph& graph)
+{
+  // O̎sŊ҂WǔɁAñWucĂ邱Ƃ.
+  Wait(graph);
+
+  auto jobCount = uint32_t(graph.m_jobs.size());
+  graph.m_remaining = jobCount;
+  for (auto& job : graph.m_jobs)
+  {
+    job.remaining = job.dependencyCount;
+    job.done = false;
+  }
+  // ˑ̂ȂWu[J[̃L[֏ɔz.
+  auto workerCount = GetThreadCount();
+  for (auto& job : graph.m_jobs)
+  {
+    if (job.dependencyCount == 0)
+    {
+      Push(m_nextQueue, &job);
+      m_nextQueue = (m_nextQueue + 1) % workerCount;
+    }
+  }
+}
+
+void JobSystem::Wait(JobGraph& graph, JobGraph::JobId job)
+{
+  const auto& target = graph.m_jobs[job];
+  WaitUntil([&target]() { return target.done.load(); });
+}
+
+void JobSystem::Wait(JobGraph& graph)
+{
+  WaitUntil([&graph]() { return graph.m_remaining.load() == 0; });
+}
+
+template<class Predicate>
+void JobSystem::WaitUntil(Predicate isDone)
+{
+  // [J[ȊÕXbh͍Ō̃L[g.
+  auto queueIndex = uint32_t(m_queues.size() - 1);
+  while (!isDone())
+  {
+    auto signal = m_signal.load();
+    if (auto job = Pop(queueIndex))
+    {
+      Execute(queueIndex, job);
+      continue;
+    }
+    ++m_waitCount;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_doneCondition.wait(lock, [&]() { return isDone() || m_signal.load() != signal; });
+    }
+    --m_waitCount;
+  }
+}
+
+void JobSystem::WorkerMain(uint32_t index)
+{
+  while (!m_stop)
+  {
+    auto signal = m_signal.load();
+    if (auto job = Pop(index))
+    {
+      Execute(index, job);
+      continue;
+    }
+    ++m_sleepCount;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_workCondition.wait(lock, [&]() { return m_stop || m_signal.load() != signal; });
+    }
+    --m_sleepCount;
+  }
+}
+
+void JobSystem::Push(uint32_t queueIndex, Job* job)
+{
+  {
+    auto& queue = *m_queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back(job);
+  }
+  NotifyWork();
+}
+
+JobSystem::Job* JobSystem::Pop(uint32_t queueIndex)
+{
+  // ̃L[͍Ōɐς񂾂̂珈.
+  {
+    auto& queue = *m_queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.jobs.empty())
+    {
+      auto job = queue.jobs.back();
+      queue.jobs.pop_back();
+      return job;
+    }
+  }
+  // ̃L[͌Â̂D.
+  auto queueCount = uint32_t(m_queues.size());
+  for (uint32_t i = 1; i < queueCount; ++i)
+  {
+    auto& queue = *m_queues[(queueIndex + i) % queueCount];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.jobs.empty())
+    {
+      auto job = queue.jobs.front();
+      queue.jobs.pop_front();
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void JobSystem::Execute(uint32_t queueIndex, Job* job)
+{
+  if (job->func)
+  {
+    job->func();
+  }
+  auto graph = job->graph;
+  for (auto successor : job->successors)
+  {
+    auto& next = graph->m_jobs[successor];
+    if (--next.remaining == 0)
+    {
+      Push(queueIndex, &next);
+    }
+  }
+  // m_remaining  0 ɂȂ̓OtɐGȂ (ҋ@ĎsEjł悤).
+  job->done = true;
+  --graph->m_remaining;
+  NotifyDone();
+}
+
+void JobSystem::NotifyWork()
+{
+  ++m_signal;
+  if (m_sleepCount.load() > 0)
+  {
+    // ҋ@mFĂ疰܂ł̊ԂɒʒmȂ悤bNoR.
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_workCondition.notify_one();
+  }
+  if (m_waitCount.load() > 0)
+  {
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_doneCondition.notify_all();
+  }
+}
+
+void JobSystem::NotifyDone()
+{
+  ++m_signal;
+  if (m_waitCount.load() > 0)
+  {
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_doneCondition.notify_all();
+  }
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <initializer_list>
+
+// ˑ֌W̃WȕW܂.
+// xgݗĂOt JobSystem::Dispatch ŉxłsł.
+// WuQƂl(t[ԍȂ)́AWuQƂϐsOɏēn.
+class JobGraph
+{
+public:
+  using JobId = uint32_t;
+
+  JobGraph() : m_remaining(0) { }
+  JobGraph(const JobGraph&) = delete;
+  JobGraph& operator=(const JobGraph&) = delete;
+
+  // dependencies ̑SẴWu func sWuǉ.
+  JobId Add(std::function<void()> func, std::initializer_list<JobId> dependencies = {});
+  JobId Add(std::function<void()> func, const std::vector<JobId>& dependencies);
+
+  // sɌĂяoȂ.
+  void Clear();
+
+  uint32_t GetJobCount() const { return uint32_t(m_jobs.size()); }
+  bool IsComplete() const { return m_remaining.load() == 0; }
+  bool IsComplete(JobId job) const { return m_jobs[job].done.load(); }
+
+private:
+  friend class JobSystem;
+  struct Job
+  {
+    std::function<void()> func;
+    std::vector<JobId> successors;
+    uint32_t dependencyCount = 0;
+    std::atomic<uint32_t> remaining{ 0 }; // ̈ˑWu.
+    std::atomic<bool> done{ false };
+    JobGraph* graph = nullptr;
+  };
+  // vfړȂ悤 deque Ŏ.
+  std::deque<Job> m_jobs;
+  std::atomic<uint32_t> m_remaining;
+};
+
+// [NXeB[OŃWuXPW[[.
+// e[J[͎̃L[̖oAȂ瑼̃L[̐擪D.
+// WuˑWúÃ[J[̃L[֐ς܂̂őēRAŏ.
+class JobSystem
+{
+public:
+  // threadCount  0 ̏ꍇ̓n[hEFAXbh - 1 (Œ1) Ƃ.
+  explicit JobSystem(uint32_t threadCount = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  // Ot̎sJn. O̎sIĂȂΊ҂.
+  void Dispatch(JobGraph& graph);
+  // w̃Wu(܂̓OtS)̊҂. ҂Ԃ͌ĂяoXbhWu.
+  void Wait(JobGraph& graph, JobGraph::JobId job);
+  void Wait(JobGraph& graph);
+  // Dispatch đŜ̊҂.
+  void Run(JobGraph& graph)
+  {
+    Dispatch(graph);
+    Wait(graph);
+  }
+
+  uint32_t GetThreadCount() const { return uint32_t(m_threads.size()); }
+
+private:
+  using Job = JobGraph::Job;
+  struct WorkQueue
+  {
+    std::mutex mutex;
+    std::deque<Job*> jobs;
+  };
+
+  void WorkerMain(uint32_t index);
+  void Push(uint32_t queueIndex, Job* job);
+  Job* Pop(uint32_t queueIndex);
+  void Execute(uint32_t queueIndex, Job* job);
+  void NotifyWork();
+  void NotifyDone();
+  template<class Predicate>
+  void WaitUntil(Predicate isDone);
+
+  std::vector<std::thread> m_threads;
+  // [J[Ƃ̃L[. Ō 1 ̓[J[ȊÕXbhp.
+  std::vector<std::unique_ptr<WorkQueue>> m_queues;
+  uint32_t m_nextQueue;
+
+  // ĂXbhN߂̒ʒm. m_signal ̓Wu̒ǉÊтɐi.
+  std::mutex m_mutex;
+  std::condition_variable m_workCondition;
+  std::condition_variable m_doneCondition;
+  std::atomic<uint64_t> m_signal;
+  std::atomic<uint32_t> m_sleepCount;   // Ă郏[J[.
+  std::atomic<uint32_t> m_waitCount;    // Wait ŖĂXbh.
+  std::atomic<bool> m_stop;
+};
@@ -0,0 +1,206 @@
+#include "MorphEvaluator.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MORPH_EVALUATOR_AVX 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MORPH_EVALUATOR_SSE 1
+#endif
+
+namespace
+{
+  // pos[0..BlockSize) += delta[0..BlockSize) * w
+  // ʂvZƈv悤 FMA ͎gȂ.
+  inline void AccumulateBlock(float* pos, const float* delta, float w)
+  {
+#if defined(MORPH_EVALUATOR_AVX)
+    auto vw = _mm256_set1_ps(w);
+    _mm256_storeu_ps(pos, _mm256_add_ps(_mm256_loadu_ps(pos), _mm256_mul_ps(_mm256_loadu_ps(delta), vw)));
+#elif defined(MORPH_EVALUATOR_SSE)
+    auto vw = _mm_set1_ps(w);
+    _mm_storeu_ps(pos + 0, _mm_add_ps(_mm_loadu_ps(pos + 0), _mm_mul_ps(_mm_loadu_ps(delta + 0), vw)));
+    _mm_storeu_ps(pos + 4, _mm_add_ps(_mm_loadu_ps(pos + 4), _mm_mul_ps(_mm_loadu_ps(delta + 4), vw)));
+#else
+    for (uint32_t i = 0; i < MorphEvaluator::BlockSize; ++i)
+    {
+      pos[i] += delta[i] * w;
+    }
+#endif
+  }
+}
+
+void MorphEvaluator::Initialize(const uint32_t* vertexIndices, const glm::vec3* basePositions, uint32_t baseCount)
+{
+  auto blockCount = (baseCount + BlockSize - 1) / BlockSize;
+  auto paddedCount = blockCount * BlockSize;
+
+  m_vertexIndices.assign(vertexIndices, vertexIndices + baseCount);
+  m_baseX.assign(paddedCount, 0.0f);
+  m_baseY.assign(paddedCount, 0.0f);
+  m_baseZ.assign(paddedCount, 0.0f);
+  for (uint32_t i = 0; i < baseCount; ++i)
+  {
+    m_baseX[i] = basePositions[i].x;
+    m_baseY[i] = basePositions[i].y;
+    m_baseZ[i] = basePositions[i].z;
+  }
+  m_posX = m_baseX;
+  m_posY = m_baseY;
+  m_posZ = m_baseZ;
+
+  m_morphs.clear();
+  m_prevWeights.clear();
+  m_blockDirty.assign(blockCount, 0);
+  m_changedBlocks.clear();
+  m_changedBlocks.reserve(blockCount);
+  m_activeMorphCount = 0;
+}
+
+void MorphEvaluator::AddMorph(const uint32_t* baseIndices, const glm::vec3* offsets, uint32_t count)
+{
+  Morph morph;
+  // GubNԍɕׁAubN̈ʒuɍu.
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    if (baseIndices[i] < GetBaseCount())
+    {
+      morph.blocks.push_back(baseIndices[i] / BlockSize);
+    }
+  }
+  std::sort(morph.blocks.begin(), morph.blocks.end());
+  morph.blocks.erase(std::unique(morph.blocks.begin(), morph.blocks.end()), morph.blocks.end());
+
+  auto deltaCount = morph.blocks.size() * BlockSize;
+  morph.deltaX.assign(deltaCount, 0.0f);
+  morph.deltaY.assign(deltaCount, 0.0f);
+  morph.deltaZ.assign(deltaCount, 0.0f);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    auto baseIndex = baseIndices[i];
+    if (baseIndex >= GetBaseCount())
+    {
+      continue;
+    }
+    auto itr = std::lower_bound(morph.blocks.begin(), morph.blocks.end(), baseIndex / BlockSize);
+    auto slot = size_t(itr - morph.blocks.begin()) * BlockSize + baseIndex % BlockSize;
+    // _dēo^Ă΍𑫂킹.
+    morph.deltaX[slot] += offsets[i].x;
+    morph.deltaY[slot] += offsets[i].y;
+    morph.deltaZ[slot] += offsets[i].z;
+  }
+  m_morphs.emplace_back(std::move(morph));
+  m_prevWeights.push_back(0.0f);
+}
+
+bool MorphEvaluator::Evaluate(const float* weights)
+{
+  m_changedBlocks.clear();
+
+  // EFCgω[t̐GubNČvZ̑ΏۂƂ.
+  // O 0 ̃[t͂ŏO.
+  for (size_t m = 0; m < m_morphs.size(); ++m)
+  {
+    if (weights[m] == m_prevWeights[m])
+    {
+      continue;
+    }
+    for (auto block : m_morphs[m].blocks)
+    {
+      if (!m_blockDirty[block])
+      {
+        m_blockDirty[block] = 1;
+        m_changedBlocks.push_back(block);
+      }
+    }
+  }
+  if (m_changedBlocks.empty())
+  {
+    return false;
+  }
+
+  // ΏۃubNx[Xʒu֖߂.
+  for (auto block : m_changedBlocks)
+  {
+    auto offset = block * BlockSize;
+    memcpy(&m_posX[offset], &m_baseX[offset], sizeof(float) * BlockSize);
+    memcpy(&m_posY[offset], &m_baseY[offset], sizeof(float) * BlockSize);
+    memcpy(&m_posZ[offset], &m_baseZ[offset], sizeof(float) * BlockSize);
+  }
+
+  // EFCg 0 łȂ[t̍ΏۃubNɂ̂݉Z.
+  m_activeMorphCount = 0;
+  for (size_t m = 0; m < m_morphs.size(); ++m)
+  {
+    float w = weights[m];
+    m_prevWeights[m] = w;
+    if (w == 0.0f)
+    {
+      continue;
+    }
+    ++m_activeMorphCount;
+
+    const auto& morph = m_morphs[m];
+    for (size_t k = 0; k < morph.blocks.size(); ++k)
+    {
+      auto block = morph.blocks[k];
+      if (!m_blockDirty[block])
+      {
+        continue;
+      }
+      auto offset = block * BlockSize;
+      auto slot = k * BlockSize;
+      AccumulateBlock(&m_posX[offset], &morph.deltaX[slot], w);
+      AccumulateBlock(&m_posY[offset], &morph.deltaY[slot], w);
+      AccumulateBlock(&m_posZ[offset], &morph.deltaZ[slot], w);
+    }
+  }
+
+  for (auto block : m_changedBlocks)
+  {
+    m_blockDirty[block] = 0;
+  }
+  return true;
+}
+
+void MorphEvaluator::BuildVertexRanges(const std::vector<uint32_t>& blocks, uint32_t mergeGap, std::vector<Range>& ranges)
+{
+  ranges.clear();
+  m_scratch.clear();
+  for (auto block : blocks)
+  {
+    auto first = block * BlockSize;
+    auto last = std::min(first + BlockSize, GetBaseCount());
+    for (auto i = first; i < last; ++i)
+    {
+      m_scratch.push_back(m_vertexIndices[i]);
+    }
+  }
+  if (m_scratch.empty())
+  {
+    return;
+  }
+  std::sort(m_scratch.begin(), m_scratch.end());
+
+  Range range{ m_scratch[0], 1 };
+  for (size_t i = 1; i < m_scratch.size(); ++i)
+  {
+    auto index = m_scratch[i];
+    auto end = range.first + range.count;
+    if (index < end)
+    {
+      continue;
+    }
+    if (index - end <= mergeGap)
+    {
+      range.count = index - range.first + 1;
+      continue;
+    }
+    ranges.push_back(range);
+    range = Range{ index, 1 };
+  }
+  ranges.push_back(range);
+}
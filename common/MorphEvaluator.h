@@ -0,0 +1,70 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+// \[t CPU ŕ].
+//  BlockSize _̃ubNPʂ SoA ŕێASIMD ł܂Ƃ߂ĉZ.
+// O̕]EFCgω[tGubN݂̂ČvZ.
+class MorphEvaluator
+{
+public:
+  enum : uint32_t
+  {
+    BlockSize = 8, // AVX  1 WX^.
+  };
+  // _obt@̘A͈.
+  struct Range
+  {
+    uint32_t first;
+    uint32_t count;
+  };
+
+  // \̑ΏۂƂȂx[X_ݒ肷.
+  // vertexIndices ̓x[X_ɑΉ郂f_̔ԍ.
+  void Initialize(const uint32_t* vertexIndices, const glm::vec3* basePositions, uint32_t baseCount);
+  // \ǉ. baseIndices ̓x[X_̔ԍ. ǉEFCg̕тƂȂ.
+  void AddMorph(const uint32_t* baseIndices, const glm::vec3* offsets, uint32_t count);
+
+  // weights Kp. ČvZubNȂ false Ԃ.
+  bool Evaluate(const float* weights);
+  // O Evaluate ōČvZubN.
+  const std::vector<uint32_t>& GetChangedBlocks() const { return m_changedBlocks; }
+
+  // blocks Ɋ܂܂钸_f_̔ԍ͈̔͂ɂ܂Ƃ߂.
+  // Ԋu mergeGap _ȉ͈̔͂ 1 Ɍ.
+  void BuildVertexRanges(const std::vector<uint32_t>& blocks, uint32_t mergeGap, std::vector<Range>& ranges);
+
+  uint32_t GetBaseCount() const { return uint32_t(m_vertexIndices.size()); }
+  uint32_t GetBlockCount() const { return uint32_t(m_blockDirty.size()); }
+  uint32_t GetMorphCount() const { return uint32_t(m_morphs.size()); }
+  // O Evaluate ŉZ[t.
+  uint32_t GetActiveMorphCount() const { return m_activeMorphCount; }
+
+  uint32_t GetVertexIndex(uint32_t baseIndex) const { return m_vertexIndices[baseIndex]; }
+  glm::vec3 GetPosition(uint32_t baseIndex) const
+  {
+    return glm::vec3(m_posX[baseIndex], m_posY[baseIndex], m_posZ[baseIndex]);
+  }
+
+private:
+  struct Morph
+  {
+    std::vector<uint32_t> blocks;
+    // blocks[k] ̍ [k * BlockSize, (k+1) * BlockSize) Ɋi[.
+    std::vector<float> deltaX, deltaY, deltaZ;
+  };
+
+  std::vector<uint32_t> m_vertexIndices;
+  std::vector<float> m_baseX, m_baseY, m_baseZ;
+  std::vector<float> m_posX, m_posY, m_posZ;
+
+  std::vector<Morph> m_morphs;
+  std::vector<float> m_prevWeights;
+
+  std::vector<uint8_t>  m_blockDirty;
+  std::vector<uint32_t> m_changedBlocks;
+  std::vector<uint32_t> m_scratch;
+  uint32_t m_activeMorphCount = 0;
+};
@@ -0,0 +1,246 @@
+#include "PipelineManager.h"
+#include "ThreadPool.h"
+#include "VulkanBookUtil.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+
+namespace
+{
+  // 1 ̐ count - 1 ̓[J[ցAŌ 1 ͌ĂяõXbhōs.
+  // create(i)  i Ԗڂ̃pCvC𐶐ČʂԂ.
+  template<class Create>
+  void CreateInParallel(ThreadPool* threadPool, uint32_t count, Create create, VkResult* results)
+  {
+    if (threadPool == nullptr || count < 2)
+    {
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        results[i] = create(i);
+      }
+      return;
+    }
+    std::vector<std::future<VkResult>> futures;
+    futures.reserve(count - 1);
+    for (uint32_t i = 0; i < count - 1; ++i)
+    {
+      futures.push_back(threadPool->Submit([&create, i]() { return create(i); }));
+    }
+    results[count - 1] = create(count - 1);
+    for (uint32_t i = 0; i < count - 1; ++i)
+    {
+      results[i] = futures[i].get();
+    }
+  }
+
+  // 1 łsĂ΁AjĂ̌ʂԂ.
+  VkResult ReleaseIfFailed(VkDevice device, uint32_t count, const VkResult* results, VkPipeline* pipelines)
+  {
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      if (results[i] == VK_SUCCESS)
+      {
+        continue;
+      }
+      for (uint32_t j = 0; j < count; ++j)
+      {
+        if (results[j] == VK_SUCCESS)
+        {
+          vkDestroyPipeline(device, pipelines[j], nullptr);
+        }
+        pipelines[j] = VK_NULL_HANDLE;
+      }
+      return results[i];
+    }
+    return VK_SUCCESS;
+  }
+}
+
+PipelineManager::PipelineManager(VkDevice device, VkPhysicalDevice physicalDevice, ThreadPool* threadPool,
+  const std::string& fileName, CacheMode mode)
+  : m_device(device), m_threadPool(threadPool), m_fileName(fileName), m_mode(mode),
+  m_cache(VK_NULL_HANDLE), m_statistics()
+{
+  vkGetPhysicalDeviceProperties(physicalDevice, &m_properties);
+
+  book_util::StopWatch stopWatch;
+  std::vector<char> data;
+  if (m_mode == CacheMode::Enabled && LoadFile(data) && IsCompatible(data))
+  {
+    m_statistics.isWarm = true;
+    m_statistics.loadedBytes = data.size();
+  }
+  else
+  {
+    data.clear();
+  }
+
+  VkPipelineCacheCreateInfo cacheCI{
+    VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+    nullptr, 0,
+    data.size(), data.empty() ? nullptr : data.data()
+  };
+  auto result = vkCreatePipelineCache(m_device, &cacheCI, nullptr, &m_cache);
+  if (result != VK_SUCCESS && !data.empty())
+  {
+    // hCo[󂯕tȂꍇ͋̃LbVō蒼.
+    cacheCI.initialDataSize = 0;
+    cacheCI.pInitialData = nullptr;
+    m_statistics.isWarm = false;
+    m_statistics.loadedBytes = 0;
+    result = vkCreatePipelineCache(m_device, &cacheCI, nullptr, &m_cache);
+  }
+  ThrowIfFailed(result, "vkCreatePipelineCache Failed.");
+  m_statistics.loadMs = stopWatch.GetElapsedMs();
+}
+
+PipelineManager::~PipelineManager()
+{
+  if (m_cache != VK_NULL_HANDLE)
+  {
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+  }
+}
+
+void PipelineManager::CreateGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* createInfos, VkPipeline* pipelines)
+{
+  book_util::StopWatch stopWatch;
+  std::vector<VkResult> results(count);
+  CreateInParallel(m_threadPool, count, [&](uint32_t i) {
+    return vkCreateGraphicsPipelines(m_device, m_cache, 1, &createInfos[i], nullptr, &pipelines[i]);
+  }, results.data());
+  m_statistics.createMs += stopWatch.GetElapsedMs();
+  m_statistics.pipelineCount += count;
+
+  ThrowIfFailed(ReleaseIfFailed(m_device, count, results.data(), pipelines), "vkCreateGraphicsPipelines Failed.");
+}
+
+void PipelineManager::CreateComputePipelines(uint32_t count, const VkComputePipelineCreateInfo* createInfos, VkPipeline* pipelines)
+{
+  book_util::StopWatch stopWatch;
+  std::vector<VkResult> results(count);
+  CreateInParallel(m_threadPool, count, [&](uint32_t i) {
+    return vkCreateComputePipelines(m_device, m_cache, 1, &createInfos[i], nullptr, &pipelines[i]);
+  }, results.data());
+  m_statistics.createMs += stopWatch.GetElapsedMs();
+  m_statistics.pipelineCount += count;
+
+  ThrowIfFailed(ReleaseIfFailed(m_device, count, results.data(), pipelines), "vkCreateComputePipelines Failed.");
+}
+
+bool PipelineManager::Save()
+{
+  if (m_mode == CacheMode::Disabled || m_cache == VK_NULL_HANDLE)
+  {
+    return false;
+  }
+  size_t size = 0;
+  auto result = vkGetPipelineCacheData(m_device, m_cache, &size, nullptr);
+  if (result != VK_SUCCESS || size == 0)
+  {
+    return false;
+  }
+  std::vector<char> data(size);
+  result = vkGetPipelineCacheData(m_device, m_cache, &size, data.data());
+  if (result != VK_SUCCESS)
+  {
+    return false;
+  }
+  data.resize(size);
+
+  auto header = MakeHeader();
+  header.dataSize = data.size();
+  header.checksum = book_util::ComputeHash(data.data(), data.size());
+
+  // ݓrŏIĂÕt@CȂ悤Aꎞt@CɏĂu.
+  auto tempName = m_fileName + ".tmp";
+  {
+    std::ofstream outfile(tempName, std::ios::binary | std::ios::trunc);
+    if (!outfile)
+    {
+      return false;
+    }
+    outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outfile.write(data.data(), data.size());
+    if (!outfile)
+    {
+      outfile.close();
+      std::remove(tempName.c_str());
+      return false;
+    }
+  }
+  std::remove(m_fileName.c_str());
+  return std::rename(tempName.c_str(), m_fileName.c_str()) == 0;
+}
+
+PipelineManager::FileHeader PipelineManager::MakeHeader() const
+{
+  FileHeader header{};
+  header.magic = FileMagic;
+  header.version = FileVersion;
+  header.vendorID = m_properties.vendorID;
+  header.deviceID = m_properties.deviceID;
+  header.driverVersion = m_properties.driverVersion;
+  memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+  return header;
+}
+
+bool PipelineManager::LoadFile(std::vector<char>& data) const
+{
+  std::ifstream infile(m_fileName, std::ios::binary);
+  if (!infile)
+  {
+    return false;
+  }
+  FileHeader header;
+  if (!infile.read(reinterpret_cast<char*>(&header), sizeof(header)))
+  {
+    return false;
+  }
+
+  // ʂ̃foCXhCo[ōꂽLbV͎gȂ.
+  auto expected = MakeHeader();
+  if (header.magic != expected.magic || header.version != expected.version ||
+    header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+    header.driverVersion != expected.driverVersion ||
+    memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+  {
+    return false;
+  }
+  if (header.dataSize == 0 || header.dataSize > MaxFileSize)
+  {
+    return false;
+  }
+  data.resize(size_t(header.dataSize));
+  if (!infile.read(data.data(), data.size()))
+  {
+    return false;
+  }
+  return book_util::ComputeHash(data.data(), data.size()) == header.checksum;
+}
+
+bool PipelineManager::IsCompatible(const std::vector<char>& data) const
+{
+  // VkPipelineCacheHeaderVersionOne Ɠ.
+  struct CacheHeader
+  {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+  };
+  if (data.size() < sizeof(CacheHeader))
+  {
+    return false;
+  }
+  CacheHeader header;
+  memcpy(&header, data.data(), sizeof(header));
+  return header.headerSize >= sizeof(CacheHeader) && header.headerSize <= data.size() &&
+    header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+    header.vendorID == m_properties.vendorID &&
+    header.deviceID == m_properties.deviceID &&
+    memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
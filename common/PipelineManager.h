@@ -0,0 +1,82 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// pCvCLbVt@C֕ۑĎ̋NōėpApCvC[J[Xbhŕɐ.
+// t@C͓Ǝ̃wb_[ (foCX vendorID, deviceID, driverVersion, pipelineCacheUUID ƃf[^̃`FbNT) A
+// ǂݍݎɂ Vulkan ̃LbVwb_[݂̃foCXƏƍ.
+// vȂAĂt@C͎g킸ɋ̃LbVn߂ (R[hX^[g).
+// pCvC̐͑SẴLbVʂ. VkPipelineCache ͊OsvȂ̂ŕXbh瓯Ɏg.
+class PipelineManager
+{
+public:
+  enum class CacheMode
+  {
+    Enabled,  // ǂݍ݁AIɕۑ.
+    Cold,     // ̃t@Cǂ܂ɕۑ. R[hX^[ǧvp.
+    Disabled, // ǂݍ݂ۑȂ.
+  };
+  struct Statistics
+  {
+    bool isWarm;            // LȃLbVt@Cǂݍ.
+    size_t loadedBytes;
+    double loadMs;
+    uint32_t pipelineCount; // pCvC̐.
+    double createMs;        // pCvČĂяoɂԂ̍v.
+  };
+
+  PipelineManager(VkDevice device, VkPhysicalDevice physicalDevice, ThreadPool* threadPool,
+    const std::string& fileName, CacheMode mode);
+  ~PipelineManager();
+
+  PipelineManager(const PipelineManager&) = delete;
+  PipelineManager& operator=(const PipelineManager&) = delete;
+
+  // ݂ɈˑȂ count ̃pCvC𐶐ASĊĂ߂.
+  // 2 ȏ̏ꍇ̓[J[Xbhɕĕɐ. sꍇ͗O𓊂.
+  void CreateGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* createInfos, VkPipeline* pipelines);
+  void CreateComputePipelines(uint32_t count, const VkComputePipelineCreateInfo* createInfos, VkPipeline* pipelines);
+
+  // LbV̓et@C֏o. ۑȂ[hł͉Ȃ.
+  bool Save();
+
+  VkPipelineCache GetPipelineCache() const { return m_cache; }
+  CacheMode GetCacheMode() const { return m_mode; }
+  const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+  struct FileHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t checksum;
+  };
+  enum : uint32_t
+  {
+    FileMagic = 0x43505356, // "VSPC"
+    FileVersion = 1,
+    MaxFileSize = 256 * 1024 * 1024,
+  };
+
+  FileHeader MakeHeader() const;
+  bool LoadFile(std::vector<char>& data) const;
+  bool IsCompatible(const std::vector<char>& data) const;
+
+  VkDevice m_device;
+  VkPhysicalDeviceProperties m_properties;
+  ThreadPool* m_threadPool;
+  std::string m_fileName;
+  CacheMode m_mode;
+  VkPipelineCache m_cache;
+  Statistics m_statistics;
+};
@@ -0,0 +1,176 @@
+#include "PoseCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+PoseCache::MotionId PoseCache::AddMotion(std::shared_ptr<const Skeleton> skeleton, uint32_t morphCount, SampleFunction sample)
+{
+  auto motion = MotionId(m_motions.size());
+  m_motions.push_back(Motion{ std::move(skeleton), morphCount, std::move(sample) });
+  return motion;
+}
+
+void PoseCache::Clear()
+{
+  m_motions.clear();
+  m_poses.clear();
+  m_lookup.clear();
+  m_runtime.Clear();
+  m_pending.clear();
+  m_graph.Clear();
+  m_statistics = Statistics();
+}
+
+void PoseCache::BeginFrame()
+{
+  ++m_frameNumber;
+  m_pending.clear();
+  m_statistics = Statistics();
+}
+
+uint64_t PoseCache::MakeKey(MotionId motion, float frame)
+{
+  // -0  0 𓯂pƂ.
+  frame = frame == 0.0f ? 0.0f : frame;
+  uint32_t bits;
+  memcpy(&bits, &frame, sizeof(bits));
+  return (uint64_t(motion) << 32) | bits;
+}
+
+PoseCache::PoseId PoseCache::Request(MotionId motion, float frame)
+{
+  ++m_statistics.requestCount;
+  auto key = MakeKey(motion, frame);
+  auto itr = m_lookup.find(key);
+  if (itr != m_lookup.end())
+  {
+    auto& pose = m_poses[itr->second];
+    if (pose.lastUsed != m_frameNumber)
+    {
+      pose.lastUsed = m_frameNumber;
+      ++m_statistics.poseCount;
+      if (pose.evaluated)
+      {
+        ++m_statistics.reusedCount;
+      }
+      else
+      {
+        m_pending.push_back(itr->second);
+      }
+    }
+    return itr->second;
+  }
+
+  auto id = Allocate(motion);
+  auto& pose = m_poses[id];
+  pose.frame = frame;
+  pose.lastUsed = m_frameNumber;
+  pose.evaluated = false;
+  m_lookup.emplace(key, id);
+  m_pending.push_back(id);
+  ++m_statistics.poseCount;
+  return id;
+}
+
+PoseCache::PoseId PoseCache::Allocate(MotionId motion)
+{
+  const auto& skeleton = m_motions[motion].skeleton;
+  auto morphCount = m_motions[motion].morphCount;
+
+  // eʂɒBĂ΁Ãt[ŎgĂȂi̎p̂łÂ̂g.
+  // SĎgpȂeʂ𒴂Ēǉ.
+  if (m_poses.size() >= m_capacity)
+  {
+    auto oldest = PoseId(m_poses.size());
+    for (PoseId i = 0; i < PoseId(m_poses.size()); ++i)
+    {
+      const auto& pose = m_poses[i];
+      if (pose.lastUsed != m_frameNumber && m_motions[pose.motion].skeleton == skeleton &&
+        (oldest == m_poses.size() || pose.lastUsed < m_poses[oldest].lastUsed))
+      {
+        oldest = i;
+      }
+    }
+    if (oldest < m_poses.size())
+    {
+      auto& pose = m_poses[oldest];
+      m_lookup.erase(MakeKey(pose.motion, pose.frame));
+      pose.motion = motion;
+      pose.morphWeights.resize(morphCount);
+      return oldest;
+    }
+  }
+
+  Pose pose;
+  pose.motion = motion;
+  pose.instance = m_runtime.AddInstance(skeleton);
+  pose.skinMatrices.resize(skeleton->GetBoneCount());
+  pose.morphWeights.resize(morphCount);
+  m_poses.push_back(std::move(pose));
+  return PoseId(m_poses.size() - 1);
+}
+
+void PoseCache::Sample(Pose& pose)
+{
+  m_runtime.ResetPose(pose.instance);
+  std::fill(pose.morphWeights.begin(), pose.morphWeights.end(), 0.0f);
+  m_motions[pose.motion].sample(pose.frame, m_runtime, pose.instance, pose.morphWeights.data());
+}
+
+void PoseCache::Finish(Pose& pose)
+{
+  m_runtime.GetSkinMatrices(pose.instance, pose.skinMatrices.data(), uint32_t(pose.skinMatrices.size()));
+  pose.evaluated = true;
+}
+
+void PoseCache::Evaluate(JobSystem* jobSystem)
+{
+  // [VƂɃt[ɕׂ. TvOŐԂ瑱ĒT.
+  std::sort(m_pending.begin(), m_pending.end(), [this](PoseId a, PoseId b) {
+    const auto& pa = m_poses[a];
+    const auto& pb = m_poses[b];
+    return pa.motion != pb.motion ? pa.motion < pb.motion : pa.frame < pb.frame;
+  });
+
+  if (jobSystem == nullptr)
+  {
+    for (auto id : m_pending)
+    {
+      auto& pose = m_poses[id];
+      Sample(pose);
+      m_runtime.UpdateWorldMatrices(pose.instance);
+      m_runtime.SolveIK(pose.instance);
+      Finish(pose);
+    }
+  }
+  else
+  {
+    // [ṼTvO 1 ̃WuŏɍsAsXV IK ͎pƂ̃Wuɂ.
+    m_graph.Clear();
+    for (size_t first = 0; first < m_pending.size(); )
+    {
+      auto motion = m_poses[m_pending[first]].motion;
+      auto last = first;
+      while (last < m_pending.size() && m_poses[m_pending[last]].motion == motion)
+      {
+        ++last;
+      }
+      auto sample = m_graph.Add([this, first, last]() {
+        for (auto i = first; i < last; ++i)
+        {
+          Sample(m_poses[m_pending[i]]);
+        }
+      });
+      for (auto i = first; i < last; ++i)
+      {
+        auto id = m_pending[i];
+        auto update = m_runtime.AddUpdateJobs(m_graph, m_poses[id].instance, sample);
+        m_graph.Add([this, id]() { Finish(m_poses[id]); }, { update });
+      }
+      first = last;
+    }
+    jobSystem->Run(m_graph);
+  }
+  m_statistics.evaluatedCount += uint32_t(m_pending.size());
+  m_pending.clear();
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "AnimationRuntime.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// [V𓯂t[ōĐLN^[̎p 1 񂾂vZċL.
+// [V͍iƃTvO̊֐̑gƂēo^Ap ([V, t[) ň.
+// QÔ悤ɑ̃LN^[̃[VĐꍇAvZ͏dȂg̐ōς.
+//
+// 1 t[̗:
+//  1. BeginFrame()
+//  2. LN^[Ƃ Request(motion, frame) Ŏp̔ԍ𓾂.
+//  3. Evaluate() ŐVvꂽp݂̂vZ (p  TvO  sXV  IK  XLjOs).
+//  4. GetSkinMatrices(pose), GetMorphWeights(pose) `Ɏg.
+// p͖񏉊pvẐŁAg͏ɓʂɂȂ.
+// vZp capacity ܂Ŏ̃t[ȍ~cA炵čĐLN^[̗vɍėp.
+class PoseCache
+{
+public:
+  using MotionId = uint32_t;
+  using PoseId = uint32_t;
+  // runtime  instance ̃[Jp morphWeights (\̔ԍ)  frame ̒lɐݒ肷.
+  // ĂяoOɏp֖߂̂ŁAŌ̃L[߂gbÑL[̒lݒ肷邱.
+  // [V̊֐͓ɂ͌Ă΂Ȃ.
+  using SampleFunction = std::function<void(float frame, AnimationRuntime& runtime, AnimationRuntime::InstanceId instance, float* morphWeights)>;
+
+  explicit PoseCache(uint32_t capacity = 256) : m_capacity(capacity), m_frameNumber(0), m_statistics() { }
+
+  MotionId AddMotion(std::shared_ptr<const Skeleton> skeleton, uint32_t morphCount, SampleFunction sample);
+  void Clear();
+
+  void BeginFrame();
+  // motion  frame ̎pv. gɂ͓ԍԂ. ԍ͎ BeginFrame ܂ŗL.
+  PoseId Request(MotionId motion, float frame);
+  // ̃t[ŗvA܂vZĂȂpvZ.
+  // jobSystem w肷ƁA[VƂ̃TvOƎpƂ̍sXVEIK Wuŕɏ.
+  void Evaluate(JobSystem* jobSystem = nullptr);
+
+  // XLjOp̍s (̃{[ԍ̏) ƕ\[t̃EFCg. Evaluate ̌Ɏg.
+  const glm::mat4* GetSkinMatrices(PoseId pose) const { return m_poses[pose].skinMatrices.data(); }
+  uint32_t GetSkinMatrixCount(PoseId pose) const { return uint32_t(m_poses[pose].skinMatrices.size()); }
+  const float* GetMorphWeights(PoseId pose) const { return m_poses[pose].morphWeights.data(); }
+  const AnimationRuntime& GetRuntime() const { return m_runtime; }
+
+  // Õt[ (BeginFrame ) ̏Wv.
+  struct Statistics
+  {
+    uint32_t requestCount;   // Request ̉.
+    uint32_t poseCount;      // vꂽقȂp̐.
+    uint32_t reusedCount;    // ̂Õt[܂łɌvZς݂.
+    uint32_t evaluatedCount; // Evaluate ŌvZ.
+  };
+  const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+  struct Motion
+  {
+    std::shared_ptr<const Skeleton> skeleton;
+    uint32_t morphCount;
+    SampleFunction sample;
+  };
+  struct Pose
+  {
+    MotionId motion;
+    float frame;
+    AnimationRuntime::InstanceId instance;
+    uint64_t lastUsed;  // Ōɗvꂽ m_frameNumber.
+    bool evaluated;
+    std::vector<glm::mat4> skinMatrices;
+    std::vector<float> morphWeights;
+  };
+
+  static uint64_t MakeKey(MotionId motion, float frame);
+  PoseId Allocate(MotionId motion);
+  void Sample(Pose& pose);
+  void Finish(Pose& pose);
+
+  uint32_t m_capacity;
+  std::vector<Motion> m_motions;
+  std::vector<Pose> m_poses;
+  std::unordered_map<uint64_t, PoseId> m_lookup;
+  AnimationRuntime m_runtime; // pƂ 1 ̃CX^X.
+  uint64_t m_frameNumber;
+  std::vector<PoseId> m_pending; // ̃t[ŗvAvZ̎p.
+  JobGraph m_graph;
+  Statistics m_statistics;
+};
@@ -0,0 +1,342 @@
+#include "ShaderLibrary.h"
+#include "DeferredDeletionQueue.h"
+#include "VulkanBookUtil.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+
+namespace
+{
+  const char* GetStageExtension(VkShaderStageFlagBits stage)
+  {
+    switch (stage)
+    {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+      return "vert";
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+      return "frag";
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+      return "comp";
+    case VK_SHADER_STAGE_GEOMETRY_BIT:
+      return "geom";
+    case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:
+      return "tesc";
+    case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT:
+      return "tese";
+    default:
+      return nullptr;
+    }
+  }
+
+  // "modelVS.spv"  VERTEX  "modelVS.vert" 𓾂. CompileShaders.bat ƓΉ.
+  std::string GetSourcePath(const std::string& fileName, VkShaderStageFlagBits stage)
+  {
+    auto extension = GetStageExtension(stage);
+    auto pos = fileName.rfind(".spv");
+    if (extension == nullptr || pos == std::string::npos || pos + 4 != fileName.size())
+    {
+      return std::string();
+    }
+    return fileName.substr(0, pos + 1) + extension;
+  }
+
+  bool ReadFile(const std::string& path, std::vector<char>& data)
+  {
+    std::ifstream infile(path, std::ios::binary);
+    if (!infile)
+    {
+      return false;
+    }
+    data.resize(size_t(infile.seekg(0, std::ifstream::end).tellg()));
+    infile.seekg(0, std::ifstream::beg).read(data.data(), data.size());
+    return bool(infile) && !data.empty();
+  }
+
+  // t@CȂ -1.
+  int64_t GetModifiedTime(const std::string& path)
+  {
+#if defined(_WIN32)
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0)
+    {
+      return -1;
+    }
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+    {
+      return -1;
+    }
+#endif
+    return int64_t(st.st_mtime);
+  }
+}
+
+ShaderLibrary::ShaderLibrary(VkDevice device)
+  : m_device(device), m_deletionQueue(nullptr), m_lastPoll(std::chrono::steady_clock::now()), m_statistics()
+{
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+  for (auto& v : m_modules)
+  {
+    vkDestroyShaderModule(m_device, v.second.module, nullptr);
+  }
+}
+
+void ShaderLibrary::EnableSourceCompile(const std::string& cacheDirectory, const std::string& compiler)
+{
+  m_cacheDirectory = cacheDirectory;
+  m_compiler = compiler;
+#if defined(_WIN32)
+  _mkdir(m_cacheDirectory.c_str());
+#else
+  mkdir(m_cacheDirectory.c_str(), 0755);
+#endif
+}
+
+VkPipelineShaderStageCreateInfo ShaderLibrary::Load(const std::string& fileName, VkShaderStageFlagBits stage)
+{
+  ++m_statistics.loadCount;
+  auto itr = m_files.find(fileName);
+  if (itr == m_files.end())
+  {
+    File file{ fileName, stage, 0, VK_NULL_HANDLE };
+    if (IsSourceCompileEnabled())
+    {
+      auto sourcePath = GetSourcePath(fileName, stage);
+      if (!sourcePath.empty() && GetModifiedTime(sourcePath) >= 0)
+      {
+        file.path = sourcePath;
+      }
+    }
+    std::vector<char> code;
+    if (!ReadCode(file, code) && file.path != fileName)
+    {
+      // RpCłȂΗpӍς݂ .spv g.
+      file.path = fileName;
+      ReadCode(file, code);
+    }
+    file.module = code.empty() ? VK_NULL_HANDLE : Intern(code);
+    if (file.module == VK_NULL_HANDLE)
+    {
+      throw book_util::VulkanException("ShaderLibrary: failed to load " + fileName);
+    }
+    file.modifiedTime = GetModifiedTime(file.path);
+    itr = m_files.emplace(fileName, file).first;
+  }
+
+  VkPipelineShaderStageCreateInfo shaderStageCI{
+    VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+    nullptr, 0,
+    stage,
+    itr->second.module,
+    "main",
+    nullptr
+  };
+  return shaderStageCI;
+}
+
+void ShaderLibrary::Watch(const void* key, const Stages& stages, std::function<void()> rebuild)
+{
+  // ẽt@C 1 ̃W[L̂ŁAW[gSẴt@CĎ.
+  Watcher watcher;
+  for (const auto& stage : stages)
+  {
+    for (const auto& v : m_files)
+    {
+      if (v.second.module == stage.module &&
+        std::find(watcher.fileNames.begin(), watcher.fileNames.end(), v.first) == watcher.fileNames.end())
+      {
+        watcher.fileNames.push_back(v.first);
+      }
+    }
+  }
+  watcher.rebuild = std::move(rebuild);
+  m_watchers[key] = std::move(watcher);
+}
+
+uint32_t ShaderLibrary::PollChanges()
+{
+  auto now = std::chrono::steady_clock::now();
+  if (now - m_lastPoll < std::chrono::milliseconds(PollIntervalMs))
+  {
+    return 0;
+  }
+  m_lastPoll = now;
+
+  std::vector<std::string> changed;
+  std::vector<VkShaderModule> replaced;
+  for (auto& v : m_files)
+  {
+    auto& file = v.second;
+    auto time = GetModifiedTime(file.path);
+    if (time < 0 || time == file.modifiedTime)
+    {
+      continue;
+    }
+    file.modifiedTime = time;
+
+    // ݓrRpCG[̏ꍇ͑ÕW[̂܂܂ƂA̍XV҂.
+    std::vector<char> code;
+    if (!ReadCode(file, code))
+    {
+      continue;
+    }
+    auto module = Intern(code);
+    if (module == VK_NULL_HANDLE || module == file.module)
+    {
+      continue;
+    }
+    replaced.push_back(file.module);
+    file.module = module;
+    ++m_statistics.reloadCount;
+    changed.push_back(v.first);
+  }
+  if (changed.empty())
+  {
+    return 0;
+  }
+
+  // rebuild ̒ Watch Ă΂̂ŁAɏW߂ĂĂ.
+  std::vector<std::function<void()>> rebuilds;
+  for (const auto& v : m_watchers)
+  {
+    const auto& fileNames = v.second.fileNames;
+    auto affected = std::any_of(fileNames.begin(), fileNames.end(), [&](const std::string& name) {
+      return std::find(changed.begin(), changed.end(), name) != changed.end();
+    });
+    if (affected)
+    {
+      rebuilds.push_back(v.second.rebuild);
+    }
+  }
+  for (auto& rebuild : rebuilds)
+  {
+    rebuild();
+  }
+
+  // ÂpCvC͕`撆̃t[gIĂĵŁAW[L[Ōォj.
+  for (auto module : replaced)
+  {
+    Release(module);
+  }
+  return uint32_t(rebuilds.size());
+}
+
+bool ShaderLibrary::ReadCode(const File& file, std::vector<char>& code)
+{
+  auto pos = file.path.rfind(".spv");
+  if (pos != std::string::npos && pos + 4 == file.path.size())
+  {
+    return ReadFile(file.path, code);
+  }
+  return Compile(file.path, file.stage, code);
+}
+
+bool ShaderLibrary::Compile(const std::string& sourcePath, VkShaderStageFlagBits stage, std::vector<char>& code)
+{
+  auto extension = GetStageExtension(stage);
+  std::vector<char> source;
+  if (extension == nullptr || !ReadFile(sourcePath, source))
+  {
+    return false;
+  }
+
+  // Xe[Wƃ\[X̓eȂRpCʂȂ̂ŁÃnbV𖼑Oɂ.
+  auto hash = book_util::ComputeHash(source.data(), source.size(), book_util::ComputeHash(extension, strlen(extension)));
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.spv", (unsigned long long)hash);
+  auto cachePath = m_cacheDirectory + "/" + name;
+  if (ReadFile(cachePath, code))
+  {
+    ++m_statistics.cacheHitCount;
+    return true;
+  }
+
+  auto tempPath = cachePath + ".tmp";
+  auto command = "\"" + m_compiler + "\" -V -S " + extension + " \"" + sourcePath + "\" -o \"" + tempPath + "\"";
+#if defined(_WIN32)
+  // cmd.exe ͐擪Ɩ̈p菜ߑŜ͂.
+  command = "\"" + command + "\"";
+#endif
+  auto succeeded = std::system(command.c_str()) == 0 && ReadFile(tempPath, code);
+  if (!succeeded)
+  {
+    std::remove(tempPath.c_str());
+    book_util::OutputDebugMessage(("ShaderLibrary: failed to compile " + sourcePath + "\n").c_str());
+    return false;
+  }
+  std::remove(cachePath.c_str());
+  std::rename(tempPath.c_str(), cachePath.c_str());
+  ++m_statistics.compileCount;
+  return true;
+}
+
+VkShaderModule ShaderLibrary::Intern(const std::vector<char>& code)
+{
+  auto hash = book_util::ComputeHash(code.data(), code.size());
+  auto range = m_modules.equal_range(hash);
+  for (auto itr = range.first; itr != range.second; ++itr)
+  {
+    // nbVłeقȂΕʂ̃W[Ƃ.
+    if (itr->second.code == code)
+    {
+      return itr->second.module;
+    }
+  }
+
+  VkShaderModuleCreateInfo ci{
+    VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+    nullptr, 0,
+    code.size(),
+    reinterpret_cast<const uint32_t*>(code.data()),
+  };
+  VkShaderModule module;
+  if (vkCreateShaderModule(m_device, &ci, nullptr, &module) != VK_SUCCESS)
+  {
+    return VK_NULL_HANDLE;
+  }
+  ++m_statistics.moduleCount;
+  m_modules.emplace(hash, Module{ code, module });
+  return module;
+}
+
+void ShaderLibrary::Release(VkShaderModule module)
+{
+  for (const auto& v : m_files)
+  {
+    if (v.second.module == module)
+    {
+      return;
+    }
+  }
+  auto itr = std::find_if(m_modules.begin(), m_modules.end(), [&](const std::pair<const uint64_t, Module>& v) {
+    return v.second.module == module;
+  });
+  if (itr == m_modules.end())
+  {
+    return;
+  }
+  m_modules.erase(itr);
+
+  auto device = m_device;
+  if (m_deletionQueue != nullptr)
+  {
+    m_deletionQueue->Push([device, module]() { vkDestroyShaderModule(device, module, nullptr); });
+  }
+  else
+  {
+    vkDestroyShaderModule(device, module, nullptr);
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class DeferredDeletionQueue;
+
+// VF[_[W[ SPIR-V ̓ẽnbVŋLAt@C̍XVɍ킹ĈˑpCvC蒼.
+// - Load ͓t@CAe SPIR-V ɑ΂ē VkShaderModule Ԃ. e̓nbVŒTAv̂͒gׂ.
+//   W[̓CuAjCuōs (book_util::DestroyShaderModules ͌Ă΂Ȃ).
+// - EnableSourceCompile ̌ "xxx.spv" ̑ɁAÕ\[X (.vert/.frag/.comp)  glslangValidator ŃRpC.
+//   ʂ̓\[X̓ẽnbV𖼑OƂăLbVfBNgɒuAeԂ͍ĂуRpCȂ.
+//   \[XȂARpCɎsꍇ .spv g.
+// - Watch œo^pCvĆÃVF[_[̃t@C (\[XRpCꍇ̓\[XAȊO .spv) 
+//   XV PollChanges ̒ rebuild Ă΂. ύXꂽt@CĝΏۂƂȂ.
+//   ǂݒłǂ̃t@CgȂȂW[́Arebuild ̌ SetDeletionQueue ̃L[Ŕj.
+class ShaderLibrary
+{
+public:
+  using Stages = std::vector<VkPipelineShaderStageCreateInfo>;
+  struct Statistics
+  {
+    uint32_t loadCount;     // Load ̉.
+    uint32_t moduleCount;   // W[̐.
+    uint32_t compileCount;  // \[XRpC.
+    uint32_t cacheHitCount; // RpCς݂̃LbVg.
+    uint32_t reloadCount;   // XVoēǂݒt@C̐.
+  };
+
+  explicit ShaderLibrary(VkDevice device);
+  ~ShaderLibrary();
+
+  ShaderLibrary(const ShaderLibrary&) = delete;
+  ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+  // ŏ Load OɌĂяo. compiler  glslangValidator ̎st@C.
+  void EnableSourceCompile(const std::string& cacheDirectory, const std::string& compiler = "glslangValidator");
+  bool IsSourceCompileEnabled() const { return !m_cacheDirectory.empty(); }
+  // ݒ肷ƁAǂݒŒuW[蒼pCvCgn߂Ăj.
+  // ݒ肵Ȃꍇ rebuild ̒ɔj.
+  void SetDeletionQueue(DeferredDeletionQueue* deletionQueue) { m_deletionQueue = deletionQueue; }
+
+  VkPipelineShaderStageCreateInfo Load(const std::string& fileName, VkShaderStageFlagBits stage);
+
+  // key (pCvC̃nhAIuWFNg̃AhX) Ƃ 1 o^.
+  //  key ŌĂђƒûŁApCvC֐̒ŖĂł悢.
+  void Watch(const void* key, const Stages& stages, std::function<void()> rebuild);
+  // Ď̃t@C̍XV𒲂ׂ. PollIntervalMs ZԊǔĂяoł͉Ȃ.
+  // XVꂽt@CǂݒAgpCvC rebuild Ă. ߂l͌Ă񂾐.
+  uint32_t PollChanges();
+
+  const Statistics& GetStatistics() const { return m_statistics; }
+
+  enum
+  {
+    PollIntervalMs = 500,
+  };
+private:
+  struct File
+  {
+    std::string path;           // Ďt@C (\[X܂ .spv).
+    VkShaderStageFlagBits stage;
+    int64_t modifiedTime;
+    VkShaderModule module;
+  };
+  struct Module
+  {
+    std::vector<char> code;     // nbVvꍇɔׂ.
+    VkShaderModule module;
+  };
+  struct Watcher
+  {
+    std::vector<std::string> fileNames;
+    std::function<void()> rebuild;
+  };
+
+  // file.path  SPIR-V ǂ. \[Xł΃RpC.
+  bool ReadCode(const File& file, std::vector<char>& code);
+  bool Compile(const std::string& sourcePath, VkShaderStageFlagBits stage, std::vector<char>& code);
+  // ẽW[΂Ԃ. Ɏsꍇ VK_NULL_HANDLE.
+  VkShaderModule Intern(const std::vector<char>& code);
+  // ǂ̃t@CgĂȂ m_modules OĔj.
+  void Release(VkShaderModule module);
+
+  VkDevice m_device;
+  std::string m_cacheDirectory;
+  std::string m_compiler;
+  DeferredDeletionQueue* m_deletionQueue;
+  std::unordered_multimap<uint64_t, Module> m_modules;    // SPIR-V ̓ẽnbV.
+  std::unordered_map<std::string, File> m_files;          // Load ɓnꂽt@C.
+  std::unordered_map<const void*, Watcher> m_watchers;
+  std::chrono::steady_clock::time_point m_lastPoll;
+  Statistics m_statistics;
+};
@@ -0,0 +1,109 @@
+#include "Skeleton.h"
+
+#include <algorithm>
+#include <numeric>
+
+bool Skeleton::IsKneeBoneName(const std::string& name)
+{
+  // \[X̕񃊃e͎sZbg (GCC ł UTF-8) ɕϊ̂ŁAShift_JIS ̃oCgŔׂ.
+  return name.find("\x82\xd0\x82\xb4") != std::string::npos;
+}
+
+Skeleton::Skeleton(const std::vector<BoneDesc>& bones, const std::vector<IkChain>& ikChains)
+{
+  auto boneCount = uint32_t(bones.size());
+  auto parentOf = [&](uint32_t i) {
+    auto parent = bones[i].parent;
+    // ͈͊O⎩gwe̓[gƂĈ.
+    return (parent < 0 || uint32_t(parent) >= boneCount || uint32_t(parent) == i) ? int32_t(NoParent) : parent;
+  };
+
+  // [g̐[ŕׂΐe͕KqOɗ.
+  std::vector<uint32_t> depths(boneCount, 0);
+  for (uint32_t i = 0; i < boneCount; ++i)
+  {
+    uint32_t depth = 0;
+    for (auto p = parentOf(i); p != NoParent && depth <= boneCount; p = parentOf(uint32_t(p)))
+    {
+      ++depth;
+    }
+    // zĂ΃[gƂĈ.
+    depths[i] = depth > boneCount ? 0 : depth;
+  }
+  m_boneIndices.resize(boneCount);
+  std::iota(m_boneIndices.begin(), m_boneIndices.end(), 0u);
+  std::stable_sort(m_boneIndices.begin(), m_boneIndices.end(),
+    [&](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+
+  m_sortedIndices.resize(boneCount);
+  for (uint32_t i = 0; i < boneCount; ++i)
+  {
+    m_sortedIndices[m_boneIndices[i]] = i;
+  }
+
+  m_parents.resize(boneCount);
+  m_translations.resize(boneCount);
+  m_invBindMatrices.resize(boneCount);
+  for (uint32_t i = 0; i < boneCount; ++i)
+  {
+    auto bone = m_boneIndices[i];
+    auto parent = depths[bone] == 0 ? int32_t(NoParent) : parentOf(bone);
+    m_parents[i] = parent == NoParent ? parent : int32_t(m_sortedIndices[parent]);
+    m_translations[i] = bones[bone].translation;
+    m_invBindMatrices[i] = bones[bone].invBindMatrix;
+  }
+
+  m_ikChains = ikChains;
+  for (auto& chain : m_ikChains)
+  {
+    chain.target = m_sortedIndices[chain.target];
+    chain.effector = m_sortedIndices[chain.effector];
+    for (auto& link : chain.links)
+    {
+      link.bone = m_sortedIndices[link.bone];
+    }
+  }
+  BuildIkDependencies();
+}
+
+void Skeleton::BuildIkDependencies()
+{
+  // `FĈ̓N̉]ƃNEGtFN^E^[Qbg̍s.
+  // ǂݍނ̂͂̃{[ƑSĂ̑c̍s.
+  // ݂̏Ƒ̓ǂݍ݂dȂ`FC͌̏ŉ.
+  auto boneCount = GetBoneCount();
+  auto chainCount = uint32_t(m_ikChains.size());
+  std::vector<std::vector<uint32_t>> writes(chainCount);
+  std::vector<std::vector<bool>> reads(chainCount, std::vector<bool>(boneCount, false));
+  for (uint32_t i = 0; i < chainCount; ++i)
+  {
+    const auto& chain = m_ikChains[i];
+    writes[i] = { chain.effector, chain.target };
+    for (const auto& link : chain.links)
+    {
+      writes[i].push_back(link.bone);
+    }
+    for (auto bone : writes[i])
+    {
+      for (auto p = int32_t(bone); p != NoParent && !reads[i][p]; p = m_parents[p])
+      {
+        reads[i][p] = true;
+      }
+    }
+  }
+
+  auto overlaps = [&](uint32_t a, uint32_t b) {
+    return std::any_of(writes[a].begin(), writes[a].end(), [&](uint32_t bone) { return reads[b][bone]; });
+  };
+  m_ikDependencies.assign(chainCount, {});
+  for (uint32_t i = 0; i < chainCount; ++i)
+  {
+    for (uint32_t j = 0; j < i; ++j)
+    {
+      if (overlaps(i, j) || overlaps(j, i))
+      {
+        m_ikDependencies[i].push_back(j);
+      }
+    }
+  }
+}
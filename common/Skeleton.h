@@ -0,0 +1,70 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <string>
+
+// Aj[Vp̍i̒`.
+// {[͐eKqOɗ悤בւAe̔ԍ̔zƂĕێ.
+// Ŏ󂯎{[̔ԍ͌(f)ԍƂ.
+class Skeleton
+{
+public:
+  enum : int32_t
+  {
+    NoParent = -1,
+  };
+  struct BoneDesc
+  {
+    int32_t parent;         // e{[̔ԍ. Ȃ NoParent.
+    glm::vec3 translation;  // ȇΈʒu(p).
+    glm::mat4 invBindMatrix;
+  };
+  struct IkLink
+  {
+    uint32_t bone;
+    bool kneeConstraint;    // X ̉]̂݋(Ђ).
+  };
+  struct IkChain
+  {
+    uint32_t target;
+    uint32_t effector;
+    std::vector<IkLink> links; // GtFN^ɋ߂.
+    uint32_t iterationCount;
+    float angleLimit;
+  };
+
+  Skeleton(const std::vector<BoneDesc>& bones, const std::vector<IkChain>& ikChains);
+
+  // PMD ̃{[ (Shift_JIS)  "Ђ" ܂߂ true. IkLink::kneeConstraint ̔Ɏg.
+  static bool IsKneeBoneName(const std::string& name);
+
+  uint32_t GetBoneCount() const { return uint32_t(m_parents.size()); }
+
+  // ̔ԍƕבւ̔ԍ̕ϊ.
+  uint32_t GetSortedIndex(uint32_t bone) const { return m_sortedIndices[bone]; }
+  uint32_t GetBoneIndex(uint32_t sortedIndex) const { return m_boneIndices[sortedIndex]; }
+
+  // ȉ͕בւ̔ԍ̏.
+  const std::vector<int32_t>& GetParents() const { return m_parents; }
+  const std::vector<glm::vec3>& GetTranslations() const { return m_translations; }
+  const std::vector<glm::mat4>& GetInvBindMatrices() const { return m_invBindMatrices; }
+  // {[̔ԍ͕בւ̂. т͌ IK ̏.
+  const std::vector<IkChain>& GetIkChains() const { return m_ikChains; }
+  // i Ԗڂ̃`FCɉKv̂`FC̔ԍ.
+  // ݂̌ʂɉeȂ`FC(ȆȂ)͕ɉĂ悢.
+  const std::vector<std::vector<uint32_t>>& GetIkDependencies() const { return m_ikDependencies; }
+
+private:
+  void BuildIkDependencies();
+
+  std::vector<uint32_t> m_sortedIndices;
+  std::vector<uint32_t> m_boneIndices;
+
+  std::vector<int32_t> m_parents;
+  std::vector<glm::vec3> m_translations;
+  std::vector<glm::mat4> m_invBindMatrices;
+  std::vector<IkChain> m_ikChains;
+  std::vector<std::vector<uint32_t>> m_ikDependencies;
+};
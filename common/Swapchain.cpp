@@ -1,9 +1,20 @@
 #include "Swapchain.h"
 #include "VulkanBookUtil.h"
+#include "DeferredDeletionQueue.h"
 #include <algorithm>
+#include <chrono>
+
+// \ (actualPresentTime)  CLOCK_MONOTONIC ̒lłAsteady_clock Ɣׂ.
+// Windows ł͎̊܂Ȃߎg킸AvkQueuePresentKHR ̖߂\̎Ƃ.
+#if defined(VK_GOOGLE_display_timing) && !defined(_WIN32)
+#define USE_DISPLAY_TIMING
+#endif
 
 Swapchain::Swapchain(VkInstance instance, VkDevice device, VkSurfaceKHR surface)
-  : m_swapchain(VK_NULL_HANDLE), m_surface(surface), m_vkInstance(instance), m_device(device), m_presentMode(VK_PRESENT_MODE_FIFO_KHR)
+  : m_swapchain(VK_NULL_HANDLE), m_surface(surface), m_vkInstance(instance), m_device(device), m_presentMode(VK_PRESENT_MODE_FIFO_KHR),
+  m_requestPresentMode(VK_PRESENT_MODE_FIFO_KHR), m_requestImageCount(0), m_deletionQueue(nullptr),
+  m_isDisplayTimingEnabled(false), m_getPastPresentationTiming(nullptr), m_nextPresentId(1),
+  m_latency(), m_refreshDurationMs(0.0)
 {
 }
 
@@ -46,7 +57,19 @@ void Swapchain::Prepare(VkPhysicalDevice physDev, uint32_t graphicsQueueIndex, u
     throw book_util::VulkanException("vkGetPhysicalDeviceSurfaceSupportKHR: isSupport = false.");
   }
 
-  auto imageCount = (std::max)(2u, m_surfaceCaps.minImageCount);
+  m_presentMode = SelectPresentMode(physDev);
+
+  // MAILBOX ͕\҂ 1 uȂ`𑱂邽߁A 3 Ƃ.
+  auto imageCount = m_requestImageCount;
+  if (imageCount == 0)
+  {
+    imageCount = m_presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3u : 2u;
+  }
+  imageCount = (std::max)(imageCount, m_surfaceCaps.minImageCount);
+  if (m_surfaceCaps.maxImageCount > 0)
+  {
+    imageCount = (std::min)(imageCount, m_surfaceCaps.maxImageCount);
+  }
   auto extent = m_surfaceCaps.currentExtent;
   if (extent.width == ~0u)
   {
@@ -81,13 +104,29 @@ void Swapchain::Prepare(VkPhysicalDevice physDev, uint32_t graphicsQueueIndex, u
   ThrowIfFailed(result, "vkCreateSwapchainKHR Failed.");
 
   // Â\[X.
+  // 폜L[΁A`撆̃t[҂AÂC[Wւ̕`悪IĂj.
   if (oldSwapchain != VK_NULL_HANDLE)
   {
-    for (auto& view : m_imageViews)
+    if (m_deletionQueue != nullptr)
     {
-      vkDestroyImageView(m_device, view, nullptr);
+      auto device = m_device;
+      auto oldViews = m_imageViews;
+      m_deletionQueue->Push([device, oldSwapchain, oldViews]() {
+        for (auto view : oldViews)
+        {
+          vkDestroyImageView(device, view, nullptr);
+        }
+        vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+      });
+    }
+    else
+    {
+      for (auto& view : m_imageViews)
+      {
+        vkDestroyImageView(m_device, view, nullptr);
+      }
+      vkDestroySwapchainKHR(m_device, oldSwapchain, nullptr);
     }
-    vkDestroySwapchainKHR(m_device, oldSwapchain, nullptr);
     m_imageViews.clear();
     m_images.clear();
   }
@@ -112,6 +151,22 @@ void Swapchain::Prepare(VkPhysicalDevice physDev, uint32_t graphicsQueueIndex, u
     result = vkCreateImageView(m_device, &viewCI, nullptr, &m_imageViews[i]);
     ThrowIfFailed(result, "vkCreateImageView Failed.");
   }
+  ResetPresentTimings();
+
+#if defined(USE_DISPLAY_TIMING)
+  if (m_isDisplayTimingEnabled)
+  {
+    m_getPastPresentationTiming = vkGetDeviceProcAddr(m_device, "vkGetPastPresentationTimingGOOGLE");
+    auto getRefreshCycleDuration = reinterpret_cast<PFN_vkGetRefreshCycleDurationGOOGLE>(
+      vkGetDeviceProcAddr(m_device, "vkGetRefreshCycleDurationGOOGLE"));
+    VkRefreshCycleDurationGOOGLE refreshCycle{};
+    if (getRefreshCycleDuration != nullptr &&
+      getRefreshCycleDuration(m_device, m_swapchain, &refreshCycle) == VK_SUCCESS)
+    {
+      m_refreshDurationMs = refreshCycle.refreshDuration / 1000000.0;
+    }
+  }
+#endif
 }
 
 void Swapchain::Cleanup()
@@ -137,16 +192,31 @@ void Swapchain::Cleanup()
 
   m_images.clear();
   m_imageViews.clear();
+  m_pendingPresents.clear();
+}
+
+void Swapchain::BeginFrame()
+{
+  if (m_deletionQueue != nullptr)
+  {
+    m_deletionQueue->Collect();
+  }
 }
 
 VkResult Swapchain::AcquireNextImage(uint32_t* pImageIndex, VkSemaphore semaphore, uint64_t timeout)
 {
+  BeginFrame();
   auto result = vkAcquireNextImageKHR(m_device, m_swapchain, timeout, semaphore, VK_NULL_HANDLE, pImageIndex);
+  if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+  {
+    OnImageAcquired(*pImageIndex);
+  }
   return result;
 }
 
 void Swapchain::QueuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitRenderComplete)
 {
+  auto present = BeginPresent(imageIndex);
   VkPresentInfoKHR presentInfo{
     VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
     nullptr,
@@ -154,6 +224,171 @@ void Swapchain::QueuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore wai
     1, &m_swapchain,
     &imageIndex
   };
+#if defined(USE_DISPLAY_TIMING)
+  // ォ\悤A񎦂ɔԍt.
+  VkPresentTimeGOOGLE presentTime{ present.presentId, 0 };
+  VkPresentTimesInfoGOOGLE presentTimesInfo{
+    VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE,
+    nullptr,
+    1, &presentTime
+  };
+  if (m_getPastPresentationTiming != nullptr)
+  {
+    presentInfo.pNext = &presentTimesInfo;
+  }
+#endif
   vkQueuePresentKHR(queue, &presentInfo);
+
+  if (m_getPastPresentationTiming != nullptr)
+  {
+    m_pendingPresents.push_back(present);
+    CollectDisplayTimings();
+  }
+  else
+  {
+    AddPresentTiming(present, GetTimeNs(), false);
+  }
+}
+
+const char* Swapchain::GetPresentModeName(VkPresentModeKHR mode)
+{
+  switch (mode)
+  {
+  case VK_PRESENT_MODE_IMMEDIATE_KHR:
+    return "IMMEDIATE";
+  case VK_PRESENT_MODE_MAILBOX_KHR:
+    return "MAILBOX";
+  case VK_PRESENT_MODE_FIFO_KHR:
+    return "FIFO";
+  case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+    return "FIFO_RELAXED";
+  default:
+    return "UNKNOWN";
+  }
+}
+
+VkPresentModeKHR Swapchain::SelectPresentMode(VkPhysicalDevice physDev) const
+{
+  uint32_t count = 0;
+  vkGetPhysicalDeviceSurfacePresentModesKHR(physDev, m_surface, &count, nullptr);
+  std::vector<VkPresentModeKHR> modes(count);
+  vkGetPhysicalDeviceSurfacePresentModesKHR(physDev, m_surface, &count, modes.data());
+
+  // v[hꍇ́A҂ȂƂ_̂Ɏ.
+  VkPresentModeKHR candidates[] = { m_requestPresentMode, m_requestPresentMode };
+  if (m_requestPresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+  {
+    candidates[1] = VK_PRESENT_MODE_IMMEDIATE_KHR;
+  }
+  else if (m_requestPresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+  {
+    candidates[1] = VK_PRESENT_MODE_MAILBOX_KHR;
+  }
+  for (auto mode : candidates)
+  {
+    if (std::find(modes.begin(), modes.end(), mode) != modes.end())
+    {
+      return mode;
+    }
+  }
+  // FIFO ͑SĂ̎Ŏg.
+  return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+uint64_t Swapchain::GetTimeNs()
+{
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+void Swapchain::ResetPresentTimings()
+{
+  m_acquireTimes.assign(m_images.size(), 0);
+  m_pendingPresents.clear();
+  m_presentTimings.clear();
+  m_latency = LatencyStatistics();
+}
+
+Swapchain::PendingPresent Swapchain::BeginPresent(uint32_t imageIndex)
+{
+  PendingPresent present{ m_nextPresentId++, m_acquireTimes[imageIndex], GetTimeNs() };
+  return present;
+}
+
+void Swapchain::AddPresentTiming(const PendingPresent& present, uint64_t presentNs, bool isDisplayTime)
+{
+  auto toMs = [presentNs](uint64_t ns) { return ns < presentNs ? (presentNs - ns) / 1000000.0 : 0.0; };
+  PresentTiming timing{
+    present.presentId,
+    toMs(present.acquireNs),
+    toMs(present.submitNs),
+    isDisplayTime
+  };
+  m_presentTimings.push_back(timing);
+  if (m_presentTimings.size() > RecentTimingCount)
+  {
+    m_presentTimings.pop_front();
+  }
+
+  auto count = ++m_latency.frameCount;
+  m_latency.acquireToPresentMs += (timing.acquireToPresentMs - m_latency.acquireToPresentMs) / count;
+  m_latency.submitToPresentMs += (timing.submitToPresentMs - m_latency.submitToPresentMs) / count;
+  m_latency.maxSubmitToPresentMs = (std::max)(m_latency.maxSubmitToPresentMs, timing.submitToPresentMs);
+}
+
+Swapchain::LatencyStatistics Swapchain::GetRecentLatencyStatistics() const
+{
+  LatencyStatistics stats{};
+  for (const auto& timing : m_presentTimings)
+  {
+    stats.acquireToPresentMs += timing.acquireToPresentMs;
+    stats.submitToPresentMs += timing.submitToPresentMs;
+    stats.maxSubmitToPresentMs = (std::max)(stats.maxSubmitToPresentMs, timing.submitToPresentMs);
+  }
+  stats.frameCount = uint32_t(m_presentTimings.size());
+  if (stats.frameCount > 0)
+  {
+    stats.acquireToPresentMs /= stats.frameCount;
+    stats.submitToPresentMs /= stats.frameCount;
+  }
+  return stats;
+}
+
+void Swapchain::CollectDisplayTimings()
+{
+#if defined(USE_DISPLAY_TIMING)
+  auto getPastPresentationTiming = reinterpret_cast<PFN_vkGetPastPresentationTimingGOOGLE>(m_getPastPresentationTiming);
+  VkPastPresentationTimingGOOGLE timings[16];
+  VkResult result;
+  do
+  {
+    uint32_t count = _countof(timings);
+    result = getPastPresentationTiming(m_device, m_swapchain, &count, timings);
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE)
+    {
+      break;
+    }
+    // \͒񎦂ɓ͂. ԍ񂾂͕̂\Ȃ (uꂽ) ̂ƂĎ̂Ă.
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      const auto& timing = timings[i];
+      while (!m_pendingPresents.empty() && m_pendingPresents.front().presentId < timing.presentID)
+      {
+        m_pendingPresents.pop_front();
+      }
+      if (!m_pendingPresents.empty() && m_pendingPresents.front().presentId == timing.presentID)
+      {
+        AddPresentTiming(m_pendingPresents.front(), timing.actualPresentTime, true);
+        m_pendingPresents.pop_front();
+      }
+    }
+  } while (result == VK_INCOMPLETE);
+
+  // ͂Ȃ܂܎ĉ͌ÂɎ̂Ă.
+  while (m_pendingPresents.size() > RecentTimingCount)
+  {
+    m_pendingPresents.pop_front();
+  }
+#endif
 }
 
@@ -2,20 +2,33 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <deque>
+
+class DeferredDeletionQueue;
 
 class Swapchain
 {
 public:
   Swapchain(VkInstance instance, VkDevice device, VkSurfaceKHR surface);
-  ~Swapchain();
+  virtual ~Swapchain();
+
+  // Prepare OɌĂяo. gȂ[hw肵ꍇ͋߂̂IсAŌ FIFO ɂ.
+  void SetPresentMode(VkPresentModeKHR mode) { m_requestPresentMode = mode; }
+  // Prepare OɌĂяo. 0 ̓[hɍ킹̐. T[tF[X̍ŏAő͈̔͂Ɏ߂.
+  void SetImageCount(uint32_t count) { m_requestImageCount = count; }
+  // foCX VK_GOOGLE_display_timing Lɂꍇ true ƂAx̌vɎۂ̕\g.
+  void SetDisplayTimingEnabled(bool enabled) { m_isDisplayTimingEnabled = enabled; }
+  // w肷ƁA蒼 (Prepare  2 ڈȍ~) ŌÂXbv`FCƃC[Wr[
+  // `撆̃t[gIĂj. AcquireNextImage ̂т BeginFrame  Collect Ă.
+  void SetDeletionQueue(DeferredDeletionQueue* deletionQueue) { m_deletionQueue = deletionQueue; }
 
-  void Prepare(VkPhysicalDevice physDev, uint32_t graphicsQueueIndex, uint32_t width, uint32_t height, VkFormat desireFormat);
-  void Cleanup();
+  virtual void Prepare(VkPhysicalDevice physDev, uint32_t graphicsQueueIndex, uint32_t width, uint32_t height, VkFormat desireFormat);
+  virtual void Cleanup();
 
-  VkResult AcquireNextImage(uint32_t* pImageIndex, VkSemaphore semaphore, uint64_t timeout = UINT64_MAX);
+  virtual VkResult AcquireNextImage(uint32_t* pImageIndex, VkSemaphore semaphore, uint64_t timeout = UINT64_MAX);
 
 
-  void QueuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitRenderComplete);
+  virtual void QueuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitRenderComplete);
 
   VkSurfaceFormatKHR GetSurfaceFormat() const { return m_selectFormat; }
 
@@ -25,7 +38,54 @@ public:
   VkImage GetImage(int index) { return m_images[index]; };
 
   VkSurfaceKHR GetSurface() const { return m_surface; }
-private:
+  VkPresentModeKHR GetPresentMode() const { return m_presentMode; }
+  static const char* GetPresentModeName(VkPresentModeKHR mode);
+
+  // 1 t[̒x. ͑S CPU  std::chrono::steady_clock Ŕׂ.
+  struct PresentTiming
+  {
+    uint32_t presentId;        // 1 .
+    double acquireToPresentMs; // AcquireNextImage ̖߂肩\܂.
+    double submitToPresentMs;  // QueuePresent ̌Ăяo (`R}h̑M) \܂.
+    bool isDisplayTime;        // true Ȃ\͎ۂɕ\ꂽ. false Ȃ vkQueuePresentKHR ̖߂.
+  };
+  struct LatencyStatistics
+  {
+    uint32_t frameCount;
+    double acquireToPresentMs; // .
+    double submitToPresentMs;  // .
+    double maxSubmitToPresentMs;
+  };
+  // \͐t[xē͂߁AL^͒񎦂ɒxĒǉ.
+  const std::deque<PresentTiming>& GetPresentTimings() const { return m_presentTimings; }
+  // ߂̋L^ (ő RecentTimingCount t[) ƁAPrepare ̑SĂ̋L^̏Wv.
+  LatencyStatistics GetRecentLatencyStatistics() const;
+  const LatencyStatistics& GetLatencyStatistics() const { return m_latency; }
+  // 1 ̃tbV̊Ԋu. 擾łȂꍇ 0.
+  double GetRefreshDurationMs() const { return m_refreshDurationMs; }
+
+  enum
+  {
+    RecentTimingCount = 120,
+  };
+protected:
+  struct PendingPresent
+  {
+    uint32_t presentId;
+    uint64_t acquireNs;
+    uint64_t submitNs;
+  };
+  static uint64_t GetTimeNs();
+  // C[W̐܂ɌĂяoAv̏Ԃ.
+  void ResetPresentTimings();
+  // t[̏. hNX AcquireNextImage ŃC[W擾OɌĂяo.
+  void BeginFrame();
+  void OnImageAcquired(uint32_t imageIndex) { m_acquireTimes[imageIndex] = GetTimeNs(); }
+  PendingPresent BeginPresent(uint32_t imageIndex);
+  void AddPresentTiming(const PendingPresent& present, uint64_t presentNs, bool isDisplayTime);
+  VkPresentModeKHR SelectPresentMode(VkPhysicalDevice physDev) const;
+  void CollectDisplayTimings();
+
   VkSwapchainKHR m_swapchain;
   VkSurfaceKHR m_surface;
   VkInstance m_vkInstance;
@@ -36,7 +96,20 @@ private:
   VkSurfaceFormatKHR m_selectFormat;
   VkExtent2D m_surfaceExtent;
   VkPresentModeKHR  m_presentMode;
+  VkPresentModeKHR  m_requestPresentMode;
+  uint32_t m_requestImageCount;
 
   std::vector<VkImage> m_images;
   std::vector<VkImageView> m_imageViews;
+
+  DeferredDeletionQueue* m_deletionQueue;
+
+  bool m_isDisplayTimingEnabled;
+  PFN_vkVoidFunction m_getPastPresentationTiming; // vkGetPastPresentationTimingGOOGLE.
+  uint32_t m_nextPresentId;
+  std::vector<uint64_t> m_acquireTimes;   // C[WƂɎ擾.
+  std::deque<PendingPresent> m_pendingPresents; // \̓͂ĂȂ.
+  std::deque<PresentTiming> m_presentTimings;
+  LatencyStatistics m_latency;
+  double m_refreshDurationMs;
 };
\ No newline at end of file
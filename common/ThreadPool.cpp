@@ -0,0 +1,50 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount) : m_stop(false)
+{
+  if (threadCount == 0)
+  {
+    auto hardwareThreads = std::thread::hardware_concurrency();
+    threadCount = (std::max)(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+  }
+  m_threads.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; ++i)
+  {
+    m_threads.emplace_back([this]() { WorkerMain(); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  for (auto& t : m_threads)
+  {
+    t.join();
+  }
+}
+
+void ThreadPool::WorkerMain()
+{
+  for (;;)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+      // ~ς܂Ă^XN͏ĂI.
+      if (m_tasks.empty())
+      {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
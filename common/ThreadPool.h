@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+// Œ萔̃[J[XbhŃ^XN.
+class ThreadPool
+{
+public:
+  // threadCount  0 ̏ꍇ̓n[hEFAXbh - 1 (Œ1) Ƃ.
+  explicit ThreadPool(uint32_t threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  template<class Func>
+  auto Submit(Func&& func) -> std::future<decltype(func())>
+  {
+    using ResultType = decltype(func());
+    auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+    auto future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_tasks.emplace_back([task]() { (*task)(); });
+    }
+    m_condition.notify_one();
+    return future;
+  }
+
+  uint32_t GetThreadCount() const { return uint32_t(m_threads.size()); }
+private:
+  void WorkerMain();
+
+  std::vector<std::thread> m_threads;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stop;
+};
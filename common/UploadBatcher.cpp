@@ -0,0 +1,316 @@
+#include "UploadBatcher.h"
+#include "VulkanBookUtil.h"
+
+#include <cstring>
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// C[W̃Rs[ItZbg̓eNZTCY 4 ̔{łKv.
+static const VkDeviceSize StagingAlignment = 16;
+
+UploadBatcher::UploadBatcher(VkDevice device, VkQueue queue, uint32_t queueFamilyIndex, DeviceMemoryAllocator& allocator, VkDeviceSize ringSize)
+  : m_device(device), m_queue(queue), m_commandPool(VK_NULL_HANDLE), m_allocator(allocator),
+  m_ringSize(AlignUp(ringSize, StagingAlignment)), m_ringHead(0), m_ringTail(0),
+  m_nextToken(1), m_lastSubmitted(0), m_completed(0), m_submitCount(0)
+{
+  VkCommandPoolCreateInfo cmdPoolCI{
+    VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+    nullptr,
+    VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+    queueFamilyIndex
+  };
+  auto result = vkCreateCommandPool(m_device, &cmdPoolCI, nullptr, &m_commandPool);
+  ThrowIfFailed(result, "vkCreateCommandPool Failed.");
+
+  m_ring = CreateStagingBuffer(m_ringSize);
+}
+
+UploadBatcher::~UploadBatcher()
+{
+  WaitIdle();
+  for (auto& batch : m_freeBatches)
+  {
+    vkDestroyFence(m_device, batch->fence, nullptr);
+  }
+  m_freeBatches.clear();
+  DestroyStagingBuffer(m_ring);
+  // R}hobt@̓v[ƈꏏɉ.
+  vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+}
+
+UploadBatcher::Token UploadBatcher::UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  VkBuffer src;
+  VkDeviceSize srcOffset;
+  void* mapped;
+  AllocateStaging(size, &src, &srcOffset, &mapped);
+  memcpy(mapped, data, size_t(size));
+
+  auto& batch = BeginBatch();
+  VkBufferCopy region{ srcOffset, dstOffset, size };
+  vkCmdCopyBuffer(batch.command, src, dst, 1, &region);
+  return batch.token;
+}
+
+UploadBatcher::Token UploadBatcher::UploadImage(VkImage dst, const VkBufferImageCopy& region, const void* data, VkDeviceSize size, VkImageLayout finalLayout)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  VkBuffer src;
+  VkDeviceSize srcOffset;
+  void* mapped;
+  AllocateStaging(size, &src, &srcOffset, &mapped);
+  memcpy(mapped, data, size_t(size));
+
+  auto& batch = BeginBatch();
+  const auto& subresource = region.imageSubresource;
+  VkImageMemoryBarrier imb{
+    VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, nullptr,
+    0, VK_ACCESS_TRANSFER_WRITE_BIT,
+    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+    dst,
+    { subresource.aspectMask, subresource.mipLevel, 1, subresource.baseArrayLayer, subresource.layerCount }
+  };
+  vkCmdPipelineBarrier(batch.command,
+    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+    0, 0, nullptr,
+    0, nullptr, 1, &imb);
+
+  auto copyRegion = region;
+  copyRegion.bufferOffset = srcOffset;
+  vkCmdCopyBufferToImage(batch.command,
+    src, dst,
+    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+  imb.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  imb.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  imb.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  imb.newLayout = finalLayout;
+  vkCmdPipelineBarrier(batch.command,
+    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+    0, 0, nullptr,
+    0, nullptr, 1, &imb);
+  return batch.token;
+}
+
+UploadBatcher::Token UploadBatcher::Submit()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return SubmitLocked();
+}
+
+bool UploadBatcher::IsComplete(Token token)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  RetireBatches(false);
+  return token <= m_completed;
+}
+
+void UploadBatcher::Wait(Token token)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_recording && token >= m_recording->token)
+  {
+    SubmitLocked();
+  }
+  RetireBatches(false);
+  while (m_completed < token && !m_inFlight.empty())
+  {
+    RetireBatches(true);
+  }
+}
+
+void UploadBatcher::WaitIdle()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  SubmitLocked();
+  while (!m_inFlight.empty())
+  {
+    RetireBatches(true);
+  }
+}
+
+UploadBatcher::StagingBuffer UploadBatcher::CreateStagingBuffer(VkDeviceSize size)
+{
+  StagingBuffer staging;
+  VkBufferCreateInfo bufferCI{
+    VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+    nullptr, 0,
+    size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_SHARING_MODE_EXCLUSIVE,
+    0, nullptr
+  };
+  auto result = vkCreateBuffer(m_device, &bufferCI, nullptr, &staging.buffer);
+  ThrowIfFailed(result, "vkCreateBuffer Failed.");
+
+  VkMemoryRequirements reqs;
+  vkGetBufferMemoryRequirements(m_device, staging.buffer, &reqs);
+  auto memoryType = m_allocator.FindMemoryTypeIndex(reqs.memoryTypeBits,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  staging.allocation = m_allocator.Allocate(reqs, memoryType, DeviceMemoryAllocator::ResourceType::Linear);
+  result = vkBindBufferMemory(m_device, staging.buffer, staging.allocation.memory, staging.allocation.offset);
+  ThrowIfFailed(result, "vkBindBufferMemory Failed.");
+  return staging;
+}
+
+void UploadBatcher::DestroyStagingBuffer(const StagingBuffer& staging)
+{
+  vkDestroyBuffer(m_device, staging.buffer, nullptr);
+  m_allocator.Free(staging.allocation);
+}
+
+void UploadBatcher::AllocateStaging(VkDeviceSize size, VkBuffer* pBuffer, VkDeviceSize* pOffset, void** pMapped)
+{
+  // OɎ܂Ȃ̂͐p̃obt@pӂAob`ɔj.
+  if (size > m_ringSize)
+  {
+    auto staging = CreateStagingBuffer(size);
+    BeginBatch().largeBuffers.push_back(staging);
+    *pBuffer = staging.buffer;
+    *pOffset = 0;
+    *pMapped = staging.allocation.mapped;
+    return;
+  }
+
+  for (;;)
+  {
+    if (!m_recording && m_inFlight.empty())
+    {
+      // gp̗̈悪̂Ő擪g.
+      m_ringHead = m_ringTail = 0;
+    }
+    auto pos = AlignUp(m_ringHead, StagingAlignment);
+    if ((pos % m_ringSize) + size > m_ringSize)
+    {
+      // Ɏ܂Ȃꍇ͐܂Ԃ.
+      pos = AlignUp(pos, m_ringSize);
+    }
+    if (pos + size - m_ringTail <= m_ringSize)
+    {
+      m_ringHead = pos + size;
+      *pBuffer = m_ring.buffer;
+      *pOffset = pos % m_ringSize;
+      *pMapped = static_cast<char*>(m_ring.allocation.mapped) + *pOffset;
+      return;
+    }
+
+    // 󂫂̂ŋL^̂̂𑗐MČÂob`̊҂.
+    if (m_recording)
+    {
+      SubmitLocked();
+    }
+    RetireBatches(true);
+  }
+}
+
+UploadBatcher::Batch& UploadBatcher::BeginBatch()
+{
+  if (m_recording)
+  {
+    return *m_recording;
+  }
+
+  if (!m_freeBatches.empty())
+  {
+    m_recording = std::move(m_freeBatches.back());
+    m_freeBatches.pop_back();
+    vkResetCommandBuffer(m_recording->command, 0);
+    vkResetFences(m_device, 1, &m_recording->fence);
+  }
+  else
+  {
+    m_recording = std::make_unique<Batch>();
+    VkCommandBufferAllocateInfo commandAI{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      nullptr, m_commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      1
+    };
+    auto result = vkAllocateCommandBuffers(m_device, &commandAI, &m_recording->command);
+    ThrowIfFailed(result, "vkAllocateCommandBuffers Failed.");
+    VkFenceCreateInfo fenceCI{
+      VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+      nullptr, 0
+    };
+    result = vkCreateFence(m_device, &fenceCI, nullptr, &m_recording->fence);
+    ThrowIfFailed(result, "vkCreateFence Failed.");
+  }
+  m_recording->token = m_nextToken++;
+  m_recording->ringEnd = 0;
+
+  VkCommandBufferBeginInfo beginInfo{
+    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    nullptr,
+    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    nullptr
+  };
+  vkBeginCommandBuffer(m_recording->command, &beginInfo);
+  return *m_recording;
+}
+
+UploadBatcher::Token UploadBatcher::SubmitLocked()
+{
+  if (!m_recording)
+  {
+    return m_lastSubmitted;
+  }
+  auto& batch = *m_recording;
+
+  // ȍ~̃Tu~bgœ]ʂQƂł悤ɂ.
+  VkMemoryBarrier barrier{
+    VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+    VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT
+  };
+  vkCmdPipelineBarrier(batch.command,
+    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+    0, 1, &barrier,
+    0, nullptr, 0, nullptr);
+  auto result = vkEndCommandBuffer(batch.command);
+  ThrowIfFailed(result, "vkEndCommandBuffer Failed.");
+
+  VkSubmitInfo submitInfo{
+    VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    nullptr,
+    0, nullptr,
+    nullptr,
+    1, &batch.command,
+    0, nullptr,
+  };
+  result = vkQueueSubmit(m_queue, 1, &submitInfo, batch.fence);
+  ThrowIfFailed(result, "vkQueueSubmit Failed.");
+
+  batch.ringEnd = m_ringHead;
+  m_lastSubmitted = batch.token;
+  m_submitCount++;
+  m_inFlight.push_back(std::move(m_recording));
+  return m_lastSubmitted;
+}
+
+void UploadBatcher::RetireBatches(bool waitOldest)
+{
+  while (!m_inFlight.empty())
+  {
+    auto& batch = m_inFlight.front();
+    if (waitOldest)
+    {
+      vkWaitForFences(m_device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+      waitOldest = false;
+    }
+    else if (vkGetFenceStatus(m_device, batch->fence) != VK_SUCCESS)
+    {
+      break;
+    }
+    m_completed = batch->token;
+    m_ringTail = batch->ringEnd;
+    for (auto& staging : batch->largeBuffers)
+    {
+      DestroyStagingBuffer(staging);
+    }
+    batch->largeBuffers.clear();
+    m_freeBatches.push_back(std::move(batch));
+    m_inFlight.pop_front();
+  }
+}
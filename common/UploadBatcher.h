@@ -0,0 +1,85 @@
+#pragma once
+#include "DeviceMemoryAllocator.h"
+
+#include <deque>
+#include <vector>
+#include <mutex>
+
+// Xe[WOobt@̓]܂Ƃ߂1̃Tu~bgōs.
+// ]f[^̓Oobt@փRs[Aob`̗̈悩ėp.
+// e Upload Ăяo͂̃f[^܂ރob`̃g[NԂ.
+class UploadBatcher
+{
+public:
+  using Token = uint64_t;
+
+  UploadBatcher(VkDevice device, VkQueue queue, uint32_t queueFamilyIndex, DeviceMemoryAllocator& allocator, VkDeviceSize ringSize = DefaultRingSize);
+  ~UploadBatcher();
+
+  UploadBatcher(const UploadBatcher&) = delete;
+  UploadBatcher& operator=(const UploadBatcher&) = delete;
+
+  // obt@ւ̓]. dst  TRANSFER_DST ŐĂ邱.
+  Token UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+  // C[Wւ̓]. UNDEFINED  finalLayout ֑Jڂ.
+  // region.bufferOffset ͓Őݒ肳.
+  Token UploadImage(VkImage dst, const VkBufferImageCopy& region, const void* data, VkDeviceSize size,
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  // L^̃ob`𑗐M. L^ĂȂΒÕob`̃g[NԂ.
+  Token Submit();
+
+  bool IsComplete(Token token);
+  // token ̃ob`܂ő҂. MłΐɑM.
+  void Wait(Token token);
+  void WaitIdle();
+
+  Token GetLastSubmittedToken() const { return m_lastSubmitted; }
+  uint32_t GetSubmitCount() const { return m_submitCount; }
+
+  enum : VkDeviceSize
+  {
+    DefaultRingSize = 32 * 1024 * 1024,
+  };
+private:
+  struct StagingBuffer
+  {
+    VkBuffer buffer;
+    DeviceMemoryAllocator::Allocation allocation;
+  };
+  struct Batch
+  {
+    VkCommandBuffer command;
+    VkFence fence;
+    Token token;
+    VkDeviceSize ringEnd;
+    std::vector<StagingBuffer> largeBuffers; // OɎ܂Ȃf[^p.
+  };
+
+  StagingBuffer CreateStagingBuffer(VkDeviceSize size);
+  void DestroyStagingBuffer(const StagingBuffer& staging);
+  // O size oCgmۂAݐ̃obt@ƃItZbgԂ.
+  void AllocateStaging(VkDeviceSize size, VkBuffer* pBuffer, VkDeviceSize* pOffset, void** pMapped);
+  Batch& BeginBatch();
+  Token SubmitLocked();
+  void RetireBatches(bool waitOldest);
+
+  VkDevice m_device;
+  VkQueue m_queue;
+  VkCommandPool m_commandPool;
+  DeviceMemoryAllocator& m_allocator;
+
+  StagingBuffer m_ring;
+  VkDeviceSize m_ringSize;
+  VkDeviceSize m_ringHead;  // ݈ʒu(P).
+  VkDeviceSize m_ringTail;  // GPU gp̐擪ʒu(P).
+
+  std::unique_ptr<Batch> m_recording;
+  std::deque<std::unique_ptr<Batch>> m_inFlight;
+  std::vector<std::unique_ptr<Batch>> m_freeBatches;
+  Token m_nextToken;
+  Token m_lastSubmitted;
+  Token m_completed;
+  uint32_t m_submitCount;
+  std::mutex m_mutex;
+};
@@ -27,7 +27,7 @@ static VkBool32 VKAPI_CALL DebugReportCallback(
   }
   ss << pMessage << std::endl;
 
-  OutputDebugStringA(ss.str().c_str());
+  book_util::OutputDebugMessage(ss.str().c_str());
 
   return ret;
 }
@@ -40,14 +40,23 @@ bool VulkanAppBase::OnSizeChanged(uint32_t width, uint32_t height)
   {
     return false;
   }
-  vkDeviceWaitIdle(m_device);
-
+  // `撆̃t[͑҂Ȃ. ÂXbv`FC oldSwapchain ƂēnA
+  // hNXō蒼\[XƋ m_deletionQueue  GPU gIĂj.
   auto format = m_swapchain->GetSurfaceFormat().format;
   // Xbv`FC蒼.
   m_swapchain->Prepare(m_physicalDevice, m_gfxQueueIndex, width, height, format);
   return true;
 }
 
+void VulkanAppBase::PollShaderChanges()
+{
+  // 蒼pCvČÂ̂͊eTvAgȂȂVF[_[W[ ShaderLibrary  m_deletionQueue Ŕj.
+  if (m_shaderLibrary)
+  {
+    m_shaderLibrary->PollChanges();
+  }
+}
+
 uint32_t VulkanAppBase::GetMemoryTypeIndex(uint32_t requestBits, VkMemoryPropertyFlags requestProps) const
 {
   uint32_t result = ~0u;
@@ -109,6 +118,64 @@ void VulkanAppBase::SwitchFullscreen(GLFWwindow* window)
 void VulkanAppBase::Initialize(GLFWwindow* window, VkFormat format, bool isFullscreen)
 {
   m_window = window;
+  InitializeDevice();
+
+  VkSurfaceKHR surface;
+  auto result = glfwCreateWindowSurface(m_vkInstance, window, nullptr, &surface);
+  ThrowIfFailed(result, "glfwCreateWindowSurface Failed.");
+
+  // Xbv`FC̐.
+  m_deletionQueue = std::make_unique<DeferredDeletionQueue>(m_device, m_deviceQueue);
+  m_swapchain = std::make_unique<Swapchain>(m_vkInstance, m_device, surface);
+  m_swapchain->SetDeletionQueue(m_deletionQueue.get());
+  m_swapchain->SetPresentMode(m_presentMode);
+  m_swapchain->SetImageCount(m_swapchainImageCount);
+  m_swapchain->SetDisplayTimingEnabled(m_isDisplayTimingEnabled);
+
+  int width, height;
+  glfwGetWindowSize(window, &width, &height);
+  m_swapchain->Prepare(
+    m_physicalDevice, m_gfxQueueIndex,
+    uint32_t(width), uint32_t(height),
+    format
+  );
+
+  InitializeResources();
+}
+
+void VulkanAppBase::InitializeHeadless(uint32_t width, uint32_t height, VkFormat format)
+{
+  m_window = nullptr;
+  m_isHeadless = true;
+  InitializeDevice();
+
+  // T[tF[X̑ɃItXN[̃C[Wg.
+  m_deletionQueue = std::make_unique<DeferredDeletionQueue>(m_device, m_deviceQueue);
+  m_swapchain = std::make_unique<HeadlessSwapchain>(m_device, m_deviceQueue);
+  m_swapchain->SetDeletionQueue(m_deletionQueue.get());
+  if (m_swapchainImageCount > 0)
+  {
+    m_swapchain->SetImageCount(m_swapchainImageCount);
+  }
+  m_swapchain->Prepare(
+    m_physicalDevice, m_gfxQueueIndex,
+    width, height,
+    format
+  );
+
+  InitializeResources();
+}
+
+void VulkanAppBase::SetHeadlessFrameCallback(HeadlessSwapchain::FrameCallback callback)
+{
+  if (m_isHeadless)
+  {
+    static_cast<HeadlessSwapchain*>(m_swapchain.get())->SetFrameCallback(callback);
+  }
+}
+
+void VulkanAppBase::InitializeDevice()
+{
   CreateInstance();
 
   // foCX̑I.
@@ -129,26 +196,15 @@ void VulkanAppBase::Initialize(GLFWwindow* window, VkFormat format, bool isFulls
   // _foCX̐.
   CreateDevice();
 
+  // obt@AC[Wp̃AP[^.
+  m_allocator = std::make_unique<DeviceMemoryAllocator>(m_device, m_physicalDevice);
+
   // R}hv[̐.
   CreateCommandPool();
+}
 
-  VkSurfaceKHR surface;
-  auto result = glfwCreateWindowSurface(m_vkInstance, window, nullptr, &surface);
-  ThrowIfFailed(result, "glfwCreateWindowSurface Failed.");
-
-  // Xbv`FC̐.
-  m_swapchain = std::make_unique<Swapchain>(m_vkInstance, m_device, surface);
-
-  int width, height;
-  glfwGetWindowSize(window, &width, &height);
-  m_swapchain->Prepare(
-    m_physicalDevice, m_gfxQueueIndex,
-    uint32_t(width), uint32_t(height),
-    format
-  );
-  auto imageCount = m_swapchain->GetImageCount();
-  auto extent = m_swapchain->GetSurfaceExtent();
-
+void VulkanAppBase::InitializeResources()
+{
   VkSemaphoreCreateInfo semCI{
     VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
     nullptr, 0,
@@ -164,7 +220,24 @@ void VulkanAppBase::Initialize(GLFWwindow* window, VkFormat format, bool isFulls
   m_descriptorSetLayoutStore = std::make_unique<DescriptorSetLayoutManager>([&](VkDescriptorSetLayout layout) { vkDestroyDescriptorSetLayout(m_device, layout, nullptr); });
   m_pipelineLayoutStore = std::make_unique<PipelineLayoutManager>([&](VkPipelineLayout layout) { vkDestroyPipelineLayout(m_device, layout, nullptr); });
 
+  m_uploadBatcher = std::make_unique<UploadBatcher>(m_device, m_deviceQueue, m_gfxQueueIndex, *m_allocator);
+  m_threadPool = std::make_unique<ThreadPool>();
+  m_framePacer = std::make_unique<FramePacer>(
+    m_device, m_physicalDevice, m_deviceQueue, m_gfxQueueIndex,
+    m_framesInFlight, m_isTimelineSemaphoreEnabled);
+  m_shaderLibrary = std::make_unique<ShaderLibrary>(m_device);
+  m_shaderLibrary->SetDeletionQueue(m_deletionQueue.get());
+  if (m_isShaderSourceCompileEnabled)
+  {
+    m_shaderLibrary->EnableSourceCompile("shader_cache");
+  }
+  m_pipelineManager = std::make_unique<PipelineManager>(
+    m_device, m_physicalDevice, m_threadPool.get(), m_pipelineCacheFile, m_pipelineCacheMode);
+
   Prepare();
+
+  // Prepare ɐς܂ꂽ]𑗐M.
+  m_uploadBatcher->Submit();
 }
 
 void VulkanAppBase::Terminate()
@@ -174,6 +247,17 @@ void VulkanAppBase::Terminate()
     vkDeviceWaitIdle(m_device);
   }
   Cleanup();
+  // ҋ@ς݂Ȃ̂Ŏc͑SĂŔj.
+  m_deletionQueue.reset();
+  if (m_pipelineManager)
+  {
+    // ̋NŃVF[_[̃RpCȂ悤ۑ.
+    m_pipelineManager->Save();
+    m_pipelineManager.reset();
+  }
+  m_shaderLibrary.reset();
+  m_framePacer.reset();
+  m_threadPool.reset();
   if (m_swapchain)
   {
     m_swapchain->Cleanup();
@@ -191,6 +275,9 @@ void VulkanAppBase::Terminate()
 
   vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
   vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+  m_uploadBatcher.reset();
+  m_allocator->Cleanup();
+  m_allocator.reset();
   vkDestroyDevice(m_device, nullptr);
   vkDestroyInstance(m_vkInstance, nullptr);
   m_commandPool = VK_NULL_HANDLE;
@@ -214,14 +301,14 @@ VulkanAppBase::BufferObject VulkanAppBase::CreateBuffer(uint32_t size, VkBufferU
   // ʂ̎Zo.
   VkMemoryRequirements reqs;
   vkGetBufferMemoryRequirements(m_device, obj.buffer, &reqs);
-  VkMemoryAllocateInfo info{
-    VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-    nullptr,
-    reqs.size,
-    GetMemoryTypeIndex(reqs.memoryTypeBits, props)
-  };
-  vkAllocateMemory(m_device, &info, nullptr, &obj.memory);
-  vkBindBufferMemory(m_device, obj.buffer, obj.memory, 0);
+  obj.allocation = m_allocator->Allocate(
+    reqs, GetMemoryTypeIndex(reqs.memoryTypeBits, props),
+    DeviceMemoryAllocator::ResourceType::Linear);
+  obj.memory = obj.allocation.memory;
+  obj.offset = obj.allocation.offset;
+  obj.mapped = obj.allocation.mapped;
+  result = vkBindBufferMemory(m_device, obj.buffer, obj.memory, obj.offset);
+  ThrowIfFailed(result, "vkBindBufferMemory Failed.");
   return obj;
 }
 
@@ -246,15 +333,13 @@ VulkanAppBase::ImageObject VulkanAppBase::CreateTexture(uint32_t width, uint32_t
   // ʂ̎Zo.
   VkMemoryRequirements reqs;
   vkGetImageMemoryRequirements(m_device, obj.image, &reqs);
-  VkMemoryAllocateInfo info{
-    VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-    nullptr,
-    reqs.size,
-    GetMemoryTypeIndex(reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-  };
-  result = vkAllocateMemory(m_device, &info, nullptr, &obj.memory);
-  ThrowIfFailed(result, "vkAllocateMemory Failed.");
-  vkBindImageMemory(m_device, obj.image, obj.memory, 0);
+  obj.allocation = m_allocator->Allocate(
+    reqs, GetMemoryTypeIndex(reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+    DeviceMemoryAllocator::ResourceType::Optimal);
+  obj.memory = obj.allocation.memory;
+  obj.offset = obj.allocation.offset;
+  result = vkBindImageMemory(m_device, obj.image, obj.memory, obj.offset);
+  ThrowIfFailed(result, "vkBindImageMemory Failed.");
 
   VkImageAspectFlags imageAspect = VK_IMAGE_ASPECT_COLOR_BIT;
   if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
@@ -279,13 +364,27 @@ VulkanAppBase::ImageObject VulkanAppBase::CreateTexture(uint32_t width, uint32_t
 void VulkanAppBase::DestroyBuffer(BufferObject bufferObj)
 {
   vkDestroyBuffer(m_device, bufferObj.buffer, nullptr);
-  vkFreeMemory(m_device, bufferObj.memory, nullptr);
+  if (bufferObj.allocation.block)
+  {
+    m_allocator->Free(bufferObj.allocation);
+  }
+  else
+  {
+    vkFreeMemory(m_device, bufferObj.memory, nullptr);
+  }
 }
 
 void VulkanAppBase::DestroyImage(ImageObject imageObj)
 {
   vkDestroyImage(m_device, imageObj.image, nullptr);
-  vkFreeMemory(m_device, imageObj.memory, nullptr);
+  if (imageObj.allocation.block)
+  {
+    m_allocator->Free(imageObj.allocation);
+  }
+  else
+  {
+    vkFreeMemory(m_device, imageObj.memory, nullptr);
+  }
   if (imageObj.view != VK_NULL_HANDLE)
   {
     vkDestroyImageView(m_device, imageObj.view, nullptr);
@@ -316,6 +415,30 @@ void VulkanAppBase::DestroyFramebuffers(uint32_t count, VkFramebuffer* framebuff
   }
 }
 
+void VulkanAppBase::DestroyBufferDeferred(BufferObject bufferObj)
+{
+  m_deletionQueue->Push([this, bufferObj]() { DestroyBuffer(bufferObj); });
+}
+
+void VulkanAppBase::DestroyImageDeferred(ImageObject imageObj)
+{
+  m_deletionQueue->Push([this, imageObj]() { DestroyImage(imageObj); });
+}
+
+void VulkanAppBase::DestroyFramebuffersDeferred(uint32_t count, VkFramebuffer* framebuffers)
+{
+  std::vector<VkFramebuffer> targets(framebuffers, framebuffers + count);
+  m_deletionQueue->Push([this, targets]() mutable {
+    DestroyFramebuffers(uint32_t(targets.size()), targets.data());
+  });
+}
+
+void VulkanAppBase::DestroyPipelineDeferred(VkPipeline pipeline)
+{
+  auto device = m_device;
+  m_deletionQueue->Push([device, pipeline]() { vkDestroyPipeline(device, pipeline, nullptr); });
+}
+
 VkCommandBuffer VulkanAppBase::CreateCommandBuffer()
 {
   VkCommandBufferAllocateInfo commandAI{
@@ -376,12 +499,31 @@ std::vector<VulkanAppBase::BufferObject> VulkanAppBase::CreateUniformBuffers(uin
   return buffers;
 }
 
-void VulkanAppBase::WriteToHostVisibleMemory(VkDeviceMemory memory, uint32_t size, const void* pData)
+void VulkanAppBase::WriteToHostVisibleMemory(const BufferObject& buffer, uint32_t size, const void* pData)
 {
+  // TuAP[Vꂽ̂͊mێ}bvς.
+  if (buffer.mapped)
+  {
+    memcpy(buffer.mapped, pData, size);
+    return;
+  }
   void* p;
-  vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &p);
+  vkMapMemory(m_device, buffer.memory, buffer.offset, VK_WHOLE_SIZE, 0, &p);
   memcpy(p, pData, size);
-  vkUnmapMemory(m_device, memory);
+  vkUnmapMemory(m_device, buffer.memory);
+}
+
+void VulkanAppBase::WriteToHostVisibleMemory(const BufferObject& buffer, uint32_t offset, uint32_t size, const void* pData)
+{
+  if (buffer.mapped)
+  {
+    memcpy(static_cast<char*>(buffer.mapped) + offset, pData, size);
+    return;
+  }
+  void* p;
+  vkMapMemory(m_device, buffer.memory, buffer.offset + offset, size, 0, &p);
+  memcpy(p, pData, size);
+  vkUnmapMemory(m_device, buffer.memory);
 }
 
 void VulkanAppBase::AllocateCommandBufferSecondary(uint32_t count, VkCommandBuffer* pCommands)
@@ -400,6 +542,14 @@ void VulkanAppBase::FreeCommandBufferSecondary(uint32_t count, VkCommandBuffer*
   vkFreeCommandBuffers(m_device, m_commandPool, count, pCommands);
 }
 
+void VulkanAppBase::FreeCommandBufferSecondaryDeferred(uint32_t count, VkCommandBuffer* pCommands)
+{
+  std::vector<VkCommandBuffer> commands(pCommands, pCommands + count);
+  m_deletionQueue->Push([this, commands]() mutable {
+    FreeCommandBufferSecondary(uint32_t(commands.size()), commands.data());
+  });
+}
+
 void VulkanAppBase::TransferStageBufferToImage(
   const BufferObject& srcBuffer, const ImageObject& dstImage, const VkBufferImageCopy* region)
 { 
@@ -517,6 +667,32 @@ void VulkanAppBase::CreateDevice()
     count, extensions.data(),
     nullptr
   };
+
+  // ^CCZ}tHɑΉĂΗLɂ (FramePacer Ŏgp).
+  m_isTimelineSemaphoreEnabled = false;
+#if defined(VK_KHR_timeline_semaphore)
+  VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{
+    VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR, nullptr, VK_FALSE
+  };
+  auto hasTimelineExtension = std::any_of(deviceExtensions.begin(), deviceExtensions.end(),
+    [](const VkExtensionProperties& v) { return strcmp(v.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0; });
+  if (hasTimelineExtension)
+  {
+    VkPhysicalDeviceFeatures2 features2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &timelineFeatures };
+    vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+    m_isTimelineSemaphoreEnabled = timelineFeatures.timelineSemaphore == VK_TRUE;
+  }
+  if (m_isTimelineSemaphoreEnabled)
+  {
+    deviceCI.pNext = &timelineFeatures;
+  }
+#endif
+  // 񋓂g͑SėLɂĂ̂ŁA\̎擾 (Swapchain ̒xvŎgp) ͑Ή̗LŌ܂.
+  m_isDisplayTimingEnabled = false;
+#if defined(VK_GOOGLE_display_timing)
+  m_isDisplayTimingEnabled = std::any_of(deviceExtensions.begin(), deviceExtensions.end(),
+    [](const VkExtensionProperties& v) { return strcmp(v.extensionName, VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME) == 0; });
+#endif
   auto result = vkCreateDevice(m_physicalDevice, &deviceCI, nullptr, &m_device);
   ThrowIfFailed(result, "vkCreateDevice Failed.");
 
@@ -541,6 +717,9 @@ void VulkanAppBase::CreateDescriptorPool()
   VkDescriptorPoolSize poolSize[] = {
     { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
     { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000 },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000 },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000 },
   };
   VkDescriptorPoolCreateInfo descPoolCI{
     VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
@@ -1,23 +1,43 @@
 #pragma once
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
 #define NOMINMAX
+#endif
 #include <windows.h>
+#endif
 
 #include <string>
+#include <cstring>
 #include <vector>
 #include <memory>
 #include <unordered_map>
 #include <functional>
+#include <algorithm>
 
+#if defined(_WIN32)
 #define VK_USE_PLATFORM_WIN32_KHR
-#define GLFW_INCLUDE_VULKAN
 #define GLFW_EXPOSE_NATIVE_WIN32
+#endif
+#define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
-#include <GLFW/glfw3native.h>
 #include <vulkan/vk_layer.h>
+#if defined(_WIN32)
+#include <GLFW/glfw3native.h>
 #include <vulkan/vulkan_win32.h>
+#endif
 
 #include "Swapchain.h"
+#include "HeadlessSwapchain.h"
+#include "DeviceMemoryAllocator.h"
+#include "UploadBatcher.h"
+#include "ThreadPool.h"
+#include "FramePacer.h"
+#include "DeferredDeletionQueue.h"
+#include "PipelineManager.h"
+#include "ShaderLibrary.h"
 
 template<class T>
 class VulkanObjectStore
@@ -48,7 +68,11 @@ private:
 
 class VulkanAppBase {
 public:
-  VulkanAppBase() :m_isMinimizedWindow(false), m_isFullscreen(false) { }
+  VulkanAppBase() :m_isMinimizedWindow(false), m_isFullscreen(false), m_isHeadless(false), m_window(nullptr),
+    m_framesInFlight(2), m_isTimelineSemaphoreEnabled(false),
+    m_presentMode(VK_PRESENT_MODE_FIFO_KHR), m_swapchainImageCount(0), m_isDisplayTimingEnabled(false),
+    m_pipelineCacheMode(PipelineManager::CacheMode::Enabled), m_pipelineCacheFile("pipeline_cache.bin"),
+    m_isShaderSourceCompileEnabled(false) { }
   virtual ~VulkanAppBase() { }
 
   virtual bool OnSizeChanged(uint32_t width, uint32_t height);
@@ -60,14 +84,32 @@ public:
   void SwitchFullscreen(GLFWwindow* window);
 
   void Initialize(GLFWwindow* window, VkFormat format, bool isFullscreen);
+  // EBhEg킸ɃItXN[̃C[W֕`悷.
+  void InitializeHeadless(uint32_t width, uint32_t height, VkFormat format);
   void Terminate();
 
+  bool IsHeadless() const { return m_isHeadless; }
+  // Initialize OɌĂяo. GPU ̊҂ɋL^łt[ (1 ` FramePacer::MaxFramesInFlight).
+  void SetFramesInFlight(uint32_t count) { m_framesInFlight = count; }
+  // Initialize OɌĂяo. Xbv`FC̒񎦃[hƃC[W (0 ͊). ڍׂ Swapchain Q.
+  void SetPresentMode(VkPresentModeKHR mode) { m_presentMode = mode; }
+  void SetSwapchainImageCount(uint32_t count) { m_swapchainImageCount = count; }
+  // Initialize OɌĂяo. pCvCLbṼt@C̈. ڍׂ PipelineManager Q.
+  void SetPipelineCacheMode(PipelineManager::CacheMode mode) { m_pipelineCacheMode = mode; }
+  // Initialize OɌĂяo. VF[_[ .spv ł͂Ȃ\[XsɃRpC. ڍׂ ShaderLibrary Q.
+  void SetShaderSourceCompileEnabled(bool enabled) { m_isShaderSourceCompileEnabled = enabled; }
+  // VF[_[̃t@C̍XV𒲂ׁAgĂpCvC蒼. C[v Render ̑OɌĂяo.
+  void PollShaderChanges();
+  // wbhXɓǂݖ߂t[󂯎.
+  void SetHeadlessFrameCallback(HeadlessSwapchain::FrameCallback callback);
+
   virtual void Render() = 0;
   virtual void Prepare() { }
   virtual void Cleanup() { }
 
   VkDescriptorPool GetDescriptorPool() const { return m_descriptorPool; }
   VkDevice GetDevice() { return m_device; }
+  VkPhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
   const Swapchain* GetSwapchain() const { return m_swapchain.get(); }
 
   VkPipelineLayout GetPipelineLayout(const std::string& name) { return m_pipelineLayoutStore->Get(name); }
@@ -77,16 +119,23 @@ public:
   void RegisterLayout(const std::string& name, VkPipelineLayout layout) { m_pipelineLayoutStore->Register(name, layout); }
   void RegisterLayout(const std::string& name, VkDescriptorSetLayout layout) { m_descriptorSetLayoutStore->Register(name, layout); }
   void RegisterRenderPass(const std::string& name, VkRenderPass renderPass) { m_renderPassStore->Register(name, renderPass); }
+  // memory/offset ̓TuAP[Vꂽ̈w.
+  // allocation.block ̏ꍇ vkAllocateMemory ŌʂɊmۂ.
   struct BufferObject
   {
     VkBuffer buffer;
     VkDeviceMemory memory;
+    VkDeviceSize offset = 0;
+    void* mapped = nullptr;
+    DeviceMemoryAllocator::Allocation allocation;
   };
   struct ImageObject
   {
     VkImage image;
     VkDeviceMemory memory;
     VkImageView view;
+    VkDeviceSize offset = 0;
+    DeviceMemoryAllocator::Allocation allocation;
   };
 
   BufferObject CreateBuffer(uint32_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props);
@@ -95,6 +144,12 @@ public:
   void DestroyBuffer(BufferObject bufferObj);
   void DestroyImage(ImageObject imageObj);
   void DestroyFramebuffers(uint32_t count, VkFramebuffer* framebuffers);
+  // `撆̃t[gĂ\̂̂́AGPU gIĂj.
+  // EBhETCY̕ύXɍ킹蒼ȂǂŎg.
+  void DestroyBufferDeferred(BufferObject bufferObj);
+  void DestroyImageDeferred(ImageObject imageObj);
+  void DestroyFramebuffersDeferred(uint32_t count, VkFramebuffer* framebuffers);
+  void DestroyPipelineDeferred(VkPipeline pipeline);
 
   VkCommandBuffer CreateCommandBuffer();
   void FinishCommandBuffer(VkCommandBuffer command);
@@ -106,13 +161,32 @@ public:
   // zXg猩郁̈Ƀf[^.ȉobt@ΏۂɎgp.
   // - Xe[WOobt@
   // - jtH[obt@
-  void WriteToHostVisibleMemory(VkDeviceMemory memory, uint32_t size, const void* pData);
+  void WriteToHostVisibleMemory(const BufferObject& buffer, uint32_t size, const void* pData);
+  // obt@̐擪 offset oCg̈ʒu֏.
+  void WriteToHostVisibleMemory(const BufferObject& buffer, uint32_t offset, uint32_t size, const void* pData);
 
   void AllocateCommandBufferSecondary(uint32_t count, VkCommandBuffer* pCommands);
   void FreeCommandBufferSecondary(uint32_t count, VkCommandBuffer* pCommands);
+  void FreeCommandBufferSecondaryDeferred(uint32_t count, VkCommandBuffer* pCommands);
 
   void TransferStageBufferToImage(const BufferObject& srcBuffer, const ImageObject& dstImage, const VkBufferImageCopy* region);
+
+  const DeviceMemoryAllocator* GetMemoryAllocator() const { return m_allocator.get(); }
+  // Xe[WOoR̓]܂Ƃ߂čs. Prepare ɋL^ꂽ͎̂őMȂ Submit ĂԂ.
+  UploadBatcher* GetUploadBatcher() { return m_uploadBatcher.get(); }
+  // ǂݍݏȂǂɍs߂̃[J[.
+  ThreadPool* GetThreadPool() { return m_threadPool.get(); }
+  // t[Ƃ̓ƃR}hobt@. Prepare ̎_Őς.
+  FramePacer* GetFramePacer() { return m_framePacer.get(); }
+  // GPU gIĂ̔j. Xbv`FC̃C[W擾Ƃɉ.
+  DeferredDeletionQueue* GetDeletionQueue() { return m_deletionQueue.get(); }
+  // pCvC̐. Prepare ̎_őOۑLbVǂݍݍς.
+  PipelineManager* GetPipelineManager() { return m_pipelineManager.get(); }
+  // VF[_[W[̓ǂݍ. ẽW[͋LAj Terminate ōs.
+  ShaderLibrary* GetShaderLibrary() { return m_shaderLibrary.get(); }
 private:
+  void InitializeDevice();
+  void InitializeResources();
   void CreateInstance();
   void SelectGraphicsQueue();
   void CreateDevice();
@@ -148,8 +222,24 @@ protected:
 
   bool m_isMinimizedWindow;
   bool m_isFullscreen;
+  bool m_isHeadless;
   std::unique_ptr<Swapchain> m_swapchain;
   GLFWwindow* m_window;
+  std::unique_ptr<DeviceMemoryAllocator> m_allocator;
+  std::unique_ptr<UploadBatcher> m_uploadBatcher;
+  std::unique_ptr<ThreadPool> m_threadPool;
+  uint32_t m_framesInFlight;
+  bool m_isTimelineSemaphoreEnabled;
+  std::unique_ptr<FramePacer> m_framePacer;
+  std::unique_ptr<DeferredDeletionQueue> m_deletionQueue;
+  VkPresentModeKHR m_presentMode;
+  uint32_t m_swapchainImageCount;
+  bool m_isDisplayTimingEnabled;
+  std::unique_ptr<PipelineManager> m_pipelineManager;
+  PipelineManager::CacheMode m_pipelineCacheMode;
+  std::string m_pipelineCacheFile;
+  std::unique_ptr<ShaderLibrary> m_shaderLibrary;
+  bool m_isShaderSourceCompileEnabled;
 
   using RenderPassRegistry = VulkanObjectStore<VkRenderPass>;
   using PipelineLayoutManager = VulkanObjectStore<VkPipelineLayout>;
@@ -1,18 +1,34 @@
 #pragma once
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 
+#include <cstdio>
+
 #include <fstream>
 #include <stdexcept>
 #include <functional>
 #include <vector>
 #include <array>
+#include <chrono>
 
 #define STRINGFY(s)  #s
 #define TO_STRING(x) STRINGFY(x)
 #define FILE_PREFIX __FILE__ "(" TO_STRING(__LINE__) "): " 
 #define ThrowIfFailed(code, msg) book_util::CheckResultCodeVk(code, FILE_PREFIX msg)
 
+#ifndef _countof
+#define _countof(a) (sizeof(a) / sizeof((a)[0]))
+#endif
+
 namespace book_util
 {
   class VulkanException : public std::runtime_error
@@ -31,6 +47,43 @@ namespace book_util
     }
   }
 
+  // fobOo. Windows ȊOł͕WG[o͂֏o.
+  inline void OutputDebugMessage(const char* msg)
+  {
+#if defined(_WIN32)
+    OutputDebugStringA(msg);
+#else
+    fputs(msg, stderr);
+#endif
+  }
+
+  // Ԍvp.
+  class StopWatch
+  {
+  public:
+    StopWatch() : m_start(std::chrono::high_resolution_clock::now()) { }
+    void Reset() { m_start = std::chrono::high_resolution_clock::now(); }
+    double GetElapsedMs() const
+    {
+      auto elapsed = std::chrono::high_resolution_clock::now() - m_start;
+      return std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+  private:
+    std::chrono::high_resolution_clock::time_point m_start;
+  };
+
+  // FNV-1a (64bit). Ǒʂ hash ɓnƑ̃f[^Ƃč.
+  inline uint64_t ComputeHash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+  {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
   template<class T, class U>
   void SafeDestroy(T& handle, U func)
   {
@@ -338,14 +391,15 @@ namespace book_util
     };
   }
   inline VkWriteDescriptorSet CreateWriteDescriptorSet(
-    VkDescriptorSet descriptorSet, uint32_t dstBinding, const VkDescriptorBufferInfo* pUboInfo)
+    VkDescriptorSet descriptorSet, uint32_t dstBinding, const VkDescriptorBufferInfo* pUboInfo,
+    VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
   {
     return VkWriteDescriptorSet{
       VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
       nullptr,
       descriptorSet,
       dstBinding, 0,
-      1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+      1, type,
       nullptr, pUboInfo, nullptr
     };
   }
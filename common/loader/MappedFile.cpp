@@ -0,0 +1,107 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace loader
+{
+#if defined(_WIN32)
+  MappedFile::MappedFile(const char* fileName)
+    : m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+  {
+    m_file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+      return;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+    {
+      close();
+      return;
+    }
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr)
+    {
+      close();
+      return;
+    }
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = m_data ? size_t(fileSize.QuadPart) : 0;
+  }
+
+  void MappedFile::close()
+  {
+    if (m_data)
+    {
+      UnmapViewOfFile(m_data);
+    }
+    if (m_mapping)
+    {
+      CloseHandle(m_mapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(m_file);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+  }
+#else
+  MappedFile::MappedFile(const char* fileName)
+    : m_data(nullptr), m_size(0), m_fd(-1)
+  {
+    m_fd = open(fileName, O_RDONLY);
+    if (m_fd < 0)
+    {
+      return;
+    }
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || st.st_size == 0)
+    {
+      close();
+      return;
+    }
+    auto p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (p == MAP_FAILED)
+    {
+      close();
+      return;
+    }
+    // 擪珇ɓǂނ̂Őǂ݂𑣂.
+    madvise(p, size_t(st.st_size), MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(p);
+    m_size = size_t(st.st_size);
+  }
+
+  void MappedFile::close()
+  {
+    if (m_data)
+    {
+      munmap(const_cast<char*>(m_data), m_size);
+    }
+    if (m_fd >= 0)
+    {
+      ::close(m_fd);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_fd = -1;
+  }
+#endif
+
+  MappedFile::~MappedFile()
+  {
+    close();
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+namespace loader
+{
+    // t@CŜǂݍݐpŃɃ}bv.
+    class MappedFile
+    {
+    public:
+        MappedFile(const char* fileName);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool isOpen() const { return m_data != nullptr; }
+        const char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+    private:
+        void close();
+
+        const char* m_data;
+        size_t m_size;
+#if defined(_WIN32)
+        void* m_file;
+        void* m_mapping;
+#else
+        int m_fd;
+#endif
+    };
+}
@@ -0,0 +1,416 @@
+#include "MotionCache.h"
+#include "MappedFile.h"
+#include "PMDloader.h"
+#include "VulkanBookUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+
+namespace loader
+{
+  namespace motioncache
+  {
+    // L[͍Đ̍\̂ւ̂܂ܓǂݑւ̂ŁACAEgŒ肷.
+    static_assert(sizeof(Header) == 88, "motion cache header layout");
+    static_assert(sizeof(Curve) == 4, "motion cache curve layout");
+    static_assert(sizeof(Track) == 40, "motion cache track layout");
+    static_assert(sizeof(NodeKey) == 48, "motion cache node key layout");
+    static_assert(sizeof(NodeKeyQuantized) == 28, "motion cache quantized node key layout");
+    static_assert(sizeof(MorphKey) == 8, "motion cache morph key layout");
+
+    uint32_t computeModelSignature(const std::vector<std::string>& boneNames, const std::vector<std::string>& morphNames)
+    {
+      // Ő؂܂߂čAтςĂlς悤ɂ.
+      const uint8_t nameEnd = 0xFF, listEnd = 0xFE;
+      auto hash = book_util::ComputeHash(nullptr, 0);
+      auto mix = [&hash, nameEnd](const std::string& s) {
+        hash = book_util::ComputeHash(s.data(), s.size(), hash);
+        hash = book_util::ComputeHash(&nameEnd, 1, hash);
+      };
+      for (const auto& name : boneNames)
+      {
+        mix(name);
+      }
+      hash = book_util::ComputeHash(&listEnd, 1, hash);
+      for (const auto& name : morphNames)
+      {
+        mix(name);
+      }
+      return uint32_t(hash ^ (hash >> 32));
+    }
+
+    bool getFileStamp(const char* fileName, uint64_t& size, int64_t& time)
+    {
+#if defined(_WIN32)
+      struct _stat64 st;
+      if (_stat64(fileName, &st) != 0)
+      {
+        return false;
+      }
+#else
+      struct stat st;
+      if (stat(fileName, &st) != 0)
+      {
+        return false;
+      }
+#endif
+      size = uint64_t(st.st_size);
+      time = int64_t(st.st_mtime);
+      return true;
+    }
+
+    std::string getCachePath(const std::string& directory, const std::string& sourceFile)
+    {
+      auto pos = sourceFile.find_last_of("/\\");
+      auto name = (pos == std::string::npos) ? sourceFile : sourceFile.substr(pos + 1);
+      return directory + "/" + name + ".cache";
+    }
+
+    void createDirectory(const std::string& directory)
+    {
+#if defined(_WIN32)
+      _mkdir(directory.c_str());
+#else
+      mkdir(directory.c_str(), 0755);
+#endif
+    }
+
+    namespace
+    {
+      uint32_t alignUp(size_t value)
+      {
+        return uint32_t((value + 3) & ~size_t(3));
+      }
+
+      uint8_t toControlPoint(float v)
+      {
+        return uint8_t(std::lround(std::min(std::max(v, 0.0f), 1.0f) * 127.0f));
+      }
+
+      // BezierCurveTable::Register ƓKŔԍU.
+      //  0, ȊO͏o 1 .
+      class CurveRegistry
+      {
+      public:
+        uint32_t add(const vec4& bezier)
+        {
+          Curve c{ toControlPoint(bezier.x), toControlPoint(bezier.y), toControlPoint(bezier.z), toControlPoint(bezier.w) };
+          if (c.x1 == c.y1 && c.x2 == c.y2)
+          {
+            return 0;
+          }
+          uint32_t key = uint32_t(c.x1) | (uint32_t(c.y1) << 8) | (uint32_t(c.x2) << 16) | (uint32_t(c.y2) << 24);
+          auto itr = m_lookup.find(key);
+          if (itr != m_lookup.end())
+          {
+            return itr->second;
+          }
+          m_curves.push_back(c);
+          auto id = uint32_t(m_curves.size());
+          m_lookup[key] = id;
+          return id;
+        }
+        const std::vector<Curve>& getCurves() const { return m_curves; }
+      private:
+        std::vector<Curve> m_curves;
+        std::unordered_map<uint32_t, uint32_t> m_lookup;
+      };
+
+      uint32_t findIndex(const std::vector<std::string>* names, const std::string& name)
+      {
+        if (names == nullptr)
+        {
+          return NoIndex;
+        }
+        auto itr = std::find(names->begin(), names->end(), name);
+        return itr != names->end() ? uint32_t(itr - names->begin()) : uint32_t(NoIndex);
+      }
+
+      template<class T>
+      void writeSection(std::ofstream& os, const std::vector<T>& data)
+      {
+        if (!data.empty())
+        {
+          os.write(reinterpret_cast<const char*>(data.data()), std::streamsize(sizeof(T) * data.size()));
+        }
+        static const char zero[4] = {};
+        auto size = sizeof(T) * data.size();
+        os.write(zero, std::streamsize(alignUp(size) - size));
+      }
+    }
+
+    bool cook(VMDFile& vmd, const char* fileName, const CookOptions& options)
+    {
+      // 擪͋󕶎ɂĂAgbNĂZNVɂȂ.
+      std::vector<char> strings(1, '\0');
+      auto addString = [&strings](const std::string& s) {
+        auto offset = uint32_t(strings.size());
+        strings.insert(strings.end(), s.begin(), s.end());
+        strings.push_back('\0');
+        return offset;
+      };
+      bool resolve = options.boneNames != nullptr && options.morphNames != nullptr;
+
+      // {[̃gbN VMDFile ŖOɕł.
+      CurveRegistry curves;
+      std::vector<Track> tracks;
+      std::vector<NodeKey> nodeKeys;
+      for (uint32_t i = 0; i < vmd.getNodeCount(); ++i)
+      {
+        const auto& name = vmd.getNodeName(i);
+        auto frames = vmd.getKeyframes(name);
+        Track track{};
+        track.nameOffset = addString(name);
+        track.firstKey = uint32_t(nodeKeys.size());
+        track.keyCount = uint32_t(frames.size());
+        track.resolvedIndex = resolve ? findIndex(options.boneNames, name) : uint32_t(NoIndex);
+        for (const auto& src : frames)
+        {
+          NodeKey key;
+          key.frame = src.getKeyframeNumber();
+          const auto& t = src.getLocation();
+          const auto& r = src.getRotation();
+          key.translation[0] = t.x; key.translation[1] = t.y; key.translation[2] = t.z;
+          key.rotation[0] = r.x; key.rotation[1] = r.y; key.rotation[2] = r.z; key.rotation[3] = r.w;
+          for (int c = 0; c < 4; ++c)
+          {
+            key.curves[c] = curves.add(src.getBezierParam(c));
+          }
+          nodeKeys.push_back(key);
+        }
+        tracks.push_back(track);
+      }
+      auto nodeTrackCount = uint32_t(tracks.size());
+
+      std::vector<std::string> morphNames;
+      for (uint32_t i = 0; i < vmd.getMorphCount(); ++i)
+      {
+        morphNames.push_back(vmd.getMorphName(i));
+      }
+      std::sort(morphNames.begin(), morphNames.end());
+      std::vector<MorphKey> morphKeys;
+      for (const auto& name : morphNames)
+      {
+        auto frames = vmd.getMorphKeyframes(name);
+        Track track{};
+        track.nameOffset = addString(name);
+        track.firstKey = uint32_t(morphKeys.size());
+        track.keyCount = uint32_t(frames.size());
+        track.resolvedIndex = resolve ? findIndex(options.morphNames, name) : uint32_t(NoIndex);
+        for (const auto& src : frames)
+        {
+          morphKeys.push_back(MorphKey{ src.getKeyframeNumber(), src.getWeight() });
+        }
+        tracks.push_back(track);
+      }
+
+      bool quantize = options.quantize && curves.getCurves().size() <= 0xFFFFu;
+      std::vector<NodeKeyQuantized> quantizedKeys;
+      if (quantize)
+      {
+        for (uint32_t i = 0; i < nodeTrackCount; ++i)
+        {
+          auto& track = tracks[i];
+          auto first = nodeKeys.begin() + track.firstKey;
+          auto last = first + track.keyCount;
+          for (int c = 0; c < 3; ++c)
+          {
+            auto range = std::minmax_element(first, last,
+              [c](const NodeKey& a, const NodeKey& b) { return a.translation[c] < b.translation[c]; });
+            track.translationMin[c] = range.first->translation[c];
+            track.translationScale[c] = (range.second->translation[c] - range.first->translation[c]) / 65535.0f;
+          }
+          for (auto itr = first; itr != last; ++itr)
+          {
+            NodeKeyQuantized key{};
+            key.frame = itr->frame;
+            for (int c = 0; c < 3; ++c)
+            {
+              auto scale = track.translationScale[c];
+              auto q = scale > 0.0f ? std::lround((itr->translation[c] - track.translationMin[c]) / scale) : 0;
+              key.translation[c] = uint16_t(std::min(std::max(q, 0L), 65535L));
+            }
+            for (int c = 0; c < 4; ++c)
+            {
+              key.rotation[c] = int16_t(std::lround(std::min(std::max(itr->rotation[c], -1.0f), 1.0f) * 32767.0f));
+              key.curves[c] = uint16_t(itr->curves[c]);
+            }
+            quantizedKeys.push_back(key);
+          }
+        }
+      }
+
+      Header header{};
+      header.magic = Magic;
+      header.version = Version;
+      header.flags = (quantize ? FlagQuantized : 0) | (resolve ? FlagResolved : 0);
+      header.sourceSize = options.sourceSize;
+      header.sourceTime = options.sourceTime;
+      header.frameCount = vmd.getKeyframeCount();
+      header.modelSignature = resolve ? computeModelSignature(*options.boneNames, *options.morphNames) : 0;
+      header.curveCount = uint32_t(curves.getCurves().size());
+      header.nodeTrackCount = nodeTrackCount;
+      header.morphTrackCount = uint32_t(tracks.size()) - nodeTrackCount;
+      header.nodeKeyCount = uint32_t(nodeKeys.size());
+      header.morphKeyCount = uint32_t(morphKeys.size());
+      header.curveOffset = alignUp(sizeof(Header));
+      header.trackOffset = header.curveOffset + alignUp(sizeof(Curve) * curves.getCurves().size());
+      header.nodeKeyOffset = header.trackOffset + alignUp(sizeof(Track) * tracks.size());
+      auto nodeKeySize = quantize ? sizeof(NodeKeyQuantized) * quantizedKeys.size() : sizeof(NodeKey) * nodeKeys.size();
+      header.morphKeyOffset = header.nodeKeyOffset + alignUp(nodeKeySize);
+      header.stringOffset = header.morphKeyOffset + alignUp(sizeof(MorphKey) * morphKeys.size());
+      header.stringSize = uint32_t(strings.size());
+      header.fileSize = header.stringOffset + alignUp(strings.size());
+
+      std::ofstream os(fileName, std::ios::binary | std::ios::trunc);
+      if (!os)
+      {
+        return false;
+      }
+      os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      writeSection(os, curves.getCurves());
+      writeSection(os, tracks);
+      if (quantize)
+      {
+        writeSection(os, quantizedKeys);
+      }
+      else
+      {
+        writeSection(os, nodeKeys);
+      }
+      writeSection(os, morphKeys);
+      writeSection(os, strings);
+      return bool(os);
+    }
+  }
+
+  MotionCache::MotionCache(const char* fileName)
+    : m_file(new MappedFile(fileName)), m_header(nullptr), m_curves(nullptr), m_tracks(nullptr),
+    m_nodeKeys(nullptr), m_morphKeys(nullptr), m_strings(nullptr)
+  {
+    if (!validate())
+    {
+      m_header = nullptr;
+      m_file.reset();
+    }
+  }
+
+  MotionCache::~MotionCache()
+  {
+  }
+
+  bool MotionCache::validate()
+  {
+    using namespace motioncache;
+    if (!m_file->isOpen() || m_file->size() < sizeof(Header))
+    {
+      return false;
+    }
+    auto base = m_file->data();
+    m_header = reinterpret_cast<const Header*>(base);
+    const auto& h = *m_header;
+    if (h.magic != Magic || h.version != Version || h.fileSize != m_file->size())
+    {
+      return false;
+    }
+    // eZNVt@CɎ܂A4 oCgEɂ邱.
+    auto inRange = [&h](uint32_t offset, uint64_t count, size_t elementSize) {
+      return (offset & 3) == 0 && offset >= sizeof(Header) && uint64_t(offset) + count * elementSize <= h.fileSize;
+    };
+    auto nodeKeySize = (h.flags & FlagQuantized) ? sizeof(NodeKeyQuantized) : sizeof(NodeKey);
+    auto trackCount = uint64_t(h.nodeTrackCount) + h.morphTrackCount;
+    if (!inRange(h.curveOffset, h.curveCount, sizeof(Curve)) ||
+      !inRange(h.trackOffset, trackCount, sizeof(Track)) ||
+      !inRange(h.nodeKeyOffset, h.nodeKeyCount, nodeKeySize) ||
+      !inRange(h.morphKeyOffset, h.morphKeyCount, sizeof(MorphKey)) ||
+      !inRange(h.stringOffset, h.stringSize, 1) ||
+      h.stringSize == 0 || base[h.stringOffset + h.stringSize - 1] != '\0')
+    {
+      return false;
+    }
+    m_curves = reinterpret_cast<const Curve*>(base + h.curveOffset);
+    m_tracks = reinterpret_cast<const Track*>(base + h.trackOffset);
+    m_nodeKeys = base + h.nodeKeyOffset;
+    m_morphKeys = reinterpret_cast<const MorphKey*>(base + h.morphKeyOffset);
+    m_strings = base + h.stringOffset;
+
+    // gbN̕\͏̂Ŕ͈͂܂ŊmF.
+    for (uint64_t i = 0; i < trackCount; ++i)
+    {
+      const auto& track = m_tracks[i];
+      auto keyCount = i < h.nodeTrackCount ? h.nodeKeyCount : h.morphKeyCount;
+      if (track.keyCount == 0 || uint64_t(track.firstKey) + track.keyCount > keyCount || track.nameOffset >= h.stringSize)
+      {
+        return false;
+      }
+    }
+
+    // ԋȐ̔ԍ 0 ()  1  curveCount ܂. ͈͊O̔ԍ BezierCurveTable ̊OQƂ̂ŁA
+    // L[̐ɔႷ邪SĊmF.
+    for (uint32_t i = 0; i < h.nodeKeyCount; ++i)
+    {
+      for (int c = 0; c < 4; ++c)
+      {
+        auto curve = (h.flags & FlagQuantized) ?
+          uint32_t(reinterpret_cast<const NodeKeyQuantized*>(m_nodeKeys)[i].curves[c]) :
+          reinterpret_cast<const NodeKey*>(m_nodeKeys)[i].curves[c];
+        if (curve > h.curveCount)
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool MotionCache::isUpToDate(const char* sourceFileName) const
+  {
+    uint64_t size;
+    int64_t time;
+    if (!isValid() || !motioncache::getFileStamp(sourceFileName, size, time))
+    {
+      return false;
+    }
+    return m_header->sourceSize == size && m_header->sourceTime == time;
+  }
+
+  void MotionCache::decodeNodeKeys(const motioncache::Track& track, motioncache::NodeKey* dst) const
+  {
+    if (!isQuantized())
+    {
+      std::memcpy(dst, getNodeKeys(track), sizeof(motioncache::NodeKey) * track.keyCount);
+      return;
+    }
+    auto src = reinterpret_cast<const motioncache::NodeKeyQuantized*>(m_nodeKeys) + track.firstKey;
+    for (uint32_t i = 0; i < track.keyCount; ++i, ++src, ++dst)
+    {
+      dst->frame = src->frame;
+      for (int c = 0; c < 3; ++c)
+      {
+        dst->translation[c] = track.translationMin[c] + src->translation[c] * track.translationScale[c];
+      }
+      float length = 0.0f;
+      for (int c = 0; c < 4; ++c)
+      {
+        dst->rotation[c] = src->rotation[c] / 32767.0f;
+        length += dst->rotation[c] * dst->rotation[c];
+      }
+      length = length > 0.0f ? 1.0f / std::sqrt(length) : 0.0f;
+      for (int c = 0; c < 4; ++c)
+      {
+        dst->rotation[c] *= length;
+        dst->curves[c] = src->curves[c];
+      }
+    }
+  }
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace loader
+{
+  class VMDFile;
+  class MappedFile;
+
+  // VMD Đp̌`ɕϊς݂̃[VLbV.
+  // ǂݍ݂̓t@C}bvăwb_؂邾ŁAL[t[̓}bv𒼐ڎQƂ.
+  //
+  // t@C̍\ (gGfBA. eZNV 4 oCgEɒu):
+  //   Header
+  //   Curve[curveCount]            ԋȐ̐_. BezierCurveTable ւ̏ɓo^ 1 ̔ԍɂȂ.
+  //   Track[nodeTrackCount]        {[̃gbN (O).
+  //   Track[morphTrackCount]       \̃gbN (O).
+  //   NodeKey ܂ NodeKeyQuantized [nodeKeyCount]   gbNƂɃt[.
+  //   MorphKey[morphKeyCount]
+  //    (NUL I[ Shift-JIS)
+  // L[͕ԋȐ̔ԍ͈͓̂݌؂̂ŁAȊO͓o[W̃NbJ[ōt@COƂ.
+  namespace motioncache
+  {
+    enum : uint32_t
+    {
+      Magic = 0x4843'4D56, // "VMCH"
+      Version = 2,
+
+      FlagQuantized = 1u << 0, // {[̃L[ NodeKeyQuantized Ŏ.
+      FlagResolved = 1u << 1,  // Track::resolvedIndex  modelSignature ̃f̔ԍ.
+
+      NoIndex = 0xFFFF'FFFFu,
+    };
+
+    struct Header
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint32_t flags;
+      uint32_t fileSize;
+      //  VMD ̃TCYƍXV. ǂݍݎɕϊ̔Ɏg.
+      uint64_t sourceSize;
+      int64_t  sourceTime;
+      uint32_t frameCount;   // Ō̃L[t[̔ԍ.
+      uint32_t modelSignature;
+      uint32_t curveCount;
+      uint32_t nodeTrackCount;
+      uint32_t morphTrackCount;
+      uint32_t nodeKeyCount;
+      uint32_t morphKeyCount;
+      uint32_t curveOffset;
+      uint32_t trackOffset;
+      uint32_t nodeKeyOffset;
+      uint32_t morphKeyOffset;
+      uint32_t stringOffset;
+      uint32_t stringSize;
+      uint32_t reserved;
+    };
+
+    struct Curve
+    {
+      uint8_t x1, y1, x2, y2;
+    };
+
+    struct Track
+    {
+      uint32_t nameOffset;    // ZNV̈ʒu.
+      uint32_t firstKey;
+      uint32_t keyCount;
+      uint32_t resolvedIndex; // {[E\̔ԍ. fɖ NoIndex.
+      // ʎqړʂ̕p (translation = min + q * scale).
+      float translationMin[3];
+      float translationScale[3];
+    };
+
+    // NodeAnimeFrame Ɠ.
+    struct NodeKey
+    {
+      uint32_t frame;
+      float translation[3];
+      float rotation[4];      // x, y, z, w
+      uint32_t curves[4];     // X, Y, Z, ]̕ԋȐ̔ԍ.
+    };
+
+    struct NodeKeyQuantized
+    {
+      uint32_t frame;
+      uint16_t translation[3];
+      int16_t  rotation[4];   // x, y, z, w  32767 {.
+      uint16_t curves[4];
+      uint16_t padding;
+    };
+
+    struct MorphKey
+    {
+      uint32_t frame;
+      float weight;
+    };
+
+    // {[ƕ\̕т̃nbV (book_util::ComputeHash  32bit ɏ񂾂). ς݂̔ԍfƈv邩̔Ɏg.
+    uint32_t computeModelSignature(const std::vector<std::string>& boneNames, const std::vector<std::string>& morphNames);
+    // t@C̃TCYƍXV擾.
+    bool getFileStamp(const char* fileName, uint64_t& size, int64_t& time);
+    // sourceFile ̃LbV directory ɒuꍇ̃pX (directory/t@C.cache).
+    // ̃t@C̉ɂ͏oȂ. directory  createDirectory ōĂ.
+    std::string getCachePath(const std::string& directory, const std::string& sourceFile);
+    void createDirectory(const std::string& directory);
+
+    struct CookOptions
+    {
+      bool quantize = false;
+      // w肷ƃgbÑf̃{[E\̔ԍ֌ѕtĕۑ.
+      // morphNames ͕\̔ԍ (base ).
+      const std::vector<std::string>* boneNames = nullptr;
+      const std::vector<std::string>* morphNames = nullptr;
+      //  VMD  getFileStamp ̒l.
+      uint64_t sourceSize = 0;
+      int64_t sourceTime = 0;
+    };
+
+    // VMD LbVt@C֏o.
+    // ԋȐ 65535 ނ𒴂ꍇ͗ʎqɏo.
+    bool cook(VMDFile& vmd, const char* fileName, const CookOptions& options);
+  }
+
+  // [VLbVǂݍݐpŃ}bv.
+  class MotionCache
+  {
+  public:
+    MotionCache(const char* fileName);
+    ~MotionCache();
+
+    MotionCache(const MotionCache&) = delete;
+    MotionCache& operator=(const MotionCache&) = delete;
+
+    // t@CJāAwb_ƊeZNV͈̔͂ true.
+    bool isValid() const { return m_header != nullptr; }
+    // sourceFileName ̃TCYƍXVϊƈv true.
+    bool isUpToDate(const char* sourceFileName) const;
+
+    const motioncache::Header& getHeader() const { return *m_header; }
+    uint32_t getFrameCount() const { return m_header->frameCount; }
+    bool isQuantized() const { return (m_header->flags & motioncache::FlagQuantized) != 0; }
+    bool isResolved() const { return (m_header->flags & motioncache::FlagResolved) != 0; }
+    uint32_t getModelSignature() const { return m_header->modelSignature; }
+
+    uint32_t getCurveCount() const { return m_header->curveCount; }
+    const motioncache::Curve& getCurve(uint32_t index) const { return m_curves[index]; }
+
+    uint32_t getNodeTrackCount() const { return m_header->nodeTrackCount; }
+    const motioncache::Track& getNodeTrack(uint32_t index) const { return m_tracks[index]; }
+    uint32_t getMorphTrackCount() const { return m_header->morphTrackCount; }
+    const motioncache::Track& getMorphTrack(uint32_t index) const { return m_tracks[m_header->nodeTrackCount + index]; }
+    const char* getName(const motioncache::Track& track) const { return m_strings + track.nameOffset; }
+
+    // ʎqĂȂꍇ̃{[̃L[.
+    const motioncache::NodeKey* getNodeKeys(const motioncache::Track& track) const
+    {
+      return reinterpret_cast<const motioncache::NodeKey*>(m_nodeKeys) + track.firstKey;
+    }
+    // {[̃L[ float ɖ߂ dst[track.keyCount] ֏o. ʎqĂȂΕ.
+    void decodeNodeKeys(const motioncache::Track& track, motioncache::NodeKey* dst) const;
+    const motioncache::MorphKey* getMorphKeys(const motioncache::Track& track) const { return m_morphKeys + track.firstKey; }
+
+  private:
+    bool validate();
+
+    std::unique_ptr<MappedFile> m_file;
+    const motioncache::Header* m_header;
+    const motioncache::Curve* m_curves;
+    const motioncache::Track* m_tracks;
+    const void* m_nodeKeys;
+    const motioncache::MorphKey* m_morphKeys;
+    const char* m_strings;
+  };
+}
@@ -1,6 +1,10 @@
 #include "PMDloader.h"
+#include "MappedFile.h"
 
-#include <pshpack1.h>
+#include <cstring>
+#include <stdexcept>
+
+#pragma pack(push, 1)
 namespace loader
 {
   namespace rawblock
@@ -83,9 +87,36 @@ namespace loader
     vec3 flipToRH(vec3 v) { return v; }
     vec4 flipToRH(vec4 v) { return v; }
 #endif
+
+    // }bv擪ǂݐi߂.
+    struct MemoryReader {
+      const char* ptr;
+      const char* end;
+
+      void require(size_t bytes) const
+      {
+        if (size_t(end - ptr) < bytes)
+        {
+          throw std::runtime_error("PMDFile: unexpected end of file.");
+        }
+      }
+      const char* skip(size_t bytes)
+      {
+        require(bytes);
+        auto p = ptr;
+        ptr += bytes;
+        return p;
+      }
+      template<class T> T read()
+      {
+        T v;
+        memcpy(&v, skip(sizeof(T)), sizeof(T));
+        return v;
+      }
+    };
   }
 }
-#include <poppack.h>
+#pragma pack(pop)
 
 namespace loader
 {
@@ -232,6 +263,7 @@ namespace loader
   }
 
   PMDFile::PMDFile(std::istream& is)
+    : m_rawVertices(nullptr), m_rawIndices(nullptr)
   {
     rawblock::PMDHeader header;
     is.read(reinterpret_cast<char*>(&header), sizeof(header));
@@ -241,10 +273,12 @@ namespace loader
     m_comment = header.comment;
 
     auto vertexCount = rawblock::readUint32(is);
+    m_vertexCount = vertexCount;
     m_vertices.resize(vertexCount);
     std::for_each(m_vertices.begin(), m_vertices.end(), [&](auto & v) { v.load(is); });
 
     auto indexCount = rawblock::readUint32(is);
+    m_indexCount = indexCount;
     m_indices.reserve(indexCount);
     auto polygonCount = indexCount / 3;
     for (uint32_t i = 0; i < polygonCount; ++i)
@@ -278,6 +312,153 @@ namespace loader
     m_faces.resize(faceCount);
     std::for_each(m_faces.begin(), m_faces.end(), [&](auto & v) {v.load(is); });
 
+    loadExtensions(is);
+  }
+
+  PMDFile::PMDFile(const MappedFile& file)
+  {
+    if (!file.isOpen())
+    {
+      throw std::runtime_error("PMDFile: file is not opened.");
+    }
+    rawblock::MemoryReader reader{ file.data(), file.data() + file.size() };
+
+    auto header = reader.read<rawblock::PMDHeader>();
+    m_version = header.version;
+    m_name.assign(header.name, strnlen(header.name, sizeof(header.name)));
+    m_comment.assign(header.comment, strnlen(header.comment, sizeof(header.comment)));
+
+    // _ECfbNX͈ʒuL^āAWJ decodeVertices/decodeIndices ōs.
+    m_vertexCount = reader.read<uint32_t>();
+    m_rawVertices = reader.skip(size_t(m_vertexCount) * sizeof(rawblock::PMDVertex));
+    m_indexCount = reader.read<uint32_t>();
+    m_rawIndices = reader.skip(size_t(m_indexCount) * sizeof(uint16_t));
+
+    // ̏ȂubN̓Xg[p̓ǂݍݏ𗬗p.
+    memorystream ms(const_cast<char*>(file.data()), file.size());
+    auto syncStream = [&]() { ms.seekg(reader.ptr - file.data(), std::ios::beg); };
+    auto syncReader = [&]() { reader.ptr = file.data() + size_t(ms.tellg()); };
+
+    syncStream();
+    auto materialCount = rawblock::readUint32(ms);
+    m_materials.resize(materialCount);
+    std::for_each(m_materials.begin(), m_materials.end(), [&](auto & v) { v.load(ms); });
+    syncReader();
+
+    // {[. Œ蒷R[h܂Ƃ߂ēWJ.
+    auto boneCount = reader.read<uint16_t>();
+    m_bones.resize(boneCount);
+    auto boneBlock = reader.skip(size_t(boneCount) * sizeof(rawblock::PMDBone));
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+      rawblock::PMDBone src;
+      memcpy(&src, boneBlock + i * sizeof(rawblock::PMDBone), sizeof(src));
+      auto& dst = m_bones[i];
+      dst.m_name.assign(src.name, strnlen(src.name, sizeof(src.name)));
+      dst.m_parent = src.parentBoneID;
+      dst.m_child = src.childBoneID;
+      dst.m_type = src.type;
+      dst.m_targetBone = src.targetBoneID;
+      dst.m_position = rawblock::flipToRH(src.position);
+    }
+
+    syncStream();
+    auto ikListCount = rawblock::readUint16(ms);
+    m_iks.resize(ikListCount);
+    std::for_each(m_iks.begin(), m_iks.end(), [&](auto & v) {v.load(ms); });
+    syncReader();
+
+    // \[t. e\̒_ubN܂Ƃ߂ēWJ.
+    auto faceCount = reader.read<uint16_t>();
+    m_faces.resize(faceCount);
+    for (auto& face : m_faces)
+    {
+      auto name = reader.skip(20);
+      face.m_name.assign(name, strnlen(name, 20));
+      face.m_numVertices = reader.read<uint32_t>();
+      face.m_faceType = PMDFace::FaceType(reader.read<uint8_t>());
+
+      const size_t recordSize = sizeof(uint32_t) + sizeof(vec3);
+      auto block = reader.skip(face.m_numVertices * recordSize);
+      face.m_faceIndices.resize(face.m_numVertices);
+      face.m_faceVertices.resize(face.m_numVertices);
+      for (uint32_t i = 0; i < face.m_numVertices; ++i)
+      {
+        auto record = block + i * recordSize;
+        vec3 pos;
+        memcpy(&face.m_faceIndices[i], record, sizeof(uint32_t));
+        memcpy(&pos, record + sizeof(uint32_t), sizeof(vec3));
+        face.m_faceVertices[i] = rawblock::flipToRH(pos);
+      }
+    }
+
+    syncStream();
+    loadExtensions(ms);
+  }
+
+  void PMDFile::decodeVertices(void* dst, const PMDVertexLayout& layout) const
+  {
+    auto out = static_cast<char*>(dst);
+    auto write = [&](char* base, const vec3& position, const vec3& normal, const vec2& uv, uint16_t bone0, uint16_t bone1, uint8_t weight, uint8_t edge)
+    {
+      uint32_t boneIndices[2] = { bone0, bone1 };
+      float boneWeights[2] = { weight / 100.0f, (100 - weight) / 100.0f };
+      uint32_t edgeFlag = edge;
+      memcpy(base + layout.position, &position, sizeof(position));
+      memcpy(base + layout.normal, &normal, sizeof(normal));
+      memcpy(base + layout.uv, &uv, sizeof(uv));
+      memcpy(base + layout.boneIndices, boneIndices, sizeof(boneIndices));
+      memcpy(base + layout.boneWeights, boneWeights, sizeof(boneWeights));
+      memcpy(base + layout.edgeFlag, &edgeFlag, sizeof(edgeFlag));
+    };
+
+    if (m_rawVertices == nullptr)
+    {
+      for (uint32_t i = 0; i < m_vertexCount; ++i, out += layout.stride)
+      {
+        const auto& v = m_vertices[i];
+        write(out, v.m_position, v.m_normal, v.m_uv, v.m_boneNum[0], v.m_boneNum[1], v.m_boneWeight, v.m_edgeFlag);
+      }
+      return;
+    }
+
+    auto src = m_rawVertices;
+    for (uint32_t i = 0; i < m_vertexCount; ++i, out += layout.stride, src += sizeof(rawblock::PMDVertex))
+    {
+      rawblock::PMDVertex v;
+      memcpy(&v, src, sizeof(v));
+      write(out, rawblock::flipToRH(v.position), rawblock::flipToRH(v.normal), v.uv, v.boneID[0], v.boneID[1], v.boneWeight, v.noEdgeFlag);
+    }
+  }
+
+  void PMDFile::decodeIndices(uint32_t* dst) const
+  {
+    if (m_rawIndices == nullptr)
+    {
+      std::copy(m_indices.begin(), m_indices.end(), dst);
+      return;
+    }
+
+    // Xg[ǂݍ݂ƓlɁAEnł͎Op`̊ւ.
+    auto polygonCount = m_indexCount / 3;
+    for (uint32_t i = 0; i < polygonCount; ++i)
+    {
+      uint16_t tri[3];
+      memcpy(tri, m_rawIndices + i * sizeof(tri), sizeof(tri));
+#ifndef USE_LEFTHAND
+      dst[3 * i + 0] = tri[0];
+      dst[3 * i + 1] = tri[2];
+      dst[3 * i + 2] = tri[1];
+#else
+      dst[3 * i + 0] = tri[0];
+      dst[3 * i + 1] = tri[1];
+      dst[3 * i + 2] = tri[2];
+#endif
+    }
+  }
+
+  void PMDFile::loadExtensions(std::istream& is)
+  {
     // \g. Skip
     auto faceDispCount = rawblock::readUint8(is);
     auto faceDispBlockBytes = faceDispCount * sizeof(uint16_t);
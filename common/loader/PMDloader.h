@@ -1,4 +1,4 @@
-﻿#pragma once
+#pragma once
 #include <iostream>
 #include <vector>
 #include <string>
@@ -15,6 +15,21 @@ namespace loader
 {
     using namespace glm;
 
+    class MappedFile;
+
+    // _WJ̃CAEg(evf̃ItZbg).
+    // p̒_\̂֒ڏނ߂Ɏgp.
+    struct PMDVertexLayout
+    {
+        size_t stride;
+        size_t position;    // vec3
+        size_t normal;      // vec3
+        size_t uv;          // vec2
+        size_t boneIndices; // uint32_t x2
+        size_t boneWeights; // float x2
+        size_t edgeFlag;    // uint32_t
+    };
+
     class PMDVertex
     {
     public:
@@ -115,10 +130,10 @@ namespace loader
         enum FaceType
         {
             BASE = 0,
-            EYEBROW,    /**< まゆ */
-            EYE,        /**< 目 */
-            LIP,        /**< リップ */
-            OTHER,      /**< その他 */
+            EYEBROW,    /**< ܂ */
+            EYE,        /**<  */
+            LIP,        /**< bv */
+            OTHER,      /**< ̑ */
         };
         std::string getName() const { return m_name; }
         FaceType getType() const { return m_faceType; }
@@ -147,9 +162,9 @@ namespace loader
             SHAPE_CAPSULE = 2,
         };
         enum RigidBodyType {
-            RIGID_BODY_BONE = 0, // ボーン追従.
-            RIGID_BODY_PHYSICS = 1, // 物理演算
-            RIGID_BODY_PHYSICS_BONE_CORRECT = 2, // 物理演算(ボーン位置合わせ)
+            RIGID_BODY_BONE = 0, // {[Ǐ].
+            RIGID_BODY_PHYSICS = 1, // Z
+            RIGID_BODY_PHYSICS_BONE_CORRECT = 2, // Z({[ʒu킹)
         };
 
     private:
@@ -192,14 +207,18 @@ namespace loader
     class PMDFile
     {
     public:
-        PMDFile() {} 
+        PMDFile() : m_vertexCount(0), m_indexCount(0), m_rawVertices(nullptr), m_rawIndices(nullptr) {} 
         PMDFile(std::istream& is);
 
+        // }bvt@Cǂݍ.
+        // _ECfbNX͓WJɎQƂێ邽߁A file ͂̃IuWFNg蒷ĂKv.
+        PMDFile(const MappedFile& file);
+
         const std::string& getName() const { return m_name; }
         const std::string& getComment() const { return m_comment; }
 
-        uint32_t getVertexCount() const { return uint32_t(m_vertices.size()); }
-        uint32_t getIndexCount() const { return uint32_t(m_indices.size()); }
+        uint32_t getVertexCount() const { return m_vertexCount; }
+        uint32_t getIndexCount() const { return m_indexCount; }
         uint32_t getMaterialCount() const { return uint32_t(m_materials.size()); }
         uint32_t getBoneCount() const { return uint32_t(m_bones.size()); }
         uint32_t getIkCount() const { return uint32_t(m_iks.size()); }
@@ -207,12 +226,19 @@ namespace loader
         uint32_t getRigidBodyCount() const { return uint32_t(m_rigidBodies.size()); }
         uint32_t getJointCount() const { return uint32_t(m_joints.size()); }
     
+        // ȉ̒_ECfbNX̌ʎ擾̓Xg[ǂݍ񂾏ꍇ̂ݗL.
         const PMDVertex& getVertex(int idx) const { return m_vertices[idx]; }
         const PMDVertex* getVertex() const { return m_vertices.data(); }
 
         uint16_t getIndices(int idx) const { return m_indices[idx]; }
         const uint16_t* getIndices() const { return m_indices.data(); }
 
+        // _ layout Ŏw肳` dst ֈꊇWJ.
+        void decodeVertices(void* dst, const PMDVertexLayout& layout) const;
+        // CfbNX 32bit Ɋg dst ֈꊇWJ.
+        void decodeIndices(uint32_t* dst) const;
+        bool isMapped() const { return m_rawVertices != nullptr; }
+
         const PMDMaterial& getMaterial(int idx) const { return m_materials[idx]; }
         const PMDBone& getBone(int idx) const { return m_bones[idx]; }
         const PMDIk& getIk(int idx) const { return m_iks[idx]; }
@@ -220,10 +246,17 @@ namespace loader
         const PMDFace& getFaceBase() const { auto itr = std::find_if(m_faces.begin(), m_faces.end(), [](const auto & v) { return v.getType() == PMDFace::BASE; }); return *itr; }
 
     private:
+        void loadExtensions(std::istream& is);
+
         float m_version;
         std::string m_name;
         std::string m_comment;
 
+        uint32_t m_vertexCount;
+        uint32_t m_indexCount;
+        const char* m_rawVertices;
+        const char* m_rawIndices;
+
         std::vector<PMDVertex> m_vertices;
         std::vector<uint16_t>  m_indices;
         std::vector<PMDMaterial> m_materials;